@@ -0,0 +1,109 @@
+/*
+  LICENSE
+  -------
+Copyright 2005 Nullsoft, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, 
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer. 
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution. 
+
+  * Neither the name of Nullsoft nor the names of its contributors may be used to 
+    endorse or promote products derived from this software without specific prior written permission. 
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include <windows.h>
+#include "audio_ring.h"
+
+C_AudioRing::frame C_AudioRing::m_frames[AUDIORING_SLOTS];
+volatile LONG C_AudioRing::m_write, C_AudioRing::m_read;
+int C_AudioRing::m_carrybeat;
+volatile LONG C_AudioRing::m_shown, C_AudioRing::m_skipped, C_AudioRing::m_dropped;
+
+// the other side's index. the interlocked op orders the slot accesses after
+// it, which a volatile read only does with /volatile:ms.
+static unsigned int ring_load(volatile LONG *p)
+{
+  return (unsigned int)InterlockedCompareExchange(p,0,0);
+}
+
+void C_AudioRing::reset()
+{
+  m_write=m_read=0;
+  m_carrybeat=0;
+  m_shown=m_skipped=m_dropped=0;
+}
+
+int C_AudioRing::write(char visdata[2][2][576], double time, int beat)
+{
+  unsigned int w=(unsigned int)m_write;
+  if (w-ring_load(&m_read) >= AUDIORING_SLOTS)
+  {
+    m_carrybeat|=beat;
+    InterlockedIncrement(&m_dropped);
+    return 0;
+  }
+  frame *f=m_frames+(w&(AUDIORING_SLOTS-1));
+  memcpy(f->visdata,visdata,sizeof(f->visdata));
+  f->time=time;
+  f->beat=beat|m_carrybeat;
+  m_carrybeat=0;
+  InterlockedExchange(&m_write,(LONG)(w+1));
+  return 1;
+}
+
+int C_AudioRing::read(double due, char visdata[2][2][576], int *beat, double *time)
+{
+  unsigned int r=(unsigned int)m_read, w=ring_load(&m_write), i, take;
+
+  // times only go up, so the frames that are due come first
+  for (take=r; take != w && m_frames[take&(AUDIORING_SLOTS-1)].time <= due; take ++);
+  if (take == r) return 0;
+  take--;
+
+  frame *f=m_frames+(take&(AUDIORING_SLOTS-1));
+  memcpy(visdata,f->visdata,sizeof(f->visdata));
+  *beat=f->beat;
+  *time=f->time;
+  for (i = r; i != take; i ++)
+  {
+    frame *s=m_frames+(i&(AUDIORING_SLOTS-1));
+    unsigned char *d=(unsigned char *)visdata[0][0], *p=(unsigned char *)s->visdata[0][0];
+    int x;
+    for (x = 0; x < 576*2; x ++) if (d[x] < p[x]) d[x]=p[x];
+    *beat|=s->beat;
+  }
+  InterlockedExchange(&m_read,(LONG)(take+1));
+  InterlockedIncrement(&m_shown);
+  InterlockedExchangeAdd(&m_skipped,(LONG)(take-r));
+  return 1;
+}
+
+int C_AudioRing::report(char *buf, int buflen)
+{
+  char line[256];
+  int l;
+  if (buflen < 1) return 0;
+  buf[0]=0;
+  if (!m_shown && !m_dropped) return 0;
+  wsprintf(line,"audio frames: %d shown, %d skipped, %d dropped\r\n",m_shown,m_skipped,m_dropped);
+  l=min(lstrlen(line),buflen-1);
+  memcpy(buf,line,l);
+  buf[l]=0;
+  return l;
+}
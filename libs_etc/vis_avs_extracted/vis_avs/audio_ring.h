@@ -0,0 +1,78 @@
+/*
+  LICENSE
+  -------
+Copyright 2005 Nullsoft, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, 
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer. 
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution. 
+
+  * Neither the name of Nullsoft nor the names of its contributors may be used to 
+    endorse or promote products derived from this software without specific prior written permission. 
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef _AUDIO_RING_H_
+#define _AUDIO_RING_H_
+
+// Audio frames from the vis callback to the render thread.
+//
+// A single-producer/single-consumer ring: the vis callback write()s every
+// frame it gets, stamped with when it came in, and the render thread read()s
+// the newest one that's due by the time its frame will be shown. Neither side
+// ever waits for the other. Each index is only written by its own side, and
+// a slot is only reused after the reader has moved past it.
+//
+// Frames the renderer skips over still count: their beats carry into the
+// frame it takes, and their spectrum peaks are held, the same as when the
+// callback used to pile frames into one buffer between renders. If the
+// renderer falls a whole ring behind, the callback drops new frames (beats
+// still carry) until there is room again.
+
+#define AUDIORING_SLOTS 64 // a power of 2, ~0.9s at the usual 70 frames/sec
+
+class C_AudioRing
+{
+  public:
+    static void reset(); // only with neither side running
+
+    // vis callback. returns 0 if the frame was dropped.
+    static int write(char visdata[2][2][576], double time, int beat);
+
+    // render thread: takes the newest frame that came in by time due and
+    // everything before it. returns 0, leaving visdata alone, if none did.
+    static int read(double due, char visdata[2][2][576], int *beat, double *time);
+
+    // frames shown/skipped/dropped. returns the length written.
+    static int report(char *buf, int buflen);
+
+  protected:
+    typedef struct
+    {
+      double time;
+      int beat;
+      char visdata[2][2][576];
+    } frame;
+
+    static frame m_frames[AUDIORING_SLOTS];
+    static volatile LONG m_write, m_read; // frames written/read so far, slot is &(AUDIORING_SLOTS-1)
+    static int m_carrybeat; // from dropped frames, writer only
+    static volatile LONG m_shown, m_skipped, m_dropped;
+};
+
+#endif//_AUDIO_RING_H_
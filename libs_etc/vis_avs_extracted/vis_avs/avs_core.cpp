@@ -0,0 +1,140 @@
+/*
+  LICENSE
+  -------
+Copyright 2005 Nullsoft, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, 
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer. 
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution. 
+
+  * Neither the name of Nullsoft nor the names of its contributors may be used to 
+    endorse or promote products derived from this software without specific prior written permission. 
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include <windows.h>
+#include "render.h"
+#include "avs_core.h"
+#include "fb_arena.h"
+#include "profiler.h"
+
+static int g_core_inited;
+
+// the OS calls the core itself makes, so a port only has to replace these.
+// the render list and the effects have their own.
+static void core_lockInit() { InitializeCriticalSection(&g_render_cs); }
+static void core_lockQuit() { DeleteCriticalSection(&g_render_cs); }
+static void core_lock() { EnterCriticalSection(&g_render_cs); }
+static void core_unlock() { LeaveCriticalSection(&g_render_cs); }
+
+int AVS_Core_Init()
+{
+  if (g_core_inited) return 0;
+
+  core_lockInit();
+  AVS_EEL_IF_init();
+  Render_InitBlendTable();
+
+  // load_config() goes through the library to create effects, so it has to
+  // exist before any preset is loaded.
+  if (!g_render_library) g_render_library=new C_RLibrary();
+
+  g_core_inited=1;
+  return 0;
+}
+
+void AVS_Core_Quit()
+{
+  if (!g_core_inited) return;
+
+  if (g_render_library) delete g_render_library;
+  g_render_library=NULL;
+
+  freeGlobalBuffers();
+  C_RenderListClass::smp_cleanupthreads();
+  C_FBArena::shutdown();
+  AVS_EEL_IF_quit();
+  core_lockQuit();
+
+  g_core_inited=0;
+}
+
+C_AvsCore::C_AvsCore()
+{
+  m_list=new C_RenderListClass(1);
+  m_fb[0]=m_fb[1]=NULL;
+  m_w=m_h=0;
+  m_s=0;
+}
+
+C_AvsCore::~C_AvsCore()
+{
+  delete m_list;
+  if (m_fb[0]) C_FBArena::free(m_fb[0]);
+  if (m_fb[1]) C_FBArena::free(m_fb[1]);
+}
+
+int C_AvsCore::loadPreset(char *filename)
+{
+  int r=m_list->__LoadPreset(filename,1);
+  reset();
+  return r;
+}
+
+void C_AvsCore::reset()
+{
+  if (m_fb[0]) memset(m_fb[0],0,m_w*m_h*sizeof(int));
+  if (m_fb[1]) memset(m_fb[1],0,m_w*m_h*sizeof(int));
+  m_s=0;
+}
+
+int C_AvsCore::renderFrame(char visdata[2][2][576], int isBeat, double time, int *out, int w, int h)
+{
+  if (!out || w < 1 || h < 1) return 0;
+
+  if (w != m_w || h != m_h || !m_fb[0] || !m_fb[1])
+  {
+    if (m_fb[0]) C_FBArena::free(m_fb[0]);
+    if (m_fb[1]) C_FBArena::free(m_fb[1]);
+    m_fb[0]=(int*)C_FBArena::alloc(w*h*sizeof(int),"Core");
+    m_fb[1]=(int*)C_FBArena::alloc(w*h*sizeof(int),"Core");
+    m_w=w;
+    m_h=h;
+    m_s=0;
+    if (!m_fb[0] || !m_fb[1])
+    {
+      m_w=m_h=0;
+      return 0;
+    }
+  }
+
+  // gettime() is process wide, but only ever set while the frame holds the
+  // lock, so every core's scripts see their own time
+  C_Profiler::beginFrame();
+  core_lock();
+  AVS_EEL_IF_SetTime(time);
+  int t=m_list->render(visdata,isBeat,m_fb[m_s],m_fb[m_s^1],w,h);
+  AVS_EEL_IF_SetTime(-1.0);
+  core_unlock();
+  C_Profiler::endFrame();
+  C_FBArena::endFrame();
+  if (t&1) m_s^=1;
+
+  memcpy(out,m_fb[m_s],w*h*sizeof(int));
+  return t;
+}
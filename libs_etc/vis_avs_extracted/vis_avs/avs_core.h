@@ -0,0 +1,87 @@
+/*
+  LICENSE
+  -------
+Copyright 2005 Nullsoft, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, 
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer. 
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution. 
+
+  * Neither the name of Nullsoft nor the names of its contributors may be used to 
+    endorse or promote products derived from this software without specific prior written permission. 
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef _AVS_CORE_H_
+#define _AVS_CORE_H_
+
+// Headless render core.
+//
+// Drives a root effect list one frame at a time without a window, DirectDraw
+// or the wall clock, so presets can be rendered offline (farm renders,
+// benchmarks, regression captures). The caller owns the output buffer and
+// supplies the audio data, beat flag and script time for every frame.
+//
+// Typical use:
+//   AVS_Core_Init();
+//   C_AvsCore *c=new C_AvsCore();
+//   c->loadPreset("foo.avs");
+//   for (...) c->renderFrame(visdata,beat,t,out,w,h);
+//   delete c;
+//   AVS_Core_Quit();
+//
+// Do not mix with the plugin entry points in main.cpp: init() already sets
+// up everything AVS_Core_Init() does. Any number of cores can exist at once;
+// their frames take turns, each with its own time. AVS_Core_Quit() frees
+// the global buffers (Buffer Save) as well, after the cores are deleted.
+
+class C_RenderListClass;
+
+// one-time setup for hosts that don't go through init() in main.cpp.
+// returns 0 on success.
+int AVS_Core_Init();
+void AVS_Core_Quit();
+
+class C_AvsCore
+{
+  public:
+    C_AvsCore();
+    ~C_AvsCore();
+
+    // returns 0 on success (same convention as __LoadPreset)
+    int loadPreset(char *filename);
+
+    // renders one frame. visdata is [spectrum,waveform][channel][576] in the
+    // same layout the plugin feeds to the render list. time is seconds and
+    // is what gettime() returns to scripts. out receives w*h ARGB pixels.
+    // returns the render list's flags (see C_RenderListClass::render).
+    int renderFrame(char visdata[2][2][576], int isBeat, double time, int *out, int w, int h);
+
+    // clears the internal framebuffers, as if the preset was just loaded
+    void reset();
+
+    C_RenderListClass *getList() { return m_list; }
+
+  protected:
+    C_RenderListClass *m_list;
+    int *m_fb[2];
+    int m_w, m_h;
+    int m_s;
+};
+
+#endif//_AVS_CORE_H_
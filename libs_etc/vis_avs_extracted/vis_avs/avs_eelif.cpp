@@ -31,13 +31,16 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../ns-eel2/ns-eel-int.h"
 #include "../ns-eel2/ns-eel-addfuncs.h"
 #include "avs_eelif.h"
+#include "profiler.h"
 
 
 
 char last_error_string[1024];
 int g_log_errors;
-CRITICAL_SECTION g_eval_cs;
-static char *g_evallib_visdata;
+CRITICAL_SECTION g_eval_cs; // compiling and the code cache only, code runs without it
+static DWORD g_evallib_tls=TLS_OUT_OF_INDEXES; // visdata of the code this thread is running
+static double g_evallib_time;
+static int g_evallib_time_set;
 
 
 
@@ -82,14 +85,16 @@ static double NSEEL_CGEN_CALL getvis(unsigned char *visdata, int bc, int bw, int
 
 static double NSEEL_CGEN_CALL  getspec_(void *_this, double *band, double *bandw, double *chan)
 {
-  if (!g_evallib_visdata) return 0.0;
-  return getvis((unsigned char *)g_evallib_visdata,(int)(*band*576.0),(int)(*bandw*576.0),(int)(*chan+0.5),0)*0.5;
+  char *visdata=(char *)TlsGetValue(g_evallib_tls);
+  if (!visdata) return 0.0;
+  return getvis((unsigned char *)visdata,(int)(*band*576.0),(int)(*bandw*576.0),(int)(*chan+0.5),0)*0.5;
 }
 
 static double NSEEL_CGEN_CALL getosc_(void *_this, double *band, double *bandw, double *chan)
 {
-  if (!g_evallib_visdata) return 0.0;
-  return getvis((unsigned char *)g_evallib_visdata+576*2,(int)(*band*576.0),(int)(*bandw*576.0),(int)(*chan+0.5),128);
+  char *visdata=(char *)TlsGetValue(g_evallib_tls);
+  if (!visdata) return 0.0;
+  return getvis((unsigned char *)visdata+576*2,(int)(*band*576.0),(int)(*bandw*576.0),(int)(*chan+0.5),128);
 }
 
 static double NSEEL_CGEN_CALL gettime_(void *_this, double *sc)
@@ -108,6 +113,7 @@ static double NSEEL_CGEN_CALL gettime_(void *_this, double *sc)
     return pos / 1000.0;
   }
 
+  if (g_evallib_time_set) return g_evallib_time - *sc;
   return GetTickCount()/1000.0 - *sc;
 }
 
@@ -155,6 +161,7 @@ void NSEEL_HOSTSTUB_LeaveMutex()
 void AVS_EEL_IF_init()
 {
   InitializeCriticalSection(&g_eval_cs);
+  g_evallib_tls=TlsAlloc();
   NSEEL_init();
 
   // todo: check to see that parameter orders are correct
@@ -168,8 +175,10 @@ void AVS_EEL_IF_init()
 }
 void AVS_EEL_IF_quit()
 {
+  NSEEL_quit(); // flushes the code cache, under g_eval_cs
+  if (g_evallib_tls != TLS_OUT_OF_INDEXES) TlsFree(g_evallib_tls);
+  g_evallib_tls=TLS_OUT_OF_INDEXES;
   DeleteCriticalSection(&g_eval_cs);
-  NSEEL_quit();
 }
 
 static void movestringover(char *str, int amount)
@@ -193,7 +202,7 @@ NSEEL_CODEHANDLE AVS_EEL_IF_Compile(void *context, char *code)
 {
   NSEEL_CODEHANDLE ret;
   EnterCriticalSection(&g_eval_cs);
-  ret=NSEEL_code_compile((NSEEL_VMCTX)context,code,0);
+  ret=NSEEL_code_compile_cached((NSEEL_VMCTX)context,code,0);
   if (!ret)
   {
     if (g_log_errors)
@@ -214,18 +223,44 @@ NSEEL_CODEHANDLE AVS_EEL_IF_Compile(void *context, char *code)
   return ret;
 }
 
+// code runs without g_eval_cs, so any number of threads can run code at once
+// as long as no two of them run the same handle or share a VM's variables.
+// the visdata getosc()/getspec() see is per thread, and put back afterwards
+// for code run from inside other code (a list's code around its effects).
 void AVS_EEL_IF_Execute(NSEEL_CODEHANDLE handle, char visdata[2][2][576])
 {
   if (handle)
   {
-    EnterCriticalSection(&g_eval_cs);
-    g_evallib_visdata=(char*)visdata;
+    C_ProfileScope prof("EEL");
+    void *old=TlsGetValue(g_evallib_tls);
+    TlsSetValue(g_evallib_tls,visdata);
     NSEEL_code_execute((NSEEL_CODEHANDLE)handle);
-    g_evallib_visdata=NULL;
-    LeaveCriticalSection(&g_eval_cs);
+    TlsSetValue(g_evallib_tls,old);
   }
 }
 
+// runs handle once per point, see NSEEL_code_execute_batch(). visdata may be
+// NULL for code that has none (getosc()/getspec() return 0).
+void AVS_EEL_IF_ExecuteBatch(NSEEL_CODEHANDLE handle, char visdata[2][2][576], NSEEL_BATCHVAR *vars, int nvars, int n)
+{
+  if (handle)
+  {
+    C_ProfileScope prof("EEL");
+    void *old=TlsGetValue(g_evallib_tls);
+    TlsSetValue(g_evallib_tls,visdata);
+    NSEEL_code_execute_batch((NSEEL_CODEHANDLE)handle,vars,nvars,n);
+    TlsSetValue(g_evallib_tls,old);
+  }
+}
+
+
+// lets a host drive gettime() from its own clock (e.g. offline rendering).
+// pass a negative value to go back to GetTickCount().
+void AVS_EEL_IF_SetTime(double t)
+{
+  g_evallib_time_set = t >= 0.0;
+  g_evallib_time = g_evallib_time_set ? t : 0.0;
+}
 
 void AVS_EEL_IF_resetvars(NSEEL_VMCTX ctx)
 {
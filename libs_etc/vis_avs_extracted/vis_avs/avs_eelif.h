@@ -37,15 +37,18 @@ void AVS_EEL_IF_quit();
 
 NSEEL_CODEHANDLE AVS_EEL_IF_Compile(void *ctx, char *code);
 void AVS_EEL_IF_Execute(NSEEL_CODEHANDLE handle, char visdata[2][2][576]);
+void AVS_EEL_IF_ExecuteBatch(NSEEL_CODEHANDLE handle, char visdata[2][2][576], NSEEL_BATCHVAR *vars, int nvars, int n);
 void AVS_EEL_IF_resetvars(NSEEL_VMCTX ctx);
+void AVS_EEL_IF_SetTime(double t);
 #define AVS_EEL_IF_VM_free(x) NSEEL_VM_free(x)
 extern char last_error_string[1024];
 extern int g_log_errors;
-extern CRITICAL_SECTION g_eval_cs;
+extern CRITICAL_SECTION g_eval_cs; // held while compiling, not while running code
 
 // our old-style interface
 #define compileCode(exp) AVS_EEL_IF_Compile(AVS_EEL_CONTEXTNAME,(exp))
 #define executeCode(x,y) AVS_EEL_IF_Execute(x,y)
+#define executeCodeBatch(x,y,v,nv,n) AVS_EEL_IF_ExecuteBatch(x,y,v,nv,n)
 #define freeCode(h) NSEEL_code_free(h)
 #define resetVars(x) FIXME+++++++++
 #define registerVar(x) NSEEL_VM_regvar(AVS_EEL_CONTEXTNAME,(x))
@@ -0,0 +1,380 @@
+/*
+  LICENSE
+  -------
+Copyright 2005 Nullsoft, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, 
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer. 
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution. 
+
+  * Neither the name of Nullsoft nor the names of its contributors may be used to 
+    endorse or promote products derived from this software without specific prior written permission. 
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+// Effect benchmark / golden frame check.
+//
+// Runs every built-in effect and APE (default config) and optionally every
+// preset in a directory through the headless core (avs_core.cpp) with
+// synthetic, deterministic audio, at a few resolutions. For each run it
+// reports frames/sec, ns/pixel and a hash over every frame rendered, and
+// compares the hash against a golden file. Effects are keyed by their
+// MOD_NAME (APEs by their ID string), presets by file name, so the golden
+// file survives effects being added to or reordered in the library.
+//
+// The canned inputs live in bench\: presets\ holds a few presets that only
+// use built-in effects, avs_golden.txt the hashes they and the effects are
+// expected to give. Run it from the plugin dll, in this directory:
+//   rundll32 vis_avs.dll,AVS_Bench -golden bench\avs_golden.txt -presets bench\presets
+// and after an intended change in output, add -update and commit the file.
+// Options:
+//   -frames N          frames per run (default 60)
+//   -sizes WxH[,WxH]   resolutions (default 320x240,640x480,1280x720)
+//   -golden file       compare against (or with -update, write) this file.
+//                      runs missing from it count as mismatches, and a file
+//                      that is missing or has no hashes fails the whole run
+//   -update            rewrite the golden file from this run
+//   -presets dir       also run every .avs in dir
+//   -smp N             use N threads for SMP effects (default off, which
+//                      keeps the hashes independent of the core count)
+//   -out file          where the report goes (default avs_bench.txt)
+
+#include <windows.h>
+#include <stdio.h>
+#include <math.h>
+#include "render.h"
+#include "avs_core.h"
+#include "rng.h"
+#include "avs_eelif.h"
+
+#define BENCH_MAX_SIZES 8
+#define BENCH_MAX_GOLDEN 4096
+
+typedef struct
+{
+  char key[MAX_PATH];
+  int w, h, frames;
+  unsigned __int64 hash;
+  int seen;
+} benchGolden;
+
+static benchGolden *g_golden;
+static int g_golden_n;
+
+static void bench_visdata(char visdata[2][2][576], int frame)
+{
+  unsigned int seed=(unsigned int)frame*2654435761u+1;
+  int ch,x;
+  for (ch = 0; ch < 2; ch ++)
+  {
+    double level=0.6+0.4*sin(frame*0.07+ch*1.3);
+    for (x = 0; x < 576; x ++)
+    {
+      seed=seed*1664525+1013904223;
+      int s=(int)(255.0*level*exp(-x/140.0))+(int)((seed>>24)&31);
+      visdata[0][ch][x]=(char)(s > 255 ? 255 : s);
+
+      seed=seed*1664525+1013904223;
+      double a=sin(x*(0.045+0.013*ch)+frame*0.31)*90.0+sin(x*0.31+frame*0.05)*20.0;
+      visdata[1][ch][x]=(char)((int)a+(int)((seed>>28)&7)-4);
+    }
+  }
+}
+
+#define BENCH_HASH_INIT 14695981039346656037ui64
+
+// FNV-1a, continued from h so one hash covers all frames of a run
+static unsigned __int64 bench_hash(unsigned __int64 h, int *fb, int n)
+{
+  unsigned char *p=(unsigned char *)fb;
+  n*=sizeof(int);
+  while (n--)
+  {
+    h^=*p++;
+    h*=1099511628211ui64;
+  }
+  return h;
+}
+
+static benchGolden *bench_findgolden(char *key, int w, int h)
+{
+  int x;
+  for (x = 0; x < g_golden_n; x ++)
+    if (g_golden[x].w == w && g_golden[x].h == h && !strcmp(g_golden[x].key,key)) return g_golden+x;
+  return NULL;
+}
+
+// golden file: one "key<tab>WxH<tab>frames<tab>hash" per line
+static void bench_loadgolden(char *fn)
+{
+  char line[MAX_PATH+128];
+  FILE *fp=fopen(fn,"rt");
+  if (!fp) return;
+  while (fgets(line,sizeof(line),fp) && g_golden_n < BENCH_MAX_GOLDEN)
+  {
+    benchGolden *g=g_golden+g_golden_n;
+    char *key=strtok(line,"\t");
+    char *size=strtok(NULL,"\t");
+    char *frames=strtok(NULL,"\t");
+    char *hash=strtok(NULL,"\t\r\n");
+    if (!key || !size || !frames || !hash || key[0] == ';') continue;
+    lstrcpyn(g->key,key,sizeof(g->key));
+    if (sscanf(size,"%dx%d",&g->w,&g->h) != 2) continue;
+    g->frames=atoi(frames);
+    if (sscanf(hash,"%I64x",&g->hash) != 1) continue;
+    g->seen=0;
+    g_golden_n++;
+  }
+  fclose(fp);
+}
+
+static void bench_savegolden(char *fn)
+{
+  int x;
+  FILE *fp=fopen(fn,"wt");
+  if (!fp) return;
+  fprintf(fp,"; AVS golden frame hashes, written by AVS_Bench -update\n");
+  for (x = 0; x < g_golden_n; x ++)
+    fprintf(fp,"%s\t%dx%d\t%d\t%016I64x\n",g_golden[x].key,g_golden[x].w,g_golden[x].h,g_golden[x].frames,g_golden[x].hash);
+  fclose(fp);
+}
+
+// state that outlives a core: the global buffers, reg00-reg99 and gmem, and
+// the seeds of C_Rng and EEL rand(). call before creating each core so a run
+// doesn't depend on the ones before it.
+static void bench_resetglobals()
+{
+  int x;
+  for (x = 0; x < NBUF; x ++) getGlobalBuffer(0,0,x,0); // frees it
+  NSEEL_resetglobals();
+  C_Rng::setGlobalSeed(1);
+}
+
+// runs one configured core; returns 1 if it matched (or had no golden file)
+static int bench_run(FILE *out, C_AvsCore *core, char *key, char *desc, int w, int h, int frames, int update, int havegolden)
+{
+  static char visdata[2][2][576];
+  int *fb=(int *)GlobalAlloc(GPTR,w*h*sizeof(int));
+  if (!fb) return 0;
+
+  LARGE_INTEGER freq,t0,t1;
+  __int64 ticks=0;
+  unsigned __int64 hash=BENCH_HASH_INIT;
+  int x;
+  core->reset();
+  QueryPerformanceFrequency(&freq);
+  for (x = 0; x < frames; x ++)
+  {
+    bench_visdata(visdata,x);
+    QueryPerformanceCounter(&t0);
+    core->renderFrame(visdata,(x&15)==0,x/60.0,fb,w,h);
+    QueryPerformanceCounter(&t1);
+    ticks+=t1.QuadPart-t0.QuadPart;
+    hash=bench_hash(hash,fb,w*h);
+  }
+
+  double secs=(double)ticks/(double)freq.QuadPart;
+  double fps=secs > 0.0 ? frames/secs : 0.0;
+  double nspp=frames ? secs*1.0e9/((double)frames*w*h) : 0.0;
+  GlobalFree(fb);
+
+  char *status="new";
+  int ok=1;
+  benchGolden *g=bench_findgolden(key,w,h);
+  if (g)
+  {
+    g->seen=1;
+    if (g->frames != frames) status="skip (frame count differs)";
+    else if (g->hash == hash) status="ok";
+    else { status="MISMATCH"; ok=0; }
+    if (update) { g->frames=frames; g->hash=hash; }
+  }
+  else if (update && g_golden_n < BENCH_MAX_GOLDEN)
+  {
+    g=g_golden+g_golden_n++;
+    lstrcpyn(g->key,key,sizeof(g->key));
+    g->w=w; g->h=h; g->frames=frames; g->hash=hash; g->seen=1;
+  }
+  else if (havegolden && !update) { status="MISSING from golden file"; ok=0; }
+
+  fprintf(out,"%-40.40s %-32.32s %5dx%-5d %9.1f fps %8.2f ns/px  %016I64x  %s\n",key,desc,w,h,fps,nspp,hash,status);
+  fflush(out);
+  return ok;
+}
+
+static char *bench_nextarg(char **p)
+{
+  char *s=*p, *r;
+  while (*s == ' ' || *s == '\t') s++;
+  if (!*s) return NULL;
+  if (*s == '"')
+  {
+    r=++s;
+    while (*s && *s != '"') s++;
+  }
+  else
+  {
+    r=s;
+    while (*s && *s != ' ' && *s != '\t') s++;
+  }
+  if (*s) *s++=0;
+  *p=s;
+  return r;
+}
+
+extern "C" __declspec( dllexport ) void CALLBACK AVS_Bench(HWND hwnd, HINSTANCE hinst, LPSTR cmdline, int nCmdShow)
+{
+  extern int g_config_smp, g_config_smp_mt;
+  char cmd[2048];
+  char *p=cmd, *a;
+  char *goldenfile=NULL, *presetdir=NULL, *outfile="avs_bench.txt";
+  int frames=60, update=0, smp=0;
+  int sizes[BENCH_MAX_SIZES][2]={{320,240},{640,480},{1280,720}};
+  int nsizes=3;
+
+  lstrcpyn(cmd,cmdline?cmdline:"",sizeof(cmd));
+  while ((a=bench_nextarg(&p)))
+  {
+    if (!stricmp(a,"-frames") && (a=bench_nextarg(&p))) frames=max(atoi(a),1);
+    else if (!stricmp(a,"-golden") && (a=bench_nextarg(&p))) goldenfile=a;
+    else if (!stricmp(a,"-update")) update=1;
+    else if (!stricmp(a,"-presets") && (a=bench_nextarg(&p))) presetdir=a;
+    else if (!stricmp(a,"-smp") && (a=bench_nextarg(&p))) smp=atoi(a);
+    else if (!stricmp(a,"-out") && (a=bench_nextarg(&p))) outfile=a;
+    else if (!stricmp(a,"-sizes") && (a=bench_nextarg(&p)))
+    {
+      nsizes=0;
+      while (*a && nsizes < BENCH_MAX_SIZES)
+      {
+        if (sscanf(a,"%dx%d",&sizes[nsizes][0],&sizes[nsizes][1]) == 2 && sizes[nsizes][0] > 1 && sizes[nsizes][1] > 1) nsizes++;
+        while (*a && *a != ',') a++;
+        if (*a) a++;
+      }
+    }
+  }
+
+  FILE *out=fopen(outfile,"wt");
+  if (!out) return;
+
+  g_golden=(benchGolden *)GlobalAlloc(GPTR,BENCH_MAX_GOLDEN*sizeof(benchGolden));
+  g_golden_n=0;
+  if (!g_golden) { fclose(out); return; }
+  if (goldenfile) bench_loadgolden(goldenfile);
+  if (goldenfile && !update && !g_golden_n)
+  {
+    // nothing to compare against, which must not pass as a clean run
+    fprintf(out,"%s: no golden hashes, record them with -update first\n\n0 runs, 1 mismatches\n",goldenfile);
+    fclose(out);
+    GlobalFree(g_golden);
+    g_golden=NULL;
+    return;
+  }
+
+  int save_smp=g_config_smp, save_smp_mt=g_config_smp_mt;
+  g_config_smp=smp > 1;
+  g_config_smp_mt=smp;
+
+  AVS_Core_Init();
+
+  int failed=0, total=0;
+  int which, s;
+
+  // built-in effects, then APEs, default config, each alone in a list
+  for (which = 0; ; which ++)
+  {
+    char desc[256], key[MAX_PATH];
+    int id;
+    if (!(id=g_render_library->GetRendererDesc(which,desc)))
+    {
+      if (which >= DLLRENDERBASE) break;
+      which=DLLRENDERBASE-1; // past the built-ins, on to the APEs
+      continue;
+    }
+    if (which < DLLRENDERBASE)
+    {
+      lstrcpyn(key,desc,sizeof(key)); // MOD_NAME
+      id=which;
+    }
+    else lstrcpyn(key,(char *)id,sizeof(key)); // what CreateRenderer() takes for an APE
+    for (s = 0; s < nsizes; s ++)
+    {
+      bench_resetglobals();
+      C_AvsCore *core=new C_AvsCore();
+      C_RenderListClass::T_RenderListType t={0,};
+      int idx=id;
+      t.render=g_render_library->CreateRenderer(&idx,&t.has_rbase2);
+      t.effect_index=idx;
+      if (t.render && core->getList()->insertRender(&t,-1) >= 0)
+      {
+        total++;
+        if (!bench_run(out,core,key,desc,sizes[s][0],sizes[s][1],frames,update,goldenfile!=NULL)) failed++;
+      }
+      else if (t.render) delete t.render;
+      delete core;
+    }
+  }
+
+  // whole presets
+  if (presetdir)
+  {
+    char mask[MAX_PATH*2];
+    WIN32_FIND_DATA d;
+    wsprintf(mask,"%s\\*.avs",presetdir);
+    HANDLE h=FindFirstFile(mask,&d);
+    if (h != INVALID_HANDLE_VALUE)
+    {
+      do
+      {
+        char fn[MAX_PATH*2];
+        wsprintf(fn,"%s\\%s",presetdir,d.cFileName);
+        for (s = 0; s < nsizes; s ++)
+        {
+          bench_resetglobals();
+          C_AvsCore *core=new C_AvsCore();
+          if (!core->loadPreset(fn))
+          {
+            total++;
+            if (!bench_run(out,core,d.cFileName,"(preset)",sizes[s][0],sizes[s][1],frames,update,goldenfile!=NULL)) failed++;
+          }
+          delete core;
+        }
+      }
+      while (FindNextFile(h,&d));
+      FindClose(h);
+    }
+  }
+
+  if (!update)
+  {
+    int x;
+    for (x = 0; x < g_golden_n; x ++)
+      if (!g_golden[x].seen) fprintf(out,"%-40s %dx%d: in golden file but not run\n",g_golden[x].key,g_golden[x].w,g_golden[x].h);
+  }
+  fprintf(out,"\n%d runs, %d mismatches\n",total,failed);
+  fclose(out);
+
+  if (update && goldenfile) bench_savegolden(goldenfile);
+
+  AVS_Core_Quit();
+  g_config_smp=save_smp;
+  g_config_smp_mt=save_smp_mt;
+
+  GlobalFree(g_golden);
+  g_golden=NULL;
+  g_golden_n=0;
+}
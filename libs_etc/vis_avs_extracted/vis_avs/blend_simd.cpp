@@ -0,0 +1,502 @@
+/*
+  LICENSE
+  -------
+Copyright 2005 Nullsoft, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, 
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer. 
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution. 
+
+  * Neither the name of Nullsoft nor the names of its contributors may be used to 
+    endorse or promote products derived from this software without specific prior written permission. 
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include <windows.h>
+#include "r_defs.h"
+#include "blend_simd.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define BLENDSIMD_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define BLENDSIMD_ALIGN16 __declspec(align(16))
+#define BLENDSIMD_ALIGN32 __declspec(align(32))
+#define BLENDSIMD_AVX2_FUNC
+#else
+#include <cpuid.h>
+#define BLENDSIMD_ALIGN16 __attribute__((aligned(16)))
+#define BLENDSIMD_ALIGN32 __attribute__((aligned(32)))
+#define BLENDSIMD_AVX2_FUNC __attribute__((target("avx2")))
+#endif
+#endif
+
+blendsimd_funcs g_blendsimd;
+
+#define RGB_MASK 0x00ffffff
+#define ALPHA_MASK 0xff000000
+
+// BLEND and BLEND_SUB do the top byte in 32 bit arithmetic, so it doesn't
+// saturate like the others: BLEND wraps, and BLEND_SUB gives the wrapped
+// difference if that is < 128, else 0. the SIMD versions copy that.
+
+/////////////////////// plain C, straight from r_defs.h
+
+static void c_addblend(int *o, int *a, int *b, int l) { while (l-- > 0) *o++=BLEND(*a++,*b++); }
+static void c_avgblend(int *o, int *a, int *b, int l) { while (l-- > 0) *o++=BLEND_AVG(*a++,*b++); }
+static void c_subblend(int *o, int *a, int *b, int l) { while (l-- > 0) *o++=BLEND_SUB(*a++,*b++); }
+static void c_maxblend(int *o, int *a, int *b, int l) { while (l-- > 0) *o++=BLEND_MAX(*a++,*b++); }
+static void c_minblend(int *o, int *a, int *b, int l) { while (l-- > 0) *o++=BLEND_MIN(*a++,*b++); }
+static void c_mulblend(int *o, int *a, int *b, int l) { while (l-- > 0) *o++=BLEND_MUL(*a++,*b++); }
+static void c_adjblend(int *o, int *a, int *b, int l, int v) { while (l-- > 0) *o++=BLEND_ADJ_NOMMX(*a++,*b++,v); }
+
+static void c_bilinear_tab(int *o, int *src, int w, int *tab, int l)
+{
+  while (l-- > 0)
+  {
+    int t=*tab++;
+    *o++=BLEND4_NOMMX((unsigned int *)src+(t&BLENDSIMD_TAB_OFFSET_MASK),w,(t>>24)&(31<<3),(t>>19)&(31<<3));
+  }
+}
+
+#ifdef BLENDSIMD_X86
+
+/////////////////////// g_blendtable[i][j] in 16 bit lanes
+//
+// the table is (unsigned char)((i/255.0)*j), which is floor(i*j/255) except
+// for a handful of entries where i*j is an exact multiple of 255 and the
+// double rounds down. we compute floor(i*j/255) exactly as
+// (x+(x>>8)+1)>>8, then look those lanes up in the table. the rows (i
+// values) that have such entries are found at init.
+
+#define MAX_FIX_ROWS 8
+static int g_fix_nrows;
+static unsigned short g_fix_rows[MAX_FIX_ROWS];
+
+static __m128i fixup_sse2(__m128i i, __m128i j)
+{
+  BLENDSIMD_ALIGN16 unsigned short ti[8], tj[8];
+  int x;
+  _mm_store_si128((__m128i *)ti,i);
+  _mm_store_si128((__m128i *)tj,j);
+  for (x = 0; x < 8; x ++) ti[x]=g_blendtable[ti[x]][tj[x]];
+  return _mm_load_si128((__m128i *)ti);
+}
+
+static __inline __m128i mul255_sse2(__m128i i, __m128i j)
+{
+  __m128i x=_mm_mullo_epi16(i,j);
+  __m128i q=_mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x,_mm_srli_epi16(x,8)),_mm_set1_epi16(1)),8);
+  if (g_fix_nrows)
+  {
+    __m128i hit=_mm_setzero_si128();
+    int k;
+    for (k = 0; k < g_fix_nrows; k ++)
+      hit=_mm_or_si128(hit,_mm_cmpeq_epi16(i,_mm_set1_epi16(g_fix_rows[k])));
+    __m128i r=_mm_sub_epi16(x,_mm_sub_epi16(_mm_slli_epi16(q,8),q));
+    hit=_mm_and_si128(hit,_mm_cmpeq_epi16(r,_mm_setzero_si128()));
+    if (_mm_movemask_epi8(hit)) q=fixup_sse2(i,j);
+  }
+  return q;
+}
+
+/////////////////////// SSE2, 4 pixels per iteration
+
+static void sse2_addblend(int *o, int *a, int *b, int l)
+{
+  __m128i m=_mm_set1_epi32(RGB_MASK), am=_mm_set1_epi32(ALPHA_MASK);
+  for (; l >= 4; l -= 4, o += 4, a += 4, b += 4)
+  {
+    __m128i va=_mm_loadu_si128((__m128i *)a), vb=_mm_loadu_si128((__m128i *)b);
+    _mm_storeu_si128((__m128i *)o,_mm_or_si128(_mm_and_si128(m,_mm_adds_epu8(va,vb)),_mm_and_si128(am,_mm_add_epi8(va,vb))));
+  }
+  c_addblend(o,a,b,l);
+}
+
+static void sse2_avgblend(int *o, int *a, int *b, int l)
+{
+  __m128i m=_mm_set1_epi8(0x7f);
+  for (; l >= 4; l -= 4, o += 4, a += 4, b += 4)
+  {
+    __m128i va=_mm_and_si128(_mm_srli_epi16(_mm_loadu_si128((__m128i *)a),1),m);
+    __m128i vb=_mm_and_si128(_mm_srli_epi16(_mm_loadu_si128((__m128i *)b),1),m);
+    _mm_storeu_si128((__m128i *)o,_mm_add_epi8(va,vb));
+  }
+  c_avgblend(o,a,b,l);
+}
+
+static void sse2_subblend(int *o, int *a, int *b, int l)
+{
+  __m128i z=_mm_setzero_si128(), m=_mm_set1_epi32(RGB_MASK), am=_mm_set1_epi32(ALPHA_MASK);
+  for (; l >= 4; l -= 4, o += 4, a += 4, b += 4)
+  {
+    __m128i va=_mm_loadu_si128((__m128i *)a), vb=_mm_loadu_si128((__m128i *)b);
+    __m128i d=_mm_sub_epi8(va,vb);
+    d=_mm_and_si128(am,_mm_andnot_si128(_mm_cmpgt_epi8(z,d),d));
+    _mm_storeu_si128((__m128i *)o,_mm_or_si128(_mm_and_si128(m,_mm_subs_epu8(va,vb)),d));
+  }
+  c_subblend(o,a,b,l);
+}
+
+static void sse2_maxblend(int *o, int *a, int *b, int l)
+{
+  __m128i m=_mm_set1_epi32(RGB_MASK);
+  for (; l >= 4; l -= 4, o += 4, a += 4, b += 4)
+    _mm_storeu_si128((__m128i *)o,_mm_and_si128(m,_mm_max_epu8(_mm_loadu_si128((__m128i *)a),_mm_loadu_si128((__m128i *)b))));
+  c_maxblend(o,a,b,l);
+}
+
+static void sse2_minblend(int *o, int *a, int *b, int l)
+{
+  __m128i m=_mm_set1_epi32(RGB_MASK);
+  for (; l >= 4; l -= 4, o += 4, a += 4, b += 4)
+    _mm_storeu_si128((__m128i *)o,_mm_and_si128(m,_mm_min_epu8(_mm_loadu_si128((__m128i *)a),_mm_loadu_si128((__m128i *)b))));
+  c_minblend(o,a,b,l);
+}
+
+static void sse2_mulblend(int *o, int *a, int *b, int l)
+{
+  __m128i z=_mm_setzero_si128(), m=_mm_set1_epi32(RGB_MASK);
+  for (; l >= 4; l -= 4, o += 4, a += 4, b += 4)
+  {
+    __m128i va=_mm_loadu_si128((__m128i *)a), vb=_mm_loadu_si128((__m128i *)b);
+    __m128i lo=mul255_sse2(_mm_unpacklo_epi8(va,z),_mm_unpacklo_epi8(vb,z));
+    __m128i hi=mul255_sse2(_mm_unpackhi_epi8(va,z),_mm_unpackhi_epi8(vb,z));
+    _mm_storeu_si128((__m128i *)o,_mm_and_si128(m,_mm_packus_epi16(lo,hi)));
+  }
+  c_mulblend(o,a,b,l);
+}
+
+static void sse2_adjblend(int *o, int *a, int *b, int l, int v)
+{
+  __m128i z=_mm_setzero_si128(), m=_mm_set1_epi32(RGB_MASK);
+  __m128i va_w=_mm_set1_epi16((short)v), vb_w=_mm_set1_epi16((short)(255-v));
+  for (; l >= 4; l -= 4, o += 4, a += 4, b += 4)
+  {
+    __m128i va=_mm_loadu_si128((__m128i *)a), vb=_mm_loadu_si128((__m128i *)b);
+    __m128i lo=_mm_add_epi16(mul255_sse2(_mm_unpacklo_epi8(va,z),va_w),mul255_sse2(_mm_unpacklo_epi8(vb,z),vb_w));
+    __m128i hi=_mm_add_epi16(mul255_sse2(_mm_unpackhi_epi8(va,z),va_w),mul255_sse2(_mm_unpackhi_epi8(vb,z),vb_w));
+    _mm_storeu_si128((__m128i *)o,_mm_and_si128(m,_mm_packus_epi16(lo,hi)));
+  }
+  c_adjblend(o,a,b,l,v);
+}
+
+// weights are one per 32 bit lane (pixel); spread each over its pixel's
+// four 16 bit channel lanes, in the same order unpacklo/hi_epi8 gives.
+#define SPREAD_LO_SSE2(a) _mm_unpacklo_epi32(_mm_or_si128(a,_mm_slli_epi32(a,16)),_mm_or_si128(a,_mm_slli_epi32(a,16)))
+#define SPREAD_HI_SSE2(a) _mm_unpackhi_epi32(_mm_or_si128(a,_mm_slli_epi32(a,16)),_mm_or_si128(a,_mm_slli_epi32(a,16)))
+
+static void sse2_bilinear_tab(int *o, int *src, int w, int *tab, int l)
+{
+  __m128i z=_mm_setzero_si128(), m=_mm_set1_epi32(RGB_MASK);
+  __m128i c255=_mm_set1_epi32(255), fm=_mm_set1_epi32(31<<3);
+  for (; l >= 4; l -= 4, o += 4, tab += 4)
+  {
+    __m128i t=_mm_loadu_si128((__m128i *)tab);
+    __m128i xp=_mm_and_si128(_mm_srli_epi32(t,24),fm);
+    __m128i yp=_mm_and_si128(_mm_srli_epi32(t,19),fm);
+    __m128i ixp=_mm_sub_epi32(c255,xp), iyp=_mm_sub_epi32(c255,yp);
+
+    // the high half of each lane is 0*0, which mul255 leaves at 0
+    __m128i a1=mul255_sse2(ixp,iyp);
+    __m128i a2=mul255_sse2(xp,iyp);
+    __m128i a3=mul255_sse2(ixp,yp);
+    __m128i a4=mul255_sse2(xp,yp);
+
+    int *p0=src+(tab[0]&BLENDSIMD_TAB_OFFSET_MASK);
+    int *p1=src+(tab[1]&BLENDSIMD_TAB_OFFSET_MASK);
+    int *p2=src+(tab[2]&BLENDSIMD_TAB_OFFSET_MASK);
+    int *p3=src+(tab[3]&BLENDSIMD_TAB_OFFSET_MASK);
+    __m128i s1=_mm_setr_epi32(p0[0],p1[0],p2[0],p3[0]);
+    __m128i s2=_mm_setr_epi32(p0[1],p1[1],p2[1],p3[1]);
+    __m128i s3=_mm_setr_epi32(p0[w],p1[w],p2[w],p3[w]);
+    __m128i s4=_mm_setr_epi32(p0[w+1],p1[w+1],p2[w+1],p3[w+1]);
+
+    __m128i lo=mul255_sse2(_mm_unpacklo_epi8(s1,z),SPREAD_LO_SSE2(a1));
+    lo=_mm_add_epi16(lo,mul255_sse2(_mm_unpacklo_epi8(s2,z),SPREAD_LO_SSE2(a2)));
+    lo=_mm_add_epi16(lo,mul255_sse2(_mm_unpacklo_epi8(s3,z),SPREAD_LO_SSE2(a3)));
+    lo=_mm_add_epi16(lo,mul255_sse2(_mm_unpacklo_epi8(s4,z),SPREAD_LO_SSE2(a4)));
+    __m128i hi=mul255_sse2(_mm_unpackhi_epi8(s1,z),SPREAD_HI_SSE2(a1));
+    hi=_mm_add_epi16(hi,mul255_sse2(_mm_unpackhi_epi8(s2,z),SPREAD_HI_SSE2(a2)));
+    hi=_mm_add_epi16(hi,mul255_sse2(_mm_unpackhi_epi8(s3,z),SPREAD_HI_SSE2(a3)));
+    hi=_mm_add_epi16(hi,mul255_sse2(_mm_unpackhi_epi8(s4,z),SPREAD_HI_SSE2(a4)));
+
+    _mm_storeu_si128((__m128i *)o,_mm_and_si128(m,_mm_packus_epi16(lo,hi)));
+  }
+  c_bilinear_tab(o,src,w,tab,l);
+}
+
+/////////////////////// AVX2, 8 pixels per iteration
+//
+// same code as above at twice the width. unpack/pack work within each 128
+// bit half, but pixels and weights go through the same shuffles so they
+// stay lined up.
+
+static BLENDSIMD_AVX2_FUNC __m256i fixup_avx2(__m256i i, __m256i j)
+{
+  BLENDSIMD_ALIGN32 unsigned short ti[16], tj[16];
+  int x;
+  _mm256_store_si256((__m256i *)ti,i);
+  _mm256_store_si256((__m256i *)tj,j);
+  for (x = 0; x < 16; x ++) ti[x]=g_blendtable[ti[x]][tj[x]];
+  return _mm256_load_si256((__m256i *)ti);
+}
+
+static BLENDSIMD_AVX2_FUNC __inline __m256i mul255_avx2(__m256i i, __m256i j)
+{
+  __m256i x=_mm256_mullo_epi16(i,j);
+  __m256i q=_mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(x,_mm256_srli_epi16(x,8)),_mm256_set1_epi16(1)),8);
+  if (g_fix_nrows)
+  {
+    __m256i hit=_mm256_setzero_si256();
+    int k;
+    for (k = 0; k < g_fix_nrows; k ++)
+      hit=_mm256_or_si256(hit,_mm256_cmpeq_epi16(i,_mm256_set1_epi16(g_fix_rows[k])));
+    __m256i r=_mm256_sub_epi16(x,_mm256_sub_epi16(_mm256_slli_epi16(q,8),q));
+    hit=_mm256_and_si256(hit,_mm256_cmpeq_epi16(r,_mm256_setzero_si256()));
+    if (_mm256_movemask_epi8(hit)) q=fixup_avx2(i,j);
+  }
+  return q;
+}
+
+static BLENDSIMD_AVX2_FUNC void avx2_addblend(int *o, int *a, int *b, int l)
+{
+  __m256i m=_mm256_set1_epi32(RGB_MASK), am=_mm256_set1_epi32(ALPHA_MASK);
+  for (; l >= 8; l -= 8, o += 8, a += 8, b += 8)
+  {
+    __m256i va=_mm256_loadu_si256((__m256i *)a), vb=_mm256_loadu_si256((__m256i *)b);
+    _mm256_storeu_si256((__m256i *)o,_mm256_or_si256(_mm256_and_si256(m,_mm256_adds_epu8(va,vb)),_mm256_and_si256(am,_mm256_add_epi8(va,vb))));
+  }
+  sse2_addblend(o,a,b,l);
+}
+
+static BLENDSIMD_AVX2_FUNC void avx2_avgblend(int *o, int *a, int *b, int l)
+{
+  __m256i m=_mm256_set1_epi8(0x7f);
+  for (; l >= 8; l -= 8, o += 8, a += 8, b += 8)
+  {
+    __m256i va=_mm256_and_si256(_mm256_srli_epi16(_mm256_loadu_si256((__m256i *)a),1),m);
+    __m256i vb=_mm256_and_si256(_mm256_srli_epi16(_mm256_loadu_si256((__m256i *)b),1),m);
+    _mm256_storeu_si256((__m256i *)o,_mm256_add_epi8(va,vb));
+  }
+  sse2_avgblend(o,a,b,l);
+}
+
+static BLENDSIMD_AVX2_FUNC void avx2_subblend(int *o, int *a, int *b, int l)
+{
+  __m256i z=_mm256_setzero_si256(), m=_mm256_set1_epi32(RGB_MASK), am=_mm256_set1_epi32(ALPHA_MASK);
+  for (; l >= 8; l -= 8, o += 8, a += 8, b += 8)
+  {
+    __m256i va=_mm256_loadu_si256((__m256i *)a), vb=_mm256_loadu_si256((__m256i *)b);
+    __m256i d=_mm256_sub_epi8(va,vb);
+    d=_mm256_and_si256(am,_mm256_andnot_si256(_mm256_cmpgt_epi8(z,d),d));
+    _mm256_storeu_si256((__m256i *)o,_mm256_or_si256(_mm256_and_si256(m,_mm256_subs_epu8(va,vb)),d));
+  }
+  sse2_subblend(o,a,b,l);
+}
+
+static BLENDSIMD_AVX2_FUNC void avx2_maxblend(int *o, int *a, int *b, int l)
+{
+  __m256i m=_mm256_set1_epi32(RGB_MASK);
+  for (; l >= 8; l -= 8, o += 8, a += 8, b += 8)
+    _mm256_storeu_si256((__m256i *)o,_mm256_and_si256(m,_mm256_max_epu8(_mm256_loadu_si256((__m256i *)a),_mm256_loadu_si256((__m256i *)b))));
+  sse2_maxblend(o,a,b,l);
+}
+
+static BLENDSIMD_AVX2_FUNC void avx2_minblend(int *o, int *a, int *b, int l)
+{
+  __m256i m=_mm256_set1_epi32(RGB_MASK);
+  for (; l >= 8; l -= 8, o += 8, a += 8, b += 8)
+    _mm256_storeu_si256((__m256i *)o,_mm256_and_si256(m,_mm256_min_epu8(_mm256_loadu_si256((__m256i *)a),_mm256_loadu_si256((__m256i *)b))));
+  sse2_minblend(o,a,b,l);
+}
+
+static BLENDSIMD_AVX2_FUNC void avx2_mulblend(int *o, int *a, int *b, int l)
+{
+  __m256i z=_mm256_setzero_si256(), m=_mm256_set1_epi32(RGB_MASK);
+  for (; l >= 8; l -= 8, o += 8, a += 8, b += 8)
+  {
+    __m256i va=_mm256_loadu_si256((__m256i *)a), vb=_mm256_loadu_si256((__m256i *)b);
+    __m256i lo=mul255_avx2(_mm256_unpacklo_epi8(va,z),_mm256_unpacklo_epi8(vb,z));
+    __m256i hi=mul255_avx2(_mm256_unpackhi_epi8(va,z),_mm256_unpackhi_epi8(vb,z));
+    _mm256_storeu_si256((__m256i *)o,_mm256_and_si256(m,_mm256_packus_epi16(lo,hi)));
+  }
+  sse2_mulblend(o,a,b,l);
+}
+
+static BLENDSIMD_AVX2_FUNC void avx2_adjblend(int *o, int *a, int *b, int l, int v)
+{
+  __m256i z=_mm256_setzero_si256(), m=_mm256_set1_epi32(RGB_MASK);
+  __m256i va_w=_mm256_set1_epi16((short)v), vb_w=_mm256_set1_epi16((short)(255-v));
+  for (; l >= 8; l -= 8, o += 8, a += 8, b += 8)
+  {
+    __m256i va=_mm256_loadu_si256((__m256i *)a), vb=_mm256_loadu_si256((__m256i *)b);
+    __m256i lo=_mm256_add_epi16(mul255_avx2(_mm256_unpacklo_epi8(va,z),va_w),mul255_avx2(_mm256_unpacklo_epi8(vb,z),vb_w));
+    __m256i hi=_mm256_add_epi16(mul255_avx2(_mm256_unpackhi_epi8(va,z),va_w),mul255_avx2(_mm256_unpackhi_epi8(vb,z),vb_w));
+    _mm256_storeu_si256((__m256i *)o,_mm256_and_si256(m,_mm256_packus_epi16(lo,hi)));
+  }
+  sse2_adjblend(o,a,b,l,v);
+}
+
+#define SPREAD_LO_AVX2(a) _mm256_unpacklo_epi32(_mm256_or_si256(a,_mm256_slli_epi32(a,16)),_mm256_or_si256(a,_mm256_slli_epi32(a,16)))
+#define SPREAD_HI_AVX2(a) _mm256_unpackhi_epi32(_mm256_or_si256(a,_mm256_slli_epi32(a,16)),_mm256_or_si256(a,_mm256_slli_epi32(a,16)))
+
+static BLENDSIMD_AVX2_FUNC void avx2_bilinear_tab(int *o, int *src, int w, int *tab, int l)
+{
+  __m256i z=_mm256_setzero_si256(), m=_mm256_set1_epi32(RGB_MASK);
+  __m256i c255=_mm256_set1_epi32(255), fm=_mm256_set1_epi32(31<<3);
+  __m256i om=_mm256_set1_epi32(BLENDSIMD_TAB_OFFSET_MASK);
+  __m256i one=_mm256_set1_epi32(1), vw=_mm256_set1_epi32(w), vw1=_mm256_set1_epi32(w+1);
+  for (; l >= 8; l -= 8, o += 8, tab += 8)
+  {
+    __m256i t=_mm256_loadu_si256((__m256i *)tab);
+    __m256i xp=_mm256_and_si256(_mm256_srli_epi32(t,24),fm);
+    __m256i yp=_mm256_and_si256(_mm256_srli_epi32(t,19),fm);
+    __m256i ixp=_mm256_sub_epi32(c255,xp), iyp=_mm256_sub_epi32(c255,yp);
+
+    __m256i a1=mul255_avx2(ixp,iyp);
+    __m256i a2=mul255_avx2(xp,iyp);
+    __m256i a3=mul255_avx2(ixp,yp);
+    __m256i a4=mul255_avx2(xp,yp);
+
+    __m256i offs=_mm256_and_si256(t,om);
+    __m256i s1=_mm256_i32gather_epi32(src,offs,4);
+    __m256i s2=_mm256_i32gather_epi32(src,_mm256_add_epi32(offs,one),4);
+    __m256i s3=_mm256_i32gather_epi32(src,_mm256_add_epi32(offs,vw),4);
+    __m256i s4=_mm256_i32gather_epi32(src,_mm256_add_epi32(offs,vw1),4);
+
+    __m256i lo=mul255_avx2(_mm256_unpacklo_epi8(s1,z),SPREAD_LO_AVX2(a1));
+    lo=_mm256_add_epi16(lo,mul255_avx2(_mm256_unpacklo_epi8(s2,z),SPREAD_LO_AVX2(a2)));
+    lo=_mm256_add_epi16(lo,mul255_avx2(_mm256_unpacklo_epi8(s3,z),SPREAD_LO_AVX2(a3)));
+    lo=_mm256_add_epi16(lo,mul255_avx2(_mm256_unpacklo_epi8(s4,z),SPREAD_LO_AVX2(a4)));
+    __m256i hi=mul255_avx2(_mm256_unpackhi_epi8(s1,z),SPREAD_HI_AVX2(a1));
+    hi=_mm256_add_epi16(hi,mul255_avx2(_mm256_unpackhi_epi8(s2,z),SPREAD_HI_AVX2(a2)));
+    hi=_mm256_add_epi16(hi,mul255_avx2(_mm256_unpackhi_epi8(s3,z),SPREAD_HI_AVX2(a3)));
+    hi=_mm256_add_epi16(hi,mul255_avx2(_mm256_unpackhi_epi8(s4,z),SPREAD_HI_AVX2(a4)));
+
+    _mm256_storeu_si256((__m256i *)o,_mm256_and_si256(m,_mm256_packus_epi16(lo,hi)));
+  }
+  sse2_bilinear_tab(o,src,w,tab,l);
+}
+
+static int cpu_level()
+{
+  int level=BLENDSIMD_C;
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info,0);
+  int maxleaf=info[0];
+  __cpuid(info,1);
+  if (info[3]&(1<<26)) level=BLENDSIMD_SSE2;
+  // avx2 needs the os to save ymm state too (osxsave+avx, then xcr0)
+  if (level && maxleaf >= 7 && (info[2]&(1<<27)) && (info[2]&(1<<28)) && (_xgetbv(0)&6) == 6)
+  {
+    __cpuidex(info,7,0);
+    if (info[1]&(1<<5)) level=BLENDSIMD_AVX2;
+  }
+#else
+  unsigned int a,b,c,d;
+  if (__get_cpuid(1,&a,&b,&c,&d))
+  {
+    if (d&(1<<26)) level=BLENDSIMD_SSE2;
+    if (level && (c&(1<<27)) && (c&(1<<28)))
+    {
+      unsigned int xlo,xhi;
+      __asm__ volatile("xgetbv" : "=a"(xlo), "=d"(xhi) : "c"(0));
+      if ((xlo&6) == 6 && __get_cpuid_count(7,0,&a,&b,&c,&d) && (b&(1<<5))) level=BLENDSIMD_AVX2;
+    }
+  }
+#endif
+  return level;
+}
+
+// finds the table rows that differ from floor(i*j/255). returns 0 if the
+// table has any difference the SIMD code can't reproduce.
+static int find_fix_rows()
+{
+  int i,j;
+  g_fix_nrows=0;
+  for (i = 0; i < 256; i ++)
+  {
+    int bad=0;
+    for (j = 0; j < 256; j ++)
+    {
+      int x=i*j;
+      if (g_blendtable[i][j] != x/255)
+      {
+        if (x%255) return 0;
+        bad=1;
+      }
+    }
+    if (bad)
+    {
+      if (g_fix_nrows >= MAX_FIX_ROWS) return 0;
+      g_fix_rows[g_fix_nrows++]=(unsigned short)i;
+    }
+  }
+  return 1;
+}
+
+#endif//BLENDSIMD_X86
+
+int BlendSIMD_Init(int maxlevel)
+{
+  int level=BLENDSIMD_C;
+#ifdef BLENDSIMD_X86
+  level=cpu_level();
+  if (level > maxlevel) level=maxlevel;
+  if (level > BLENDSIMD_C && !find_fix_rows()) level=BLENDSIMD_C;
+#endif
+
+  g_blendsimd.addblend=c_addblend;
+  g_blendsimd.avgblend=c_avgblend;
+  g_blendsimd.subblend=c_subblend;
+  g_blendsimd.maxblend=c_maxblend;
+  g_blendsimd.minblend=c_minblend;
+  g_blendsimd.mulblend=c_mulblend;
+  g_blendsimd.adjblend=c_adjblend;
+  g_blendsimd.bilinear_tab=c_bilinear_tab;
+
+#ifdef BLENDSIMD_X86
+  if (level == BLENDSIMD_SSE2)
+  {
+    g_blendsimd.addblend=sse2_addblend;
+    g_blendsimd.avgblend=sse2_avgblend;
+    g_blendsimd.subblend=sse2_subblend;
+    g_blendsimd.maxblend=sse2_maxblend;
+    g_blendsimd.minblend=sse2_minblend;
+    g_blendsimd.mulblend=sse2_mulblend;
+    g_blendsimd.adjblend=sse2_adjblend;
+    g_blendsimd.bilinear_tab=sse2_bilinear_tab;
+  }
+  else if (level == BLENDSIMD_AVX2)
+  {
+    g_blendsimd.addblend=avx2_addblend;
+    g_blendsimd.avgblend=avx2_avgblend;
+    g_blendsimd.subblend=avx2_subblend;
+    g_blendsimd.maxblend=avx2_maxblend;
+    g_blendsimd.minblend=avx2_minblend;
+    g_blendsimd.mulblend=avx2_mulblend;
+    g_blendsimd.adjblend=avx2_adjblend;
+    g_blendsimd.bilinear_tab=avx2_bilinear_tab;
+  }
+#endif
+  return level;
+}
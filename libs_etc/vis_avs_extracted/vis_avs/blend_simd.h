@@ -0,0 +1,68 @@
+/*
+  LICENSE
+  -------
+Copyright 2005 Nullsoft, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, 
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer. 
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution. 
+
+  * Neither the name of Nullsoft nor the names of its contributors may be used to 
+    endorse or promote products derived from this software without specific prior written permission. 
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef _BLEND_SIMD_H_
+#define _BLEND_SIMD_H_
+
+// Runtime dispatched blend kernels (C, SSE2, AVX2).
+//
+// Every kernel gives exactly the result of the g_blendtable based C code in
+// r_defs.h (BLEND, BLEND_AVG, BLEND_SUB, BLEND_MAX, BLEND_MIN, BLEND_MUL,
+// BLEND_ADJ_NOMMX and BLEND4_NOMMX), only several pixels at a time. o may
+// be the same buffer as a or b.
+
+#define BLENDSIMD_C    0
+#define BLENDSIMD_SSE2 1
+#define BLENDSIMD_AVX2 2
+
+#define BLENDSIMD_TAB_OFFSET_MASK ((1<<22)-1)
+
+typedef struct
+{
+  void (*addblend)(int *o, int *a, int *b, int l); // o=BLEND(a,b)
+  void (*avgblend)(int *o, int *a, int *b, int l); // o=BLEND_AVG(a,b)
+  void (*subblend)(int *o, int *a, int *b, int l); // o=BLEND_SUB(a,b)
+  void (*maxblend)(int *o, int *a, int *b, int l); // o=BLEND_MAX(a,b)
+  void (*minblend)(int *o, int *a, int *b, int l); // o=BLEND_MIN(a,b)
+  void (*mulblend)(int *o, int *a, int *b, int l); // o=BLEND_MUL(a,b)
+  void (*adjblend)(int *o, int *a, int *b, int l, int v); // o=BLEND_ADJ_NOMMX(a,b,v)
+
+  // bilinear fetch from an R_Trans style table: each entry is a pixel offset
+  // (low 22 bits) plus 5 bit x/y fractions in bits 27-31 and 22-26.
+  // o[i]=BLEND4_NOMMX(src+(t&BLENDSIMD_TAB_OFFSET_MASK),w,(t>>24)&0xf8,(t>>19)&0xf8)
+  void (*bilinear_tab)(int *o, int *src, int w, int *tab, int l);
+} blendsimd_funcs;
+
+extern blendsimd_funcs g_blendsimd;
+
+// picks the best kernels the cpu supports, up to maxlevel. g_blendtable must
+// already be filled in. returns the level in use.
+int BlendSIMD_Init(int maxlevel);
+
+#endif//_BLEND_SIMD_H_
@@ -41,7 +41,7 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "bpm.h"
 #include "../Agave/Language/api_language.h"
 
-int refineBeat(int isBeat);
+int refineBeat(int isBeat, DWORD tc, int tempo);
 BOOL TCHistStep(BeatType *t, DWORD _Avg, int *_halfDiscriminated, int *_hdPos, DWORD *_lastTC, DWORD TC, int Type);
 void InsertHistStep(BeatType *t, DWORD TC, int Type, int i);
 void CalcBPM(void);
@@ -589,7 +589,7 @@ if (!*slide || *slide == 8) (Ctl == IDC_IN ? inInc : outInc) *= -1;
 // isBeat is 1 if a beat has been detected.
 // visdata is in the format of [spectrum:0,wave:1][channel][band].
 
-int refineBeat(int isBeat)
+int refineBeat(int isBeat, DWORD tc, int tempo)
 {
   BOOL accepted=FALSE;
   BOOL predicted=FALSE;
@@ -599,7 +599,7 @@ int refineBeat(int isBeat)
   if (isBeat) // Show the beat received from AVS
 	SliderStep(IDC_IN, &inSlide);
 
-  DWORD TCNow = GetTickCount();
+  DWORD TCNow = tc ? tc : GetTickCount();
 
    if (songChanged(TCNow))
 	{
@@ -618,7 +618,8 @@ int refineBeat(int isBeat)
    if (isBeat) // If it is a real beat, do discrimination/guessing and computations, then see if it is accepted
  		accepted = TCHistStep(TCHist, Avg, halfDiscriminated, &hdPos, &lastTC, TCNow, BEAT_REAL);
 
-   // Calculate current Bpm
+   // Calculate current Bpm. Until there's enough history to, go with the tempo we were given
+   if (!ReadyToLearn() && tempo >= MIN_BPM && tempo <= MAX_BPM) Bpm = tempo;
    CalcBPM();
 
    // If prediction Bpm has not yet been set
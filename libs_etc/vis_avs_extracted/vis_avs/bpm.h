@@ -50,7 +50,9 @@ typedef struct {
 
 BOOL CALLBACK DlgProc_Bpm(HWND hwndDlg, UINT uMsg, WPARAM wParam,LPARAM lParam);
 void initBpm(void);
-int refineBeat(int isBeat);
+// tc is when the beat was (GetTickCount() time, 0 for now). tempo is an
+// outside bpm estimate that's used until there are enough beats to learn from.
+int refineBeat(int isBeat, DWORD tc=0, int tempo=0);
 
 
 #endif
@@ -41,6 +41,10 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "bpm.h"
 #include "avs_eelif.h"
 #include "undo.h"
+#include "fb_arena.h"
+#include "frame_pacer.h"
+#include "profiler.h"
+#include "audio_ring.h"
 #include "../Agave/Language/api_language.h"
 #include "../WAT/WAT.h"
 
@@ -91,6 +95,8 @@ int cfg_transitions_speed=8;
 int cfg_transition_mode=0x8001;
 int cfg_bkgnd_render=0,cfg_bkgnd_render_color=0x1F000F;
 int cfg_render_prio=0;
+int cfg_render_scale=0,cfg_render_scale_fps=60;
+int cfg_pace_audio=0;
 
 char config_pres_subdir[MAX_PATH];
 char last_preset[2048];
@@ -368,6 +374,10 @@ static BOOL CALLBACK DlgProc_Disp(HWND hwndDlg, UINT uMsg, WPARAM wParam,LPARAM
       ShowWindow(GetDlgItem(hwndDlg,IDC_CHECK4),SW_HIDE);
       ShowWindow(GetDlgItem(hwndDlg,IDC_EDIT1),SW_HIDE);
       ShowWindow(GetDlgItem(hwndDlg,IDC_THREADS),SW_HIDE);
+      ShowWindow(GetDlgItem(hwndDlg,IDC_RENDERSCALEBORDER),SW_HIDE);
+      ShowWindow(GetDlgItem(hwndDlg,IDC_RENDERSCALE),SW_HIDE);
+      ShowWindow(GetDlgItem(hwndDlg,IDC_RENDERSCALE_FPS),SW_HIDE);
+      ShowWindow(GetDlgItem(hwndDlg,IDC_RENDERSCALE_LABEL),SW_HIDE);
       CheckDlgButton(hwndDlg,IDC_L_SUPPRESS_DIALOGS,(g_laser_nomessage&1)?BST_CHECKED:BST_UNCHECKED);
       CheckDlgButton(hwndDlg,IDC_L_SUPPRESS_OUTPUT,(g_laser_nomessage&4)?BST_CHECKED:BST_UNCHECKED);
       CheckDlgButton(hwndDlg,IDC_L_SYNC,(g_laser_nomessage&8)?BST_CHECKED:BST_UNCHECKED);
@@ -375,6 +385,8 @@ static BOOL CALLBACK DlgProc_Disp(HWND hwndDlg, UINT uMsg, WPARAM wParam,LPARAM
 #else
             CheckDlgButton(hwndDlg,IDC_CHECK4,g_config_smp?BST_CHECKED:0);
             SetDlgItemInt(hwndDlg,IDC_EDIT1,g_config_smp_mt,FALSE);
+            CheckDlgButton(hwndDlg,IDC_RENDERSCALE,cfg_render_scale?BST_CHECKED:0);
+            SetDlgItemInt(hwndDlg,IDC_RENDERSCALE_FPS,cfg_render_scale_fps,FALSE);
 #endif
 		}
 #ifdef WA2_EMBED
@@ -516,6 +528,17 @@ static BOOL CALLBACK DlgProc_Disp(HWND hwndDlg, UINT uMsg, WPARAM wParam,LPARAM
                 g_config_smp_mt=GetDlgItemInt(hwndDlg,IDC_EDIT1,&t,FALSE);
           }
         return 0;
+        case IDC_RENDERSCALE:
+            cfg_render_scale=!!IsDlgButtonChecked(hwndDlg,IDC_RENDERSCALE);
+        return 0;
+        case IDC_RENDERSCALE_FPS:
+          if (HIWORD(wParam) == EN_CHANGE)
+          {
+                BOOL t;
+                int v=GetDlgItemInt(hwndDlg,IDC_RENDERSCALE_FPS,&t,FALSE);
+                if (t && v > 0) cfg_render_scale_fps=v;
+          }
+        return 0;
 #endif
 			    case IDC_TRANS_CHECK:
 					cfg_trans=IsDlgButtonChecked(hwndDlg,IDC_TRANS_CHECK)?1:0;
@@ -922,6 +945,7 @@ static BOOL CALLBACK debugProc(HWND hwndDlg, UINT uMsg, WPARAM wParam,LPARAM lPa
       if (g_log_errors) CheckDlgButton(hwndDlg,IDC_CHECK1,BST_CHECKED);
       if (g_reset_vars_on_recompile) CheckDlgButton(hwndDlg,IDC_CHECK2,BST_CHECKED);
       if (!g_config_seh) CheckDlgButton(hwndDlg,IDC_CHECK3,BST_CHECKED);     
+      if (C_Profiler::isEnabled()) CheckDlgButton(hwndDlg,IDC_PROFILE,BST_CHECKED);
      
     return 0;
     case WM_TIMER:
@@ -958,6 +982,23 @@ static BOOL CALLBACK debugProc(HWND hwndDlg, UINT uMsg, WPARAM wParam,LPARAM lPa
           SetDlgItemText(hwndDlg,IDC_EDIT2,buf);
         }
 
+        {
+          char buf[4096], oldbuf[4096];
+          int l=C_FramePacer::report(buf,sizeof(buf));
+          l+=C_AudioRing::report(buf+l,sizeof(buf)-l);
+          C_FBArena::report(buf+l,sizeof(buf)-l);
+          GetDlgItemText(hwndDlg,IDC_EDIT3,oldbuf,sizeof(oldbuf));
+          if (strcmp(buf,oldbuf)) SetDlgItemText(hwndDlg,IDC_EDIT3,buf);
+        }
+
+        {
+          static char buf[16384], oldbuf[16384];
+          C_Profiler::report(buf,sizeof(buf));
+          GetDlgItemText(hwndDlg,IDC_EDIT4,oldbuf,sizeof(oldbuf));
+          if (strcmp(buf,oldbuf)) SetDlgItemText(hwndDlg,IDC_EDIT4,buf);
+          EnableWindow(GetDlgItem(hwndDlg,IDC_PROFILE_TRACE),!C_Profiler::tracing());
+        }
+
       }
     return 0;
     case WM_COMMAND:
@@ -972,6 +1013,23 @@ static BOOL CALLBACK debugProc(HWND hwndDlg, UINT uMsg, WPARAM wParam,LPARAM lPa
         case IDC_CHECK3:
           g_config_seh = !IsDlgButtonChecked(hwndDlg,IDC_CHECK3);
         return 0;             
+        case IDC_PROFILE:
+          C_Profiler::setEnabled(!!IsDlgButtonChecked(hwndDlg,IDC_PROFILE));
+        return 0;
+        case IDC_PROFILE_TRACE:
+          {
+            char temp[MAX_PATH];
+            OPENFILENAME l={sizeof(l),0};
+            lstrcpyn(temp,"avs_trace.json",sizeof(temp));
+            l.hwndOwner = hwndDlg;
+            l.lpstrFilter = "Chrome trace (*.json)\0*.json\0";
+            l.lpstrFile = temp;
+            l.nMaxFile = sizeof(temp)-1;
+            l.lpstrDefExt = "json";
+            l.Flags = OFN_HIDEREADONLY|OFN_EXPLORER|OFN_OVERWRITEPROMPT;
+            if (GetSaveFileName(&l)) C_Profiler::trace(temp,120); // written out once the frames are done
+          }
+        return 0;
         case IDC_BUTTON1:
           EnterCriticalSection(&g_eval_cs);
           last_error_string[0]=0;
@@ -1000,6 +1058,7 @@ static BOOL CALLBACK debugProc(HWND hwndDlg, UINT uMsg, WPARAM wParam,LPARAM lPa
     return 0;
     case WM_DESTROY:
       g_debugwnd=0;
+      C_Profiler::setEnabled(0); // nobody is looking anymore
     return 0;
   }
   return 0;
@@ -42,6 +42,8 @@ extern int cfg_smartbeat, cfg_smartbeatsticky, cfg_smartbeatresetnewsong, cfg_sm
 extern int cfg_transitions, cfg_transitions2, cfg_transitions_speed, cfg_transition_mode;
 extern int cfg_bkgnd_render,cfg_bkgnd_render_color;
 extern int cfg_render_prio;
+extern int cfg_render_scale,cfg_render_scale_fps; // see render_scale.h
+extern int cfg_pace_audio; // see frame_pacer.h
 
 extern char config_pres_subdir[MAX_PATH];
 extern HWND g_hwndDlg;
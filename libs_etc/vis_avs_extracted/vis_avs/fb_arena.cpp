@@ -0,0 +1,237 @@
+/*
+  LICENSE
+  -------
+Copyright 2005 Nullsoft, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, 
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer. 
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution. 
+
+  * Neither the name of Nullsoft nor the names of its contributors may be used to 
+    endorse or promote products derived from this software without specific prior written permission. 
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include <windows.h>
+#include "fb_arena.h"
+
+volatile LONG C_FBArena::m_lock;
+C_FBArena::hdr *C_FBArena::m_free[FB_ARENA_CLASSES];
+unsigned int C_FBArena::m_frame;
+unsigned int C_FBArena::m_cached;
+unsigned int C_FBArena::m_hits, C_FBArena::m_misses;
+const char *C_FBArena::m_owners[FB_ARENA_MAX_OWNERS];
+unsigned int C_FBArena::m_ownerbytes[FB_ARENA_MAX_OWNERS], C_FBArena::m_ownerpeak[FB_ARENA_MAX_OWNERS];
+int C_FBArena::m_ownerblocks[FB_ARENA_MAX_OWNERS];
+int C_FBArena::m_nowners;
+
+// the arena is used from the render thread, the transition loader and the
+// config dialogs, but never for long, so a spinlock does.
+void C_FBArena::lock()
+{
+  while (InterlockedCompareExchange(&m_lock,1,0)) Sleep(0);
+}
+
+void C_FBArena::unlock()
+{
+  InterlockedExchange(&m_lock,0);
+}
+
+// class 0 is 256 bytes, after that four classes per power of two
+// (5/4, 6/4, 7/4 and 8/4 of the one below).
+int C_FBArena::sizeClass(int bytes)
+{
+  int p=8;
+  if (bytes <= 256) return 0;
+  if (bytes > (1<<30)) return FB_ARENA_CLASSES; // nothing that size belongs here
+  while ((bytes-1) >> (p+1)) p++;
+  int q=1<<(p-2);
+  return (p-8)*4 + (bytes-1)/q + 1 - 4;
+}
+
+int C_FBArena::classBytes(int cls)
+{
+  if (!cls) return 256;
+  return (((cls-1)&3)+5) << (8 + (cls-1)/4 - 2);
+}
+
+int C_FBArena::ownerIndex(const char *owner)
+{
+  int x;
+  if (!owner) owner="?";
+  for (x = 0; x < m_nowners; x ++)
+    if (m_owners[x] == owner || !strcmp(m_owners[x],owner)) return x;
+  if (m_nowners >= FB_ARENA_MAX_OWNERS) return FB_ARENA_MAX_OWNERS-1; // lumped together
+  m_owners[m_nowners]=owner;
+  return m_nowners++;
+}
+
+void C_FBArena::release(hdr *h)
+{
+  m_cached-=classBytes(h->cls);
+  GlobalFree(h->raw);
+}
+
+void *C_FBArena::alloc(int bytes, const char *owner, int zero)
+{
+  if (bytes < 1) bytes=1;
+  int cls=sizeClass(bytes), c;
+  if (cls >= FB_ARENA_CLASSES) return NULL;
+
+  hdr *h=NULL;
+  lock();
+  // a block up to four classes bigger (at most twice the size) will do,
+  // which is what lets a shrinking window reuse the bigger buffers
+  for (c = cls; c < cls+4 && c < FB_ARENA_CLASSES; c ++)
+  {
+    if (m_free[c])
+    {
+      h=m_free[c];
+      m_free[c]=h->next;
+      m_cached-=classBytes(c);
+      m_hits++;
+      break;
+    }
+  }
+  if (!h) m_misses++;
+  unlock();
+
+  if (!h)
+  {
+    void *raw=GlobalAlloc(GMEM_FIXED,classBytes(cls)+sizeof(hdr)+FB_ARENA_ALIGN-1);
+    if (!raw) return NULL;
+    UINT_PTR p=((UINT_PTR)raw+sizeof(hdr)+FB_ARENA_ALIGN-1) & ~(UINT_PTR)(FB_ARENA_ALIGN-1);
+    h=(hdr *)p - 1;
+    h->raw=raw;
+    h->cls=cls;
+  }
+  h->next=NULL;
+
+  lock();
+  h->owner=ownerIndex(owner);
+  m_ownerblocks[h->owner]++;
+  m_ownerbytes[h->owner]+=classBytes(h->cls);
+  if (m_ownerbytes[h->owner] > m_ownerpeak[h->owner]) m_ownerpeak[h->owner]=m_ownerbytes[h->owner];
+  unlock();
+
+  if (zero) memset(h+1,0,bytes);
+  return h+1;
+}
+
+void C_FBArena::free(void *p)
+{
+  if (!p) return;
+  hdr *h=(hdr *)p - 1;
+  int cb=classBytes(h->cls);
+
+  lock();
+  m_ownerblocks[h->owner]--;
+  m_ownerbytes[h->owner]-=cb;
+  if (m_cached + cb > FB_ARENA_MAX_CACHED)
+  {
+    unlock();
+    GlobalFree(h->raw);
+    return;
+  }
+  h->lastframe=m_frame;
+  h->next=m_free[h->cls];
+  m_free[h->cls]=h;
+  m_cached+=cb;
+  unlock();
+}
+
+void C_FBArena::endFrame()
+{
+  int x;
+  hdr *rel=NULL;
+  lock();
+  m_frame++;
+  if (!(m_frame & 31)) // no need to look every frame
+  {
+    for (x = 0; x < FB_ARENA_CLASSES; x ++)
+    {
+      hdr **pp=&m_free[x];
+      while (*pp)
+      {
+        hdr *h=*pp;
+        if (m_frame - h->lastframe > FB_ARENA_IDLE_FRAMES)
+        {
+          *pp=h->next;
+          h->next=rel;
+          rel=h;
+        }
+        else pp=&h->next;
+      }
+    }
+  }
+  // GlobalFree() outside the lock
+  x=0;
+  for (hdr *h=rel; h; h=h->next) x+=classBytes(h->cls);
+  m_cached-=x;
+  unlock();
+  while (rel)
+  {
+    hdr *n=rel->next;
+    GlobalFree(rel->raw);
+    rel=n;
+  }
+}
+
+int C_FBArena::report(char *buf, int buflen)
+{
+  int x, pos=0;
+  char line[256];
+  if (buflen < 1) return 0;
+  buf[0]=0;
+  lock();
+  for (x = 0; x < m_nowners; x ++)
+  {
+    if (!m_ownerpeak[x]) continue;
+    wsprintf(line,"%s: %u KB (peak %u KB), %d blocks\r\n",m_owners[x],
+      m_ownerbytes[x]>>10,m_ownerpeak[x]>>10,m_ownerblocks[x]);
+    int l=lstrlen(line);
+    if (pos+l >= buflen) break;
+    memcpy(buf+pos,line,l+1);
+    pos+=l;
+  }
+  wsprintf(line,"cached: %u KB, reused %u of %u\r\n",m_cached>>10,m_hits,m_hits+m_misses);
+  unlock();
+  int l=lstrlen(line);
+  if (pos+l < buflen)
+  {
+    memcpy(buf+pos,line,l+1);
+    pos+=l;
+  }
+  return pos;
+}
+
+void C_FBArena::shutdown()
+{
+  int x;
+  lock();
+  for (x = 0; x < FB_ARENA_CLASSES; x ++)
+  {
+    while (m_free[x])
+    {
+      hdr *h=m_free[x];
+      m_free[x]=h->next;
+      release(h);
+    }
+  }
+  unlock();
+}
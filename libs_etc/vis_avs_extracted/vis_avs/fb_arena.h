@@ -0,0 +1,98 @@
+/*
+  LICENSE
+  -------
+Copyright 2005 Nullsoft, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, 
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer. 
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution. 
+
+  * Neither the name of Nullsoft nor the names of its contributors may be used to 
+    endorse or promote products derived from this software without specific prior written permission. 
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef _FB_ARENA_H_
+#define _FB_ARENA_H_
+
+// Pooled allocator for framebuffers and other per-resolution scratch.
+//
+// Blocks are 64 byte aligned and rounded up to a size class (four classes
+// per power of two). A freed block goes on its class's free list rather
+// than back to the system, so a resize, or flipping between windowed and
+// fullscreen, hands the same memory back out instead of doing a burst of
+// large frees and allocations. endFrame() releases blocks that have sat
+// unused for a while, or that take the cache over its budget.
+//
+// Each block is charged to an owner name (usually the effect's MOD_NAME)
+// so report() can show who is holding how much.
+
+#define FB_ARENA_ALIGN 64
+#define FB_ARENA_CLASSES 128
+#define FB_ARENA_MAX_OWNERS 64
+#define FB_ARENA_IDLE_FRAMES 300 // cached blocks unused this long are freed
+#define FB_ARENA_MAX_CACHED (128*1024*1024)
+
+class C_FBArena
+{
+  public:
+    // zero=1 clears the block, like GPTR. returns NULL on failure.
+    // owner must be a string that outlives the arena (a literal).
+    static void *alloc(int bytes, const char *owner, int zero=1);
+    static void free(void *p); // NULL is ok
+
+    // call once per rendered frame, from the render thread
+    static void endFrame();
+
+    // writes one line per owner (current, peak, blocks) plus cache totals.
+    // returns the length written.
+    static int report(char *buf, int buflen);
+
+    // frees every cached block. blocks that are still allocated stay valid.
+    static void shutdown();
+
+  protected:
+    typedef struct _hdr
+    {
+      void *raw; // what GlobalAlloc() returned
+      struct _hdr *next; // free list
+      int cls;
+      int owner;
+      unsigned int lastframe;
+    } hdr;
+
+    static int sizeClass(int bytes);
+    static int classBytes(int cls);
+    static int ownerIndex(const char *owner);
+    static void lock();
+    static void unlock();
+    static void release(hdr *h);
+
+    static volatile LONG m_lock;
+    static hdr *m_free[FB_ARENA_CLASSES];
+    static unsigned int m_frame;
+    static unsigned int m_cached;
+    static unsigned int m_hits, m_misses;
+
+    static const char *m_owners[FB_ARENA_MAX_OWNERS];
+    static unsigned int m_ownerbytes[FB_ARENA_MAX_OWNERS], m_ownerpeak[FB_ARENA_MAX_OWNERS];
+    static int m_ownerblocks[FB_ARENA_MAX_OWNERS];
+    static int m_nowners;
+};
+
+#endif//_FB_ARENA_H_
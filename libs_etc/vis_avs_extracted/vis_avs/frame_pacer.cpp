@@ -0,0 +1,216 @@
+/*
+  LICENSE
+  -------
+Copyright 2005 Nullsoft, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, 
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer. 
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution. 
+
+  * Neither the name of Nullsoft nor the names of its contributors may be used to 
+    endorse or promote products derived from this software without specific prior written permission. 
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include <windows.h>
+#include <mmsystem.h>
+#include "frame_pacer.h"
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+volatile LONG C_FramePacer::m_lock;
+double C_FramePacer::m_freq;
+double C_FramePacer::m_deadline, C_FramePacer::m_lastframe;
+HANDLE C_FramePacer::m_timer, C_FramePacer::m_audio;
+int C_FramePacer::m_period;
+volatile LONG C_FramePacer::m_gotaudio;
+int C_FramePacer::m_late;
+C_FramePacer::stat C_FramePacer::m_frames, C_FramePacer::m_latency;
+
+// only the debug window reads the stats, a spinlock does
+void C_FramePacer::lock()
+{
+  while (InterlockedCompareExchange(&m_lock,1,0)) Sleep(0);
+}
+
+void C_FramePacer::unlock()
+{
+  InterlockedExchange(&m_lock,0);
+}
+
+void C_FramePacer::init()
+{
+  LARGE_INTEGER f;
+  QueryPerformanceFrequency(&f);
+  m_freq=(double)f.QuadPart/1000.0;
+
+  // high resolution timers are Windows 10 1803 and up, anything else needs
+  // the system timer at 1ms (until quit())
+  typedef HANDLE (WINAPI *CWTE)(LPSECURITY_ATTRIBUTES, LPCWSTR, DWORD, DWORD);
+  CWTE cwte=(CWTE)GetProcAddress(GetModuleHandle("kernel32.dll"),"CreateWaitableTimerExW");
+  if (cwte) m_timer=cwte(NULL,NULL,CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,TIMER_ALL_ACCESS);
+  if (!m_timer)
+  {
+    m_timer=CreateWaitableTimer(NULL,FALSE,NULL);
+    if (!m_period) m_period=(timeBeginPeriod(1) == TIMERR_NOERROR);
+  }
+  m_audio=CreateEvent(NULL,FALSE,FALSE,NULL);
+
+  m_deadline=m_lastframe=0.0;
+  m_gotaudio=0;
+  m_late=0;
+  memset(&m_frames,0,sizeof(m_frames));
+  memset(&m_latency,0,sizeof(m_latency));
+}
+
+void C_FramePacer::quit()
+{
+  if (m_timer) CloseHandle(m_timer);
+  if (m_audio) CloseHandle(m_audio);
+  m_timer=m_audio=NULL;
+  if (m_period) timeEndPeriod(1);
+  m_period=0;
+}
+
+double C_FramePacer::now()
+{
+  LARGE_INTEGER t;
+  QueryPerformanceCounter(&t);
+  return (double)t.QuadPart/m_freq;
+}
+
+void C_FramePacer::sleepUntil(double t)
+{
+  double left;
+  while ((left=t-now()) > 0.05)
+  {
+    LARGE_INTEGER due;
+    due.QuadPart=-(LONGLONG)(left*10000.0); // 100ns units, relative
+    if (m_timer && SetWaitableTimer(m_timer,&due,0,NULL,NULL,FALSE)) WaitForSingleObject(m_timer,INFINITE);
+    else Sleep(max((int)left,1));
+  }
+}
+
+int C_FramePacer::speedToFps(int speed)
+{
+  if (speed <= 0) return 0;
+  if (speed > 80) speed=80;
+  return 1200/(speed+15);
+}
+
+void C_FramePacer::wait(int fps, int audio)
+{
+  double t=now();
+  if (fps > 0)
+  {
+    double interval=1000.0/fps;
+    if (m_deadline <= 0.0) m_deadline=t;
+    m_deadline+=interval;
+    if (m_deadline < t+PACER_MIN_YIELD)
+    {
+      if (m_deadline < t)
+      {
+        lock();
+        m_late++;
+        unlock();
+        if (m_deadline < t-interval) m_deadline=t;
+      }
+      sleepUntil(t+PACER_MIN_YIELD);
+    }
+    else sleepUntil(m_deadline);
+  }
+  else
+  {
+    m_deadline=0.0;
+    sleepUntil(t+PACER_MIN_YIELD);
+  }
+
+  // nothing to wait for until the vis callback has started calling
+  if (audio && m_audio && m_gotaudio)
+  {
+    // whatever arrived during the interval counts, the event stays set
+    if (WaitForSingleObject(m_audio,PACER_AUDIO_TIMEOUT) == WAIT_OBJECT_0) m_deadline=now();
+  }
+}
+
+void C_FramePacer::audioArrived()
+{
+  m_gotaudio=1;
+  if (m_audio) SetEvent(m_audio);
+}
+
+void C_FramePacer::add(stat *s, double ms)
+{
+  int b=(int)(ms*10.0);
+  if (b < 0) b=0;
+  if (b >= PACER_BUCKETS) b=PACER_BUCKETS-1;
+  if (s->n == PACER_WINDOW) s->hist[s->ring[s->pos]]--;
+  else s->n++;
+  s->hist[b]++;
+  s->ring[s->pos]=(unsigned short)b;
+  if (++s->pos == PACER_WINDOW) s->pos=0;
+}
+
+int C_FramePacer::percentile(stat *s, int pct)
+{
+  int want=(s->n*pct+99)/100, sum=0, x;
+  for (x = 0; x < PACER_BUCKETS-1; x ++)
+  {
+    sum+=s->hist[x];
+    if (sum >= want) break;
+  }
+  return x;
+}
+
+void C_FramePacer::framePresented(double audiotime)
+{
+  double t=now();
+  lock();
+  if (m_lastframe > 0.0) add(&m_frames,t-m_lastframe);
+  if (audiotime > 0.0) add(&m_latency,t-audiotime);
+  unlock();
+  m_lastframe=t;
+}
+
+int C_FramePacer::report(char *buf, int buflen)
+{
+  char line[512];
+  int l=0;
+  if (buflen < 1) return 0;
+  buf[0]=0;
+  lock();
+  stat *s[2]={&m_frames,&m_latency};
+  const char *names[2]={"frame time","audio to screen"};
+  int x;
+  for (x = 0; x < 2; x ++)
+  {
+    if (!s[x]->n) continue;
+    int p50=percentile(s[x],50), p95=percentile(s[x],95), p99=percentile(s[x],99), p100=percentile(s[x],100);
+    wsprintf(line+l,"%s (ms): median %d.%d, 95%% %d.%d, 99%% %d.%d, max %s%d.%d\r\n",names[x],
+      p50/10,p50%10,p95/10,p95%10,p99/10,p99%10,p100==PACER_BUCKETS-1?">":"",p100/10,p100%10);
+    l+=lstrlen(line+l);
+  }
+  if (m_frames.n) wsprintf(line+l,"late frames: %d\r\n",m_late);
+  unlock();
+  l=min(lstrlen(line),buflen-1);
+  memcpy(buf,line,l);
+  buf[l]=0;
+  return l;
+}
@@ -0,0 +1,108 @@
+/*
+  LICENSE
+  -------
+Copyright 2005 Nullsoft, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, 
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer. 
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution. 
+
+  * Neither the name of Nullsoft nor the names of its contributors may be used to 
+    endorse or promote products derived from this software without specific prior written permission. 
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef _FRAME_PACER_H_
+#define _FRAME_PACER_H_
+
+// Frame pacing for the render thread.
+//
+// Frames are scheduled against absolute deadlines, one interval apart, so
+// the frame rate is set by the interval and not by how long each frame
+// took plus however long Sleep() felt like. A frame that runs late starts
+// the next one after PACER_MIN_YIELD, and once more than a whole interval
+// is lost the schedule restarts from now instead of trying to catch up.
+// Every frame gives up at least PACER_MIN_YIELD, as the old Sleep() did.
+//
+// The performance sliders cap the frame rate, see speedToFps().
+//
+// With audio pacing, a frame starts as soon as the vis callback hands over
+// new audio (once the interval has passed), so what's on screen is never
+// more than one render behind the audio it was made from.
+//
+// The time between frames and the time from audio arrival to the frame
+// being shown are kept for the last PACER_WINDOW frames, for report().
+
+#define PACER_BUCKETS 1000 // 0.1ms each, the last one takes anything longer
+#define PACER_WINDOW 512
+#define PACER_AUDIO_TIMEOUT 33 // ms to wait for audio before going ahead anyway
+#define PACER_MIN_YIELD 1.0 // ms given up after every frame, however late
+
+class C_FramePacer
+{
+  public:
+    static void init();
+    static void quit();
+
+    static double now(); // ms
+
+    // frame rate cap for a performance slider position (0-80, left is
+    // "higher framerate"): 0 is no cap, 1-80 go from 75 down to 12 fps,
+    // with the default of 5 at 60.
+    static int speedToFps(int speed);
+
+    // blocks until the next frame is due, 1000/fps ms after the last
+    // (fps=0 is no cap, only PACER_MIN_YIELD). audio=1 also waits for
+    // audioArrived(), up to PACER_AUDIO_TIMEOUT.
+    static void wait(int fps, int audio);
+
+    // from the vis callback, whenever new audio has been copied in
+    static void audioArrived();
+
+    // right after a frame is shown. audiotime is now() as of the audio it was
+    // made from, 0 if unknown.
+    static void framePresented(double audiotime);
+
+    // frame time and latency percentiles. returns the length written.
+    static int report(char *buf, int buflen);
+
+  protected:
+    typedef struct
+    {
+      int hist[PACER_BUCKETS];
+      unsigned short ring[PACER_WINDOW];
+      int pos, n;
+    } stat;
+
+    static void add(stat *s, double ms);
+    static int percentile(stat *s, int pct); // in buckets
+    static void sleepUntil(double t);
+    static void lock();
+    static void unlock();
+
+    static volatile LONG m_lock;
+    static double m_freq;
+    static double m_deadline, m_lastframe;
+    static HANDLE m_timer, m_audio;
+    static int m_period; // timeBeginPeriod(1) is in effect
+    static volatile LONG m_gotaudio;
+    static int m_late;
+    static stat m_frames, m_latency;
+};
+
+#endif//_FRAME_PACER_H_
@@ -0,0 +1,210 @@
+/*
+  LICENSE
+  -------
+Copyright 2005 Nullsoft, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, 
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer. 
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution. 
+
+  * Neither the name of Nullsoft nor the names of its contributors may be used to 
+    endorse or promote products derived from this software without specific prior written permission. 
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include <windows.h>
+#include "frame_ring.h"
+#include "fb_arena.h"
+
+#define FRAME_RING_MINRUN 3 // shorter runs are cheaper as literals
+
+C_FrameRing::C_FrameRing()
+{
+  m_owner="Frame ring";
+  m_slots=NULL;
+  m_nslots=m_first=m_count=0;
+  m_length=1;
+  m_w=m_h=0;
+  m_used=0;
+  m_budget=64*1024*1024;
+  m_scratch=NULL;
+  m_scratchwords=0;
+}
+
+C_FrameRing::~C_FrameRing()
+{
+  clear();
+  if (m_slots) GlobalFree(m_slots);
+  if (m_scratch) C_FBArena::free(m_scratch);
+}
+
+void C_FrameRing::drop()
+{
+  if (!m_count) return;
+  slot *s=&m_slots[m_first];
+  C_FBArena::free(s->data);
+  s->data=NULL;
+  m_used-=s->size;
+  s->size=0;
+  m_first=(m_first+1)%m_nslots;
+  m_count--;
+}
+
+void C_FrameRing::clear()
+{
+  while (m_count) drop();
+  m_first=0;
+}
+
+void C_FrameRing::setLength(int frames)
+{
+  if (frames < 1) frames=1;
+  m_length=frames;
+  if (frames == m_nslots) return;
+
+  // keep the newest frames that still fit, oldest first in the new array
+  while (m_count > frames) drop();
+  slot *n=(slot *)GlobalAlloc(GPTR,frames*sizeof(slot));
+  if (!n) return; // put() tries again
+  int x;
+  for (x = 0; x < m_count; x ++) n[x]=m_slots[(m_first+x)%m_nslots];
+  if (m_slots) GlobalFree(m_slots);
+  m_slots=n;
+  m_nslots=frames;
+  m_first=0;
+}
+
+int C_FrameRing::encode(const unsigned int *fb, int w, int h)
+{
+  unsigned int *o=m_scratch;
+  int y;
+  for (y = 0; y < h; y ++)
+  {
+    const unsigned int *row=fb+y*w;
+    if (y && !memcmp(row,row-w,w*sizeof(int)))
+    {
+      *o++=0;
+      continue;
+    }
+    int x=0, lit=0;
+    while (x < w)
+    {
+      unsigned int v=row[x];
+      int r=1;
+      while (x+r < w && row[x+r] == v) r++;
+      if (r >= FRAME_RING_MINRUN)
+      {
+        if (x > lit)
+        {
+          *o++=x-lit;
+          memcpy(o,row+lit,(x-lit)*sizeof(int));
+          o+=x-lit;
+        }
+        *o++=0x80000000|r;
+        *o++=v;
+        lit=x+r;
+      }
+      x+=r;
+    }
+    if (w > lit)
+    {
+      *o++=w-lit;
+      memcpy(o,row+lit,(w-lit)*sizeof(int));
+      o+=w-lit;
+    }
+  }
+  return o-m_scratch;
+}
+
+void C_FrameRing::decode(const unsigned int *in, unsigned int *fb, int w, int h)
+{
+  int y;
+  for (y = 0; y < h; y ++)
+  {
+    unsigned int *out=fb+y*w;
+    if (!*in)
+    {
+      memcpy(out,out-w,w*sizeof(int));
+      in++;
+      continue;
+    }
+    int x=0;
+    while (x < w)
+    {
+      unsigned int c=*in++;
+      if (c&0x80000000)
+      {
+        unsigned int v=*in++, *p=out+x;
+        int n=c&0x7fffffff;
+        x+=n;
+        while (n--) *p++=v;
+      }
+      else
+      {
+        memcpy(out+x,in,c*sizeof(int));
+        in+=c;
+        x+=c;
+      }
+    }
+  }
+}
+
+int C_FrameRing::put(unsigned int stamp, const int *fb, int w, int h)
+{
+  if (w != m_w || h != m_h)
+  {
+    clear();
+    m_w=w;
+    m_h=h;
+  }
+  // each packet covers at least as many pixels as it has words of payload,
+  // plus one header per row
+  if (m_scratchwords < (w+1)*h)
+  {
+    if (m_scratch) C_FBArena::free(m_scratch);
+    m_scratchwords=(w+1)*h;
+    m_scratch=(unsigned int *)C_FBArena::alloc(m_scratchwords*sizeof(int),m_owner,0);
+    if (!m_scratch) { m_scratchwords=0; return 0; }
+  }
+  if (m_nslots != m_length) setLength(m_length);
+  if (!m_slots) return 0;
+
+  unsigned int size=encode((const unsigned int *)fb,w,h)*sizeof(int);
+  while (m_count >= m_nslots) drop();
+  while (m_count && m_used + size > m_budget) drop();
+
+  slot *s=&m_slots[(m_first+m_count)%m_nslots];
+  s->data=(unsigned int *)C_FBArena::alloc(size,m_owner,0);
+  if (!s->data) return 0;
+  memcpy(s->data,m_scratch,size);
+  s->size=size;
+  s->stamp=stamp;
+  m_used+=size;
+  m_count++;
+  return 1;
+}
+
+int C_FrameRing::get(unsigned int stamp, int *fb, int w, int h)
+{
+  int x;
+  if (!m_count || w != m_w || h != m_h) return 0;
+  for (x = m_count-1; x > 0; x --)
+    if ((int)(m_slots[(m_first+x)%m_nslots].stamp - stamp) <= 0) break;
+  decode(m_slots[(m_first+x)%m_nslots].data,(unsigned int *)fb,w,h);
+  return 1;
+}
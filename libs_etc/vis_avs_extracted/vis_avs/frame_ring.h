@@ -0,0 +1,85 @@
+/*
+  LICENSE
+  -------
+Copyright 2005 Nullsoft, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, 
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer. 
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution. 
+
+  * Neither the name of Nullsoft nor the names of its contributors may be used to 
+    endorse or promote products derived from this software without specific prior written permission. 
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef _FRAME_RING_H_
+#define _FRAME_RING_H_
+
+// Ring of losslessly compressed frames, for the delay effects.
+//
+// Every row is either a copy of the row above (one zero word) or a list of
+// packets: a word with bit 31 set is a run of (word&0x7fffffff) copies of
+// the next word, any other nonzero word is that many literal pixels. The
+// encoder is one pass of compares and the decoder is memcpy()s and fills,
+// so both stay well under the cost of the copies they replace.
+//
+// Frames are stamped by the caller. get() returns the newest frame with a
+// stamp at or before the one asked for, so a delay longer than what fits
+// in the budget plays the oldest frame still kept.
+
+class C_FrameRing
+{
+  public:
+    C_FrameRing();
+    ~C_FrameRing();
+
+    void setOwner(const char *owner) { m_owner=owner; } // for C_FBArena::report()
+    void setBudget(unsigned int bytes) { m_budget=bytes; }
+    void setLength(int frames); // frames kept at most, including the newest
+    void clear();
+
+    // returns 0 if out of memory
+    int put(unsigned int stamp, const int *fb, int w, int h);
+    // returns 0 (and leaves fb alone) if nothing was stored at this size
+    int get(unsigned int stamp, int *fb, int w, int h);
+
+    unsigned int bytesUsed() { return m_used; }
+    int count() { return m_count; }
+
+  protected:
+    typedef struct
+    {
+      unsigned int stamp;
+      unsigned int size; // bytes
+      unsigned int *data;
+    } slot;
+
+    int encode(const unsigned int *fb, int w, int h); // into m_scratch, returns words
+    static void decode(const unsigned int *in, unsigned int *fb, int w, int h);
+    void drop(); // oldest
+
+    const char *m_owner;
+    slot *m_slots;
+    int m_nslots, m_first, m_count, m_length;
+    int m_w, m_h;
+    unsigned int m_used, m_budget;
+    unsigned int *m_scratch;
+    int m_scratchwords;
+};
+
+#endif//_FRAME_RING_H_
@@ -29,23 +29,54 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 #include <windows.h>
 #include "r_defs.h"
+#include "smp_pool.h"
 #include <math.h>
 
 #define SWAP(x,y,temp) ( temp ) = ( x ); ( x ) = ( y ); ( y ) = ( temp )
 #define ABS(x) (( x ) < 0 ? - ( x ) : ( x ))
 
-void line(int *fb, int x1,int y1,int x2,int y2, int width, int height, int color, int lw) 
+extern int g_config_smp_mt,g_config_smp;
+
+// BLEND_LINE with the blend mode known at compile time. v is the
+// adjustable blend value.
+template <int BM> static __inline void blend_pixel(int *fb, int color, int v)
+{
+  switch (BM)
+  {
+    case 1: *fb=BLEND(*fb,color); break;
+    case 2: *fb=BLEND_MAX(*fb,color); break;
+    case 3: *fb=BLEND_AVG(*fb,color); break;
+    case 4: *fb=BLEND_SUB(*fb,color); break;
+    case 5: *fb=BLEND_SUB(color,*fb); break;
+    case 6: *fb=BLEND_MUL(*fb,color); break;
+    case 7: *fb=BLEND_ADJ_NOMMX(*fb,color,v); break;
+    case 8: *fb=*fb^color; break;
+    case 9: *fb=BLEND_MIN(*fb,color); break;
+    default: *fb=color; break;
+  }
+}
+
+// advances a line k steps along its major axis (length ma) in one go, from
+// the starting error term d. returns how far the minor axis (length mi)
+// moved and updates d, same as k iterations of the loops below would.
+static __inline int line_skip(int ma, int mi, int k, int *d)
+{
+  int n=(int)(((__int64)2*mi*k+ma)/(2*ma));
+  *d=(int)(*d+(__int64)2*mi*k-(__int64)2*ma*n);
+  return n;
+}
+
+// draws the pixels of the line that are in rows [ys,ye), exactly as they
+// would be drawn with the whole line at once.
+template <int BM> static void line_rows(int *fb, int x1,int y1,int x2,int y2, int width, int height, int color, int lw, int v, int ys, int ye)
 {
   int dy = ABS(y2-y1); 
   int dx = ABS(x2-x1);
 
-#ifdef LASER
-  lw=1;
-  #define BLEND_LINE(fb,color) (*(fb)=BLEND(*(fb),(color)))
-#else
   if (lw<1) lw=1;
   else if (lw>255)lw=255;
-#endif
+  if (ys<0) ys=0;
+  if (ye>height) ye=height;
 
   int lw2=lw/2;
   if (!dx) // optimize vertical draw
@@ -53,24 +84,23 @@ void line(int *fb, int x1,int y1,int x2,int y2, int width, int height, int color
     x1-=lw2;
     if (x1+lw >= 0 && x1 < width) 
     {
-      int d=max(min(y1,y2),0);
-	    int ye=min(max(y1,y2),height-1);
+      int d=max(min(y1,y2),ys);
+      int e=min(max(y1,y2),height-1); // the last row isn't drawn
+      if (e > ye) e=ye;
       if (x1<0)
       {
         lw+=x1;
         x1=0;
       }
       if (x1+lw >= width) lw=width-x1;
-	    fb += d*width+x1;
-      width-=lw;
-	    if (lw>0) while (d++ < ye)
+      if (lw>0) for (; d < e; d ++)
       {
+        int *p=fb+d*width+x1;
         int x=lw;
-        while (x--) { BLEND_LINE(fb, color); fb++; }
-		    fb+=width;
-	    }
+        while (x--) blend_pixel<BM>(p++,color,v);
+      }
     }
-	  return;
+    return;
   }
   if (y1==y2) // optimize horizontal draw.
   {
@@ -82,19 +112,15 @@ void line(int *fb, int x1,int y1,int x2,int y2, int width, int height, int color
       if (y1<0)
       {
         lw+=y1;
-       
-        
         y1=0;
       }
       if (y1+lw >= height) lw=height-y1;
-      fb+=y1*width+d;
-      width-=xe-d;
-      int y=lw;
-      while (y--)
+      int y=max(y1,ys), e=min(y1+lw,ye);
+      for (; y < e; y ++)
       {
+        int *p=fb+y*width+d;
         int lt=d;
-        while (lt++<xe) { BLEND_LINE(fb,color); fb++; }
-        fb+=width;
+        while (lt++<xe) blend_pixel<BM>(p++,color,v);
       }
     }
     return;
@@ -102,46 +128,6 @@ void line(int *fb, int x1,int y1,int x2,int y2, int width, int height, int color
 
   if (dy <= dx)  // x major, low slope
   {
-    // first things first for better line drawing, let's see if we can't get the 
-    // width calculated right.
-    // lw is the width in pixels. if dy = 0, then lw=lw. if dy=dx, then:
-    /*
-
-
-        __________ C=30d
-       |\
-       | \ lw
-       |  \_____ A=90d
-    ?  |  /       
-       | /   pc2
-       |/ ____ B = 60d
-
-       tan(C) = sin(C)/cos(C) = (dy / dx)
-       cos(C) = lw / ?
-
-        sin(C)/(lw / ? ) = (dy / dx)
-        sin(C) * ? / lw = (dy/dx)
-        sin(C) * ?  = lw * dy/dx;
-        ? = lw * dy/dx / sin(C)
-
-
-        cos(C) = lw / ?  === ? = lw / cos(C)
-        tan(C) = dy / dx;
-
-        C = atan2(dy,dx);
-        ? = lw / cos(C)
-
-    */
-
-#if 0// lame
-    if (lw>1 && (GetAsyncKeyState(VK_SHIFT)&0x8000)){
-      double d=atan2((double)dy,(double)dx);
-      lw = (int) (lw / cos(d));
-      if (lw<1)lw=1;
-    }
-#endif
-
-
     if (x2 < x1) 
     {
       int temp;
@@ -170,20 +156,33 @@ void line(int *fb, int x1,int y1,int x2,int y2, int width, int height, int color
       }
 
       if (x2 > width) x2=width;
+
+      // skip the columns whose span is entirely before the rows
+      int need=yincr > 0 ? ys-(y1+lw)+1 : y1-ye+1;
+      if (need > 0 && x1 < x2)
+      {
+        int k=(int)(((__int64)2*dx*need-dx+2*dy-1)/(2*dy));
+        if (k > x2-x1) k=x2-x1;
+        int n=line_skip(dx,dy,k,&d);
+        y1+=yincr*n;
+        offs+=offsincr*n+k;
+        x1+=k;
+      }
       while (x1<x2)
       {
         int yp=y1;
         int ype=y1+lw;
+        if (yincr > 0 ? yp >= ye : ype <= ys) break; // moving away from the rows
         int *newfb=fb+offs;
-        if (yp < 0) 
+        if (yp < ys) 
         {
-          newfb-=yp*width;
-          yp=0;
+          newfb+=(ys-yp)*width;
+          yp=ys;
         }
-        if (ype>height) ype=height;
+        if (ype>ye) ype=ye;
         while (yp++ < ype)
         {
-          BLEND_LINE(newfb,color);
+          blend_pixel<BM>(newfb,color,v);
           newfb+=width;
         }
         if (d < 0) d += Eincr;
@@ -200,13 +199,6 @@ void line(int *fb, int x1,int y1,int x2,int y2, int width, int height, int color
   } 
   else
   {
-#if 0//lame
-    if (lw>1 && (GetAsyncKeyState(VK_SHIFT)&0x8000)){
-      double d=atan2((double)dx,(double)dy);
-      lw = (int) (lw / cos(d));
-      if (lw<1)lw=1;
-    }
-#endif
     if (y2 < y1) 
     {
       int temp;
@@ -232,7 +224,15 @@ void line(int *fb, int x1,int y1,int x2,int y2, int width, int height, int color
         offs += v - y1*width;
         y1=0;
       }
-      if (y2 > height) y2 = height;
+      if (y2 > ye) y2 = ye;
+      if (y1 < ys && y1 < y2)
+      {
+        int k=min(ys,y2)-y1;
+        int n=line_skip(dy,dx,k,&d);
+        x1+=yincr*n;
+        offs+=yincr*n+k*width;
+        y1+=k;
+      }
       while (y1 < y2)
       {
         int xp=x1;
@@ -244,7 +244,7 @@ void line(int *fb, int x1,int y1,int x2,int y2, int width, int height, int color
           xp=0;
         }
         if (xpe > width) xpe=width;
-        while (xp++ < xpe) { BLEND_LINE(newfb, color); newfb++; }
+        while (xp++ < xpe) blend_pixel<BM>(newfb++,color,v);
 
         if (d < 0) d += Eincr;
         else 
@@ -259,3 +259,205 @@ void line(int *fb, int x1,int y1,int x2,int y2, int width, int height, int color
     }
   }
 }
+
+typedef void (*lineRowsProc)(int *fb, int x1,int y1,int x2,int y2, int width, int height, int color, int lw, int v, int ys, int ye);
+
+static const lineRowsProc line_procs[10]=
+{
+  line_rows<0>, line_rows<1>, line_rows<2>, line_rows<3>, line_rows<4>,
+  line_rows<5>, line_rows<6>, line_rows<7>, line_rows<8>, line_rows<9>,
+};
+
+static lineRowsProc getLineProc(int *v)
+{
+#ifdef LASER
+  *v=0;
+  return line_rows<1>;
+#else
+  int bm=g_line_blend_mode&0xff;
+  *v=(g_line_blend_mode>>8)&0xff;
+  return line_procs[bm < 10 ? bm : 0];
+#endif
+}
+
+void line(int *fb, int x1,int y1,int x2,int y2, int width, int height, int color, int lw) 
+{
+  int v;
+#ifdef LASER
+  lw=1;
+#endif
+  getLineProc(&v)(fb,x1,y1,x2,y2,width,height,color,lw,v,0,height);
+}
+
+
+/////////////////////// C_LineBatch
+
+#define LINEBATCH_MINPRIMS 64 // fewer than that aren't worth waking threads for
+#define LINEBATCH_BANDS_PER_THREAD 4
+#define LINEBATCH_MINROWS 16
+
+C_LineBatch::C_LineBatch()
+{
+  prims=NULL;
+  nprims=prims_alloc=0;
+  bins=NULL;
+  bins_alloc=0;
+  nbands=0;
+}
+
+C_LineBatch::~C_LineBatch()
+{
+  free(prims);
+  free(bins);
+}
+
+void C_LineBatch::add(int x1, int y1, int x2, int y2, int color, int lw)
+{
+  if (nprims >= prims_alloc)
+  {
+    int na=prims_alloc ? prims_alloc*2 : 1024;
+    linePrim *np=(linePrim *)realloc(prims,na*sizeof(linePrim));
+    if (!np) return;
+    prims=np;
+    prims_alloc=na;
+  }
+  linePrim *p=prims+nprims++;
+  p->x1=x1;
+  p->y1=y1;
+  p->x2=x2;
+  p->y2=y2;
+  p->color=color;
+  p->lw=lw;
+}
+
+void C_LineBatch::line(int x1, int y1, int x2, int y2, int color, int lw)
+{
+#ifdef LASER
+  lw=1;
+#else
+  if (lw<1) lw=1;
+  else if (lw>255) lw=255;
+#endif
+  add(x1,y1,x2,y2,color,lw);
+}
+
+void C_LineBatch::point(int x, int y, int color)
+{
+  add(x,y,x,y,color,0);
+}
+
+void C_LineBatch::drawBand(int band)
+{
+  int ys=bandstart[band], ye=bandstart[band+1];
+  int *idx=nbands > 1 ? bins+binstart[band] : NULL;
+  int n=nbands > 1 ? binstart[band+1]-binstart[band] : nprims;
+  int i;
+  for (i = 0; i < n; i ++)
+  {
+    linePrim *p=prims+(idx ? idx[i] : i);
+    if (p->lw) d_proc(d_fb,p->x1,p->y1,p->x2,p->y2,d_w,d_h,p->color,p->lw,d_v,ys,ye);
+    else if (p->y1 >= ys && p->y1 < ye && p->x1 >= 0 && p->x1 < d_w) 
+      d_pointproc(d_fb+p->x1+p->y1*d_w,p->color,d_v);
+  }
+}
+
+void C_LineBatch::bandProc(void *ctx, int tile, int ntiles)
+{
+  ((C_LineBatch *)ctx)->drawBand(tile);
+}
+
+template <int BM> static void point_proc(int *fb, int color, int v) { blend_pixel<BM>(fb,color,v); }
+
+static void (* const point_procs[10])(int *fb, int color, int v)=
+{
+  point_proc<0>, point_proc<1>, point_proc<2>, point_proc<3>, point_proc<4>,
+  point_proc<5>, point_proc<6>, point_proc<7>, point_proc<8>, point_proc<9>,
+};
+
+void C_LineBatch::draw(int *fb, int w, int h)
+{
+  int nthreads=g_config_smp ? g_config_smp_mt : 1;
+  int x;
+  if (!nprims) return;
+  if (w < 1 || h < 1) { nprims=0; return; }
+
+  d_fb=fb;
+  d_w=w;
+  d_h=h;
+  d_proc=getLineProc(&d_v);
+#ifdef LASER
+  d_pointproc=point_proc<1>;
+#else
+  d_pointproc=point_procs[(g_line_blend_mode&0xff) < 10 ? (g_line_blend_mode&0xff) : 0];
+#endif
+
+  nbands=1;
+  if (nthreads > 1 && nprims >= LINEBATCH_MINPRIMS)
+  {
+    nbands=min(nthreads*LINEBATCH_BANDS_PER_THREAD,h/LINEBATCH_MINROWS);
+    if (nbands > LINEBATCH_MAXBANDS) nbands=LINEBATCH_MAXBANDS;
+    if (nbands < 1) nbands=1;
+  }
+  for (x = 0; x <= nbands; x ++) bandstart[x]=(x*h)/nbands;
+
+  if (nbands > 1)
+  {
+    // bin the primitives by the bands their rows (plus the line width) can
+    // reach. every band draws its own in the order they were added, so
+    // overlapping primitives blend the same as when drawn one by one.
+    int nrefs=0, b;
+    memset(binstart,0,sizeof(binstart));
+    for (x = 0; x < nprims; x ++)
+    {
+      int b0, b1;
+      if (binRange(prims+x,&b0,&b1)) for (b = b0; b <= b1; b ++) binstart[b+1]++;
+    }
+    for (b = 0; b < nbands; b ++) binstart[b+1]+=binstart[b];
+    nrefs=binstart[nbands];
+    if (nrefs > bins_alloc)
+    {
+      int *nb=(int *)realloc(bins,nrefs*sizeof(int));
+      if (!nb) nbands=1;
+      else
+      {
+        bins=nb;
+        bins_alloc=nrefs;
+      }
+    }
+    if (nbands > 1)
+    {
+      int pos[LINEBATCH_MAXBANDS];
+      memcpy(pos,binstart,nbands*sizeof(int));
+      for (x = 0; x < nprims; x ++)
+      {
+        int b0, b1;
+        if (binRange(prims+x,&b0,&b1)) for (b = b0; b <= b1; b ++) bins[pos[b]++]=x;
+      }
+      C_SmpPool::run(nthreads,nbands,bandProc,this);
+    }
+    else bandstart[1]=h;
+  }
+  if (nbands == 1) drawBand(0);
+
+  nprims=0;
+}
+
+// bands a primitive can touch, 0 if none
+int C_LineBatch::binRange(linePrim *p, int *b0, int *b1)
+{
+  int ylo=min(p->y1,p->y2)-p->lw, yhi=max(p->y1,p->y2)+p->lw;
+  if (ylo < 0) ylo=0;
+  if (yhi >= d_h) yhi=d_h-1;
+  if (ylo > yhi) return 0;
+  *b0=bandOf(ylo);
+  *b1=bandOf(yhi);
+  return 1;
+}
+
+int C_LineBatch::bandOf(int y)
+{
+  int b=(y*nbands)/d_h;
+  while (b > 0 && bandstart[b] > y) b--;
+  while (b < nbands-1 && bandstart[b+1] <= y) b++;
+  return b;
+}
@@ -120,10 +120,9 @@ static void config(struct winampVisModule *this_mod)
 }
 
 CRITICAL_SECTION g_render_cs;
-static int g_is_beat;
 char g_path[1024];
 
-int beat_peak1,beat_peak2, beat_cnt,beat_peak1_peak;
+static C_OnsetDetector g_onset; // fed from the vis callback (or the render thread for reaplay)
 
 void main_setRenderThreadPriority()
 {
@@ -154,6 +153,7 @@ static int init(struct winampVisModule *this_mod)
 #endif
   GetSystemTimeAsFileTime(&ft);
   srand(ft.dwLowDateTime|ft.dwHighDateTime^GetCurrentThreadId());
+  C_Rng::setGlobalSeed(ft.dwLowDateTime^ft.dwHighDateTime^GetCurrentThreadId());
 	g_hInstance=this_mod->hDllInstance;
 	GetModuleFileName(g_hInstance,g_path,MAX_PATH);
 	char *p=g_path+strlen(g_path);
@@ -188,14 +188,19 @@ static int init(struct winampVisModule *this_mod)
 #endif
   CreateDirectory(g_path,NULL);
 
-	InitializeCriticalSection(&g_cs);
 	InitializeCriticalSection(&g_render_cs);
 	g_ThreadQuit=0;
-	g_visdata_pstat=1;
+  C_AudioRing::reset();
+  g_onset.reset();
 
   AVS_EEL_IF_init();
+  C_FramePacer::init();
 
-	if (Wnd_Init(this_mod)) return 1;
+	if (Wnd_Init(this_mod))
+  {
+    C_FramePacer::quit();
+    return 1;
+  }
 
 	{
 		int x;
@@ -225,69 +230,19 @@ static int init(struct winampVisModule *this_mod)
 
 static int render(struct winampVisModule *this_mod)
 {
-	int x,avs_beat=0,b;
+	int x,beat;
+	char visdata[2][2][576];
+	double t,onset;
 	if (g_ThreadQuit) return 1;
-  EnterCriticalSection(&g_cs);
-	if (g_ThreadQuit)
-	{
-		LeaveCriticalSection(&g_cs);
-		return 1;
-	}
-	if (g_visdata_pstat)
-		for (x = 0; x<  576*2; x ++)
-			g_visdata[0][0][x]=g_logtab[(unsigned char)this_mod->spectrumData[0][x]];
-	else 
-	{
-		for (x = 0; x < 576*2; x ++)
-		{ 
-			int t=g_logtab[(unsigned char)this_mod->spectrumData[0][x]];
-			if (g_visdata[0][0][x] < t)
-				g_visdata[0][0][x] = t;
-		}
-	}
-	memcpy(&g_visdata[1][0][0],this_mod->waveformData,576*2);
-	{
-    int lt[2]={0,0};
-    int x;
-    int ch;
-    for (ch = 0; ch < 2; ch ++)
-    {
-      unsigned char *f=(unsigned char*)&this_mod->waveformData[ch][0];
-      for (x = 0; x < 576; x ++)
-      {
-        int r= *f++^128;
-        r-=128;
-        if (r<0)r=-r;
-        lt[ch]+=r;
-      }
-    }
-    lt[0]=max(lt[0],lt[1]);
-
-    beat_peak1=(beat_peak1*125+beat_peak2*3)/128;
-
-    beat_cnt++;
-
-    if (lt[0] >= (beat_peak1*34)/32 && lt[0] > (576*16)) 
-    {
-      if (beat_cnt>0)
-      {
-        beat_cnt=0;
-        avs_beat=1;
-      }
-      beat_peak1=(lt[0]+beat_peak1_peak)/2;
-      beat_peak1_peak=lt[0];
-    }
-    else if (lt[0] > beat_peak2)
-    {
-      beat_peak2=lt[0];
-    } 
-    else beat_peak2=(beat_peak2*14)/16;
-
-	}
-	b=refineBeat(avs_beat);
-	if (b) g_is_beat=1;
-	g_visdata_pstat=0;
-	LeaveCriticalSection(&g_cs);
+	for (x = 0; x<  576*2; x ++)
+		visdata[0][0][x]=g_logtab[(unsigned char)this_mod->spectrumData[0][x]];
+	memcpy(&visdata[1][0][0],this_mod->waveformData,576*2);
+  t=C_FramePacer::now();
+  beat=g_onset.process(this_mod->spectrumData,this_mod->waveformData,this_mod->sRate,t,&onset);
+  // refineBeat() keeps time in GetTickCount() ms
+  beat=refineBeat(beat,GetTickCount()-(beat?(DWORD)(t-onset):0),g_onset.tempo());
+  C_AudioRing::write(visdata,t,beat);
+  C_FramePacer::audioArrived();
   return 0;
 }
 
@@ -324,11 +279,12 @@ static void quit(struct winampVisModule *this_mod)
     AVS_EEL_IF_quit();
 
     DS("cleaning up critsections\n");
-		DeleteCriticalSection(&g_cs);
 		DeleteCriticalSection(&g_render_cs);    
 
     DS("smp_cleanupthreads\n");
     C_RenderListClass::smp_cleanupthreads();
+    C_FBArena::shutdown();
+    C_FramePacer::quit();
 	}
 #undef DS
 #if 0//syntax highlighting
@@ -345,12 +301,13 @@ static unsigned int WINAPI RenderThread(LPVOID a)
 	int framedata_pos=0;
   int s=0;
 	char vis_data[2][2][576];
-  FILETIME ft;
-  GetSystemTimeAsFileTime(&ft);
-  srand(ft.dwLowDateTime|ft.dwHighDateTime^GetCurrentThreadId());
+  C_RenderScale *rscale=new C_RenderScale;
+  double render_ms=0.0; // from taking the audio to showing the frame, smoothed
+  memset(vis_data,0,sizeof(vis_data));
 	while (!g_ThreadQuit)
 	{
 		int w,h,*fb=NULL, *fb2=NULL,beat=0;
+    double audiotime=0.0, t0=C_FramePacer::now();
 
 #ifdef REAPLAY_PLUGIN
     if(!IsWindowVisible(g_hwnd)) 
@@ -375,53 +332,21 @@ static unsigned int WINAPI RenderThread(LPVOID a)
 		  for (x = 0; x < 576*2; x ++)
         ((unsigned char *)vis_data[1][0])[x]=*v++;
 
-      v=(unsigned char *)visdata+1152;
-	    {
-        int lt[2]={0,0};
-        int ch;
-        for (ch = 0; ch < 2; ch ++)
-        {
-          for (x = 0; x < 576; x ++)
-          {
-            int r=*v++^128;
-            r-=128;
-            if (r<0)r=-r;
-            lt[ch]+=r;
-          }
-        }
-        lt[0]=max(lt[0],lt[1]);
-
-        beat_peak1=(beat_peak1*125+beat_peak2*3)/128;
-        beat_cnt++;
-
-        if (lt[0] >= (beat_peak1*34)/32 && lt[0] > (576*16)) 
-        {
-          if (beat_cnt>0)
-          {
-            beat_cnt=0;
-            beat=1;
-          }
-          beat_peak1=(lt[0]+beat_peak1_peak)/2;
-          beat_peak1_peak=lt[0];
-        }
-        else if (lt[0] > beat_peak2)
-        {
-          beat_peak2=lt[0];
-        } 
-        else beat_peak2=(beat_peak2*14)/16;
-
-	    }
+      double t=C_FramePacer::now(), onset;
+      beat=g_onset.process((unsigned char (*)[576])visdata,(unsigned char (*)[576])(visdata+1152),0,t,&onset);
 //     EnterCriticalSection(&g_title_cs);
-	    beat=refineBeat(beat);
+	    beat=refineBeat(beat,GetTickCount()-(beat?(DWORD)(t-onset):0),g_onset.tempo());
 //      LeaveCriticalSection(&g_title_cs);
     }
 #else
-		EnterCriticalSection(&g_cs);
-		memcpy(&vis_data[0][0][0],&g_visdata[0][0][0],576*2*2);
-		g_visdata_pstat=1;
-		beat=g_is_beat;
-		g_is_beat=0;
-		LeaveCriticalSection(&g_cs);
+    // winamp already calls render() latencyMS ahead of playback to match, so
+    // the stamps are on the playback clock: take what will be playing once
+    // this frame is up. nothing due keeps the last frame.
+    if (!C_AudioRing::read(t0+render_ms,vis_data,&beat,&audiotime))
+    {
+      beat=0;
+      audiotime=0.0;
+    }
 #endif
 
     if (!g_ThreadQuit)
@@ -435,10 +360,15 @@ static unsigned int WINAPI RenderThread(LPVOID a)
         g_laser_linelist->ClearLineList();
 #endif
 
+        int *rfb=s?fb2:fb, *rfbout=s?fb:fb2, rw=w, rh=h;
+        C_Profiler::beginFrame();
+        rscale->begin(cfg_render_scale?cfg_render_scale_fps:0,&rfb,&rfbout,&rw,&rh);
 	      EnterCriticalSection(&g_render_cs);
-				int t=g_render_transition->render(vis_data,beat,s?fb2:fb,s?fb:fb2,w,h);
+				int t=g_render_transition->render(vis_data,beat,rfb,rfbout,rw,rh);
 	      LeaveCriticalSection(&g_render_cs);
-        if (t&1) s^=1;
+        if (rscale->end(t)) s^=1;
+        C_Profiler::endFrame();
+        C_FBArena::endFrame();
 
 #ifdef LASER
         s=0;
@@ -446,12 +376,14 @@ static unsigned int WINAPI RenderThread(LPVOID a)
         LineDrawList(g_laser_linelist,fb,w,h);
 #endif
 			  if (IsWindow(g_hwnd)) DDraw_Exit(s);
+        C_FramePacer::framePresented(audiotime);
+        render_ms=render_ms*0.9+(C_FramePacer::now()-t0)*0.1;
 
         int lastt=framedata[framedata_pos];
         int thist=GetTickCount();
         framedata[framedata_pos]=thist;
-        g_dlg_w=w;
-        g_dlg_h=h;
+        g_dlg_w=rw;
+        g_dlg_h=rh;
         if (lastt)
         {
           g_dlg_fps=MulDiv(sizeof(framedata)/sizeof(framedata[0]),10000,thist-lastt);
@@ -460,11 +392,13 @@ static unsigned int WINAPI RenderThread(LPVOID a)
         if (framedata_pos >= sizeof(framedata)/sizeof(framedata[0])) framedata_pos=0;
 
 		  }
+      // the performance slider is a frame rate cap, see C_FramePacer::speedToFps()
       int fs=DDraw_IsFullScreen();
       int sv=(fs?(cfg_speed>>8):cfg_speed)&0xff;
-	    Sleep(min(max(sv,1),100));
+      C_FramePacer::wait(C_FramePacer::speedToFps(sv),cfg_pace_audio);
     }
 	}
+  delete rscale;
   _endthreadex(0);
 	return 0;
 }
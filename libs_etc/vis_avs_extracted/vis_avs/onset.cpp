@@ -0,0 +1,150 @@
+/*
+  LICENSE
+  -------
+Copyright 2005 Nullsoft, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, 
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer. 
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution. 
+
+  * Neither the name of Nullsoft nor the names of its contributors may be used to 
+    endorse or promote products derived from this software without specific prior written permission. 
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include <windows.h>
+#include <math.h>
+#include "onset.h"
+
+static const int onset_bands[ONSET_BANDS+1]={1,4,12,32,80,200,576}; // bins, 0 is dc
+static const float onset_weight[ONSET_BANDS]={1.5f,1.25f,1.0f,1.0f,0.75f,0.5f}; // beats live low
+
+#define ONSET_ADAPT 0.03f // running mean/deviation, ~0.5s at 70 hops/sec
+#define ONSET_K 3.0f // deviations above the mean that count
+#define ONSET_FLOOR 0.01f // deviation floor, keeps near silence from triggering
+#define ONSET_THRESHOLD 2.0f
+#define ONSET_WARMUP 16 // hops before the means are any good
+
+static float g_onset_log[256];
+
+C_OnsetDetector::C_OnsetDetector()
+{
+  if (g_onset_log[255] == 0.0f)
+  {
+    int x;
+    for (x = 0; x < 256; x ++) g_onset_log[x]=(float)log(1.0+x*0.25);
+  }
+  reset();
+}
+
+void C_OnsetDetector::reset()
+{
+  memset(m_prev,0,sizeof(m_prev));
+  memset(m_mean,0,sizeof(m_mean));
+  memset(m_dev,0,sizeof(m_dev));
+  m_hops=0;
+  m_nonsets=0;
+  m_tempo=0;
+}
+
+int C_OnsetDetector::process(unsigned char spectrum[2][576], unsigned char waveform[2][576], int srate, double time, double *onset)
+{
+  float novelty=0.0f;
+  int b, x;
+
+  for (b = 0; b < ONSET_BANDS; b ++)
+  {
+    float flux=0.0f;
+    for (x = onset_bands[b]; x < onset_bands[b+1]; x ++)
+    {
+      float v=g_onset_log[spectrum[0][x]]+g_onset_log[spectrum[1][x]];
+      if (v > m_prev[x]) flux+=v-m_prev[x];
+      m_prev[x]=v;
+    }
+    flux/=(float)(onset_bands[b+1]-onset_bands[b]);
+
+    // judged against the statistics from before this hop
+    float over=flux-m_mean[b]-ONSET_K*m_dev[b];
+    if (over > 0.0f) novelty+=onset_weight[b]*over/(m_dev[b]+ONSET_FLOOR);
+
+    m_dev[b]+=ONSET_ADAPT*((float)fabs(flux-m_mean[b])-m_dev[b]);
+    m_mean[b]+=ONSET_ADAPT*(flux-m_mean[b]);
+  }
+
+  if (++m_hops < ONSET_WARMUP || novelty < ONSET_THRESHOLD) return 0;
+  if (m_nonsets && time-m_onsets[(m_nonsets-1)%ONSET_HIST] < ONSET_MIN_GAP) return 0;
+
+  // where in the hop: the 32 sample block the envelope jumps most at. the
+  // hop's last sample is what came in at time.
+  int best=17, bestrise=0, last=0;
+  for (x = 0; x < 18; x ++)
+  {
+    int e=0, i, ch;
+    for (ch = 0; ch < 2; ch ++)
+      for (i = x*32; i < x*32+32; i ++) e+=abs((int)(char)waveform[ch][i]);
+    if (x && e-last > bestrise) { bestrise=e-last; best=x; }
+    last=e;
+  }
+  *onset=time-(576-best*32)*1000.0/(srate > 0 ? srate : 44100);
+
+  m_onsets[m_nonsets%ONSET_HIST]=*onset;
+  m_nonsets++;
+  estimateTempo();
+  return 1;
+}
+
+// every pair of recent onsets up to 4 beats apart votes for the periods it's
+// 1-4 of; the period with the most votes wins, if it has enough of them.
+void C_OnsetDetector::estimateTempo()
+{
+  int n=min(m_nonsets,ONSET_HIST), i, j, k, p;
+  int hist[401]={0,}; // 10ms bins
+  int pairs=0, bestp=0, bestscore=0;
+  double newest=m_onsets[(m_nonsets-1)%ONSET_HIST];
+
+  for (i = 0; i < n; i ++)
+    for (j = 0; j < n; j ++)
+    {
+      double d=m_onsets[j]-m_onsets[i];
+      if (d <= 0.0 || d > 4000.0 || newest-m_onsets[i] > 8000.0) continue;
+      hist[(int)(d*0.1+0.5)]++;
+      pairs++;
+    }
+  if (pairs < 8) { m_tempo=0; return; }
+
+  for (p = 6000/170; p <= 6000/60; p ++) // MAX_BPM..MIN_BPM, see bpm.h
+  {
+    int score=0;
+    for (k = 1; k <= 4 && k*p < 400; k ++) score+=hist[k*p-1]+hist[k*p]+hist[k*p+1];
+    if (score > bestscore) { bestscore=score; bestp=p; }
+  }
+  if (bestscore*3 < pairs) { m_tempo=0; return; }
+
+  // the period to better than a bin from the intervals that voted for it
+  double sum=0.0;
+  int cnt=0;
+  for (i = 0; i < n; i ++)
+    for (j = 0; j < n; j ++)
+    {
+      double d=m_onsets[j]-m_onsets[i];
+      if (d <= 0.0 || d > 4000.0 || newest-m_onsets[i] > 8000.0) continue;
+      for (k = 1; k <= 4; k ++)
+        if (fabs(d-k*bestp*10.0) <= 15.0) { sum+=d/k; cnt++; break; }
+    }
+  m_tempo=cnt ? (int)(60000.0*cnt/sum+0.5) : 0;
+}
@@ -0,0 +1,75 @@
+/*
+  LICENSE
+  -------
+Copyright 2005 Nullsoft, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, 
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer. 
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution. 
+
+  * Neither the name of Nullsoft nor the names of its contributors may be used to 
+    endorse or promote products derived from this software without specific prior written permission. 
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef _ONSET_H_
+#define _ONSET_H_
+
+// Beat (onset) detection on every hop of audio the vis callback gets.
+//
+// Each hop's spectrum is log compressed and split into ONSET_BANDS bands.
+// A band's spectral flux is how much it rose since the last hop. It counts
+// towards an onset when it rises above that band's own running mean plus a
+// few running deviations, so quiet and loud passages and bass and hats are
+// all judged by their own standard. Nothing waits for later hops, so a beat
+// is reported on the hop it starts in. Its time is then narrowed down within
+// the hop from where the waveform's envelope jumps.
+//
+// The tempo comes from the intervals between recent onsets. It's the beat
+// period that the most intervals are whole multiples of, given only once
+// enough of them agree.
+
+#define ONSET_BANDS 6
+#define ONSET_HIST 24 // onsets kept for the tempo
+#define ONSET_MIN_GAP 100.0 // ms, no two onsets closer than this
+
+class C_OnsetDetector
+{
+  public:
+    C_OnsetDetector();
+    void reset();
+
+    // one hop of vis data (winamp's spectrumData/waveformData layout) that
+    // came in at time ms. returns 1 if a beat starts in it, with *onset set
+    // to when, 0 otherwise.
+    int process(unsigned char spectrum[2][576], unsigned char waveform[2][576], int srate, double time, double *onset);
+
+    int tempo() { return m_tempo; } // bpm, 0 while unsure
+
+  protected:
+    void estimateTempo();
+
+    float m_prev[576]; // log spectrum of the last hop, channels summed
+    float m_mean[ONSET_BANDS], m_dev[ONSET_BANDS];
+    int m_hops;
+    double m_onsets[ONSET_HIST];
+    int m_nonsets;
+    int m_tempo;
+};
+
+#endif//_ONSET_H_
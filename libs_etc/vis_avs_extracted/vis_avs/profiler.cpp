@@ -0,0 +1,326 @@
+/*
+  LICENSE
+  -------
+Copyright 2005 Nullsoft, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, 
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer. 
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution. 
+
+  * Neither the name of Nullsoft nor the names of its contributors may be used to 
+    endorse or promote products derived from this software without specific prior written permission. 
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include <windows.h>
+#include <stdio.h>
+#include "profiler.h"
+
+volatile int C_Profiler::m_on;
+int C_Profiler::m_enabled;
+volatile LONG C_Profiler::m_lock;
+double C_Profiler::m_freq;
+DWORD C_Profiler::m_frametid;
+int C_Profiler::m_frametoken;
+unsigned int C_Profiler::m_frame;
+C_Profiler::node C_Profiler::m_nodes[PROF_MAX_NODES];
+int C_Profiler::m_nnodes;
+int C_Profiler::m_lastchild[PROF_MAX_DEPTH];
+C_Profiler::thread C_Profiler::m_threads[PROF_MAX_THREADS];
+volatile LONG C_Profiler::m_nthreads;
+volatile int C_Profiler::m_trace_state;
+int C_Profiler::m_trace_frames;
+char C_Profiler::m_trace_file[MAX_PATH];
+C_Profiler::event *C_Profiler::m_events;
+volatile LONG C_Profiler::m_nevents, C_Profiler::m_writers;
+__int64 C_Profiler::m_trace_start;
+
+static __int64 prof_now()
+{
+  LARGE_INTEGER t;
+  QueryPerformanceCounter(&t);
+  return t.QuadPart;
+}
+
+// the render thread holds it for a few node updates at most
+void C_Profiler::lock()
+{
+  while (InterlockedCompareExchange(&m_lock,1,0)) Sleep(0);
+}
+
+void C_Profiler::unlock()
+{
+  InterlockedExchange(&m_lock,0);
+}
+
+void C_Profiler::setEnabled(int en)
+{
+  if (!m_freq)
+  {
+    LARGE_INTEGER f;
+    QueryPerformanceFrequency(&f);
+    m_freq=(double)f.QuadPart;
+  }
+  m_enabled=en;
+  m_on=m_enabled || m_trace_state;
+}
+
+int C_Profiler::trace(const char *file, int frames)
+{
+  if (m_trace_state || frames < 1) return 0;
+  m_events=(event *)GlobalAlloc(GMEM_FIXED,PROF_MAX_EVENTS*sizeof(event));
+  if (!m_events) return 0;
+  lstrcpyn(m_trace_file,file,sizeof(m_trace_file));
+  m_trace_frames=frames;
+  m_trace_state=1;
+  setEnabled(m_enabled);
+  return 1;
+}
+
+// a slot per thread that is inside a scope, given back when it leaves the
+// outermost one (the prefetch threads come and go)
+C_Profiler::thread *C_Profiler::getThread()
+{
+  DWORD tid=GetCurrentThreadId();
+  int x, n=min((int)m_nthreads,PROF_MAX_THREADS);
+  for (x = 0; x < n; x ++)
+    if (m_threads[x].tid == tid) return m_threads+x;
+  for (x = 0; x < PROF_MAX_THREADS; x ++)
+  {
+    if (!m_threads[x].tid && !InterlockedCompareExchange((volatile LONG *)&m_threads[x].tid,(LONG)tid,0))
+    {
+      m_threads[x].depth=0;
+      while (m_nthreads <= x) InterlockedCompareExchange(&m_nthreads,x+1,m_nthreads);
+      return m_threads+x;
+    }
+  }
+  return NULL;
+}
+
+int C_Profiler::findNode(int parent, const char *name, int index)
+{
+  node *p=m_nodes+parent;
+  int depth=p->depth+1;
+  if (depth >= PROF_MAX_DEPTH) return -1;
+
+  // lists render their effects in order, so try the sibling after the last match first
+  int hint=m_lastchild[depth];
+  int c=(hint > 0 && hint < m_nnodes && m_nodes[hint].parent == parent) ? m_nodes[hint].next : -1;
+  if (c < 0 || m_nodes[c].name != name || m_nodes[c].index != index)
+  {
+    for (c = p->firstchild; c >= 0; c = m_nodes[c].next)
+      if (m_nodes[c].name == name && m_nodes[c].index == index) break;
+  }
+  if (c < 0)
+  {
+    if (m_nnodes >= PROF_MAX_NODES) return -1; // endFrame() starts over
+    lock();
+    c=m_nnodes;
+    node *n=m_nodes+c;
+    n->name=name;
+    n->index=index;
+    n->parent=parent;
+    n->firstchild=n->next=-1;
+    n->depth=depth;
+    n->thisframe=0;
+    n->avg=n->peak=0.0;
+    n->lastseen=m_frame;
+    if (p->firstchild < 0) p->firstchild=c;
+    else
+    {
+      int l=p->firstchild;
+      while (m_nodes[l].next >= 0) l=m_nodes[l].next;
+      m_nodes[l].next=c;
+    }
+    m_nnodes++;
+    unlock();
+  }
+  m_lastchild[depth]=c;
+  return c;
+}
+
+int C_Profiler::_enter(const char *name, int index)
+{
+  thread *t=getThread();
+  if (!t) return 0;
+  if (t->depth >= PROF_MAX_DEPTH)
+  {
+    t->depth++; // still has to match up with leave()
+    return 1;
+  }
+  scope *s=t->stack+t->depth;
+  s->name=name;
+  s->index=index;
+  s->node=-1;
+  if (m_enabled && t->tid == m_frametid && m_nnodes)
+  {
+    int parent=t->depth ? t->stack[t->depth-1].node : 0;
+    if (parent >= 0) s->node=findNode(parent,name,index);
+  }
+  t->depth++;
+  s->start=prof_now();
+  return 1;
+}
+
+void C_Profiler::_leave()
+{
+  __int64 end=prof_now();
+  thread *t=getThread();
+  if (!t || !t->depth) return;
+  if (--t->depth >= PROF_MAX_DEPTH) return;
+  scope *s=t->stack+t->depth;
+
+  if (s->node >= 0)
+  {
+    m_nodes[s->node].thisframe+=end-s->start;
+    m_nodes[s->node].lastseen=m_frame;
+  }
+
+  InterlockedIncrement(&m_writers);
+  if (m_trace_state == 2)
+  {
+    LONG i=InterlockedIncrement(&m_nevents)-1;
+    if (i < PROF_MAX_EVENTS)
+    {
+      event *e=m_events+i;
+      e->name=s->name;
+      e->index=s->index;
+      e->tid=t->tid;
+      e->start=max(s->start,m_trace_start);
+      e->end=end;
+    }
+  }
+  InterlockedDecrement(&m_writers);
+
+  if (!t->depth && t->tid != m_frametid) t->tid=0;
+}
+
+void C_Profiler::beginFrame()
+{
+  if (!m_on) return;
+  if (m_trace_state == 1)
+  {
+    m_nevents=0;
+    m_trace_start=prof_now();
+    m_trace_state=2;
+  }
+  m_frametid=GetCurrentThreadId();
+  if (!m_nnodes)
+  {
+    memset(m_nodes,0,sizeof(m_nodes[0]));
+    m_nodes[0].name="";
+    m_nodes[0].firstchild=m_nodes[0].next=-1;
+    m_nodes[0].depth=-1;
+    m_nnodes=1;
+  }
+  m_frame++;
+  m_frametoken=enter("Frame");
+}
+
+void C_Profiler::endFrame()
+{
+  int x;
+  leave(m_frametoken);
+  m_frametoken=0;
+  if (m_nnodes)
+  {
+    lock();
+    for (x = 1; x < m_nnodes; x ++)
+    {
+      node *n=m_nodes+x;
+      if (n->lastseen != m_frame) continue;
+      double ms=(double)n->thisframe*1000.0/m_freq;
+      n->avg=n->avg > 0.0 ? n->avg*0.95+ms*0.05 : ms;
+      n->peak=max(n->peak*0.99,ms);
+      n->thisframe=0;
+    }
+    if (m_nnodes >= PROF_MAX_NODES || !m_enabled) m_nnodes=0; // too many presets since, start over
+    unlock();
+  }
+
+  if (m_trace_state == 2 && --m_trace_frames <= 0) writeTrace();
+}
+
+void C_Profiler::writeTrace()
+{
+  m_trace_state=0;
+  while (m_writers) Sleep(0);
+  setEnabled(m_enabled);
+
+  FILE *fp=fopen(m_trace_file,"wt");
+  if (fp)
+  {
+    int x, n=min((int)m_nevents,PROF_MAX_EVENTS);
+    fprintf(fp,"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (x = 0; x < n; x ++)
+    {
+      event *e=m_events+x;
+      char name[256];
+      const char *p=e->name;
+      int l=0;
+      if (e->index >= 0) l=wsprintf(name,"%d: ",e->index);
+      while (*p && l < (int)sizeof(name)-3)
+      {
+        if (*p == '"' || *p == '\\') name[l++]='\\';
+        name[l++]=(*p >= 0 && *p < 32) ? ' ' : *p;
+        p++;
+      }
+      name[l]=0;
+      fprintf(fp,"{\"name\":\"%s\",\"cat\":\"avs\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}%s\n",
+        name,(unsigned int)e->tid,(double)(e->start-m_trace_start)*1000000.0/m_freq,
+        (double)(e->end-e->start)*1000000.0/m_freq,x < n-1 ? "," : "");
+    }
+    fprintf(fp,"]}\n");
+    fclose(fp);
+  }
+  GlobalFree(m_events);
+  m_events=NULL;
+}
+
+int C_Profiler::report(char *buf, int buflen)
+{
+  int pos=0;
+  if (buflen < 1) return 0;
+  buf[0]=0;
+  lock();
+  // preorder walk, the tree is at most PROF_MAX_DEPTH deep
+  int stack[PROF_MAX_DEPTH+1], sp=0;
+  if (m_nnodes && m_nodes[0].firstchild >= 0) stack[sp++]=m_nodes[0].firstchild;
+  while (sp > 0)
+  {
+    int c=stack[--sp];
+    node *n=m_nodes+c;
+    if (n->next >= 0) stack[sp++]=n->next;
+    if (m_frame-n->lastseen > PROF_STALE_FRAMES) continue;
+    if (n->firstchild >= 0 && sp <= PROF_MAX_DEPTH) stack[sp++]=n->firstchild;
+
+    char line[512], idx[16];
+    int avg=(int)(n->avg*100.0+0.5), peak=(int)(n->peak*100.0+0.5);
+    idx[0]=0;
+    if (n->index >= 0) wsprintf(idx,"%d: ",n->index);
+    int ind=min(n->depth*2,40);
+    memset(line,' ',ind);
+    wsprintf(line+ind,"%s%.200s  %d.%02d (%d.%02d)\r\n",idx,n->name,avg/100,avg%100,peak/100,peak%100);
+    int l=lstrlen(line);
+    if (pos+l >= buflen) break;
+    memcpy(buf+pos,line,l+1);
+    pos+=l;
+  }
+  unlock();
+  return pos;
+}
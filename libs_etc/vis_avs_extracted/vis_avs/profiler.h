@@ -0,0 +1,157 @@
+/*
+  LICENSE
+  -------
+Copyright 2005 Nullsoft, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, 
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer. 
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution. 
+
+  * Neither the name of Nullsoft nor the names of its contributors may be used to 
+    endorse or promote products derived from this software without specific prior written permission. 
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+// Hierarchical profiler.
+//
+// Code marks the work it does with enter()/leave() pairs (or a
+// C_ProfileScope where the function has no __try). When nothing is being
+// profiled, each pair costs a test of m_on.
+//
+// On the thread that calls beginFrame()/endFrame() the pairs make up a tree,
+// one node per (parent, name, index), with a running average of the time
+// each node takes per frame. report() prints it, so a list with sixty
+// effects shows which of them eat the frame. Scopes on other threads (the
+// SMP workers) don't go in the tree, their time is already inside the effect
+// that started them.
+//
+// trace() records every scope on every thread for a number of frames and
+// writes them to a file as Chrome trace events (load it in
+// chrome://tracing or Perfetto).
+
+#define PROF_MAX_NODES 2048
+#define PROF_MAX_DEPTH 64
+#define PROF_MAX_THREADS 32
+#define PROF_MAX_EVENTS (1<<20)
+#define PROF_STALE_FRAMES 100 // nodes not seen this long drop out of report()
+
+class C_Profiler
+{
+  public:
+    static void setEnabled(int en); // the per-frame tree
+    static int isEnabled() { return m_enabled; }
+
+    // records the next frames, then writes them to file. returns 0 if a
+    // trace is already running or there's no memory for it.
+    static int trace(const char *file, int frames);
+    static int tracing() { return m_trace_state != 0; }
+
+    static void beginFrame();
+    static void endFrame();
+
+    // name must stay valid until the next report()/trace write, a literal or
+    // an effect's get_desc(). index tells apart entries with the same name,
+    // -1 for none. returns what to pass to leave().
+    static int enter(const char *name, int index=-1) { return m_on ? _enter(name,index) : 0; }
+    static void leave(int token) { if (token) _leave(); }
+    // 0 if enter() would drop its name anyway: check before building one
+    static int isOn() { return m_on; }
+
+    // one line per node, indented by depth: average and peak ms per frame
+    static int report(char *buf, int buflen);
+
+  protected:
+    typedef struct
+    {
+      const char *name;
+      int index;
+      int parent, firstchild, next, depth;
+      __int64 thisframe;
+      double avg, peak; // ms
+      unsigned int lastseen;
+    } node;
+
+    typedef struct
+    {
+      const char *name;
+      int index;
+      __int64 start;
+      int node;
+    } scope;
+
+    typedef struct
+    {
+      DWORD tid;
+      int depth;
+      scope stack[PROF_MAX_DEPTH];
+    } thread;
+
+    typedef struct
+    {
+      const char *name;
+      int index;
+      DWORD tid;
+      __int64 start, end;
+    } event;
+
+    static int _enter(const char *name, int index);
+    static void _leave();
+    static thread *getThread();
+    static int findNode(int parent, const char *name, int index);
+    static void writeTrace();
+    static void lock();
+    static void unlock();
+
+    static volatile int m_on;
+    static int m_enabled;
+    static volatile LONG m_lock;
+    static double m_freq;
+
+    static DWORD m_frametid;
+    static int m_frametoken;
+    static unsigned int m_frame;
+    static node m_nodes[PROF_MAX_NODES];
+    static int m_nnodes;
+    static int m_lastchild[PROF_MAX_DEPTH]; // where the last lookup at each depth ended, usually the next one is its sibling
+
+    static thread m_threads[PROF_MAX_THREADS];
+    static volatile LONG m_nthreads;
+
+    // 0 off, 1 waiting for the next frame, 2 recording
+    static volatile int m_trace_state;
+    static int m_trace_frames;
+    static char m_trace_file[MAX_PATH];
+    static event *m_events;
+    static volatile LONG m_nevents, m_writers;
+    static __int64 m_trace_start;
+};
+
+// for functions without __try
+class C_ProfileScope
+{
+  public:
+    C_ProfileScope(const char *name, int index=-1) { m_token=C_Profiler::enter(name,index); }
+    ~C_ProfileScope() { C_Profiler::leave(m_token); }
+  private:
+    int m_token;
+};
+
+#endif//_PROFILER_H_
@@ -34,7 +34,6 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "r_defs.h"
 #include "resource.h"
 
-#include "timing.h"
 #include "../Agave/Language/api_language.h"
 
 
@@ -56,7 +55,7 @@ class C_THISCLASS : public C_RBASE2 {
 		virtual void load_config(unsigned char *data, int len);
 		virtual int  save_config(unsigned char *data);
 
-    virtual int smp_getflags() { return 1; }
+    virtual int smp_getflags() { return 3; }
 		virtual int smp_begin(int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); 
     virtual void smp_render(int this_thread, int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); 
     virtual int smp_finish(char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); // return value is that of render() for fbstuff etc
@@ -115,7 +114,6 @@ void C_THISCLASS::smp_render(int this_thread, int max_threads, char visdata[2][2
 {
   if (!enabled) return;
 
-  timingEnter(0);
 
 	unsigned int *f = (unsigned int *) framebuffer;
   unsigned int *of = (unsigned int *) fbout;
@@ -800,7 +798,6 @@ mmx_normal_blur_loop:
   __asm emms;
 #endif
   
-	timingLeave(0);
 }
 
 int C_THISCLASS::smp_begin(int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
@@ -29,9 +29,9 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 #include <windows.h>
 #include <commctrl.h>
-#include <time.h>
 #include "resource.h"
 #include "r_defs.h"
+#include "rng.h"
 #include "../Agave/Language/api_language.h"
 
 #ifndef LASER
@@ -47,7 +47,7 @@ typedef struct {
 	int onbeat;
 } apeconfig;
 
-class C_THISCLASS : public C_RBASE 
+class C_THISCLASS : public C_RBASE2 
 {
 	protected:
 	public:
@@ -59,7 +59,14 @@ class C_THISCLASS : public C_RBASE
 		virtual void load_config(unsigned char *data, int len);
 		virtual int  save_config(unsigned char *data);
 
+		virtual int smp_getflags() { return 7; }
+		virtual int smp_begin(int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); 
+		virtual void smp_render(int this_thread, int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); 
+		virtual int smp_finish(char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h) { return 0; }
+
 		apeconfig config;
+		int cur_mode; // config.mode as of smp_begin(), the dialog can change it any time
+		C_Rng rng;
 
 		HWND hwndDlg;
 };
@@ -116,211 +123,65 @@ C_THISCLASS::~C_THISCLASS()
 
 
 int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
+{
+	if (!smp_begin(1,visdata,isBeat,framebuffer,fbout,w,h)) return 0;
+	smp_render(0,1,visdata,isBeat,framebuffer,fbout,w,h);
+	return 0;
+}
+
+int C_THISCLASS::smp_begin(int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
 {
   if (isBeat&0x80000000) return 0;
 
-	int c;
 	int modes[] = { IDC_RGB, IDC_RBG, IDC_GBR, IDC_GRB, IDC_BRG, IDC_BGR };
 
 	if (isBeat && config.onbeat) {
-		config.mode = modes[rand() % 6];
+		config.mode = modes[rng.below(6)];
 	}
+	cur_mode = config.mode;
+
+	switch (cur_mode) {
+	case IDC_RBG: case IDC_BRG: case IDC_BGR: case IDC_GBR: case IDC_GRB:
+		return max_threads;
+	}
+	return 0;
+}
+
+// same results as the asm loops this used to have (including what they left
+// in the top byte), but any number of pixels at a time.
+#define CHANSHIFT_LOOP(expr) while (c--) { unsigned int v=*p; *p++=(expr); }
 
-	c = w*h;
+void C_THISCLASS::smp_render(int this_thread, int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
+{
+	if (max_threads < 1) max_threads=1;
+
+	int start_l = ( this_thread * h ) / max_threads;
+	int end_l;
+
+	if (this_thread >= max_threads - 1) end_l = h;
+	else end_l = ( (this_thread+1) * h ) / max_threads;  
 
-	switch (config.mode) {
-	default:
-	case IDC_RGB:
-		return 0;
+	int c = w*(end_l-start_l);
+	unsigned int *p = (unsigned int *)framebuffer+start_l*w;
+	if (c < 1) return;
+
+	switch (cur_mode) {
 	case IDC_RBG:
-		__asm {
-			mov ebx, framebuffer;
-			mov ecx, c;
-			lp1:
-			sub ecx, 4;
-
-			mov eax, dword ptr [ebx+ecx*4];
-			xchg ah, al;
-			mov [ebx+ecx*4], eax;
-
-			mov eax, dword ptr [ebx+ecx*4+4];
-			xchg ah, al;
-			mov [ebx+ecx*4+4], eax;
-
-			mov eax, dword ptr [ebx+ecx*4+8];
-			xchg ah, al;
-			mov [ebx+ecx*4+8], eax;
-
-			mov eax, dword ptr [ebx+ecx*4+12];
-			xchg ah, al;
-			mov [ebx+ecx*4+12], eax;
-
-			test ecx, ecx;
-			jnz lp1;
-		}
+		CHANSHIFT_LOOP((v&0xffff0000) | ((v&0xff)<<8) | ((v>>8)&0xff))
 		break;
-		
 	case IDC_BRG:
-		__asm {
-			mov ebx, framebuffer;
-			mov ecx, c;
-			lp2:
-			sub ecx, 4;
-			
-			mov eax, dword ptr [ebx+ecx*4];
-			mov dl, al;
-			shr eax, 8;
-			bswap eax;
-			mov ah, dl;
-			bswap eax;
-			mov [ebx+ecx*4], eax;
-			
-			mov eax, dword ptr [ebx+ecx*4+4];
-			mov dl, al;
-			shr eax, 8;
-			bswap eax;
-			mov ah, dl;
-			bswap eax;
-			mov [ebx+ecx*4+4], eax;
-
-			mov eax, dword ptr [ebx+ecx*4+8];
-			mov dl, al;
-			shr eax, 8;
-			bswap eax;
-			mov ah, dl;
-			bswap eax;
-			mov [ebx+ecx*4+8], eax;
-
-			mov eax, dword ptr [ebx+ecx*4+12];
-			mov dl, al;
-			shr eax, 8;
-			bswap eax;
-			mov ah, dl;
-			bswap eax;
-			mov [ebx+ecx*4+12], eax;
-
-			test ecx, ecx;
-			jnz lp2;
-		}
+		CHANSHIFT_LOOP(((v&0xff)<<16) | ((v>>8)&0xff00) | ((v>>8)&0xff))
 		break;
-
 	case IDC_BGR:
-		__asm {
-			mov ebx, framebuffer;
-			mov ecx, c;
-			lp3:
-			sub ecx, 4;
-
-			mov eax, dword ptr [ebx+ecx*4];
-			bswap eax;
-			shr eax, 8;
-			mov [ebx+ecx*4], eax;
-
-			mov eax, dword ptr [ebx+ecx*4+4];
-			bswap eax;
-			shr eax, 8;
-			mov [ebx+ecx*4+4], eax;
-
-			mov eax, dword ptr [ebx+ecx*4+8];
-			bswap eax;
-			shr eax, 8;
-			mov [ebx+ecx*4+8], eax;
-
-			mov eax, dword ptr [ebx+ecx*4+12];
-			bswap eax;
-			shr eax, 8;
-			mov [ebx+ecx*4+12], eax;
-
-			test ecx, ecx;
-			jnz lp3;
-		}
+		CHANSHIFT_LOOP(((v&0xff)<<16) | (v&0xff00) | ((v>>16)&0xff))
 		break;
-
 	case IDC_GBR:
-		__asm {
-			mov ebx, framebuffer;
-			mov ecx, c;
-			lp4:
-			sub ecx, 4;
-
-			mov eax, dword ptr [ebx+ecx*4];
-			mov edx, eax;
-			bswap edx;
-			shl eax, 8;
-			mov al, dh;
-			mov [ebx+ecx*4], eax;
-
-			mov eax, dword ptr [ebx+ecx*4+4];
-			mov edx, eax;
-			bswap edx;
-			shl eax, 8;
-			mov al, dh;
-			mov [ebx+ecx*4+4], eax;
-
-			mov eax, dword ptr [ebx+ecx*4+8];
-			mov edx, eax;
-			bswap edx;
-			shl eax, 8;
-			mov al, dh;
-			mov [ebx+ecx*4+8], eax;
-
-			mov eax, dword ptr [ebx+ecx*4+12];
-			mov edx, eax;
-			bswap edx;
-			shl eax, 8;
-			mov al, dh;
-			mov [ebx+ecx*4+12], eax;
-
-			test ecx, ecx;
-			jnz lp4;
-		}
+		CHANSHIFT_LOOP(((v&0xff0000)<<8) | ((v&0xff00)<<8) | ((v&0xff)<<8) | ((v>>16)&0xff))
 		break;
-
 	case IDC_GRB:
-		__asm {
-			mov ebx, framebuffer;
-			mov ecx, c;
-			lp5:
-			sub ecx, 4;
-
-			mov eax, dword ptr [ebx+ecx*4];
-			shl eax, 8;
-			bswap eax;
-			xchg ah, al;
-			bswap eax;
-			shr eax, 8;
-			mov [ebx+ecx*4], eax;
-
-			mov eax, dword ptr [ebx+ecx*4+4];
-			shl eax, 8;
-			bswap eax;
-			xchg ah, al;
-			bswap eax;
-			shr eax, 8;
-			mov [ebx+ecx*4+4], eax;
-
-			mov eax, dword ptr [ebx+ecx*4+8];
-			shl eax, 8;
-			bswap eax;
-			xchg ah, al;
-			bswap eax;
-			shr eax, 8;
-			mov [ebx+ecx*4+8], eax;
-
-			mov eax, dword ptr [ebx+ecx*4+12];
-			shl eax, 8;
-			bswap eax;
-			xchg ah, al;
-			bswap eax;
-			shr eax, 8;
-			mov [ebx+ecx*4+12], eax;
-
-			test ecx, ecx;
-			jnz lp5;
-		}
+		CHANSHIFT_LOOP(((v&0xff00)<<8) | ((v>>8)&0xff00) | (v&0xff))
 		break;
 	}
-	return 0;
 }
 
 HWND C_THISCLASS::conf(HINSTANCE hInstance, HWND hwndParent) 
@@ -337,7 +198,6 @@ char *C_THISCLASS::get_desc(void)
 
 void C_THISCLASS::load_config(unsigned char *data, int len) 
 {
-	srand((unsigned int)time(0));
 	if (len <= sizeof(apeconfig))
 		memcpy(&this->config, data, len);
 }
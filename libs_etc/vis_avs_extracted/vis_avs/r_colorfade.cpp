@@ -31,9 +31,9 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <windows.h>
 #include <commctrl.h>
 #include "r_defs.h"
+#include "rng.h"
 #include "resource.h"
 
-#include "timing.h"
 #include "../Agave/Language/api_language.h"
 
 #ifndef LASER
@@ -53,11 +53,11 @@ class C_THISCLASS : public C_RBASE2 {
 		virtual int  save_config(unsigned char *data);
 
 
-    virtual int smp_getflags() { return 1; }
+    virtual int smp_getflags() { return 7; }
 		virtual int smp_begin(int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); 
     virtual void smp_render(int this_thread, int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); 
     virtual int smp_finish(char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); // return value is that of render() for fbstuff etc
-    static int ft[4][3];
+    int ft[4][3]; // fader per colour class, set up by smp_begin()
 
 
     int enabled;
@@ -66,8 +66,8 @@ class C_THISCLASS : public C_RBASE2 {
     int faderpos[3];
     unsigned char c_tab[512][512];
     unsigned char clip[256+40+40];
+    C_Rng rng;
 };
-int C_THISCLASS::ft[4][3];
 
 #define PUT_INT(y) data[pos]=(y)&255; data[pos+1]=(y>>8)&255; data[pos+2]=(y>>16)&255; data[pos+3]=(y>>24)&255
 #define GET_INT() (data[pos]|(data[pos+1]<<8)|(data[pos+2]<<16)|(data[pos+3]<<24))
@@ -155,11 +155,11 @@ int C_THISCLASS::smp_begin(int max_threads, char visdata[2][2][576], int isBeat,
   }
   else if (isBeat && (enabled&2))
   {
-    faderpos[0]=(rand()%32)-6;
-    faderpos[1]=(rand()%64)-32;
+    faderpos[0]=rng.below(32)-6;
+    faderpos[1]=rng.below(64)-32;
     if (faderpos[1] < 0 && faderpos[1] > -16) faderpos[1]=-32;
     if (faderpos[1] >= 0 && faderpos[1] < 16) faderpos[1]=32;
-    faderpos[2]=(rand()%32)-6;
+    faderpos[2]=rng.below(32)-6;
   }
   else if (isBeat)
   {
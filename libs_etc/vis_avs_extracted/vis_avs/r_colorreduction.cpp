@@ -45,7 +45,7 @@ typedef struct {
 	int	levels;
 } apeconfig;
 
-class C_THISCLASS : public C_RBASE 
+class C_THISCLASS : public C_RBASE2 
 {
 	protected:
 	public:
@@ -57,7 +57,13 @@ class C_THISCLASS : public C_RBASE
 		virtual void load_config(unsigned char *data, int len);
 		virtual int  save_config(unsigned char *data);
 
+		virtual int smp_getflags() { return 7; }
+		virtual int smp_begin(int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); 
+		virtual void smp_render(int this_thread, int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); 
+		virtual int smp_finish(char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h) { return 0; }
+
 		apeconfig config;
+		int mask; // set by smp_begin()
 
 		HWND hwndDlg;
 };
@@ -126,31 +132,55 @@ C_THISCLASS::~C_THISCLASS()
 
 
 int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
+{
+	if (!smp_begin(1,visdata,isBeat,framebuffer,fbout,w,h)) return 0;
+	smp_render(0,1,visdata,isBeat,framebuffer,fbout,w,h);
+	return 0;
+}
+
+int C_THISCLASS::smp_begin(int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
 {
   if (isBeat&0x80000000) return 0;
 
-	int a,b,c;
+	int a,b;
 	a = 8-config.levels;
 	b = 0xFF;
 	while (a--) b=(b<<1)&0xFF;
-	b |= (b<<16) | (b<<8);
-	c = w*h;
-	__asm {
-		mov ebx, framebuffer;
-		mov ecx, c;
-		mov edx, b;
-		lp:
-		sub ecx, 4;
-		test ecx, ecx;
-		jz end;
-		and dword ptr [ebx+ecx*4], edx;
-		and dword ptr [ebx+ecx*4+4], edx;
-		and dword ptr [ebx+ecx*4+8], edx;
-		and dword ptr [ebx+ecx*4+12], edx;
-		jmp lp;
-		end:
+	mask = b | (b<<16) | (b<<8);
+	return max_threads;
+}
+
+void C_THISCLASS::smp_render(int this_thread, int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
+{
+	if (max_threads < 1) max_threads=1;
+
+	int start_l = ( this_thread * h ) / max_threads;
+	int end_l;
+
+	if (this_thread >= max_threads - 1) end_l = h;
+	else end_l = ( (this_thread+1) * h ) / max_threads;  
+
+	// was an asm loop that only handled w*h divisible by 4, and never got
+	// to the first four pixels; they're still left alone
+	int c = w*(end_l-start_l);
+	int *p = framebuffer+start_l*w;
+	if (!start_l)
+	{
+		int skip = c < 4 ? c : 4;
+		p+=skip;
+		c-=skip;
 	}
-	return 0;
+	int b = mask;
+	while (c >= 4)
+	{
+		p[0]&=b;
+		p[1]&=b;
+		p[2]&=b;
+		p[3]&=b;
+		p+=4;
+		c-=4;
+	}
+	while (c-- > 0) *p++&=b;
 }
 
 HWND C_THISCLASS::conf(HINSTANCE hInstance, HWND hwndParent) 
@@ -33,7 +33,6 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "r_defs.h"
 #include "resource.h"
 
-#include "timing.h"
 #include "../Agave/Language/api_language.h"
 
 #define C_THISCLASS C_ContrastEnhanceClass
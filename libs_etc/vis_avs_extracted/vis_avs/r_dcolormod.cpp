@@ -34,7 +34,6 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "resource.h"
 #include "avs_eelif.h"
 
-#include "timing.h"
 #include "../Agave/Language/api_language.h"
 
 #ifndef LASER
@@ -42,7 +41,7 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define C_THISCLASS C_DColorModClass
 #define MOD_NAME "Trans / Color Modifier"
 
-class C_THISCLASS : public C_RBASE {
+class C_THISCLASS : public C_RBASE2 {
 	protected:
 	public:
 		C_THISCLASS();
@@ -52,6 +51,12 @@ class C_THISCLASS : public C_RBASE {
 		virtual HWND conf(HINSTANCE hInstance, HWND hwndParent);
 		virtual void load_config(unsigned char *data, int len);
 		virtual int  save_config(unsigned char *data);
+
+    virtual int smp_getflags() { return 7; }
+		virtual int smp_begin(int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); 
+    virtual void smp_render(int this_thread, int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); 
+    virtual int smp_finish(char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h) { return 0; }
+
     RString effect_exp[4];
 
     int m_recompute;
@@ -144,6 +149,14 @@ C_THISCLASS::~C_THISCLASS()
 
 
 int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
+{
+  if (!smp_begin(1,visdata,isBeat,framebuffer,fbout,w,h)) return 0;
+  smp_render(0,1,visdata,isBeat,framebuffer,fbout,w,h);
+  return 0;
+}
+
+// runs the code and rebuilds the table, smp_render() only looks pixels up in it
+int C_THISCLASS::smp_begin(int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
 {
   if (need_recompile)
   {
@@ -199,19 +212,28 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
     }
     m_tab_valid=1;
   }
+  return max_threads;
+}
 
-  unsigned char *fb=(unsigned char *)framebuffer;
-  int l=w*h;
-  while (l--)
+void C_THISCLASS::smp_render(int this_thread, int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
+{
+  if (max_threads < 1) max_threads=1;
+
+  int start_l = ( this_thread * h ) / max_threads;
+  int end_l;
+
+  if (this_thread >= max_threads - 1) end_l = h;
+  else end_l = ( (this_thread+1) * h ) / max_threads;  
+
+  unsigned char *fb=(unsigned char *)(framebuffer+start_l*w);
+  int l=w*(end_l-start_l);
+  while (l-- > 0)
   {
     fb[0]=m_tab[fb[0]];
     fb[1]=m_tab[(int)fb[1]+256];
     fb[2]=m_tab[(int)fb[2]+512];
     fb+=4;
   }
-
-
-  return 0;
 }
 
 C_RBASE *R_DColorMod(char *desc)
@@ -57,6 +57,15 @@ class C_RBASE2 : public C_RBASE {
 
 
     virtual int smp_getflags() { return 0; } // return 1 to enable smp support
+    // |2 means smp_render() only derives its rows from this_thread/max_threads and
+    // keeps no per-thread state, so the list may call it with max_threads > the
+    // value smp_begin() returned (this_thread is then a tile index, and any thread
+    // may run any tile).
+    // |4 (with |3) means the effect is point-wise: smp_render() changes each pixel of
+    // rows this_thread*h/max_threads up to (this_thread+1)*h/max_threads of framebuffer
+    // in place, from that same pixel only, doesn't touch fbout, and smp_finish()
+    // returns 0. the list runs consecutive point-wise effects as one pass over tiles
+    // that fit in the cache, each tile going through all of them in order.
 
     // returns # of threads you desire, <= max_threads, or 0 to not do anything
     // default should return max_threads if you are flexible
@@ -71,12 +80,16 @@ class C_RBASE2 : public C_RBASE {
 extern char g_path[];
 extern unsigned char g_blendtable[256][256];
 
+// blend_simd.cpp
+#include "blend_simd.h"
+
 extern int g_reset_vars_on_recompile;
 
 // use this function to get a global buffer, and the last flag says whether or not to
 // allocate it if it's not valid...
 #define NBUF 8
 void *getGlobalBuffer(int w, int h, int n, int do_alloc);
+void freeGlobalBuffers(); // for hosts that quit and may init again (avs_core.cpp)
 
 
 // implemented in util.cpp
@@ -96,6 +109,52 @@ void matrixApply(float *m, float x, float y, float z, float *outx, float *outy,
 extern int g_line_blend_mode;
 void line(int *fb, int x1,int y1,int x2,int y2, int width, int height, int color, int lw);
 
+// queues lines and points for an effect, then draws them all at once. the
+// frame is cut into horizontal bands that are drawn in parallel (with SMP
+// enabled), and the blend mode is looked up once. the result is the same as
+// drawing them in order with line() and BLEND_LINE().
+#define LINEBATCH_MAXBANDS 64
+class C_LineBatch
+{
+  public:
+    C_LineBatch();
+    ~C_LineBatch();
+
+    void line(int x1, int y1, int x2, int y2, int color, int lw); // as line()
+    void point(int x, int y, int color); // BLEND_LINE(), if it's in the frame
+
+    // draws everything queued with g_line_blend_mode as it is now, and empties the batch
+    void draw(int *fb, int w, int h);
+
+  protected:
+    typedef struct
+    {
+      int x1, y1, x2, y2;
+      int color;
+      int lw; // 0 for a point
+    } linePrim;
+
+    void add(int x1, int y1, int x2, int y2, int color, int lw);
+    int binRange(linePrim *p, int *b0, int *b1);
+    int bandOf(int y);
+    void drawBand(int band);
+    static void bandProc(void *ctx, int tile, int ntiles);
+
+    linePrim *prims;
+    int nprims, prims_alloc;
+
+    int nbands;
+    int bandstart[LINEBATCH_MAXBANDS+1]; // first row of each band
+    int binstart[LINEBATCH_MAXBANDS+1]; // into bins
+    int *bins; // primitive indices, by band
+    int bins_alloc;
+
+    // draw() in progress
+    int *d_fb, d_w, d_h, d_v;
+    void (*d_proc)(int *fb, int x1,int y1,int x2,int y2, int width, int height, int color, int lw, int v, int ys, int ye);
+    void (*d_pointproc)(int *fb, int color, int v);
+};
+
 
 // inlines
 static unsigned int __inline BLEND(unsigned int a, unsigned int b)
@@ -326,9 +385,8 @@ static unsigned int __inline BLEND_ADJ(unsigned int a, unsigned int b, int v)
 #endif
 
 
-static __inline unsigned int BLEND4(unsigned int *p1, unsigned int w, int xp, int yp)
+static __inline unsigned int BLEND4_NOMMX(unsigned int *p1, unsigned int w, int xp, int yp)
 {
-#ifdef NO_MMX
   register int t;
   unsigned char a1,a2,a3,a4;
   a1=g_blendtable[255-xp][255-yp];
@@ -339,6 +397,12 @@ static __inline unsigned int BLEND4(unsigned int *p1, unsigned int w, int xp, in
   t|=(g_blendtable[(p1[0]>>8)&0xff][a1]+g_blendtable[(p1[1]>>8)&0xff][a2]+g_blendtable[(p1[w]>>8)&0xff][a3]+g_blendtable[(p1[w+1]>>8)&0xff][a4])<<8;
   t|=(g_blendtable[(p1[0]>>16)&0xff][a1]+g_blendtable[(p1[1]>>16)&0xff][a2]+g_blendtable[(p1[w]>>16)&0xff][a3]+g_blendtable[(p1[w+1]>>16)&0xff][a4])<<16;
   return t;      
+}
+
+static __inline unsigned int BLEND4(unsigned int *p1, unsigned int w, int xp, int yp)
+{
+#ifdef NO_MMX
+  return BLEND4_NOMMX(p1,w,xp,yp);
 #else
   __asm
   {
@@ -413,18 +477,7 @@ static __inline unsigned int BLEND4(unsigned int *p1, unsigned int w, int xp, in
 static __inline unsigned int BLEND4_16(unsigned int *p1, unsigned int w, int xp, int yp)
 {
 #ifdef NO_MMX
-  register int t;
-  unsigned char a1,a2,a3,a4;
-  xp=(xp>>8)&0xff;
-  yp=(yp>>8)&0xff;
-  a1=g_blendtable[255-xp][255-yp];
-  a2=g_blendtable[xp][255-yp];
-  a3=g_blendtable[255-xp][yp];
-  a4=g_blendtable[xp][yp];
-  t=g_blendtable[p1[0]&0xff][a1]+g_blendtable[p1[1]&0xff][a2]+g_blendtable[p1[w]&0xff][a3]+g_blendtable[p1[w+1]&0xff][a4];
-  t|=(g_blendtable[(p1[0]>>8)&0xff][a1]+g_blendtable[(p1[1]>>8)&0xff][a2]+g_blendtable[(p1[w]>>8)&0xff][a3]+g_blendtable[(p1[w+1]>>8)&0xff][a4])<<8;
-  t|=(g_blendtable[(p1[0]>>16)&0xff][a1]+g_blendtable[(p1[1]>>16)&0xff][a2]+g_blendtable[(p1[w]>>16)&0xff][a3]+g_blendtable[(p1[w+1]>>16)&0xff][a4])<<16;
-  return t;      
+  return BLEND4_NOMMX(p1,w,(xp>>8)&0xff,(yp>>8)&0xff);
 #else
   __asm
   {
@@ -505,11 +558,7 @@ static __inline unsigned int BLEND4_16(unsigned int *p1, unsigned int w, int xp,
 static __inline void mmx_avgblend_block(int *output, int *input, int l)
 {
 #ifdef NO_MMX
-  while (l--)
-  {
-    *output=BLEND_AVG(*input++,*output);
-    output++;
-  }
+  g_blendsimd.avgblend(output,input,output,l);
 #else
   static int mask[2]=
   {
@@ -556,11 +605,7 @@ mmx_avgblend_loop:
 static __inline void mmx_addblend_block(int *output, int *input, int l)
 {
 #ifdef NO_MMX
-  while (l--)
-  {
-    *output=BLEND(*input++,*output);
-    output++;
-  }
+  g_blendsimd.addblend(output,input,output,l);
 #else
   __asm 
   {
@@ -593,11 +638,7 @@ mmx_addblend_loop:
 static __inline void mmx_mulblend_block(int *output, int *input, int l)
 {
 #ifdef NO_MMX
-  while (l--)
-  {
-    *output=BLEND_MUL(*input++,*output);
-    output++;
-  }
+  g_blendsimd.mulblend(output,input,output,l);
 #else
   __asm 
   {
@@ -638,10 +679,7 @@ mmx_mulblend_loop:
 static void __inline mmx_adjblend_block(int *o, int *in1, int *in2, int len, int v)
 {
 #ifdef NO_MMX
-  while (len--)
-  {
-    *o++=BLEND_ADJ(*in1++,*in2++,inblendval);
-  }
+  g_blendsimd.adjblend(o,in1,in2,len,v);
 #else
   __asm
   {
@@ -36,8 +36,8 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "resource.h"
 #include "avs_eelif.h"
 #include "r_list.h"
+#include "fb_arena.h"
 
-#include "timing.h"
 #include "../Agave/Language/api_language.h"
 
 
@@ -68,7 +68,7 @@ class C_THISCLASS : public C_RBASE2 {
 		virtual ~C_THISCLASS();
 		virtual int render(char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h);
 
-    virtual int smp_getflags() { return 1; }
+    virtual int smp_getflags() { return 3; }
 		virtual int smp_begin(int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); 
     virtual void smp_render(int this_thread, int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); 
     virtual int smp_finish(char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); // return value is that of render() for fbstuff etc
@@ -90,6 +90,7 @@ class C_THISCLASS : public C_RBASE2 {
     int need_recompile;
     int buffern;
     int subpixel,rectcoords,blend,wrap, nomove;
+    int adaptive, adapt_err; // adapt_err is in pixels
     CRITICAL_SECTION rcs;
 
 
@@ -100,6 +101,16 @@ class C_THISCLASS : public C_RBASE2 {
     int XRES;
     int YRES;
 
+    // table generation. gen_point() runs the pixel code for one grid point,
+    // adaptive mode only runs it where bilinear interpolation isn't good enough
+#define DMOVE_ADAPT_STEP 8 // coarse cell size, in grid points
+    char *m_tabdone; // XRES*YRES, set where the table came from the pixel code
+    double gen_xsc, gen_ysc, gen_dw2, gen_dh2, gen_divmax_d, gen_max_screen_d;
+    int gen_xc_dpos, gen_yc_dpos, gen_maxerr;
+    void gen_point(int x, int y, char visdata[2][2][576]);
+    void gen_cell(int x0, int y0, int x1, int y1, char visdata[2][2][576]);
+    void gen_interp(int x0, int y0, int x1, int y1, int x, int y, int *out);
+
 };
 
 #define PUT_INT(y) data[pos]=(y)&255; data[pos+1]=(y>>8)&255; data[pos+2]=(y>>16)&255; data[pos+3]=(y>>24)&255
@@ -142,6 +153,10 @@ void C_THISCLASS::load_config(unsigned char *data, int len)
   else buffern=0;
 	if (len-pos >= 4) { nomove=GET_INT(); pos+=4; }
   else nomove=0;
+	if (len-pos >= 4) { adaptive=GET_INT(); pos+=4; }
+  else adaptive=0;
+	if (len-pos >= 4) { adapt_err=GET_INT(); pos+=4; }
+  else adapt_err=1;
 
 }
 int  C_THISCLASS::save_config(unsigned char *data)
@@ -160,6 +175,8 @@ int  C_THISCLASS::save_config(unsigned char *data)
 	PUT_INT(wrap); pos+=4;
 	PUT_INT(buffern); pos+=4;
 	PUT_INT(nomove); pos+=4;
+	PUT_INT(adaptive); pos+=4;
+	PUT_INT(adapt_err); pos+=4;
 	return pos;
 }
 
@@ -172,6 +189,7 @@ C_THISCLASS::C_THISCLASS()
   m_lasth=m_lastw=0;
   m_wmul=0;
   m_tab=0;
+  m_tabdone=0;
   effect_exp[0].assign("");
   effect_exp[1].assign("");
   effect_exp[2].assign("");
@@ -187,6 +205,8 @@ C_THISCLASS::C_THISCLASS()
   wrap=0;
   buffern=0;
   nomove=0;
+  adaptive=0;
+  adapt_err=1;
 }
 
 C_THISCLASS::~C_THISCLASS()
@@ -198,10 +218,12 @@ C_THISCLASS::~C_THISCLASS()
     codehandle[x]=0;
   }
   AVS_EEL_QUITINST();
-  if (m_wmul) GlobalFree(m_wmul);
-  if (m_tab) GlobalFree(m_tab);
+  if (m_wmul) C_FBArena::free(m_wmul);
+  if (m_tab) C_FBArena::free(m_tab);
+  if (m_tabdone) C_FBArena::free(m_tabdone);
 
   m_tab=0;
+  m_tabdone=0;
   m_wmul=0;
   DeleteCriticalSection(&rcs);
 }
@@ -238,7 +260,7 @@ int C_THISCLASS::smp_begin(int max_threads, char visdata[2][2][576], int isBeat,
   if (YRES < 2) YRES=2;
   if (YRES > 256) YRES=256;
 
-  if (m_lasth != h || m_lastw != w || !m_tab || !m_wmul || 
+  if (m_lasth != h || m_lastw != w || !m_tab || !m_tabdone || !m_wmul || 
     m_lastxres != XRES || m_lastyres != YRES)
   {
     int y;
@@ -246,12 +268,14 @@ int C_THISCLASS::smp_begin(int max_threads, char visdata[2][2][576], int isBeat,
     m_lastyres = YRES;
     m_lastw=w;
     m_lasth=h;
-    if (m_wmul) GlobalFree(m_wmul);
-    m_wmul=(int*)GlobalAlloc(GMEM_FIXED,sizeof(int)*h);
+    if (m_wmul) C_FBArena::free(m_wmul);
+    m_wmul=(int*)C_FBArena::alloc(sizeof(int)*h,MOD_NAME,0);
     for (y = 0; y < h; y ++) m_wmul[y]=y*w;
-    if (m_tab) GlobalFree(m_tab);
+    if (m_tab) C_FBArena::free(m_tab);
 
-    m_tab=(int*)GlobalAlloc(GMEM_FIXED,(XRES*YRES*3 + (XRES*6 + 6)*MAX_SMP_THREADS)*sizeof(int));
+    m_tab=(int*)C_FBArena::alloc((XRES*YRES*3)*sizeof(int),MOD_NAME,0);
+    if (m_tabdone) C_FBArena::free(m_tabdone);
+    m_tabdone=(char*)C_FBArena::alloc(XRES*YRES,MOD_NAME,0);
   }
 
   if (!__subpixel)
@@ -300,73 +324,150 @@ int C_THISCLASS::smp_begin(int max_threads, char visdata[2][2][576], int isBeat,
   {
     int x;
     int y;
-    int *tabptr=m_tab;
-
-    double xsc=2.0/w,ysc=2.0/h;
-    double dw2=((double)w*32768.0);
-    double dh2=((double)h*32768.0);
-    double max_screen_d=sqrt((double)(w*w+h*h))*0.5;
-    
-    double divmax_d=1.0/max_screen_d;
-
-    max_screen_d *= 65536.0;
-
-    int yc_pos, yc_dpos, xc_pos, xc_dpos;
-    yc_pos=0;
-    xc_dpos = (w<<16)/(XRES-1);
-    yc_dpos = (h<<16)/(YRES-1);
-    for (y = 0; y < YRES; y ++)
+
+    gen_xsc=2.0/w;
+    gen_ysc=2.0/h;
+    gen_dw2=((double)w*32768.0);
+    gen_dh2=((double)h*32768.0);
+    gen_max_screen_d=sqrt((double)(w*w+h*h))*0.5;
+    gen_divmax_d=1.0/gen_max_screen_d;
+    gen_max_screen_d *= 65536.0;
+    gen_xc_dpos = (w<<16)/(XRES-1);
+    gen_yc_dpos = (h<<16)/(YRES-1);
+
+    memset(m_tabdone,0,XRES*YRES);
+    if (!adaptive)
+    {
+      for (y = 0; y < YRES; y ++)
+        for (x = 0; x < XRES; x ++)
+          gen_point(x,y,visdata);
+    }
+    else
     {
-      xc_pos=0;
-      for (x = 0; x < XRES; x ++)
+      // coarse cells first, each one split until its samples are within
+      // adapt_err pixels (and adapt_err/255 alpha) of the bilinear estimate
+      gen_maxerr=(adapt_err < 1 ? 1 : adapt_err)<<16;
+      for (y = 0; y < YRES-1; y += DMOVE_ADAPT_STEP)
       {
-        double xd,yd;
-        
-        xd=((double)xc_pos-dw2)*(1.0/65536.0);
-        yd=((double)yc_pos-dh2)*(1.0/65536.0);
+        int y1=min(y+DMOVE_ADAPT_STEP,YRES-1);
+        for (x = 0; x < XRES-1; x += DMOVE_ADAPT_STEP)
+          gen_cell(x,y,min(x+DMOVE_ADAPT_STEP,XRES-1),y1,visdata);
+      }
+    }
+  }
 
-        xc_pos+=xc_dpos;
+  return max_threads;
+}
 
-        *var_x=xd*xsc;
-        *var_y=yd*ysc;
-        *var_d=sqrt(xd*xd+yd*yd)*divmax_d;
-        *var_r=atan2(yd,xd) + M_PI*0.5;
+void C_THISCLASS::gen_point(int x, int y, char visdata[2][2][576])
+{
+  int *tabptr=m_tab+(y*XRES+x)*3;
+  double xd,yd;
 
-        executeCode(codehandle[0],visdata);
+  m_tabdone[y*XRES+x]=1;
 
-        int tmp1,tmp2;
-        if (!__rectcoords)
-        {
-          *var_d *= max_screen_d;
-          *var_r -= M_PI*0.5;
-          tmp1=(int) (dw2 + cos(*var_r) * *var_d);
-          tmp2=(int) (dh2 + sin(*var_r) * *var_d);
-        }
-        else
-        {
-          tmp1=(int) ((*var_x+1.0)*dw2);
-          tmp2=(int) ((*var_y+1.0)*dh2);
-        }
-        if (!__wrap)
-        {
-          if (tmp1 < 0) tmp1=0;
-          if (tmp1 > w_adj) tmp1=w_adj;
-          if (tmp2 < 0) tmp2=0;
-          if (tmp2 > h_adj) tmp2=h_adj;
-        }
-        *tabptr++ = tmp1;
-        *tabptr++ = tmp2;
-        double va=*var_alpha;
-        if (va < 0.0) va=0.0;
-        else if (va > 1.0) va=1.0;
-        int a=(int)(va*255.0*65536.0);
-        *tabptr++ = a;
-      }
-      yc_pos+=yc_dpos;
-    }
+  xd=((double)(x*gen_xc_dpos)-gen_dw2)*(1.0/65536.0);
+  yd=((double)(y*gen_yc_dpos)-gen_dh2)*(1.0/65536.0);
+
+  *var_x=xd*gen_xsc;
+  *var_y=yd*gen_ysc;
+  *var_d=sqrt(xd*xd+yd*yd)*gen_divmax_d;
+  *var_r=atan2(yd,xd) + M_PI*0.5;
+
+  executeCode(codehandle[0],visdata);
+
+  int tmp1,tmp2;
+  if (!__rectcoords)
+  {
+    *var_d *= gen_max_screen_d;
+    *var_r -= M_PI*0.5;
+    tmp1=(int) (gen_dw2 + cos(*var_r) * *var_d);
+    tmp2=(int) (gen_dh2 + sin(*var_r) * *var_d);
   }
+  else
+  {
+    tmp1=(int) ((*var_x+1.0)*gen_dw2);
+    tmp2=(int) ((*var_y+1.0)*gen_dh2);
+  }
+  if (!__wrap)
+  {
+    if (tmp1 < 0) tmp1=0;
+    if (tmp1 > w_adj) tmp1=w_adj;
+    if (tmp2 < 0) tmp2=0;
+    if (tmp2 > h_adj) tmp2=h_adj;
+  }
+  *tabptr++ = tmp1;
+  *tabptr++ = tmp2;
+  double va=*var_alpha;
+  if (va < 0.0) va=0.0;
+  else if (va > 1.0) va=1.0;
+  int a=(int)(va*255.0*65536.0);
+  *tabptr++ = a;
+}
 
-  return max_threads;
+// bilinear estimate of point x,y from the corners of cell x0,y0-x1,y1
+void C_THISCLASS::gen_interp(int x0, int y0, int x1, int y1, int x, int y, int *out)
+{
+  int *t00=m_tab+(y0*XRES+x0)*3, *t10=m_tab+(y0*XRES+x1)*3;
+  int *t01=m_tab+(y1*XRES+x0)*3, *t11=m_tab+(y1*XRES+x1)*3;
+  double fx=x1 > x0 ? (double)(x-x0)/(x1-x0) : 0.0;
+  double fy=y1 > y0 ? (double)(y-y0)/(y1-y0) : 0.0;
+  int c;
+  for (c = 0; c < 3; c ++)
+  {
+    double top=t00[c]+(t10[c]-t00[c])*fx;
+    double bot=t01[c]+(t11[c]-t01[c])*fx;
+    out[c]=(int)(top+(bot-top)*fy);
+  }
+}
+
+void C_THISCLASS::gen_cell(int x0, int y0, int x1, int y1, char visdata[2][2][576])
+{
+  // corners are shared with neighbouring cells, only evaluate them once
+  if (!m_tabdone[y0*XRES+x0]) gen_point(x0,y0,visdata);
+  if (!m_tabdone[y0*XRES+x1]) gen_point(x1,y0,visdata);
+  if (!m_tabdone[y1*XRES+x0]) gen_point(x0,y1,visdata);
+  if (!m_tabdone[y1*XRES+x1]) gen_point(x1,y1,visdata);
+
+  int mx=x1-x0 > 1 ? (x0+x1)/2 : -1;
+  int my=y1-y0 > 1 ? (y0+y1)/2 : -1;
+  if (mx < 0 && my < 0) return; // no grid points inside
+
+  // sample the centre and edge midpoints
+  int sx[5], sy[5], ns=0, i;
+  if (mx >= 0) { sx[ns]=mx; sy[ns++]=y0; sx[ns]=mx; sy[ns++]=y1; }
+  if (my >= 0) { sx[ns]=x0; sy[ns++]=my; sx[ns]=x1; sy[ns++]=my; }
+  if (mx >= 0 && my >= 0) { sx[ns]=mx; sy[ns++]=my; }
+
+  int split=0;
+  for (i = 0; i < ns; i ++)
+  {
+    int est[3];
+    int *t=m_tab+(sy[i]*XRES+sx[i])*3;
+    if (!m_tabdone[sy[i]*XRES+sx[i]]) gen_point(sx[i],sy[i],visdata);
+    gen_interp(x0,y0,x1,y1,sx[i],sy[i],est);
+    if (abs(t[0]-est[0]) > gen_maxerr || abs(t[1]-est[1]) > gen_maxerr ||
+        abs(t[2]-est[2]) > gen_maxerr) split=1;
+  }
+
+  if (split)
+  {
+    if (mx < 0) mx=x1;
+    if (my < 0) my=y1;
+    gen_cell(x0,y0,mx,my,visdata);
+    if (mx < x1) gen_cell(mx,y0,x1,my,visdata);
+    if (my < y1) gen_cell(x0,my,mx,y1,visdata);
+    if (mx < x1 && my < y1) gen_cell(mx,my,x1,y1,visdata);
+    return;
+  }
+
+  // smooth enough, fill in whatever the pixel code didn't produce. points
+  // on a shared edge may get filled again by the neighbour, both estimates
+  // are within gen_maxerr of the code there.
+  int x,y;
+  for (y = y0; y <= y1; y ++)
+    for (x = x0; x <= x1; x ++)
+      if (!m_tabdone[y*XRES+x]) gen_interp(x0,y0,x1,y1,x,y,m_tab+(y*XRES+x)*3);
 }
 
 
@@ -390,7 +491,7 @@ void C_THISCLASS::smp_render(int this_thread, int max_threads, char visdata[2][2
   // interpolation of the whole thing and pray.
 
   {
-    int *interptab=m_tab+XRES*YRES*3 + this_thread * (XRES*6+6);
+    int interptab[256*6+6]; // per call, so any thread can run any tile (XRES <= 256)
     int *rdtab=m_tab;
     unsigned int *in=(unsigned int *)fbin;
     unsigned int *blendin=(unsigned int *)framebuffer;
@@ -639,6 +740,9 @@ static BOOL CALLBACK g_DlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam,LPARAM lPa
         CheckDlgButton(hwndDlg,IDC_WRAP,BST_CHECKED);
       if (g_this->nomove)
         CheckDlgButton(hwndDlg,IDC_NOMOVEMENT,BST_CHECKED);
+      if (g_this->adaptive)
+        CheckDlgButton(hwndDlg,IDC_ADAPTIVE,BST_CHECKED);
+      SetDlgItemInt(hwndDlg,IDC_EDIT_ADAPTERR,g_this->adapt_err,FALSE);
 
       SendDlgItemMessage(hwndDlg, IDC_COMBO1, CB_ADDSTRING, 0, (LPARAM)WASABI_API_LNGSTRING(IDS_CURRENT));
   		{
@@ -687,6 +791,10 @@ static BOOL CALLBACK g_DlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam,LPARAM lPa
       {
         g_this->nomove=IsDlgButtonChecked(hwndDlg,IDC_NOMOVEMENT)?1:0;
       }
+      if (LOWORD(wParam)==IDC_ADAPTIVE)
+      {
+        g_this->adaptive=IsDlgButtonChecked(hwndDlg,IDC_ADAPTIVE)?1:0;
+      }
       // Load preset examples from the examples table.
       if (LOWORD(wParam) == IDC_BUTTON4)
       {
@@ -750,6 +858,11 @@ static BOOL CALLBACK g_DlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam,LPARAM lPa
           g_this->m_xres=GetDlgItemInt(hwndDlg,IDC_EDIT5,&t,0);
           g_this->m_yres=GetDlgItemInt(hwndDlg,IDC_EDIT6,&t,0);
         }
+        if (LOWORD(wParam) == IDC_EDIT_ADAPTERR)
+        {
+          BOOL t;
+          g_this->adapt_err=GetDlgItemInt(hwndDlg,IDC_EDIT_ADAPTERR,&t,0);
+        }
       
         if (LOWORD(wParam) == IDC_EDIT1||LOWORD(wParam) == IDC_EDIT2||LOWORD(wParam) == IDC_EDIT3||LOWORD(wParam) == IDC_EDIT4)
         {
@@ -33,7 +33,6 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "r_defs.h"
 #include "resource.h"
 
-#include "timing.h"
 #include "../Agave/Language/api_language.h"
 
 #ifndef LASER
@@ -121,7 +120,6 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
 {
   if (isBeat&0x80000000) return 0;
   if (!fadelen) return 0;
-	timingEnter(1);
 	if (
 #ifdef NO_MMX
     1
@@ -209,7 +207,6 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
 		}
   }
 #endif
-	timingLeave(1);
   return 0;
 }
 
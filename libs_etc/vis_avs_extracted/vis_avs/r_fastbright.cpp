@@ -32,7 +32,6 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "r_defs.h"
 #include "resource.h"
 
-#include "timing.h"
 #include "../Agave/Language/api_language.h"
 
 #ifndef LASER
@@ -40,7 +39,7 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define C_THISCLASS C_FastBright
 #define MOD_NAME "Trans / Fast Brightness"
 
-class C_THISCLASS : public C_RBASE {
+class C_THISCLASS : public C_RBASE2 {
 	protected:
 	public:
 		C_THISCLASS();
@@ -50,6 +49,11 @@ class C_THISCLASS : public C_RBASE {
 		virtual HWND conf(HINSTANCE hInstance, HWND hwndParent);
 		virtual void load_config(unsigned char *data, int len);
 		virtual int  save_config(unsigned char *data);
+
+    virtual int smp_getflags() { return 7; }
+		virtual int smp_begin(int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); 
+    virtual void smp_render(int this_thread, int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); 
+    virtual int smp_finish(char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h) { return 0; }
 #ifdef NO_MMX 
     int tab[3][256];
 #endif
@@ -100,15 +104,40 @@ C_THISCLASS::~C_THISCLASS()
 }
 	
 int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
+{
+  if (!smp_begin(1,visdata,isBeat,framebuffer,fbout,w,h)) return 0;
+  smp_render(0,1,visdata,isBeat,framebuffer,fbout,w,h);
+  return 0;
+}
+
+int C_THISCLASS::smp_begin(int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
 {
   if (isBeat&0x80000000) return 0;
+  if (dir != 0 && dir != 1) return 0;
+  return max_threads;
+}
+
+void C_THISCLASS::smp_render(int this_thread, int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
+{
+  if (max_threads < 1) max_threads=1;
+
+  int start_l = ( this_thread * h ) / max_threads;
+  int end_l;
+
+  if (this_thread >= max_threads - 1) end_l = h;
+  else end_l = ( (this_thread+1) * h ) / max_threads;  
+
+  int l=w*(end_l-start_l);
+  int *p=framebuffer+start_l*w;
+  if (l<2) return;
+
 #ifdef NO_MMX // the non mmx x2 version really isn't any , in terms faster than normal brightness with no exclusions turned on
 	{
-	  unsigned int *t=(unsigned int *)framebuffer;
+	  unsigned int *t=(unsigned int *)p;
 	  int x;
     unsigned int mask = 0x7F7F7F7F;
 
-    x=w*h/2;
+    x=l/2;
 	  if (dir == 0)
       while (x--)
 	    {
@@ -136,12 +165,12 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
     0x7F7F7F7F,
     0x7F7F7F7F,
   };
-  int l=(w*h);
   if (dir == 0) __asm 
 		{
 			mov edx, l
-			mov edi, framebuffer
+			mov edi, p
       shr edx, 3 // 8 pixels at a time
+      jz _l1done
       align 16
 		_l1:
 			movq mm0, [edi]
@@ -161,6 +190,7 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
 
 			dec edx
 			jnz _l1
+		_l1done:
 
 			mov edx, l
 			and edx, 7
@@ -181,8 +211,9 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
 		{
 			mov edx, l
       movq mm7, [mask]
-			mov edi, framebuffer
+			mov edi, p
       shr edx, 3 // 8 pixels at a time
+      jz _lr1done
       align 16
 		_lr1:
 			movq mm0, [edi]
@@ -213,6 +244,7 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
 
 			dec edx
 			jnz _lr1
+		_lr1done:
 
 			mov edx, l
 			and edx, 7
@@ -231,7 +263,6 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
 			emms
 		}
 #endif
-  return 0;
 }
 
 C_RBASE *R_FastBright(char *desc)
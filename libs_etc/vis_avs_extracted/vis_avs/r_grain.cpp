@@ -33,6 +33,8 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <commctrl.h>
 #include "resource.h"
 #include "r_defs.h"
+#include "fb_arena.h"
+#include "rng.h"
 #include "../Agave/Language/api_language.h"
 
 #ifndef LASER
@@ -59,6 +61,7 @@ class C_THISCLASS : public C_RBASE {
 	int staticgrain;
   unsigned char randtab[491];
   int randtab_pos;
+  C_Rng rng;
 };
 
 
@@ -69,7 +72,7 @@ static HINSTANCE g_hDllInstance; // global DLL instance pointer (not needed in t
 C_THISCLASS::~C_THISCLASS() // set up default configuration
 {
 if (depthBuffer)
-	GlobalFree(depthBuffer);
+	C_FBArena::free(depthBuffer);
 }
 
 // configuration read/write
@@ -84,10 +87,8 @@ C_THISCLASS::C_THISCLASS() // set up default configuration
   oldy=0;
   staticgrain=0;
   depthBuffer=NULL;
-  int x;
-  for (x = 0 ;x < sizeof(randtab); x ++)
-    randtab[x]=rand()&255;
-  randtab_pos=rand()%sizeof(randtab);
+  rng.fill(randtab,sizeof(randtab));
+  randtab_pos=rng.below((int)sizeof(randtab));
 }
 
 unsigned char __inline C_THISCLASS::fastrandbyte(void)
@@ -96,7 +97,7 @@ unsigned char __inline C_THISCLASS::fastrandbyte(void)
   randtab_pos++;
   if (!(randtab_pos&15))
   {
-    randtab_pos+=rand()%73;
+    randtab_pos+=rng.below(73);
   }
   if (randtab_pos >= 491) randtab_pos-=491;
   return r;
@@ -130,15 +131,15 @@ void C_THISCLASS::reinit(int w, int h)
 int x,y;
 unsigned char *p;
 if (depthBuffer)
-	GlobalFree(depthBuffer);
-depthBuffer = (unsigned char *)GlobalAlloc(GMEM_FIXED,w*h*2);
+	C_FBArena::free(depthBuffer);
+depthBuffer = (unsigned char *)C_FBArena::alloc(w*h*2,MOD_NAME,0);
 p = depthBuffer;
 if (p)
 	for (y=0;y<h;y++)
 		for (x=0;x<w;x++)
 			{
-			*p++ = (rand()%255);
-			*p++ = (rand()%100);
+			*p++ = rng.below(255);
+			*p++ = rng.below(100);
 			}
 
 }
@@ -166,7 +167,7 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
 	  oldx = w;
 	  oldy = h;
 	}
-  randtab_pos+=rand()%300;
+  randtab_pos+=rng.below(300);
   if (randtab_pos >= 491) randtab_pos-=491;
 
   p = framebuffer;
@@ -40,7 +40,7 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define MOD_NAME "Trans / Invert"
 #define C_THISCLASS C_InvertClass
 
-class C_THISCLASS : public C_RBASE {
+class C_THISCLASS : public C_RBASE2 {
 	protected:
 	public:
 		C_THISCLASS();
@@ -50,6 +50,12 @@ class C_THISCLASS : public C_RBASE {
 		virtual HWND conf(HINSTANCE hInstance, HWND hwndParent);
 		virtual void load_config(unsigned char *data, int len);
 		virtual int  save_config(unsigned char *data);
+
+    virtual int smp_getflags() { return 7; }
+		virtual int smp_begin(int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); 
+    virtual void smp_render(int this_thread, int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); 
+    virtual int smp_finish(char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h) { return 0; }
+
     int enabled;
 	};
 
@@ -93,20 +99,41 @@ int  C_THISCLASS::save_config(unsigned char *data) // write configuration to dat
 
 int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
 {
-  int i=w*h;
-  int *p=framebuffer;
+  if (!smp_begin(1,visdata,isBeat,framebuffer,fbout,w,h)) return 0;
+  smp_render(0,1,visdata,isBeat,framebuffer,fbout,w,h);
+  return 0;
+}
 
+int C_THISCLASS::smp_begin(int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
+{
   if (isBeat&0x80000000) return 0;
   if (!enabled) return 0;
-  
+  return max_threads;
+}
+
+void C_THISCLASS::smp_render(int this_thread, int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
+{
+  if (max_threads < 1) max_threads=1;
+
+  int start_l = ( this_thread * h ) / max_threads;
+  int end_l;
+
+  if (this_thread >= max_threads - 1) end_l = h;
+  else end_l = ( (this_thread+1) * h ) / max_threads;  
+
+  int i=w*(end_l-start_l);
+  int *p=framebuffer+start_l*w;
+  if (i<1) return;
+
 #ifndef NO_MMX
     int a[2]={0xffffff,0xffffff};
     __asm
     {
       mov ecx, i
-      shr ecx, 3
       movq mm0, [a]
       mov edi, p
+      shr ecx, 3
+      jz _mmx_invert_nomainloop
       align 16
 _mmx_invert_loop:
       movq mm1, [edi]
@@ -124,6 +151,7 @@ _mmx_invert_loop:
       add edi, 32
       dec ecx
       jnz _mmx_invert_loop
+_mmx_invert_nomainloop:
       mov ecx, i
       shr ecx, 1
       and ecx, 3
@@ -142,7 +170,6 @@ _mmx_invert_noendloop:
 #else 
   while (i--) *p++ = 0xFFFFFF^*p;
 #endif
-  return 0;
 }
 
 
@@ -36,6 +36,9 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "r_list.h"
 #include "render.h"
 #include "undo.h"
+#include "smp_pool.h"
+#include "fb_arena.h"
+#include "profiler.h"
 
 #include "avs_eelif.h"
 #include "../Agave/Language/api_language.h"
@@ -43,7 +46,8 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define PUT_INT(y) data[pos]=(y)&255; data[pos+1]=(y>>8)&255; data[pos+2]=(y>>16)&255; data[pos+3]=(y>>24)&255
 #define GET_INT() (data[pos]|(data[pos+1]<<8)|(data[pos+2]<<16)|(data[pos+3]<<24))
 
-char *C_RenderListClass::get_desc() { static char desc[128]; return WASABI_API_LNGSTRING_BUF(isroot?IDS_MAIN:IDS_EFFECT_LIST,desc,128); }
+// looked up once: lists rendering at the same time can't share a buffer being written
+char *C_RenderListClass::get_desc() { static char desc[2][128]; char *d=desc[!!isroot]; return d[0] ? d : WASABI_API_LNGSTRING_BUF(isroot?IDS_MAIN:IDS_EFFECT_LIST,d,128); }
 
 int g_config_seh=1;
 extern int g_config_smp_mt,g_config_smp;
@@ -135,9 +139,18 @@ int  C_RenderListClass::save_config(unsigned char *data)
   return save_config_ex(data,0);
 }
 int  C_RenderListClass::save_config_ex(unsigned char *data, int rootsave)
+{
+  C_ConfigWriter w(data);
+  save_config_ex(w,rootsave);
+  return w.size();
+}
+
+int  C_RenderListClass::save_config_ex(C_ConfigWriter &w, int rootsave)
 {
 	int pos=0;
 	int x;
+  unsigned char *data=w.reserve(64);
+  if (!data) return -1;
   if (!rootsave)
   {
     set_extended_datasize(36); // size of extended data + 4 cause we fucked up
@@ -155,10 +168,13 @@ int  C_RenderListClass::save_config_ex(unsigned char *data, int rootsave)
     // end extended data
   }
   else data[pos++] = mode;
+  w.skip(pos);
 
   if (!rootsave)
   {
     // write in our ext field
+    if (!(data=w.reserve(CONFIG_EFFECT_HEADROOM))) return -1;
+    pos=0;
     PUT_INT(DLLRENDERBASE); pos+=4;
     char s[33];
     strncpy(s,extsigstr,32);
@@ -167,6 +183,7 @@ int  C_RenderListClass::save_config_ex(unsigned char *data, int rootsave)
     int t=save_config_code(data+pos+4);
     PUT_INT(t);
     pos+=4+t;
+    w.skip(pos);
   }
 
 
@@ -174,6 +191,8 @@ int  C_RenderListClass::save_config_ex(unsigned char *data, int rootsave)
   {
     int t;
     int idx=renders[x].effect_index;
+    if (!(data=w.reserve(CONFIG_EFFECT_HEADROOM))) return -1;
+    pos=0;
     if (idx==UNKN_ID)
     {
       C_UnknClass *r=(C_UnknClass *)renders[x].render;
@@ -197,14 +216,55 @@ int  C_RenderListClass::save_config_ex(unsigned char *data, int rootsave)
       }
     }
 
+    if (idx == LIST_ID)
+    {
+      // nested lists have no size limit, they write to w themselves and
+      // the length goes in afterwards
+      w.skip(pos+4);
+      int start=w.size();
+      if (((C_RenderListClass *)renders[x].render)->save_config_ex(w,0) < 0) return -1;
+      t=w.size()-start;
+      data=w.get()+start-4; // w may have moved
+      pos=0;
+      PUT_INT(t);
+      continue;
+    }
+
     t=renders[x].render->save_config(data+pos+4);
     PUT_INT(t);
     pos+=4+t;
+    w.skip(pos);
   }
 
+  return 0;
+}
 
+C_ConfigWriter::C_ConfigWriter(unsigned char *fixed)
+{
+  m_data=fixed;
+  m_fixed=!!fixed;
+  m_pos=m_alloc=0;
+}
 
-  return pos;
+C_ConfigWriter::~C_ConfigWriter()
+{
+  if (!m_fixed && m_data) GlobalFree((HGLOBAL)m_data);
+}
+
+unsigned char *C_ConfigWriter::reserve(int bytes)
+{
+  if (m_fixed || m_pos+bytes <= m_alloc) return m_data+m_pos;
+  int n=max(m_pos+bytes,m_alloc*2);
+  unsigned char *p=(unsigned char *)GlobalAlloc(GMEM_FIXED,n);
+  if (!p) return NULL;
+  if (m_data)
+  {
+    memcpy(p,m_data,m_pos);
+    GlobalFree((HGLOBAL)m_data);
+  }
+  m_data=p;
+  m_alloc=n;
+  return m_data+m_pos;
 }
 
 
@@ -243,6 +303,7 @@ C_RenderListClass::C_RenderListClass(int iroot)
   num_renders_alloc=0;
   renders=NULL;
   thisfb=NULL;
+  groupfb=NULL;
   l_w=l_h=0;
   mode=0;
   beat_render = 0;
@@ -291,24 +352,7 @@ void C_RenderListClass::unset_n_Context()
 
 void C_RenderListClass::smp_cleanupthreads()
 {
-
-  if (smp_parms.threadTop>0)
-  {
-    if (smp_parms.hQuitHandle) SetEvent(smp_parms.hQuitHandle);
-
-    WaitForMultipleObjects(smp_parms.threadTop,smp_parms.hThreads,TRUE,INFINITE);
-    int x;
-    for (x = 0; x < smp_parms.threadTop; x ++)
-    {
-      CloseHandle(smp_parms.hThreads[x]);
-      CloseHandle(smp_parms.hThreadSignalsDone[x]);
-      CloseHandle(smp_parms.hThreadSignalsStart[x]);
-    }
-  }
-
-  if (smp_parms.hQuitHandle) CloseHandle(smp_parms.hQuitHandle);
-
-  memset(&smp_parms,0,sizeof(smp_parms));
+  C_SmpPool::shutdown();
 }
 
 void C_RenderListClass::freeBuffers()
@@ -319,7 +363,7 @@ void C_RenderListClass::freeBuffers()
     int x;
     for (x = 0; x < NBUF; x ++)
     {
-      if (nb_save[x]) GlobalFree(nb_save[x]);
+      if (nb_save[x]) C_FBArena::free(nb_save[x]);
       nb_save[x]=NULL;
       nbw_save[x]=nbh_save[x]=0;
     }
@@ -355,7 +399,9 @@ static int __inline depthof(int c, int i)
 
 
 	
-int C_RenderListClass::render(char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
+
+// runs the list's code, which can change what the rest of the frame does
+void C_RenderListClass::layer_Begin(char visdata[2][2][576], int isBeat, int w, int h, _s_layer_parms *p)
 {
   int is_preinit = (isBeat&0x80000000);
 
@@ -424,6 +470,25 @@ int C_RenderListClass::render(char visdata[2][2][576], int isBeat, int *framebuf
     // code execute
   }
 
+  p->is_preinit=is_preinit;
+  p->isBeat=isBeat;
+  p->enabled=use_enabled;
+  p->clear=use_clear;
+  p->inblendval=use_inblendval;
+  p->outblendval=use_outblendval;
+  p->grouped=0;
+}
+
+int C_RenderListClass::render(char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
+{
+  _s_layer_parms lp;
+  layer_Begin(visdata,isBeat,w,h,&lp);
+
+  int is_preinit=lp.is_preinit;
+  int use_enabled=lp.enabled;
+  int use_clear=lp.clear;
+  isBeat=lp.isBeat;
+
 #ifndef LASER
   // root/replaceinout special cases
   if (isroot || (use_enabled && blendin()==1 && blendout()==1)) 
@@ -432,8 +497,10 @@ int C_RenderListClass::render(char visdata[2][2][576], int isBeat, int *framebuf
     int s=0,x;
 #ifndef LASER
     int line_blend_mode_save=g_line_blend_mode;
-    if (thisfb) GlobalFree((HGLOBAL)thisfb); 
+    if (thisfb) C_FBArena::free(thisfb); 
     thisfb=NULL;
+    if (groupfb) C_FBArena::free(groupfb);
+    groupfb=NULL;
     if (use_clear&&(isroot||blendin()!=1)) 
       memset(framebuffer,0,w*h*sizeof(int));
     if (!is_preinit) 
@@ -457,21 +524,39 @@ int C_RenderListClass::render(char visdata[2][2][576], int isBeat, int *framebuf
         int smp_max_threads = g_config_smp ? g_config_smp_mt : 0;
         C_RBASE2 *rb2 = (C_RBASE2*)renders[x].render;
 
+        // a fused run or a group is charged to its first effect
+        int prof=C_Profiler::isOn() ? C_Profiler::enter(renders[x].render->get_desc(),x) : 0;
+        int nfused=fused_Render(x,is_preinit,visdata,isBeat,s?fbout:framebuffer,s?framebuffer:fbout,w,h);
+#ifndef LASER
+        if (!nfused) nfused=group_Render(x,is_preinit,visdata,isBeat,s?fbout:framebuffer,w,h);
+#endif
+        if (nfused)
+        {
+          C_Profiler::leave(prof);
+          x+=nfused-1;
+          continue;
+        }
+
         if (renders[x].has_rbase2 && smp_max_threads > 1 && (rb2->smp_getflags()&1))
         {
           if (smp_max_threads>MAX_SMP_THREADS) smp_max_threads=MAX_SMP_THREADS;
 
           int nt=smp_max_threads;
+          int pp=C_Profiler::enter("smp_begin");
           nt=rb2->smp_begin(nt,visdata,isBeat,s?fbout:framebuffer,s?framebuffer:fbout,w,h);
+          C_Profiler::leave(pp);
           if (!is_preinit && nt>0)
           {
             if (nt>smp_max_threads)nt=smp_max_threads;
 
             // launch threads
+            pp=C_Profiler::enter("smp_render");
             smp_Render(nt,rb2,visdata,isBeat,s?fbout:framebuffer,s?framebuffer:fbout,w,h);
+            C_Profiler::leave(pp);
 
-
+            pp=C_Profiler::enter("smp_finish");
             t=rb2->smp_finish(visdata,isBeat,s?fbout:framebuffer,s?framebuffer:fbout,w,h);
+            C_Profiler::leave(pp);
           }
 
         }
@@ -493,6 +578,7 @@ int C_RenderListClass::render(char visdata[2][2][576], int isBeat, int *framebuf
             t=renders[x].render->render(visdata,isBeat,s?fbout:framebuffer,s?framebuffer:fbout,w,h);
           }
         }
+        C_Profiler::leave(prof);
 
 
         if (t&1) s^=1;
@@ -528,13 +614,44 @@ int C_RenderListClass::render(char visdata[2][2][576], int isBeat, int *framebuf
   // check to see if we're enabled
   if (!use_enabled) 
   {
-    if (thisfb) GlobalFree((HGLOBAL)thisfb); 
+    if (thisfb) C_FBArena::free(thisfb); 
     thisfb=NULL;
+    if (groupfb) C_FBArena::free(groupfb);
+    groupfb=NULL;
     return 0;
   }
 
   fake_enabled--;
 
+  int s=layer_Render(visdata,&lp,framebuffer,fbout,w,h);
+
+  // if s==1 at this point, data we want is in fbout.
+
+  if (!is_preinit) 
+  {
+    if (s) memcpy(thisfb,fbout,w*h*sizeof(int));
+
+    // replace can leave it there
+    int use_blendout=blendout();
+    if (use_blendout == 10 && lp.outblendval >= 255)
+      use_blendout=1;
+    if (use_blendout == 1 && s) return 1;
+
+    layer_BlendOut(&lp,framebuffer,s?fbout:thisfb,w,h);
+  }
+  return 0;
+#endif // !LASER
+}
+
+#ifndef LASER
+// blends framebuffer in and renders the effects into thisfb. returns 1 if
+// they left the result in fbout.
+int C_RenderListClass::layer_Render(char visdata[2][2][576], _s_layer_parms *lp, int *framebuffer, int *fbout, int w, int h)
+{
+  int is_preinit=lp->is_preinit;
+  int isBeat=lp->isBeat;
+  int use_clear=lp->clear;
+  int use_inblendval=lp->inblendval;
 
   // handle resize
   if (l_w != w || l_h != h || !thisfb)
@@ -542,7 +659,7 @@ int C_RenderListClass::render(char visdata[2][2][576], int isBeat, int *framebuf
     extern int config_reuseonresize;
     int do_resize=config_reuseonresize && !!thisfb && l_w && l_h && !use_clear;
 
-    int *newfb=(int*)GlobalAlloc(do_resize?GMEM_FIXED:GPTR,w*h*sizeof(int));
+    int *newfb=(int*)C_FBArena::alloc(w*h*sizeof(int),"Render / Effect List",!do_resize);
     if (newfb && do_resize) 
     {
       int x,y;
@@ -564,8 +681,10 @@ int C_RenderListClass::render(char visdata[2][2][576], int isBeat, int *framebuf
     }
     l_w=w;
     l_h=h;
-    if (thisfb) GlobalFree((HGLOBAL)thisfb);
+    if (thisfb) C_FBArena::free(thisfb);
     thisfb=newfb;
+    if (groupfb) C_FBArena::free(groupfb);
+    groupfb=NULL;
   }
   // handle clear mode
   if (use_clear) memset(thisfb,0,w*h*sizeof(int));
@@ -592,28 +711,16 @@ int C_RenderListClass::render(char visdata[2][2][576], int isBeat, int *framebuf
         mmx_avgblend_block(o,tfb,x);
       break;
       case 3:
-        while (x--)
-        {
-          *o=BLEND_MAX(*o,*tfb++);
-          o++;
-        }
+        g_blendsimd.maxblend(o,o,tfb,x);
       break;
       case 4:
         mmx_addblend_block(o,tfb,x);
       break;
       case 5:
-        while (x--)
-        {
-          *o=BLEND_SUB(*o,*tfb++);
-          o++;
-        }
+        g_blendsimd.subblend(o,o,tfb,x);
       break;
       case 6:
-        while (x--)
-        {
-          *o=BLEND_SUB(*tfb++,*o);
-          o++;
-        }
+        g_blendsimd.subblend(o,tfb,o,x);
       break;
       case 7:
         {
@@ -662,11 +769,7 @@ int C_RenderListClass::render(char visdata[2][2][576], int isBeat, int *framebuf
           mmx_mulblend_block(o,tfb,x);
       break;
       case 13:
-        while (x--)
-        {
-          *o=BLEND_MIN(*o,*tfb++);
-          o++;
-        }
+        g_blendsimd.minblend(o,o,tfb,x);
       break;
       case 12:
 				{
@@ -691,8 +794,9 @@ int C_RenderListClass::render(char visdata[2][2][576], int isBeat, int *framebuf
 
   int s=0;
   int x;
+  // not written from a group: its lists render at the same time
   int line_blend_mode_save=g_line_blend_mode;
-  if (!is_preinit) g_line_blend_mode=0;
+  if (!is_preinit && !lp->grouped) g_line_blend_mode=0;
 
   for (x = 0; x < num_renders; x ++)
   {
@@ -700,6 +804,14 @@ int C_RenderListClass::render(char visdata[2][2][576], int isBeat, int *framebuf
     
     int smp_max_threads;
     C_RBASE2 *rb2;
+
+    int nfused=fused_Render(x,is_preinit,visdata,isBeat,s?fbout:thisfb,s?thisfb:fbout,w,h);
+    if (!nfused) nfused=group_Render(x,is_preinit,visdata,isBeat,s?fbout:thisfb,w,h);
+    if (nfused)
+    {
+      x+=nfused-1;
+      continue;
+    }
     
     if (renders[x].has_rbase2 && (smp_max_threads=g_config_smp ? g_config_smp_mt : 0) > 1 && ((rb2 = (C_RBASE2*)renders[x].render)->smp_getflags()&1))
     {
@@ -744,113 +856,91 @@ int C_RenderListClass::render(char visdata[2][2][576], int isBeat, int *framebuf
           isBeat=0;
     }
   }
-  if (!is_preinit) g_line_blend_mode=line_blend_mode_save;
+  if (!is_preinit && !lp->grouped) g_line_blend_mode=line_blend_mode_save;
 
-  // if s==1 at this point, data we want is in fbout.
+  return s;
+}
 
-  if (!is_preinit) 
+void C_RenderListClass::layer_BlendOut(_s_layer_parms *lp, int *framebuffer, int *tfb, int w, int h)
+{
+  int *o=framebuffer;
+  int x=w*h;
+  set_n_Context();
+
+  int use_outblendval=lp->outblendval;
+  int use_blendout=blendout();
+  if (use_blendout == 10 && use_outblendval >= 255)
+    use_blendout=1;
+  switch (use_blendout)
   {
-    if (s) memcpy(thisfb,fbout,w*h*sizeof(int));
-
-    int *tfb=s?fbout:thisfb;
-    int *o=framebuffer;
-    x=w*h;
-    set_n_Context();
-
-    int use_blendout=blendout();
-    if (use_blendout == 10 && use_outblendval >= 255)
-      use_blendout=1;
-    switch (use_blendout)
-    {
-      case 1:
-        if (s) 
-        { 
-          unset_n_Context(); 
-          return 1; 
-        }
-        memcpy(o,tfb,x*sizeof(int));
-      break;
-      case 2:
-        mmx_avgblend_block(o,tfb,x);
-      break;
-      case 3:
-        while (x--)
-        {
-          *o=BLEND_MAX(*o,*tfb++);
-          o++;
-        }
-      break;
-      case 4:
-            mmx_addblend_block(o,tfb,x);
-      break;
-      case 5:
-        while (x--)
-        {
-          *o=BLEND_SUB(*o,*tfb++);
-          o++;
-        }
-      break;
-      case 6:
-        while (x--)
-        {
-          *o=BLEND_SUB(*tfb++,*o);
-          o++;
-        }
-      break;
-      case 7:
+    case 1:
+      memcpy(o,tfb,x*sizeof(int));
+    break;
+    case 2:
+      mmx_avgblend_block(o,tfb,x);
+    break;
+    case 3:
+      g_blendsimd.maxblend(o,o,tfb,x);
+    break;
+    case 4:
+          mmx_addblend_block(o,tfb,x);
+    break;
+    case 5:
+      g_blendsimd.subblend(o,o,tfb,x);
+    break;
+    case 6:
+      g_blendsimd.subblend(o,tfb,o,x);
+    break;
+    case 7:
+      {
+        int y=h/2;
+        while (y-- > 0)
         {
-          int y=h/2;
-          while (y-- > 0)
-          {
-            memcpy(o,tfb,w*sizeof(int));
-            tfb+=w*2;
-            o+=w*2;
-          }
+          memcpy(o,tfb,w*sizeof(int));
+          tfb+=w*2;
+          o+=w*2;
         }
-      break;
-      case 8:
+      }
+    break;
+    case 8:
+      {
+        int r=0;
+        int y=h;
+        while (y-- > 0)
         {
-          int r=0;
-          int y=h;
-          while (y-- > 0)
+          int *out, *in;
+          int x=w/2;
+          out=o+r;
+          in=tfb+r;
+          r^=1;
+          while (x-- > 0)
           {
-            int *out, *in;
-            int x=w/2;
-            out=o+r;
-            in=tfb+r;
-            r^=1;
-            while (x-- > 0)
-            {
-              *out=*in;
-              out+=2;
-              in+=2;
-            }
-            o+=w;
-            tfb+=w;
+            *out=*in;
+            out+=2;
+            in+=2;
           }
+          o+=w;
+          tfb+=w;
         }
-      break;
-      case 9:
-        while (x--)
-        {
-          *o=*o^*tfb++;
-          o++;
-        }
-      break;
-      case 10:
-          mmx_adjblend_block(o,tfb,o,x,use_outblendval);
-      break;
-      case 11:
-            mmx_mulblend_block(o,tfb,x);
-      break;
-      case 13:
-        while (x--)
-        {
-          *o=BLEND_MIN(*o,*tfb++);
-          o++;
-        }
-      break;
-      case 12:
+      }
+    break;
+    case 9:
+      while (x--)
+      {
+        *o=*o^*tfb++;
+        o++;
+      }
+    break;
+    case 10:
+        mmx_adjblend_block(o,tfb,o,x,use_outblendval);
+    break;
+    case 11:
+          mmx_mulblend_block(o,tfb,x);
+    break;
+    case 13:
+      g_blendsimd.minblend(o,o,tfb,x);
+    break;
+    case 12:
 			  {
 				  int *buf=(int*)getGlobalBuffer(w,h,bufferout,0);
 				  if (!buf) break;
@@ -860,19 +950,17 @@ int C_RenderListClass::render(char visdata[2][2][576], int isBeat, int *framebuf
 					  o++;
 					  buf++;
 				  }
-  #ifndef NO_MMX
-          __asm emms;
-  #endif
+#ifndef NO_MMX
+        __asm emms;
+#endif
 			  }
-      break;
-      default:
-      break;
-    }
-    unset_n_Context();
+    break;
+    default:
+    break;
   }
-  return 0;
-#endif // !LASER
+  unset_n_Context();
 }
+#endif // !LASER
 
 int C_RenderListClass::getNumRenders(void)
 {
@@ -937,8 +1025,10 @@ void C_RenderListClass::clearRenders(void)
   num_renders=0;
   num_renders_alloc=0;
   renders=NULL;
-  if (thisfb) GlobalFree((HGLOBAL)thisfb);
+  if (thisfb) C_FBArena::free(thisfb);
   thisfb=0;
+  if (groupfb) C_FBArena::free(groupfb);
+  groupfb=0;
 }
 
 int C_RenderListClass::insertRenderBefore(T_RenderListType *r, T_RenderListType *before)
@@ -1224,93 +1314,91 @@ HWND C_RenderListClass::conf(HINSTANCE hInstance, HWND hwndParent)
 
 char C_RenderListClass::sig_str[] = "Nullsoft AVS Preset 0.2\x1a";
 
+int C_RenderListClass::checksig(unsigned char *data, int len)
+{
+  int l=strlen(sig_str);
+  if (len > l+2 && !memcmp(data,sig_str,l-2) &&
+       data[l-2] >= '1' &&
+       data[l-2] <= '2' &&
+       data[l-1] == '\x1a') return l;
+  return 0;
+}
+
 int C_RenderListClass::__SavePreset(char *filename)
 {
   EnterCriticalSection(&g_render_cs);
-	unsigned char *data = (unsigned char *) GlobalAlloc(GPTR,1124*1024);
+  C_ConfigWriter w;
+  unsigned char *data = w.reserve(strlen(sig_str));
   int success=-1;
   if (data)
   {
-    int pos=0;
-  	memcpy(data+pos,sig_str,strlen(sig_str)); pos += strlen(sig_str);
-    pos+=save_config_ex(data+pos,1);
-    if (pos < 1024*1024) 
+  	memcpy(data,sig_str,strlen(sig_str)); w.skip(strlen(sig_str));
+    if (!save_config_ex(w,1))
     {
       HANDLE fp=CreateFile(filename,GENERIC_WRITE,0,NULL,CREATE_ALWAYS,FILE_ATTRIBUTE_NORMAL,NULL);
 	    if (fp!=INVALID_HANDLE_VALUE)
       {
         DWORD dw;
-        success=0;
-        WriteFile(fp,data,pos,&dw,NULL);
+        success=WriteFile(fp,w.get(),w.size(),&dw,NULL) && dw == (DWORD)w.size() ? 0 : 2;
         CloseHandle(fp);
       }
       else success=2;
     }
-    else success=1;
-    GlobalFree((HGLOBAL)data);
   }
   LeaveCriticalSection(&g_render_cs);
 	return success;
 }
 
-int C_RenderListClass::__LoadPreset(char *filename, int clear)
+int C_RenderListClass::__LoadPreset(char *filename, int clear, int lock)
 {
-  EnterCriticalSection(&g_render_cs);
-	unsigned char *data = (unsigned char *) GlobalAlloc(GPTR,1024*1024);
+  if (lock) EnterCriticalSection(&g_render_cs);
   int success=1;
   if (clear) clearRenders();
-  if (data)
-  {
   //  OutputDebugString(filename);
-    HANDLE fp=CreateFile(filename,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
-    if (fp!=INVALID_HANDLE_VALUE)
+  HANDLE fp=CreateFile(filename,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+  if (fp!=INVALID_HANDLE_VALUE)
+  {
+    DWORD len=GetFileSize(fp,NULL);
+    if (len == 0xffffffff || len > 0x7fffffff) len=0;
+    // mapped copy-on-write, so the effects parse the file cache directly and
+    // any of them writing to its config data can't touch the file
+    HANDLE hMap=len ? CreateFileMapping(fp,NULL,PAGE_WRITECOPY,0,0,NULL) : NULL;
+    unsigned char *data=hMap ? (unsigned char *)MapViewOfFile(hMap,FILE_MAP_COPY,0,0,0) : NULL;
+    if (data)
     {
-      DWORD len=GetFileSize(fp,NULL);
-      if (len == 0xffffffff) len=0;
-      if (!ReadFile(fp,data,min(len,1024*1024),&len,NULL)) len=0;
-		  CloseHandle(fp);
-	    if (len>strlen(sig_str)+2 && !memcmp(data,sig_str,strlen(sig_str)-2) &&
-           data[strlen(sig_str)-2] >= '1' &&
-           data[strlen(sig_str)-2] <= '2' &&
-           data[strlen(sig_str)-1] == '\x1a')
+      int l=checksig(data,len);
+	    if (l)
 	    {
-	      load_config(data+strlen(sig_str),len-strlen(sig_str));
+	      load_config(data+l,len-l);
         success=0;
       }
-      else 
-      {
-   //     if (len<=strlen(sig_str)+2) MessageBox(NULL,"Error loading preset: len",filename,MB_OK);
- //       else MessageBox(NULL,"Error loading preset: signature",filename,MB_OK);
-      }
+      UnmapViewOfFile(data);
     }
-  //  else MessageBox(NULL,"Error loading preset: fopen",filename,MB_OK);
-    GlobalFree((HGLOBAL)data);
+    if (hMap) CloseHandle(hMap);
+	  CloseHandle(fp);
   }
-//  else MessageBox(NULL,"Error loading preset: MALLOC",filename,MB_OK);
-  LeaveCriticalSection(&g_render_cs);
+  //  else MessageBox(NULL,"Error loading preset: fopen",filename,MB_OK);
+  if (lock) LeaveCriticalSection(&g_render_cs);
   return success;
 }
 
 int C_RenderListClass::__SavePresetToUndo(C_UndoItem &item)
 {
   EnterCriticalSection(&g_render_cs);
-	unsigned char *data = (unsigned char *) GlobalAlloc(GPTR,1124*1024);
+  C_ConfigWriter w;
+  unsigned char *data = w.reserve(strlen(sig_str));
   int success=-1;
   if (data)
   {
     // Do whatever the file saving stuff did
-    int pos=0;
-  	memcpy(data+pos,sig_str,strlen(sig_str)); pos += strlen(sig_str);
-    pos+=save_config_ex(data+pos,1);
+  	memcpy(data,sig_str,strlen(sig_str)); w.skip(strlen(sig_str));
 
     // And then set the data into the undo object.
-    if (pos < 1024*1024) 
+    if (!save_config_ex(w,1))
     {
-      item.set(data, pos, true); // all undo items start dirty.
+      item.set(w.get(), w.size(), true); // all undo items start dirty.
+      success=0;
     }
-
-    else success=1;
-    GlobalFree((HGLOBAL)data);
   }
   LeaveCriticalSection(&g_render_cs);
 	return success;
@@ -1319,27 +1407,20 @@ int C_RenderListClass::__SavePresetToUndo(C_UndoItem &item)
 int C_RenderListClass::__LoadPresetFromUndo(C_UndoItem &item, int clear)
 {
   EnterCriticalSection(&g_render_cs);
-	unsigned char *data = (unsigned char *) GlobalAlloc(GPTR,1024*1024);
   int success=1;
   if (clear) clearRenders();
+  // a copy, effects can write to their config data and the item is the
+  // undo stack's own. zero padded like the file mapping's last page.
+  int len=item.get() ? item.size() : 0;
+  unsigned char *data=len ? (unsigned char *)GlobalAlloc(GPTR,len+4096) : NULL;
   if (data)
   {
-    if (item.size() < 1024*1024)
+    memcpy(data,item.get(),len);
+    int l=checksig(data,len);
+    if (l)
     {
-      // Get the data from the undo object.
-      DWORD len = item.size();
-      if (len == 0xffffffff) len=0;
-      memcpy(data, item.get(), item.size());
-
-      // And then do whatever the file loading stuff did.
-	    if (!memcmp(data,sig_str,strlen(sig_str)-2) &&
-           data[strlen(sig_str)-2] >= '1' &&
-           data[strlen(sig_str)-2] <= '2' &&
-           data[strlen(sig_str)-1] == '\x1a')
-	    {
-	      load_config(data+strlen(sig_str),len-strlen(sig_str));
-        success=0;
-      }
+      load_config(data+l,len-l);
+      success=0;
     }
     GlobalFree((HGLOBAL)data);
   }
@@ -1354,10 +1435,19 @@ int C_RenderListClass::__LoadPresetFromUndo(C_UndoItem &item, int clear)
 
 void C_RenderListClass::smp_Render(int minthreads, C_RBASE2 *render, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
 {
-  int x;
-  smp_parms.nthreads=minthreads;
-  if (!smp_parms.hQuitHandle) smp_parms.hQuitHandle=CreateEvent(NULL,TRUE,FALSE,NULL);
+  int ntiles=minthreads;
 
+  // effects that are tile-safe get cut into more pieces than threads, so
+  // a thread that finishes its rows early can steal from a slower one.
+  // everyone else gets exactly one call per thread index, as before.
+  if (render->smp_getflags()&2)
+  {
+    ntiles=min(minthreads*SMP_TILES_PER_THREAD,h/SMP_TILE_MINROWS);
+    if (ntiles < minthreads) ntiles=minthreads;
+  }
+
+  // on the stack, presets can be rendered by other threads than the render thread
+  _s_smp_parms smp_parms;
   smp_parms.vis_data_ptr=visdata;
   smp_parms.isBeat=isBeat;
   smp_parms.framebuffer=framebuffer;
@@ -1365,37 +1455,197 @@ void C_RenderListClass::smp_Render(int minthreads, C_RBASE2 *render, char visdat
   smp_parms.w=w;
   smp_parms.h=h;
   smp_parms.render=render;
-  for (x = 0; x < minthreads; x ++)
+
+  C_SmpPool::run(minthreads,ntiles,smp_tileProc,&smp_parms);
+}
+
+void C_RenderListClass::smp_tileProc(void *ctx, int tile, int ntiles)
+{
+  _s_smp_parms *p=(_s_smp_parms *)ctx;
+  p->render->smp_render(tile,ntiles,
+    *(char (*)[2][2][576])p->vis_data_ptr,
+    p->isBeat,p->framebuffer,p->fbout,p->w,p->h);
+}
+
+// if renders[x] starts a run of two or more point-wise effects, renders the
+// whole run, a cache sized tile at a time, and returns its length. returns
+// 0 (and does nothing) otherwise, or when SMP is off (the effects then go
+// through render() like everything else).
+int C_RenderListClass::fused_Render(int x, int is_preinit, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
+{
+  int n=0, i;
+  while (x+n < num_renders && n < FUSE_MAX_RENDERS && renders[x+n].has_rbase2 &&
+         (((C_RBASE2 *)renders[x+n].render)->smp_getflags()&7) == 7) n++;
+  if (n < 2) return 0;
+
+  int nthreads=g_config_smp ? g_config_smp_mt : 0;
+  if (nthreads < 2) return 0;
+  if (nthreads > MAX_SMP_THREADS) nthreads=MAX_SMP_THREADS;
+
+  _s_fuse_parms fuse_parms;
+  fuse_parms.vis_data_ptr=visdata;
+  fuse_parms.isBeat=isBeat;
+  fuse_parms.framebuffer=framebuffer;
+  fuse_parms.fbout=fbout;
+  fuse_parms.w=w;
+  fuse_parms.h=h;
+  fuse_parms.nrenders=0;
+
+  // point-wise effects don't change isBeat or swap buffers, so every
+  // smp_begin() can go first
+  for (i = 0; i < n; i ++)
   {
-    if (x >= smp_parms.threadTop)
+    C_RBASE2 *rb2=(C_RBASE2 *)renders[x+i].render;
+    int nt;
+    if (g_config_seh)
     {
-      DWORD id;
-      smp_parms.hThreadSignalsStart[x]=CreateEvent(NULL,FALSE,TRUE,NULL);
-      smp_parms.hThreadSignalsDone[x]=CreateEvent(NULL,FALSE,FALSE,NULL);
+      __try
+      {
+        nt=rb2->smp_begin(nthreads,visdata,isBeat,framebuffer,fbout,w,h);
+      }
+      __except(EXCEPTION_EXECUTE_HANDLER)
+      {
+        nt=0;
+      }
+    }
+    else nt=rb2->smp_begin(nthreads,visdata,isBeat,framebuffer,fbout,w,h);
+    if (nt > 0 && !is_preinit)
+      fuse_parms.renders[fuse_parms.nrenders++]=rb2;
+  }
+  if (!fuse_parms.nrenders) return n;
 
-      smp_parms.hThreads[x]=CreateThread(NULL,0,smp_threadProc,(LPVOID)(x),0,&id);
-      smp_parms.threadTop=x+1;
+  int rows=FUSE_TILE_BYTES/(w*sizeof(int));
+  if (rows < 1) rows=1;
+  int ntiles=h/rows;
+  if (ntiles < nthreads) ntiles=nthreads;
+  if (ntiles > SMP_POOL_MAX_TILES) ntiles=SMP_POOL_MAX_TILES;
+  if (ntiles > h) ntiles=h;
+
+  if (ntiles > 0) C_SmpPool::run(nthreads,ntiles,fuse_tileProc,&fuse_parms);
+
+  for (i = 0; i < fuse_parms.nrenders; i ++)
+    fuse_parms.renders[i]->smp_finish(visdata,isBeat,framebuffer,fbout,w,h);
+
+  return n;
+}
+
+void C_RenderListClass::fuse_tileProc(void *ctx, int tile, int ntiles)
+{
+  _s_fuse_parms *p=(_s_fuse_parms *)ctx;
+  int i;
+  for (i = 0; i < p->nrenders; i ++)
+  {
+    // same as a lone effect's render(): a fault only loses this effect's
+    // part of the tile
+    if (g_config_seh)
+    {
+      __try
+      {
+        p->renders[i]->smp_render(tile,ntiles,
+          *(char (*)[2][2][576])p->vis_data_ptr,
+          p->isBeat,p->framebuffer,p->fbout,p->w,p->h);
+      }
+      __except(EXCEPTION_EXECUTE_HANDLER)
+      {
+      }
     }
     else
-      SetEvent(smp_parms.hThreadSignalsStart[x]);
+      p->renders[i]->smp_render(tile,ntiles,
+        *(char (*)[2][2][576])p->vis_data_ptr,
+        p->isBeat,p->framebuffer,p->fbout,p->w,p->h);
   }
-  WaitForMultipleObjects(smp_parms.nthreads,smp_parms.hThreadSignalsDone,TRUE,INFINITE);
 }
 
-DWORD WINAPI C_RenderListClass::smp_threadProc(LPVOID parm)
+#ifndef LASER
+// a list can go in a group when it doesn't read the framebuffer it's in
+// (blend out 12 reads a buffer after everything in the group has rendered,
+// so not that either), its thisfb is already the right size (a resize can
+// free global buffers, see getGlobalBuffer()), and nothing in it touches
+// state it shares with other lists: no code of its own, and only the
+// isolated built-in effects (C_RLibrary::IsIsolated(), so no EEL code,
+// global buffers, line mode, nested lists or APEs).
+int C_RenderListClass::groupable(int w, int h)
+{
+  if (isroot || use_code || blendin() != 0 || blendout() == 12 || !thisfb || l_w != w || l_h != h) return 0;
+  int x;
+  for (x = 0; x < num_renders; x ++)
+    if (!g_render_library->IsIsolated(renders[x].effect_index)) return 0;
+  return 1;
+}
+
+// if renders[x] starts a run of two or more groupable lists, renders the
+// whole run and returns its length. returns 0 (and does nothing) otherwise.
+//
+// each list renders into its own thisfb, so that can happen on any thread.
+// the blend outs are the only part that touches framebuffer, and go last,
+// in order.
+int C_RenderListClass::group_Render(int x, int is_preinit, char visdata[2][2][576], int isBeat, int *framebuffer, int w, int h)
 {
-  int which=(int)parm;
-  HANDLE hdls[2]={smp_parms.hThreadSignalsStart[which],smp_parms.hQuitHandle};
-  for (;;)
+  int nthreads=g_config_smp ? g_config_smp_mt : 0;
+  if (is_preinit || nthreads < 2) return 0;
+  if (nthreads > MAX_SMP_THREADS) nthreads=MAX_SMP_THREADS;
+
+  // on the stack, presets can be rendered by other threads than the render thread
+  _s_group_parms group_parms;
+  int n=0, i;
+  while (x+n < num_renders && n < GROUP_MAX_RENDERS && renders[x+n].effect_index == LIST_ID &&
+         ((C_RenderListClass *)renders[x+n].render)->groupable(w,h))
   {
-    if (WaitForMultipleObjects(2,hdls,FALSE,INFINITE) == WAIT_OBJECT_0 + 1) return 0;
+    group_parms.renders[n]=(C_RenderListClass *)renders[x+n].render;
+    n++;
+  }
+  if (n < 2) return 0;
+
+  // what a list sets before its effects, done once for all of them (see
+  // layer_Render()). nothing in a group changes it, isolated effects don't
+  int line_blend_mode_save=g_line_blend_mode;
+  g_line_blend_mode=0;
+
+  group_parms.vis_data_ptr=visdata;
+  group_parms.isBeat=isBeat;
+  group_parms.framebuffer=framebuffer;
+  group_parms.w=w;
+  group_parms.h=h;
+  group_parms.nrenders=n;
+  C_SmpPool::run(nthreads,n,group_tileProc,&group_parms);
+
+  g_line_blend_mode=line_blend_mode_save;
 
-    smp_parms.render->smp_render(which,smp_parms.nthreads,
-      *(char (*)[2][2][576])smp_parms.vis_data_ptr,
-      
-      smp_parms.isBeat,smp_parms.framebuffer,smp_parms.fbout,smp_parms.w,smp_parms.h);
-    SetEvent(smp_parms.hThreadSignalsDone[which]);
+  for (i = 0; i < n; i ++)
+  {
+    C_RenderListClass *l=group_parms.renders[i];
+    if (l->group_layer.enabled) l->layer_BlendOut(&l->group_layer,framebuffer,l->thisfb,w,h);
   }
+  return n;
 }
 
-C_RenderListClass::_s_smp_parms C_RenderListClass::smp_parms;
\ No newline at end of file
+// render() up to the blend out, with groupfb for fbout
+void C_RenderListClass::group_tileProc(void *ctx, int tile, int ntiles)
+{
+  _s_group_parms *p=(_s_group_parms *)ctx;
+  C_RenderListClass *l=p->renders[tile];
+  _s_layer_parms *lp=&l->group_layer;
+  int w=p->w, h=p->h;
+
+  l->layer_Begin(*(char (*)[2][2][576])p->vis_data_ptr,p->isBeat,w,h,lp);
+  lp->grouped=1;
+  if (!lp->enabled)
+  {
+    if (l->thisfb) C_FBArena::free(l->thisfb);
+    l->thisfb=NULL;
+    if (l->groupfb) C_FBArena::free(l->groupfb);
+    l->groupfb=NULL;
+    return;
+  }
+  l->fake_enabled--;
+
+  if (!l->groupfb) l->groupfb=(int*)C_FBArena::alloc(w*h*sizeof(int),"Render / Effect List",0);
+  if (!l->groupfb)
+  {
+    lp->enabled=0;
+    return;
+  }
+  if (l->layer_Render(*(char (*)[2][2][576])p->vis_data_ptr,lp,p->framebuffer,l->groupfb,w,h))
+    memcpy(l->thisfb,l->groupfb,w*h*sizeof(int));
+}
+#endif
\ No newline at end of file
@@ -39,6 +39,24 @@ extern BOOL blendtableInited;
 class C_RenderTransitionClass;
 class C_UndoItem;
 
+// growable output for save_config_ex(). effects still write through a plain
+// pointer (save_config() takes no size), so reserve() leaves them
+// CONFIG_EFFECT_HEADROOM bytes to work with first.
+#define CONFIG_EFFECT_HEADROOM (1024*1024)
+class C_ConfigWriter
+{
+  public:
+    C_ConfigWriter(unsigned char *fixed=NULL); // a fixed buffer never grows, it's the caller's problem like before
+    ~C_ConfigWriter();
+    unsigned char *reserve(int bytes); // where the next bytes go, NULL if out of memory
+    void skip(int bytes) { m_pos+=bytes; }
+    unsigned char *get() { return m_data; }
+    int size() { return m_pos; }
+  protected:
+    unsigned char *m_data;
+    int m_pos, m_alloc, m_fixed;
+};
+
 class C_RenderListClass : public C_RBASE {
 	friend C_RenderTransitionClass;
   public:
@@ -93,33 +111,77 @@ class C_RenderListClass : public C_RBASE {
 #endif
 
 #define MAX_SMP_THREADS 8
+#define SMP_TILES_PER_THREAD 4 // for effects with smp_getflags()&2
+#define SMP_TILE_MINROWS 16
     // smp stuff
     void smp_Render(int minthreads, C_RBASE2 *render, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h);
     typedef struct 
     {
       void *vis_data_ptr;
-      int nthreads;
       int isBeat;
       int *framebuffer;
       int *fbout;
       int w;
       int h;
       C_RBASE2 *render;
+    } _s_smp_parms;
 
+    static void smp_tileProc(void *ctx, int tile, int ntiles);
 
+    // runs of point-wise effects (smp_getflags()&4), fused into one pass
+#define FUSE_MAX_RENDERS 32
+#define FUSE_TILE_BYTES (128*1024) // a tile should stay in L2 while every effect goes over it
+    int fused_Render(int x, int is_preinit, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h);
+    typedef struct
+    {
+      void *vis_data_ptr;
+      int isBeat;
+      int *framebuffer;
+      int *fbout;
+      int w;
+      int h;
+      int nrenders;
+      C_RBASE2 *renders[FUSE_MAX_RENDERS];
+    } _s_fuse_parms;
 
-      HANDLE hQuitHandle;
-      HANDLE hThreads[MAX_SMP_THREADS];
-      HANDLE hThreadSignalsStart[MAX_SMP_THREADS];
-      HANDLE hThreadSignalsDone[MAX_SMP_THREADS];
+    static void fuse_tileProc(void *ctx, int tile, int ntiles);
 
-      int threadTop;
+    // a frame of a nested list, in steps: the list's code, then blending in
+    // and rendering the effects, then blending out
+    typedef struct
+    {
+      int is_preinit;
+      int isBeat;
+      int enabled;
+      int clear;
+      int inblendval;
+      int outblendval;
+      int grouped; // the group has set g_line_blend_mode for all of its lists
+    } _s_layer_parms;
+    void layer_Begin(char visdata[2][2][576], int isBeat, int w, int h, _s_layer_parms *p);
+    int layer_Render(char visdata[2][2][576], _s_layer_parms *lp, int *framebuffer, int *fbout, int w, int h);
+    void layer_BlendOut(_s_layer_parms *lp, int *framebuffer, int *tfb, int w, int h);
+
+    // runs of nested lists that ignore their input and hold only isolated
+    // effects (see groupable()) render at the same time, a list per tile
+#define GROUP_MAX_RENDERS 32
+    int group_Render(int x, int is_preinit, char visdata[2][2][576], int isBeat, int *framebuffer, int w, int h);
+    int groupable(int w, int h);
+    typedef struct
+    {
+      void *vis_data_ptr;
+      int isBeat;
+      int *framebuffer;
+      int w;
+      int h;
+      int nrenders;
+      C_RenderListClass *renders[GROUP_MAX_RENDERS];
+    } _s_group_parms;
 
-    } _s_smp_parms;
+    static void group_tileProc(void *ctx, int tile, int ntiles);
 
-    
-    static _s_smp_parms smp_parms;
-    static DWORD WINAPI smp_threadProc(LPVOID parm);
+    _s_layer_parms group_layer; // worked out by the tile, for the blend out after it
+    int *groupfb; // fbout while rendering in a group, since the parent's is shared
 
 	public:
 
@@ -144,8 +206,9 @@ class C_RenderListClass : public C_RBASE {
     void clearRenders(void);
     void freeBuffers();
 
+    static int checksig(unsigned char *data, int len); // length of the preset signature, 0 if not a preset
     int __SavePreset(char *filename);
-    int __LoadPreset(char *filename, int clear);
+    int __LoadPreset(char *filename, int clear, int lock=1); // lock=0 for lists nothing renders yet
 
     int __SavePresetToUndo(C_UndoItem &item);
     int __LoadPresetFromUndo(C_UndoItem &item, int clear);
@@ -165,6 +228,7 @@ class C_RenderListClass : public C_RBASE {
     static BOOL CALLBACK g_DlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam,LPARAM lParam);
     static BOOL CALLBACK g_DlgProcRoot(HWND hwndDlg, UINT uMsg, WPARAM wParam,LPARAM lParam);
 		int save_config_ex(unsigned char *data, int rootsave);
+		int save_config_ex(C_ConfigWriter &w, int rootsave); // returns -1 if out of memory
 		void load_config_code(unsigned char *data, int len);
 		int  save_config_code(unsigned char *data);    
 		void FillBufferCombo(HWND dlg, int ctl);
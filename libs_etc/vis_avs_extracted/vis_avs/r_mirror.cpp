@@ -31,6 +31,7 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <commctrl.h>
 #include "resource.h"
 #include "r_defs.h"
+#include "rng.h"
 #include "../Agave/Language/api_language.h"
 
 #ifndef LASER
@@ -57,6 +58,7 @@ class C_THISCLASS : public C_RBASE {
 	int rbeat;
 	int smooth;
 	int slower;
+	C_Rng rng;
 	};
 
 
@@ -146,7 +148,7 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
 
   if (onbeat)
 	{
-	  if (isBeat)	rbeat = (rand()%16) & mode;
+	  if (isBeat)	rbeat = rng.below(16) & mode;
 	  thismode=&rbeat;
 	}
 
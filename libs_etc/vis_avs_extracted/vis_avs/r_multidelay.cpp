@@ -34,6 +34,7 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <windows.h>
 #include "resource.h"
 #include "r_defs.h"
+#include "frame_ring.h"
 #include "../Agave/Language/api_language.h"
 
 #define MOD_NAME "Trans / Multi Delay"
@@ -44,6 +45,8 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 // saved
 bool usebeats[6];
 int delay[6];
+static bool compressbuffers;
+static unsigned int buffersbudget; // MB per buffer, for compressbuffers
 
 // unsaved
 LPVOID buffer[6];
@@ -59,6 +62,8 @@ unsigned long framesperbeat;
 unsigned long framemem;
 unsigned long oldframemem;
 unsigned int renderid;
+static C_FrameRing bufferring[6]; // used instead of buffer[] when compressbuffers is set
+static unsigned int ringframe;
 
 class C_DELAY : public C_RBASE 
 {
@@ -107,11 +112,25 @@ static BOOL CALLBACK g_DlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam,LPARAM lPa
 				  _itoa(delay[i],value,10);
 				  SetWindowText(hwndEdit,value);
 			  }
+			  CheckDlgButton(hwndDlg,IDC_COMPRESS,compressbuffers);
+			  SetDlgItemInt(hwndDlg,IDC_BUDGET,buffersbudget,FALSE);
       }
 			return 1;
 		case WM_COMMAND:
 			objectcode = LOWORD(wParam);
 			objectmessage = HIWORD(wParam);
+			if (objectcode == IDC_COMPRESS)
+			{
+				compressbuffers = IsDlgButtonChecked(hwndDlg,IDC_COMPRESS)==1;
+			    return 0;
+			}
+			if (objectcode == IDC_BUDGET)
+			{
+				BOOL t;
+				int val = GetDlgItemInt(hwndDlg,IDC_BUDGET,&t,FALSE);
+				if (objectmessage == EN_CHANGE && t && val >= 1 && val < 4096) buffersbudget = val;
+			    return 0;
+			}
 			// mode stuff
 			if (objectcode >= 1100)
 			{
@@ -187,8 +206,12 @@ C_DELAY::C_DELAY()
 	creationid = numinstances;
 	if (creationid == 1)
 	{
+		compressbuffers = false;
+		buffersbudget = 64;
+		ringframe = 0;
 		for (int i=0; i<6; i++)
 		{
+			bufferring[i].setOwner(MOD_NAME);
 			renderid = 0;
 			framessincebeat = 0;
 			framesperbeat = 0;
@@ -211,7 +234,11 @@ C_DELAY::C_DELAY()
 C_DELAY::~C_DELAY() 
 {
 	numinstances--;
-	if (numinstances == 0) for (int i=0; i<6; i++) VirtualFree(buffer[i],buffersize[i],MEM_DECOMMIT);
+	if (numinstances == 0) for (int i=0; i<6; i++)
+	{
+		VirtualFree(buffer[i],buffersize[i],MEM_DECOMMIT);
+		bufferring[i].clear();
+	}
 }
 
 // RENDER FUNCTION:
@@ -238,6 +265,22 @@ int C_DELAY::render(char visdata[2][2][576], int isBeat, int *framebuffer, int *
 		framessincebeat++;
 		for (int i=0;i<6;i++)
 		{
+			if (compressbuffers)
+			{
+				if (buffersize[i] > 1)
+				{
+					// back to what the constructor set up, see r_videodelay.cpp
+					VirtualFree(buffer[i],buffersize[i],MEM_DECOMMIT);
+					buffersize[i] = virtualbuffersize[i] = oldvirtualbuffersize[i] = 1;
+					buffer[i] = VirtualAlloc(NULL,buffersize[i],MEM_COMMIT,PAGE_READWRITE);
+					inpos[i] = outpos[i] = buffer[i];
+					oldframemem = 0;
+				}
+				bufferring[i].setBudget(buffersbudget<<20);
+				bufferring[i].setLength(framedelay[i]);
+				continue;
+			}
+			bufferring[i].clear();
 			if (framedelay[i]>1)
 			{
 				virtualbuffersize[i] = framedelay[i]*framemem;
@@ -343,9 +386,16 @@ int C_DELAY::render(char visdata[2][2][576], int isBeat, int *framebuffer, int *
 	}
 	if (mode != 0 && framedelay[activebuffer]>1)
 	{
-		if (mode == 2) CopyMemory(framebuffer,outpos[activebuffer],framemem);
+		if (compressbuffers)
+		{
+			// the output runs delay frames behind the input, see inpos/outpos
+			if (mode == 2) bufferring[activebuffer].get(ringframe-(framedelay[activebuffer]-1),framebuffer,w,h);
+			else bufferring[activebuffer].put(ringframe,framebuffer,w,h);
+		}
+		else if (mode == 2) CopyMemory(framebuffer,outpos[activebuffer],framemem);
 		else CopyMemory(inpos[activebuffer],framebuffer,framemem);
 	}
+	if (renderid == numinstances) ringframe++;
 	if (renderid == numinstances) for (int i=0;i<6;i++)
 	{
 		inpos[i] = (LPVOID)(((unsigned long)inpos[i])+framemem);
@@ -403,6 +453,19 @@ void C_DELAY::load_config(unsigned char *data, int len) // read configuration of
 				pos+=4;
 			}
 		}
+		compressbuffers = false;
+		buffersbudget = 64;
+		if (len-pos >= 4)
+		{
+			compressbuffers=(GET_INT()==1);
+			pos+=4;
+		}
+		if (len-pos >= 4)
+		{
+			buffersbudget=GET_INT();
+			if (buffersbudget < 1 || buffersbudget >= 4096) buffersbudget = 64;
+			pos+=4;
+		}
 	}
 }
 
@@ -424,6 +487,10 @@ int  C_DELAY::save_config(unsigned char *data)
 			PUT_INT(delay[i]);
 			pos+=4;
 		}
+		PUT_INT((int)compressbuffers);
+		pos+=4;
+		PUT_INT(buffersbudget);
+		pos+=4;
 	}
 	return pos;
 }
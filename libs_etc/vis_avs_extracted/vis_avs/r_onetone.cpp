@@ -41,7 +41,7 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define MOD_NAME "Trans / Unique tone"
 #define C_THISCLASS C_OnetoneClass
 
-class C_THISCLASS : public C_RBASE {
+class C_THISCLASS : public C_RBASE2 {
 	protected:
 	public:
 		C_THISCLASS();
@@ -51,6 +51,12 @@ class C_THISCLASS : public C_RBASE {
 		virtual HWND conf(HINSTANCE hInstance, HWND hwndParent);
 		virtual void load_config(unsigned char *data, int len);
 		virtual int  save_config(unsigned char *data);
+
+    virtual int smp_getflags() { return 7; }
+		virtual int smp_begin(int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); 
+    virtual void smp_render(int this_thread, int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); 
+    virtual int smp_finish(char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h) { return 0; }
+
 		void RebuildTable(void);
 		int __inline depthof(int c);
     int enabled;
@@ -133,12 +139,31 @@ for (i=0;i<256;i++)
 
 int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
 {
-  int i=w*h;
-  int *p=framebuffer;
-	int c,d;
+  if (!smp_begin(1,visdata,isBeat,framebuffer,fbout,w,h)) return 0;
+  smp_render(0,1,visdata,isBeat,framebuffer,fbout,w,h);
+  return 0;
+}
 
+int C_THISCLASS::smp_begin(int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
+{
   if (!enabled) return 0;
   if (isBeat&0x80000000) return 0;
+  return max_threads;
+}
+
+void C_THISCLASS::smp_render(int this_thread, int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
+{
+  if (max_threads < 1) max_threads=1;
+
+  int start_l = ( this_thread * h ) / max_threads;
+  int end_l;
+
+  if (this_thread >= max_threads - 1) end_l = h;
+  else end_l = ( (this_thread+1) * h ) / max_threads;  
+
+  int i=w*(end_l-start_l);
+  int *p=framebuffer+start_l*w;
+	int c,d;
 
   if (blend)
   {
@@ -166,7 +191,6 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
 		  *p++ = tableb[d] | (tableg[d]<<8) | (tabler[d]<<16);
 		  }
   }
-  return 0;
 }
 
 
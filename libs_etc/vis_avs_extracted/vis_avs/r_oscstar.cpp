@@ -59,6 +59,9 @@ class C_THISCLASS : public C_RBASE {
 
     int color_pos;
     double m_r;
+#ifndef LASER
+    C_LineBatch batch;
+#endif
 };
 
 
@@ -210,7 +213,7 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
 				  if ((x >= 0 && x < w && y >= 0 && y < h) ||
               (lx >= 0 && lx < w && ly >= 0 && ly < h))
           {
-              line(framebuffer,x,y,lx,ly,w,h,current_color,(g_line_blend_mode&0xff0000)>>16);
+              batch.line(x,y,lx,ly,current_color,(g_line_blend_mode&0xff0000)>>16);
           }
 #endif
 				  lx=x;
@@ -219,6 +222,9 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
 				  dfactor -= ((1.0/1024.0f)-(1.0/128.0f))/64.0f;
 			  }
 		  }
+#ifndef LASER
+      batch.draw(framebuffer,w,h);
+#endif
 
 		  m_r+=0.01 * (double)rot;
 		  if (m_r >= 3.14159*2)
@@ -32,6 +32,7 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <commctrl.h>
 #include <math.h>
 #include "r_defs.h"
+#include "rng.h"
 
 #include "resource.h"
 #include "../Agave/Language/api_language.h"
@@ -64,6 +65,7 @@ class C_THISCLASS : public C_RBASE {
 		double c[2];
 		double v[2];
 		double p[2];
+		C_Rng rng;
 };
 
 #define PUT_INT(y) data[pos]=(y)&255; data[pos+1]=(y>>8)&255; data[pos+2]=(y>>16)&255; data[pos+3]=(y>>24)&255
@@ -122,8 +124,8 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
 
 	if (isBeat)
 	{
-		c[0]=((rand()%33)-16)/48.0f;
-		c[1]=((rand()%33)-16)/48.0f;
+		c[0]=(rng.below(33)-16)/48.0f;
+		c[1]=(rng.below(33)-16)/48.0f;
 	}
 
 
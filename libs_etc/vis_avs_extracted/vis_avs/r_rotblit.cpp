@@ -32,8 +32,8 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <commctrl.h>
 #include "r_defs.h"
 #include "resource.h"
+#include "fb_arena.h"
 
-#include "timing.h"
 #include "../Agave/Language/api_language.h"
 
 
@@ -118,7 +118,7 @@ C_THISCLASS::C_THISCLASS()
 
 C_THISCLASS::~C_THISCLASS()
 {
-  if (w_mul) GlobalFree(w_mul);
+  if (w_mul) C_FBArena::free(w_mul);
   w_mul=NULL;
   l_w=l_h=0;
 }
@@ -130,10 +130,10 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
   if (l_w != w || l_h != h || !w_mul) // generate width table
   {
     int x;
-    if (w_mul) GlobalFree(w_mul);
+    if (w_mul) C_FBArena::free(w_mul);
     l_w=w;
     l_h=h;
-    w_mul=(int *)GlobalAlloc(GMEM_FIXED,sizeof(int)*h);
+    w_mul=(int *)C_FBArena::alloc(sizeof(int)*h,MOD_NAME,0);
     for (x = 0; x < h; x ++)
       w_mul[x]=x*w;
   }
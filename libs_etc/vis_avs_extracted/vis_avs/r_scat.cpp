@@ -31,9 +31,9 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <windows.h>
 #include <commctrl.h>
 #include "r_defs.h"
+#include "rng.h"
 #include "resource.h"
 
-#include "timing.h"
 #include "../Agave/Language/api_language.h"
 
 #ifndef LASER
@@ -54,6 +54,7 @@ class C_THISCLASS : public C_RBASE {
 
     int enabled;
     int fudgetable[512],ftw;
+    C_Rng rng;
 };
 
 #define PUT_INT(y) data[pos]=(y)&255; data[pos+1]=(y>>8)&255; data[pos+2]=(y>>16)&255; data[pos+3]=(y>>24)&255
@@ -107,11 +108,19 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
 
   l=w*4;
   while (l-- > 0) *fbout++=*framebuffer++;
+  // three 9 bit picks out of every 32 random bits
   l=w*(h-8);
-  while (l-- > 0)
+  while (l > 0)
   {
-    *fbout++ = framebuffer[fudgetable[rand()&511]];
-    framebuffer++;
+    unsigned int r=rng.next();
+    int n=min(l,3);
+    l-=n;
+    while (n-- > 0)
+    {
+      *fbout++ = framebuffer[fudgetable[r&511]];
+      framebuffer++;
+      r>>=9;
+    }
   }
   l=w*4;
   while (l-- > 0) *fbout++=*framebuffer++;
@@ -34,7 +34,6 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "resource.h"
 #include "avs_eelif.h"
 
-#include "timing.h"
 #include "../Agave/Language/api_language.h"
 
 
@@ -55,7 +55,7 @@ class C_THISCLASS : public C_RBASE {
 		int colors[16];
 
     int color_pos;
-
+    C_LineBatch batch;
 };
 
 
@@ -200,7 +200,7 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
           float r=x*xs;
           float s1=r-(int)r;
           float yr=fa_data[(int)r]*(1.0f-s1)+fa_data[(int)r+1]*(s1);
-				  line(framebuffer,x,h2-adj,x,h2 + adj + (int) (yr*ys - 1.0f),w,h,current_color,(g_line_blend_mode&0xff0000)>>16);
+				  batch.line(x,h2-adj,x,h2 + adj + (int) (yr*ys - 1.0f),current_color,(g_line_blend_mode&0xff0000)>>16);
 			  }
 	    }
       break;
@@ -221,7 +221,7 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
 			  {
 				  oy=h2 + (int) ((fa_data[x])*ys);
 				  ox=(int) (x*xs);
-				  line(framebuffer,lx,ly,ox,oy,w,h,current_color,(g_line_blend_mode&0xff0000)>>16);
+				  batch.line(lx,ly,ox,oy,current_color,(g_line_blend_mode&0xff0000)>>16);
 				  ly=oy;
 				  lx=ox;
 			  }
@@ -241,7 +241,7 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
 			  {
 				  ox=(int)(x*xs);
 				  oy = yh + (int) ((int)(fa_data[x]^128)*yscale);
-				  line(framebuffer, lx,ly,ox,oy,w,h,current_color,(g_line_blend_mode&0xff0000)>>16);
+				  batch.line(lx,ly,ox,oy,current_color,(g_line_blend_mode&0xff0000)>>16);
 				  lx=ox;
 				  ly=oy;
 			  }
@@ -257,11 +257,12 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
           float r=x*xscale;
           float s1=r-(int)r;
           float yr=(fa_data[(int)r]^128)*(1.0f-s1)+(fa_data[(int)r+1]^128)*(s1);
-				  line(framebuffer,x,ys-1,x,yh + (int) (yr*yscale),w,h,current_color,(g_line_blend_mode&0xff0000)>>16);
+				  batch.line(x,ys-1,x,yh + (int) (yr*yscale),current_color,(g_line_blend_mode&0xff0000)>>16);
 			  }
 		  }
       break;
     }
+  batch.draw(framebuffer,w,h);
   return 0;
 }
 
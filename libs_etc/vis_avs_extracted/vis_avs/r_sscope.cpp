@@ -38,7 +38,6 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #if 0//syntax highlighting
 #include "richedit.h"
 #endif
-#include "timing.h"
 #include "../Agave/Language/api_language.h"
 
 #define C_THISCLASS C_SScopeClass
@@ -73,8 +72,16 @@ class C_THISCLASS : public C_RBASE {
     NSEEL_CODEHANDLE codehandle[4];
     int need_recompile;
     CRITICAL_SECTION rcs;
+
+    double *pt_buf; // per point inputs/outputs for executeCodeBatch()
+    int pt_buf_len;
+#ifndef LASER
+    C_LineBatch batch; // lines and dots, drawn at the end of render()
+#endif
 };
 
+enum { PT_V, PT_I, PT_X, PT_Y, PT_SKIP, PT_RED, PT_GREEN, PT_BLUE, PT_LINESIZE, PT_DRAWMODE, PT_NBUF };
+
 #define PUT_INT(y) data[pos]=(y)&255; data[pos+1]=(y>>8)&255; data[pos+2]=(y>>16)&255; data[pos+3]=(y>>24)&255
 #define GET_INT() (data[pos]|(data[pos+1]<<8)|(data[pos+2]<<16)|(data[pos+3]<<24))
 void C_THISCLASS::load_config(unsigned char *data, int len)
@@ -164,6 +171,8 @@ C_THISCLASS::C_THISCLASS()
 #endif
 
   var_n=0;
+  pt_buf=0;
+  pt_buf_len=0;
 }
 
 C_THISCLASS::~C_THISCLASS()
@@ -175,6 +184,7 @@ C_THISCLASS::~C_THISCLASS()
     codehandle[x]=0;
   }
   AVS_EEL_QUITINST();
+  if (pt_buf) GlobalFree(pt_buf);
   DeleteCriticalSection(&rcs);
 }
 
@@ -281,29 +291,59 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
     int a;
     int l=(int)*var_n;
     if (l > 128*1024) l = 128*1024;
+    if (l < 1) return 0;
+    if (l > pt_buf_len)
+    {
+      if (pt_buf) GlobalFree(pt_buf);
+      pt_buf=(double *)GlobalAlloc(GMEM_FIXED,sizeof(double)*PT_NBUF*l);
+      pt_buf_len=pt_buf?l:0;
+      if (!pt_buf) return 0;
+    }
+    double *pt[PT_NBUF];
+    for (a = 0; a < PT_NBUF; a ++) pt[a]=pt_buf+a*l;
+
     for (a = 0; a < l; a ++)
     {
-      int x,y;
       double r=(a*576.0)/l;
       double s1=r-(int)r;
       double yr=(fa_data[(int)r]^xorv)*(1.0f-s1)+(fa_data[(int)r+1]^xorv)*(s1);
-      *var_v = yr/128.0 - 1.0;
-      *var_i = (double)a/(double)(l-1);
-      *var_skip=0.0;
-      executeCode(codehandle[0],visdata);
-      x=(int)((*var_x+1.0)*w*0.5);
-      y=(int)((*var_y+1.0)*h*0.5);
-      if (*var_skip < 0.00001)
+      pt[PT_V][a] = yr/128.0 - 1.0;
+      pt[PT_I][a] = (double)a/(double)(l-1);
+    }
+
+    // run the point code over all points at once, skip is reset for every point
+    double skip0=0.0;
+    NSEEL_BATCHVAR bv[PT_NBUF]=
+    {
+      { var_v, pt[PT_V], 1, NULL },
+      { var_i, pt[PT_I], 1, NULL },
+      { var_x, NULL, 0, pt[PT_X] },
+      { var_y, NULL, 0, pt[PT_Y] },
+      { var_skip, &skip0, 0, pt[PT_SKIP] },
+      { var_red, NULL, 0, pt[PT_RED] },
+      { var_green, NULL, 0, pt[PT_GREEN] },
+      { var_blue, NULL, 0, pt[PT_BLUE] },
+      { var_linesize, NULL, 0, pt[PT_LINESIZE] },
+      { var_drawmode, NULL, 0, pt[PT_DRAWMODE] },
+    };
+    executeCodeBatch(codehandle[0],visdata,bv,PT_NBUF,l);
+
+    for (a = 0; a < l; a ++)
+    {
+      int x,y;
+      x=(int)((pt[PT_X][a]+1.0)*w*0.5);
+      y=(int)((pt[PT_Y][a]+1.0)*h*0.5);
+      if (pt[PT_SKIP][a] < 0.00001)
       {
-        int thiscolor=makeint(*var_blue)|(makeint(*var_green)<<8)|(makeint(*var_red)<<16);
-        if (*var_drawmode < 0.00001)
+        int thiscolor=makeint(pt[PT_BLUE][a])|(makeint(pt[PT_GREEN][a])<<8)|(makeint(pt[PT_RED][a])<<16);
+        if (pt[PT_DRAWMODE][a] < 0.00001)
         {
           if (y >= 0 && y < h && x >= 0 && x < w) 
           {
   #ifdef LASER
-            laser_drawpoint((float)*var_x,(float)*var_y,thiscolor);
+            laser_drawpoint((float)pt[PT_X][a],(float)pt[PT_Y][a],thiscolor);
   #else
-            BLEND_LINE(framebuffer+x+y*w,thiscolor);
+            batch.point(x,y,thiscolor);
   #endif
           }
         }
@@ -315,15 +355,15 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
             LineType l;
             l.color=thiscolor;
             l.mode=0;
-            l.x1=(float)*var_x;
-            l.y1=(float)*var_y;
+            l.x1=(float)pt[PT_X][a];
+            l.y1=(float)pt[PT_Y][a];
             l.x2=(float)dlx;
             l.y2=(float)dly;
             g_laser_linelist->AddLine(&l);
   #else
             if ((thiscolor&0xffffff) || (g_line_blend_mode&0xff)!=1)
             {
-              line(framebuffer,lx,ly,x,y,w,h,thiscolor,(int) (*var_linesize+0.5));
+              batch.line(lx,ly,x,y,thiscolor,(int) (pt[PT_LINESIZE][a]+0.5));
             }
   #endif
           } // candraw
@@ -333,10 +373,13 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
       lx=x;
       ly=y;
   #ifdef LASER
-      dlx=*var_x;
-      dly=*var_y;
+      dlx=pt[PT_X][a];
+      dly=pt[PT_Y][a];
   #endif
     }
+#ifndef LASER
+    batch.draw(framebuffer,w,h);
+#endif
   }
  
   return 0;
@@ -33,6 +33,7 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <commctrl.h>
 #include "resource.h"
 #include "r_defs.h"
+#include "rng.h"
 #include "../Agave/Language/api_language.h"
 
 #define MOD_NAME "Render / Starfield"
@@ -78,6 +79,7 @@ class C_THISCLASS : public C_RBASE {
 	int durFrames;
 	float CurrentSpeed;
     int nc;
+    C_Rng rng;
 	};
 
 
@@ -171,17 +173,17 @@ void C_THISCLASS::InitializeStars(void)
   if (MaxStars > 4095) MaxStars=4095;
   for (i=0;i<MaxStars;i++)
 	{
-    Stars[i].X=(rand()%Width)-Xoff;
-    Stars[i].Y=(rand()%Height)-Yoff;
-    Stars[i].Z=(float)(rand()%255);
-    Stars[i].Speed = (float)(rand()%9+1)/10;
+    Stars[i].X=rng.below(Width)-Xoff;
+    Stars[i].Y=rng.below(Height)-Yoff;
+    Stars[i].Z=(float)rng.below(255);
+    Stars[i].Speed = (float)(rng.below(9)+1)/10;
 	}
 }
 
 void C_THISCLASS::CreateStar(int A)
 {
-  Stars[A].X = (rand()%Width)-Xoff;
-  Stars[A].Y = (rand()%Height)-Yoff;
+  Stars[A].X = rng.below(Width)-Xoff;
+  Stars[A].Y = rng.below(Height)-Yoff;
   Stars[A].Z = (float)Zoff;
 }
 
@@ -35,6 +35,8 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <commctrl.h>
 #include "resource.h"
 #include "r_defs.h"
+#include "fb_arena.h"
+#include "rng.h"
 
 #include "avs_eelif.h"
 #include "../Agave/Language/api_language.h"
@@ -108,6 +110,7 @@ class C_THISCLASS : public C_RBASE {
 	int oldxshift, oldyshift;
 	int randomword;
 	int shiftinit;
+	C_Rng rng;
 	};
 
 
@@ -124,11 +127,11 @@ if (lw || lh)
    if (hOldFont) SelectObject(hBitmapDC, hOldFont);
    DeleteDC (hBitmapDC); 
    ReleaseDC (NULL, hDesktopDC); 
-   if (myBuffer) GlobalFree(myBuffer);
+   if (myBuffer) C_FBArena::free(myBuffer);
    }
 
 // Alloc buffers, select objects, init structures
-   myBuffer = (int *)GlobalAlloc(GMEM_FIXED,w*h*4);
+   myBuffer = (int *)C_FBArena::alloc(w*h*4,MOD_NAME,0);
    hDesktopDC = GetDC (NULL); 
    hRetBitmap = CreateCompatibleBitmap (hDesktopDC, w, h);
    hBitmapDC = CreateCompatibleDC (hDesktopDC); 
@@ -163,7 +166,7 @@ if (lw || lh)
     if (hOldFont) SelectObject(hBitmapDC, hOldFont);
 	DeleteDC (hBitmapDC); 
 	ReleaseDC (NULL, hDesktopDC); 
-	if (myBuffer) GlobalFree(myBuffer);
+	if (myBuffer) C_FBArena::free(myBuffer);
 	}
 if (text) GlobalFree(text);
 if (myFont)
@@ -549,7 +552,7 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
 	if (!(insertBlank && !(oddeven % 2))) 
 		{
 		if (randomword)
-			curword=rand()%(getNWords(text)+1);
+			curword=rng.below(getNWords(text)+1);
 		else
 			{
 			curword++;
@@ -585,10 +588,10 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
 		GetTextExtentPoint32(hBitmapDC, thisText, strlen(thisText), &size); // Don't write outside the screen
 		_halign = DT_LEFT;
 		if (size.cx < w)
-			_xshift = rand() % (int)(((float)(w-size.cx) / (float)w) * 100.0F);
+			_xshift = rng.below((int)(((float)(w-size.cx) / (float)w) * 100.0F));
 		_valign = DT_TOP;
 		if (size.cy < h)
-			_yshift = rand() % (int)(((float)(h-size.cy) / (float)h) * 100.0F);
+			_yshift = rng.below((int)(((float)(h-size.cy) / (float)h) * 100.0F));
 		forceshift=1;	
 		}
 	else
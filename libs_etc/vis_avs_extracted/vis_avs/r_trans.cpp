@@ -35,8 +35,10 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "r_defs.h"
 #include "resource.h"
 
-#include "timing.h"
 #include "avs_eelif.h"
+#include "smp_pool.h"
+#include "fb_arena.h"
+#include "rng.h"
 #include "../Agave/Language/api_language.h"
 #include "../nu/AutoWide.h"
 #include <math.h>
@@ -126,14 +128,30 @@ static inline bool effect_uses_eval(int t)
 }
 
 
+class C_THISCLASS;
+
+// one trans_tab generation, split by rows
+typedef struct
+{
+  C_THISCLASS *_this;
+  char *exp; // code of scripted effects, NULL for the builtin radial ones
+  int is_rect;
+  int w, h;
+  char (*visdata)[2][576]; // of the frame the table is built on, for getosc() & co
+  volatile LONG failed; // the code didn't compile
+} transGenParms;
+
 class C_THISCLASS : public C_RBASE2 {
 	protected:
+    void gen_tab(int w, int h, char visdata[2][2][576]);
+    int gen_rows(transGenParms *p, int y0, int y1);
+    static void gen_tileProc(void *ctx, int tile, int ntiles);
 	public:
 		C_THISCLASS();
 		virtual ~C_THISCLASS();
 		virtual int render(char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h);
 
-    virtual int smp_getflags() { return 1; }
+    virtual int smp_getflags() { return 3; }
 		virtual int smp_begin(int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); 
     virtual void smp_render(int this_thread, int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); 
     virtual int smp_finish(char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); // return value is that of render() for fbstuff etc
@@ -153,6 +171,7 @@ class C_THISCLASS : public C_RBASE2 {
     int subpixel;
     int wrap;
     CRITICAL_SECTION rcs;
+    C_Rng rng;
 };
 
 #define PUT_INT(y) data[pos]=(y)&255; data[pos+1]=(y>>8)&255; data[pos+2]=(y>>16)&255; data[pos+3]=(y>>24)&255
@@ -284,13 +303,454 @@ C_THISCLASS::C_THISCLASS()
 
 C_THISCLASS::~C_THISCLASS()
 {
-  if (trans_tab) GlobalFree(trans_tab);
+  if (trans_tab) C_FBArena::free(trans_tab);
   trans_tab=NULL;
   trans_tab_w=trans_tab_h=0;
   trans_effect=0;
   DeleteCriticalSection(&rcs);
 }
 
+///////////////////// trans_tab generation
+
+extern int g_config_smp, g_config_smp_mt;
+
+#define TRANS_TAB_BIGPIXELS (64*1024) // smaller tables are built at once, without threads or the cache
+#define TRANS_CACHE_MAXBYTES (256*1024*1024) // least recently used tables go first past that
+
+// finished tables are kept in files named by a hash of everything they depend
+// on, in the temp directory. the file starts with the whole key, so a hash
+// collision is a miss.
+typedef struct
+{
+  char magic[4]; // AVTC
+  int keylen;
+  int n;
+  int reserved;
+} transCacheHdr;
+
+static int trans_cacheDir(char *dir) // at least MAX_PATH+32
+{
+  int l=GetTempPath(MAX_PATH,dir);
+  if (l < 1 || l >= MAX_PATH) return 0;
+  if (dir[l-1] != '\\') dir[l++]='\\';
+  strcpy(dir+l,"avs_movement\\");
+  return 1;
+}
+
+static int trans_cacheName(const char *key, char *fn) // at least MAX_PATH+64
+{
+  unsigned __int64 h=0xcbf29ce484222325; // FNV-1a
+  if (!trans_cacheDir(fn)) return 0;
+  while (*key) 
+  {
+    h^=(unsigned char)*key++;
+    h*=0x100000001b3;
+  }
+  wsprintf(fn+strlen(fn),"%08x%08x.tab",(unsigned int)(h>>32),(unsigned int)h);
+  return 1;
+}
+
+static int trans_cacheLoad(const char *key, int *tab, int n)
+{
+  char fn[MAX_PATH+64];
+  int keylen=strlen(key), ok=0;
+  if (!trans_cacheName(key,fn)) return 0;
+
+  HANDLE hf=CreateFile(fn,GENERIC_READ|FILE_WRITE_ATTRIBUTES,FILE_SHARE_READ|FILE_SHARE_DELETE,NULL,OPEN_EXISTING,0,NULL);
+  if (hf == INVALID_HANDLE_VALUE) return 0;
+  if (GetFileSize(hf,NULL) == sizeof(transCacheHdr)+keylen+n*sizeof(int))
+  {
+    HANDLE hm=CreateFileMapping(hf,NULL,PAGE_READONLY,0,0,NULL);
+    if (hm)
+    {
+      char *v=(char *)MapViewOfFile(hm,FILE_MAP_READ,0,0,0);
+      if (v)
+      {
+        transCacheHdr *hdr=(transCacheHdr *)v;
+        if (!memcmp(hdr->magic,"AVTC",4) && hdr->keylen == keylen && hdr->n == n && 
+            !memcmp(v+sizeof(transCacheHdr),key,keylen))
+        {
+          memcpy(tab,v+sizeof(transCacheHdr)+keylen,n*sizeof(int));
+          ok=1;
+        }
+        UnmapViewOfFile(v);
+      }
+      CloseHandle(hm);
+    }
+  }
+  if (ok) // used now, for trans_cacheTrim()
+  {
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    SetFileTime(hf,NULL,NULL,&ft);
+  }
+  CloseHandle(hf);
+  return ok;
+}
+
+static void trans_cacheTrim(const char *dir)
+{
+  typedef struct { char name[MAX_PATH]; unsigned __int64 size, time; } ent;
+  ent *list=NULL;
+  int n=0, n_alloc=0, x;
+  unsigned __int64 total=0;
+  char mask[MAX_PATH+64];
+  WIN32_FIND_DATA fd;
+
+  wsprintf(mask,"%s*.tab",dir);
+  HANDLE h=FindFirstFile(mask,&fd);
+  if (h == INVALID_HANDLE_VALUE) return;
+  do
+  {
+    if (n >= n_alloc)
+    {
+      ent *nl=(ent *)realloc(list,(n_alloc=n_alloc*2+64)*sizeof(ent));
+      if (!nl) break;
+      list=nl;
+    }
+    lstrcpyn(list[n].name,fd.cFileName,MAX_PATH);
+    list[n].size=((unsigned __int64)fd.nFileSizeHigh<<32)|fd.nFileSizeLow;
+    list[n].time=((unsigned __int64)fd.ftLastWriteTime.dwHighDateTime<<32)|fd.ftLastWriteTime.dwLowDateTime;
+    total+=list[n++].size;
+  } while (FindNextFile(h,&fd));
+  FindClose(h);
+
+  while (total > TRANS_CACHE_MAXBYTES && n > 0)
+  {
+    int oldest=0;
+    for (x = 1; x < n; x ++) if (list[x].time < list[oldest].time) oldest=x;
+    wsprintf(mask,"%s%s",dir,list[oldest].name);
+    DeleteFile(mask);
+    total-=list[oldest].size;
+    list[oldest]=list[--n];
+  }
+  free(list);
+}
+
+static void trans_cacheSave(const char *key, int *tab, int n)
+{
+  char dir[MAX_PATH+32], fn[MAX_PATH+64], tmp[MAX_PATH+96];
+  transCacheHdr hdr;
+  DWORD wr;
+  int ok;
+  if (!trans_cacheDir(dir) || !trans_cacheName(key,fn)) return;
+  CreateDirectory(dir,NULL);
+
+  // written under another name first, so nobody maps half a file
+  wsprintf(tmp,"%s.%u",fn,GetCurrentThreadId());
+  HANDLE hf=CreateFile(tmp,GENERIC_WRITE,0,NULL,CREATE_ALWAYS,FILE_ATTRIBUTE_NORMAL,NULL);
+  if (hf == INVALID_HANDLE_VALUE) return;
+  memcpy(hdr.magic,"AVTC",4);
+  hdr.keylen=strlen(key);
+  hdr.n=n;
+  hdr.reserved=0;
+  ok=WriteFile(hf,&hdr,sizeof(hdr),&wr,NULL) && wr == sizeof(hdr) &&
+     WriteFile(hf,key,hdr.keylen,&wr,NULL) && wr == (DWORD)hdr.keylen &&
+     WriteFile(hf,tab,n*sizeof(int),&wr,NULL) && wr == n*sizeof(int);
+  CloseHandle(hf);
+  if (!ok || !MoveFileEx(tmp,fn,MOVEFILE_REPLACE_EXISTING)) 
+  {
+    DeleteFile(tmp);
+    return;
+  }
+  trans_cacheTrim(dir);
+}
+
+#define TRANS_CODE_VOLATILE 1 // uses reg00-reg99, gmegabuf(), rand() or the audio
+#define TRANS_CODE_STATEFUL 2 // keeps variables from one pixel to the next
+
+// how the table exp builds depends on more than exp and the size. volatile
+// tables aren't cached, and neither those nor stateful ones are split over
+// threads, so that they come out the same with any SMP settings.
+static int trans_codeCheck(char *exp)
+{
+  NSEEL_VMCTX AVS_EEL_CONTEXTNAME;
+  AVS_EEL_INITINST();
+  // the variables of gen_rows(), so its compile reuses this one
+  double *inputs[4];
+  inputs[0]=registerVar("d");
+  inputs[1]=registerVar("r");
+  inputs[2]=registerVar("x");
+  inputs[3]=registerVar("y");
+  registerVar("sw");
+  registerVar("sh");
+  NSEEL_CODEHANDLE codehandle=compileCode(exp);
+  int v=0;
+  if (codehandle)
+  {
+    if (NSEEL_code_isvolatile(codehandle)) v|=TRANS_CODE_VOLATILE;
+    if (NSEEL_code_carriesstate(codehandle,inputs,4)) v|=TRANS_CODE_STATEFUL;
+  }
+  freeCode(codehandle);
+  AVS_EEL_QUITINST();
+  return v;
+}
+
+// builds trans_tab for the radial and the scripted effects. big ones come
+// from the cache if they're there, otherwise they're split by rows over the
+// SMP threads (every one with its own VM, unless trans_codeCheck() says the
+// code needs them all in one) and then saved to the cache.
+void C_THISCLASS::gen_tab(int w, int h, char visdata[2][2][576])
+{
+  int is_eval=trans_effect == 32767 || effect_uses_eval(trans_effect);
+  int big=w*h >= TRANS_TAB_BIGPIXELS;
+  char *key=NULL;
+  transGenParms p;
+  p._this=this;
+  p.exp=NULL;
+  p.is_rect=0;
+  p.w=w;
+  p.h=h;
+  p.visdata=visdata;
+  p.failed=0;
+
+  if (is_eval)
+  {
+    p.is_rect = trans_effect == 32767 ? rectangular : descriptions[trans_effect].uses_rect;
+    EnterCriticalSection(&rcs); // the editor can change effect_exp
+    p.exp=_strdup(trans_effect == 32767 ? effect_exp.get() : descriptions[trans_effect].eval_desc);
+    LeaveCriticalSection(&rcs);
+    if (!p.exp) p.failed=1;
+  }
+
+  int check=big && p.exp ? trans_codeCheck(p.exp) : 0;
+  if (big && !p.failed && !(check&TRANS_CODE_VOLATILE))
+  {
+    char hdr[128];
+    wsprintf(hdr,"trans1 e%d w%d h%d s%d r%d wr%d\n",trans_effect,w,h,trans_tab_subpixel,p.is_rect,wrap);
+    key=(char *)malloc(strlen(hdr)+(p.exp ? strlen(p.exp) : 0)+1);
+    if (key)
+    {
+      strcpy(key,hdr);
+      if (p.exp) strcat(key,p.exp);
+      if (trans_cacheLoad(key,trans_tab,w*h))
+      {
+        free(key);
+        free(p.exp);
+        return;
+      }
+    }
+  }
+
+  if (!p.failed)
+  {
+    int nthreads=big && !check && g_config_smp ? g_config_smp_mt : 1;
+    if (nthreads > SMP_POOL_MAX_THREADS) nthreads=SMP_POOL_MAX_THREADS;
+    if (nthreads < 1) nthreads=1;
+    C_SmpPool::run(nthreads,nthreads,gen_tileProc,&p);
+  }
+
+  if (p.failed)
+  {
+    int x, *transp=trans_tab;
+    trans_tab_subpixel=0;
+    for (x = 0; x < w*h; x ++)
+      *transp++=x;
+  }
+  else if (key) trans_cacheSave(key,trans_tab,w*h);
+
+  free(key);
+  free(p.exp);
+}
+
+void C_THISCLASS::gen_tileProc(void *ctx, int tile, int ntiles)
+{
+  transGenParms *p=(transGenParms *)ctx;
+  int y0=(tile*p->h)/ntiles, y1=((tile+1)*p->h)/ntiles;
+  if (y0 < y1 && !p->_this->gen_rows(p,y0,y1)) InterlockedExchange(&p->failed,1);
+}
+
+// fills rows [y0,y1) of trans_tab, returns 0 if the code doesn't compile.
+// scripted effects run in a VM of their own; code that keeps variables from
+// one pixel to the next is only given all the rows at once.
+int C_THISCLASS::gen_rows(transGenParms *p, int y0, int y1)
+{
+  int w=p->w, h=p->h;
+  int *transp=trans_tab+y0*w;
+  int x, y;
+
+  if (!p->exp)
+  {
+    double max_d=sqrt((w*w+h*h)/4.0);
+    t_reffect *ref=radial_effects[trans_effect-REFFECT_MIN];
+    if (ref) for (y = y0; y < y1; y ++)
+    {
+      for (x = 0; x < w; x ++)
+      {
+        double r,d;
+        double xd,yd;
+        int ow,oh,xo=0,yo=0;
+        xd=x-(w/2);
+        yd=y-(h/2);
+        d=sqrt(xd*xd+yd*yd);
+        r=atan2(yd,xd);
+
+        ref(r,d,max_d,xo,yo);
+
+        double tmp1,tmp2;
+        tmp1= ((h/2) + sin(r)*d + 0.5) + (yo*h)*(1.0/256.0);
+        tmp2= ((w/2) + cos(r)*d + 0.5) + (xo*w)*(1.0/256.0);
+        oh=(int)tmp1;
+        ow=(int)tmp2;
+        if (trans_tab_subpixel)
+        {
+          int xpartial=(int)(32.0*(tmp2-ow));
+          int ypartial=(int)(32.0*(tmp1-oh));
+          if (wrap)
+          {
+            ow%=(w-1);
+            oh%=(h-1);
+            if (ow<0)ow+=w-1;
+            if (oh<0)oh+=h-1;
+          }
+          else
+          {
+            if (ow < 0) { xpartial=0; ow=0; }
+            if (ow >= w-1) { xpartial=31; ow=w-2; }
+            if (oh < 0) { ypartial=0; oh=0; }
+            if (oh >= h-1) {ypartial=31; oh=h-2; }
+          }
+          *transp++ = ow+oh*w | (ypartial<<22) | (xpartial<<27);
+        }
+        else 
+        {
+          if (wrap)
+          {
+            ow%=(w);
+            oh%=(h);
+            if (ow<0)ow+=w;
+            if (oh<0)oh+=h;
+          }
+          else
+          {
+            if (ow < 0) ow=0;
+            if (ow >= w) ow=w-1;
+            if (oh < 0) oh=0;
+            if (oh >= h) oh=h-1;
+          }
+          *transp++ = ow+oh*w;
+        }
+      }
+    }
+    return 1;
+  }
+
+  NSEEL_VMCTX AVS_EEL_CONTEXTNAME;
+  AVS_EEL_INITINST();
+  double max_d=sqrt((double)(w*w+h*h))/2.0;
+  double divmax_d=1.0/max_d;
+  double *d = registerVar("d");
+  double *r = registerVar("r");
+  double *px = registerVar("x");
+  double *py = registerVar("y");
+  double *pw = registerVar("sw");
+  double *ph = registerVar("sh");
+  NSEEL_CODEHANDLE codehandle=0;
+  int is_rect=p->is_rect, ok=0;
+  *pw=w;
+  *ph=h;
+  codehandle=compileCode(p->exp);
+
+  // a row of pixels per batch: x,d,r in, x,y,d,r out
+  double *buf=codehandle ? (double *)malloc(sizeof(double)*w*7) : NULL;
+  if (buf)         
+  {
+    double *xin=buf, *din=buf+w, *rin=buf+w*2;
+    double *xout=buf+w*3, *yout=buf+w*4, *dout=buf+w*5, *rout=buf+w*6;
+    double w2=w/2;
+    double h2=h/2;
+    double xsc=1.0/w2,ysc=1.0/h2;
+
+    for (y = y0; y < y1; y ++)
+    {
+      double yd=y-h2;
+      double yin=yd*ysc;
+      for (x = 0; x < w; x ++)
+      {
+        double xd=x-w2;
+        xin[x]=xd*xsc;
+        din[x]=sqrt(xd*xd+yd*yd)*divmax_d;
+        rin[x]=atan2(yd,xd) + M_PI*0.5;
+      }
+      NSEEL_BATCHVAR bv[4]=
+      {
+        { px, xin, 1, xout },
+        { py, &yin, 0, yout },
+        { d, din, 1, dout },
+        { r, rin, 1, rout },
+      };
+      executeCodeBatch(codehandle,p->visdata,bv,4,w);
+
+      for (x = 0; x < w; x ++)
+      {
+        int ow,oh;
+        double tmp1,tmp2;
+        if (!is_rect)
+        {
+          double dd=dout[x]*max_d;
+          double rr=rout[x]-M_PI/2.0;
+          tmp1=((h/2) + sin(rr)*dd);
+          tmp2=((w/2) + cos(rr)*dd);
+        }
+        else
+        {
+          tmp1=((yout[x]+1.0)*h2);
+          tmp2=((xout[x]+1.0)*w2);
+        }
+        if (trans_tab_subpixel)
+        {
+          oh=(int) tmp1;
+          ow=(int) tmp2;
+          int xpartial=(int)(32.0*(tmp2-ow));
+          int ypartial=(int)(32.0*(tmp1-oh));
+          if (wrap)
+          {
+            ow%=(w-1);
+            oh%=(h-1);
+            if (ow<0)ow+=w-1;
+            if (oh<0)oh+=h-1;
+          }
+          else
+          {
+            if (ow < 0) { xpartial=0; ow=0; }
+            if (ow >= w-1) { xpartial=31; ow=w-2; }
+            if (oh < 0) { ypartial=0; oh=0; }
+            if (oh >= h-1) {ypartial=31; oh=h-2; }
+          }
+          *transp++ = ow+oh*w | (ypartial<<22) | (xpartial<<27);
+        }
+        else
+        {
+          tmp1+=0.5;
+          tmp2+=0.5;
+          oh=(int) tmp1;
+          ow=(int) tmp2;
+          if (wrap)
+          {
+            ow%=(w);
+            oh%=(h);
+            if (ow<0)ow+=w;
+            if (oh<0)oh+=h;
+          }
+          else
+          {
+            if (ow < 0) ow=0;
+            if (ow >= w) ow=w-1;
+            if (oh < 0) oh=0;
+            if (oh >= h) oh=h-1;
+          }
+          *transp++ = ow+oh*w;
+        }
+      }
+    }
+    free(buf);
+    ok=1;
+  }
+  freeCode(codehandle);
+  AVS_EEL_QUITINST();
+  return ok;
+}
+
 int C_THISCLASS::smp_begin(int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
 {
   if (!effect) return 0;
@@ -300,10 +760,10 @@ int C_THISCLASS::smp_begin(int max_threads, char visdata[2][2][576], int isBeat,
   {
     int p;
     int *transp,x;
-    if (trans_tab) GlobalFree(trans_tab);
+    if (trans_tab) C_FBArena::free(trans_tab);
     trans_tab_w=w; 
     trans_tab_h=h;
-    trans_tab=(int*)GlobalAlloc(GMEM_FIXED,trans_tab_w*trans_tab_h*sizeof(int));
+    trans_tab=(int*)C_FBArena::alloc(trans_tab_w*trans_tab_h*sizeof(int),MOD_NAME,0);
     trans_effect=effect;
     trans_tab_subpixel=(subpixel && trans_tab_w*trans_tab_h < (1<<22) &&
                   ((trans_effect >= REFFECT_MIN && trans_effect <= REFFECT_MAX
@@ -319,7 +779,7 @@ int C_THISCLASS::smp_begin(int max_threads, char visdata[2][2][576], int isBeat,
 	  {
 		  while (x--)
 		  {
-		    int r=(p++)+(rand()%3)-1 + ((rand()%3)-1)*w;
+		    int r=(p++)+rng.below(3)-1 + (rng.below(3)-1)*w;
 		    *transp++ = min(w*h-1,max(r,0));
 		  }
 	  }
@@ -358,184 +818,9 @@ int C_THISCLASS::smp_begin(int max_threads, char visdata[2][2][576], int isBeat,
         }
       }
     }
-    else if (trans_effect >= REFFECT_MIN && trans_effect <= REFFECT_MAX && !effect_uses_eval(trans_effect))
+    else if (trans_effect >= REFFECT_MIN && trans_effect <= REFFECT_MAX || trans_effect == 32767)
     {
-      double max_d=sqrt((w*w+h*h)/4.0);
-      int y;
-      t_reffect *ref=radial_effects[trans_effect-REFFECT_MIN];
-      if (ref) for (y = 0; y < h; y ++)
-      {
-        for (x = 0; x < w; x ++)
-        {
-          double r,d;
-          double xd,yd;
-          int ow,oh,xo=0,yo=0;
-          xd=x-(w/2);
-          yd=y-(h/2);
-          d=sqrt(xd*xd+yd*yd);
-          r=atan2(yd,xd);
-
-          ref(r,d,max_d,xo,yo);
-
-          double tmp1,tmp2;
-          tmp1= ((h/2) + sin(r)*d + 0.5) + (yo*h)*(1.0/256.0);
-          tmp2= ((w/2) + cos(r)*d + 0.5) + (xo*w)*(1.0/256.0);
-          oh=(int)tmp1;
-          ow=(int)tmp2;
-          if (trans_tab_subpixel)
-          {
-            int xpartial=(int)(32.0*(tmp2-ow));
-            int ypartial=(int)(32.0*(tmp1-oh));
-            if (wrap)
-            {
-              ow%=(w-1);
-              oh%=(h-1);
-              if (ow<0)ow+=w-1;
-              if (oh<0)oh+=h-1;
-            }
-            else
-            {
-              if (ow < 0) { xpartial=0; ow=0; }
-              if (ow >= w-1) { xpartial=31; ow=w-2; }
-              if (oh < 0) { ypartial=0; oh=0; }
-              if (oh >= h-1) {ypartial=31; oh=h-2; }
-            }
-            *transp++ = ow+oh*w | (ypartial<<22) | (xpartial<<27);
-          }
-          else 
-          {
-            if (wrap)
-            {
-              ow%=(w);
-              oh%=(h);
-              if (ow<0)ow+=w;
-              if (oh<0)oh+=h;
-            }
-            else
-            {
-              if (ow < 0) ow=0;
-              if (ow >= w) ow=w-1;
-              if (oh < 0) oh=0;
-              if (oh >= h) oh=h-1;
-            }
-            *transp++ = ow+oh*w;
-          }
-        }
-      }
-    }
-    else if (trans_effect == 32767 || effect_uses_eval(trans_effect))
-    {
-      NSEEL_VMCTX AVS_EEL_CONTEXTNAME;
-      AVS_EEL_INITINST();
-      double max_d=sqrt((double)(w*w+h*h))/2.0;
-      double divmax_d=1.0/max_d;
-      int y;
-      double *d = registerVar("d");
-      double *r = registerVar("r");
-      double *px = registerVar("x");
-      double *py = registerVar("y");
-      double *pw = registerVar("sw");
-      double *ph = registerVar("sh");
-      NSEEL_CODEHANDLE codehandle=0;
-      int offs=0;
-      int is_rect = trans_effect == 32767 ? rectangular : descriptions[trans_effect].uses_rect;
-      *pw=w;
-      *ph=h;
-      EnterCriticalSection(&rcs);
-      codehandle=compileCode(
-        trans_effect == 32767 ? effect_exp.get() : descriptions[trans_effect].eval_desc
-        );
-      LeaveCriticalSection(&rcs);
-      if (codehandle)         
-      {
-        double w2=w/2;
-        double h2=h/2;
-        double xsc=1.0/w2,ysc=1.0/h2;
-
-        for (y = 0; y < h; y ++)
-        {
-          for (x = 0; x < w; x ++)
-          {
-            double xd,yd;
-            int ow,oh;
-            xd=x-w2;
-            yd=y-h2;
-            *px=xd*xsc;
-            *py=yd*ysc;
-            *d=sqrt(xd*xd+yd*yd)*divmax_d;
-            *r=atan2(yd,xd) + M_PI*0.5;
-    
-            executeCode(codehandle,visdata);
-        
-            double tmp1,tmp2;
-            if (!is_rect)
-            {
-              *d *= max_d;
-              *r -= M_PI/2.0;
-              tmp1=((h/2) + sin(*r)* *d);
-              tmp2=((w/2) + cos(*r)* *d);
-            }
-            else
-            {
-              tmp1=((*py+1.0)*h2);
-              tmp2=((*px+1.0)*w2);
-            }
-            if (trans_tab_subpixel)
-            {
-              oh=(int) tmp1;
-              ow=(int) tmp2;
-              int xpartial=(int)(32.0*(tmp2-ow));
-              int ypartial=(int)(32.0*(tmp1-oh));
-              if (wrap)
-              {
-                ow%=(w-1);
-                oh%=(h-1);
-                if (ow<0)ow+=w-1;
-                if (oh<0)oh+=h-1;
-              }
-              else
-              {
-                if (ow < 0) { xpartial=0; ow=0; }
-                if (ow >= w-1) { xpartial=31; ow=w-2; }
-                if (oh < 0) { ypartial=0; oh=0; }
-                if (oh >= h-1) {ypartial=31; oh=h-2; }
-              }
-              *transp++ = ow+oh*w | (ypartial<<22) | (xpartial<<27);
-            }
-            else
-            {
-              tmp1+=0.5;
-              tmp2+=0.5;
-              oh=(int) tmp1;
-              ow=(int) tmp2;
-              if (wrap)
-              {
-                ow%=(w);
-                oh%=(h);
-                if (ow<0)ow+=w;
-                if (oh<0)oh+=h;
-              }
-              else
-              {
-                if (ow < 0) ow=0;
-                if (ow >= w) ow=w-1;
-                if (oh < 0) oh=0;
-                if (oh >= h) oh=h-1;
-              }
-              *transp++ = ow+oh*w;
-            }
-          }
-        }
-      }
-      else 
-      {
-        transp=trans_tab;
-        trans_tab_subpixel=0;
-        for (x = 0; x < w*h; x ++)
-          *transp++=x;
-      }
-      freeCode(codehandle);
-      AVS_EEL_QUITINST();
+      gen_tab(w,h,visdata);
     }
     effect_exp_ch=0;
   }
@@ -584,7 +869,6 @@ void C_THISCLASS::smp_render(int this_thread, int max_threads, char visdata[2][2
     transp += skip_pix;
     if (trans_tab_subpixel)
     {
-      timingEnter(3);
       while (x--) 
       {
         fbout[transp[0]&OFFSET_MASK]=BLEND_MAX(inp[0],fbout[transp[0]&OFFSET_MASK]);
@@ -594,7 +878,6 @@ void C_THISCLASS::smp_render(int this_thread, int max_threads, char visdata[2][2
         inp+=4;
         transp+=4;
       }
-      timingLeave(3);
       x = (w*outh)&3;
       if (x>0) while (x--)
       {
@@ -605,7 +888,6 @@ void C_THISCLASS::smp_render(int this_thread, int max_threads, char visdata[2][2
     else
     {
       {
-        timingEnter(3);
         while (x--) 
         {
           fbout[transp[0]]=BLEND_MAX(inp[0],fbout[transp[0]]);
@@ -615,7 +897,6 @@ void C_THISCLASS::smp_render(int this_thread, int max_threads, char visdata[2][2
           inp+=4;
           transp+=4;
         }
-        timingLeave(3);
         x = (w*outh)&3;
         if (x>0) while (x--)
         {
@@ -654,6 +935,10 @@ void C_THISCLASS::smp_render(int this_thread, int max_threads, char visdata[2][2
     transp += skip_pix;
     if (trans_tab_subpixel&&blend)
     {
+#ifdef NO_MMX
+      g_blendsimd.bilinear_tab((int *)outp,framebuffer,w,transp,w*outh);
+      g_blendsimd.avgblend((int *)outp,(int *)inp,(int *)outp,w*outh);
+#else
       while (x--)
       {
         int offs=transp[0]&OFFSET_MASK;
@@ -679,9 +964,13 @@ void C_THISCLASS::smp_render(int this_thread, int max_threads, char visdata[2][2
     #ifndef NO_MMX
       __asm emms;
     #endif
+#endif
     }
     else if (trans_tab_subpixel)
     {
+#ifdef NO_MMX
+      g_blendsimd.bilinear_tab((int *)outp,framebuffer,w,transp,w*outh);
+#else
       while (x--)
       {
         int offs=transp[0]&OFFSET_MASK;
@@ -705,10 +994,10 @@ void C_THISCLASS::smp_render(int this_thread, int max_threads, char visdata[2][2
     #ifndef NO_MMX
       __asm emms;
     #endif
+#endif
     }
     else if (blend)
     {
-      timingEnter(3);
       while (x--) 
       {
         outp[0]=BLEND_AVG(inp[0],framebuffer[transp[0]]);
@@ -719,7 +1008,6 @@ void C_THISCLASS::smp_render(int this_thread, int max_threads, char visdata[2][2
         inp+=4;
         transp+=4;
       }
-      timingLeave(3);
       x = (w*outh)&3;
       if (x>0) while (x--)
       {
@@ -728,7 +1016,6 @@ void C_THISCLASS::smp_render(int this_thread, int max_threads, char visdata[2][2
     }
     else
     {
-      timingEnter(4);
       while (x--) 
       {
         outp[0]=framebuffer[transp[0]];
@@ -738,7 +1025,6 @@ void C_THISCLASS::smp_render(int this_thread, int max_threads, char visdata[2][2
         outp+=4;
         transp+=4;
       }
-      timingLeave(4);
       x = (w*outh)&3;
       if (x>0) while (x--)
       {
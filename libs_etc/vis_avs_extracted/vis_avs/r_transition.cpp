@@ -37,6 +37,8 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "r_defs.h"
 #include "r_unkn.h"
 #include "r_transition.h"
+#include "fb_arena.h"
+#include "profiler.h"
 #include "render.h"
 #include <math.h>
 #include "../Agave/Language/api_language.h"
@@ -72,6 +74,11 @@ C_RenderTransitionClass::C_RenderTransitionClass()
   start_time=0;
   _dotransitionflag=0;
   initThread=0;
+  memset(prefetch,0,sizeof(prefetch));
+  InitializeCriticalSection(&prefetch_cs);
+  prefetchEvent=CreateEvent(NULL,FALSE,FALSE,NULL);
+  prefetchThread=0;
+  prefetchQuit=0;
 }
 
 C_RenderTransitionClass::~C_RenderTransitionClass()
@@ -82,9 +89,25 @@ C_RenderTransitionClass::~C_RenderTransitionClass()
     WaitForSingleObject(initThread,INFINITE);
     CloseHandle(initThread);
     initThread=0;
-  }  for (x = 0; x < 4; x ++)
+  }
+  if (prefetchThread)
+  {
+    prefetchQuit=1;
+    SetEvent(prefetchEvent);
+    WaitForSingleObject(prefetchThread,INFINITE);
+    CloseHandle(prefetchThread);
+    prefetchThread=0;
+  }
+  for (x = 0; x < PREFETCH_SLOTS; x ++)
   {
-    if (fbs[x]) GlobalFree(fbs[x]);
+    if (prefetch[x].list) delete prefetch[x].list;
+    prefetch[x].list=NULL;
+  }
+  CloseHandle(prefetchEvent);
+  DeleteCriticalSection(&prefetch_cs);
+  for (x = 0; x < 4; x ++)
+  {
+    if (fbs[x]) C_FBArena::free(fbs[x]);
     fbs[x]=NULL;
   }
 }
@@ -92,9 +115,6 @@ C_RenderTransitionClass::~C_RenderTransitionClass()
 unsigned int WINAPI C_RenderTransitionClass::m_initThread(LPVOID p)
 {
   C_RenderTransitionClass *_this=(C_RenderTransitionClass*)p;
-  FILETIME ft;
-  GetSystemTimeAsFileTime(&ft);
-  srand(ft.dwLowDateTime|ft.dwHighDateTime^GetCurrentThreadId());
   if (cfg_transitions2&32)
   {
     extern HANDLE g_hThread;
@@ -107,10 +127,10 @@ unsigned int WINAPI C_RenderTransitionClass::m_initThread(LPVOID p)
     else if (d == THREAD_PRIORITY_LOWEST) d=THREAD_PRIORITY_IDLE;
     SetThreadPriority(GetCurrentThread(),d);
   }
-  int *fb=(int *)GlobalAlloc(GPTR,_this->l_w*_this->l_h*sizeof(int));
+  int *fb=(int *)C_FBArena::alloc(_this->l_w*_this->l_h*sizeof(int),"Transitions");
   char last_visdata[2][2][576]={0,};
   g_render_effects2->render(last_visdata,0x80000000,fb,fb,_this->l_w,_this->l_h);
-  GlobalFree((HGLOBAL)fb);
+  C_FBArena::free(fb);
 
   _this->_dotransitionflag=2;
 
@@ -118,6 +138,226 @@ unsigned int WINAPI C_RenderTransitionClass::m_initThread(LPVOID p)
   return 0;
 }
 
+enum
+{
+  PREFETCH_EMPTY=0,
+  PREFETCH_QUEUED,
+  PREFETCH_LOADING,
+  PREFETCH_READY,
+  PREFETCH_FAILED, // kept so it isn't retried, LoadPreset() reports the error
+  PREFETCH_SKIPPED, // kept so it isn't retried, LoadPreset() loads it itself
+  PREFETCH_FREE // list is to be deleted
+};
+
+// every Multi Delay counts itself into a frame counter shared by all
+// instances, so one sitting in a held list (which never renders) would have
+// the live ones advance their buffers only every other frame
+static int prefetch_canHold(C_RenderListClass *l)
+{
+  int x, n=l->getNumRenders();
+  for (x = 0; x < n; x ++)
+  {
+    C_RenderListClass::T_RenderListType *t=l->getRender(x);
+    if (!t) continue;
+    if (t->effect_index == LIST_ID && !prefetch_canHold((C_RenderListClass *)t->render)) return 0;
+    if (t->effect_index >= DLLRENDERBASE &&
+        !strcmp((char *)t->effect_index,"Holden05: Multi Delay")) return 0;
+  }
+  return 1;
+}
+
+unsigned int WINAPI C_RenderTransitionClass::m_prefetchThread(LPVOID p)
+{
+  C_RenderTransitionClass *_this=(C_RenderTransitionClass*)p;
+  SetThreadPriority(GetCurrentThread(),THREAD_PRIORITY_BELOW_NORMAL);
+  while (WaitForSingleObject(_this->prefetchEvent,INFINITE) == WAIT_OBJECT_0 && !_this->prefetchQuit)
+  {
+    while (!_this->prefetchQuit)
+    {
+      C_RenderListClass *del=NULL;
+      char file[MAX_PATH];
+      int x, w, h, mem, slot=-1;
+
+      EnterCriticalSection(&_this->prefetch_cs);
+      for (x = 0; x < PREFETCH_SLOTS && !del; x ++)
+      {
+        if (_this->prefetch[x].state == PREFETCH_FREE)
+        {
+          del=_this->prefetch[x].list;
+          _this->prefetch[x].list=NULL;
+          _this->prefetch[x].state=PREFETCH_EMPTY;
+        }
+        else if (_this->prefetch[x].state == PREFETCH_QUEUED && slot < 0) slot=x;
+      }
+      if (!del && slot >= 0)
+      {
+        _this->prefetch[slot].state=PREFETCH_LOADING;
+        lstrcpyn(file,_this->prefetch[slot].file,sizeof(file));
+      }
+      w=_this->l_w;
+      h=_this->l_h;
+      LeaveCriticalSection(&_this->prefetch_cs);
+
+      // effects can share state between instances (see prefetch_canHold()),
+      // so lists are made and deleted under g_render_cs like any other
+      if (del) 
+      {
+        EnterCriticalSection(&g_render_cs);
+        delete del;
+        LeaveCriticalSection(&g_render_cs);
+        continue;
+      }
+      if (slot < 0) break;
+
+      // only loaded though: rendering it would run init code against
+      // reg00-reg99, the global buffers and the line mode of the live preset,
+      // so its first frame is left to the render thread after the swap
+      EnterCriticalSection(&g_render_cs);
+      C_RenderListClass *l=new C_RenderListClass(1);
+      int r=l->__LoadPreset(file,1,0);
+      int hold=!r && prefetch_canHold(l);
+      mem=(l->getNumRenders()+1)*w*h*sizeof(int);
+      LeaveCriticalSection(&g_render_cs);
+
+      EnterCriticalSection(&_this->prefetch_cs);
+      mem+=_this->prefetch[slot].size;
+      for (x = 0; x < PREFETCH_SLOTS; x ++) 
+        if (_this->prefetch[x].state == PREFETCH_READY) mem+=_this->prefetch[x].mem;
+      if (_this->prefetch[slot].cancel || r || !hold || mem > PREFETCH_MAXMEM)
+      {
+        if (_this->prefetch[slot].cancel) _this->prefetch[slot].state=PREFETCH_EMPTY;
+        else if (r) _this->prefetch[slot].state=PREFETCH_FAILED;
+        else if (!hold) _this->prefetch[slot].state=PREFETCH_SKIPPED;
+        else _this->prefetch[slot].state=PREFETCH_EMPTY;
+        del=l;
+      }
+      else
+      {
+        _this->prefetch[slot].list=l;
+        _this->prefetch[slot].mem=mem;
+        _this->prefetch[slot].state=PREFETCH_READY;
+      }
+      LeaveCriticalSection(&_this->prefetch_cs);
+      if (del)
+      {
+        EnterCriticalSection(&g_render_cs);
+        delete del;
+        LeaveCriticalSection(&g_render_cs);
+      }
+    }
+  }
+
+  _endthreadex(0);
+  return 0;
+}
+
+void C_RenderTransitionClass::Prefetch(char **files, int nfiles)
+{
+  int x, y;
+  if (nfiles > PREFETCH_AHEAD) nfiles=PREFETCH_AHEAD;
+
+  EnterCriticalSection(&prefetch_cs);
+  for (x = 0; x < PREFETCH_SLOTS; x ++) 
+  {
+    int s=prefetch[x].state;
+    if (s == PREFETCH_EMPTY || s == PREFETCH_FREE) continue;
+    for (y = 0; y < nfiles && stricmp(files[y],prefetch[x].file); y ++);
+    if (y < nfiles) continue;
+
+    if (s == PREFETCH_LOADING) prefetch[x].cancel=1;
+    else prefetch[x].state = prefetch[x].list ? PREFETCH_FREE : PREFETCH_EMPTY;
+  }
+  for (y = 0; y < nfiles; y ++)
+  {
+    int freeslot=-1;
+    for (x = 0; x < PREFETCH_SLOTS; x ++)
+    {
+      int s=prefetch[x].state;
+      if (s == PREFETCH_EMPTY) { if (freeslot < 0) freeslot=x; }
+      else if (s != PREFETCH_FREE && !prefetch[x].cancel && !stricmp(files[y],prefetch[x].file)) break;
+    }
+    if (x == PREFETCH_SLOTS && freeslot >= 0)
+    {
+      WIN32_FILE_ATTRIBUTE_DATA fa;
+      if (!GetFileAttributesEx(files[y],GetFileExInfoStandard,&fa)) continue;
+      lstrcpyn(prefetch[freeslot].file,files[y],sizeof(prefetch[freeslot].file));
+      prefetch[freeslot].mtime=fa.ftLastWriteTime;
+      prefetch[freeslot].size=fa.nFileSizeLow;
+      prefetch[freeslot].cancel=0;
+      prefetch[freeslot].state=PREFETCH_QUEUED;
+    }
+  }
+  LeaveCriticalSection(&prefetch_cs);
+
+  if (!prefetchThread)
+  {
+    DWORD id;
+    prefetchThread=(HANDLE)_beginthreadex(NULL,0,m_prefetchThread,(LPVOID)this,0,(unsigned int*)&id);
+  }
+  SetEvent(prefetchEvent);
+}
+
+int C_RenderTransitionClass::GetPrefetched(char *file, int maxlen)
+{
+  int x, r=0;
+  EnterCriticalSection(&prefetch_cs);
+  for (x = 0; x < PREFETCH_SLOTS && !r; x ++)
+  {
+    if (prefetch[x].state == PREFETCH_READY)
+    {
+      lstrcpyn(file,prefetch[x].file,maxlen);
+      r=1;
+    }
+  }
+  LeaveCriticalSection(&prefetch_cs);
+  return r;
+}
+
+C_RenderListClass *C_RenderTransitionClass::takePrefetched(char *file)
+{
+  C_RenderListClass *l=NULL;
+  int x;
+  EnterCriticalSection(&prefetch_cs);
+  for (x = 0; x < PREFETCH_SLOTS; x ++)
+  {
+    if (prefetch[x].state == PREFETCH_READY && !stricmp(file,prefetch[x].file))
+    {
+      WIN32_FILE_ATTRIBUTE_DATA fa;
+      if (GetFileAttributesEx(file,GetFileExInfoStandard,&fa) &&
+          !CompareFileTime(&fa.ftLastWriteTime,&prefetch[x].mtime))
+      {
+        l=prefetch[x].list;
+        prefetch[x].list=NULL;
+        prefetch[x].state=PREFETCH_EMPTY;
+      }
+      else prefetch[x].state=PREFETCH_FREE; // changed since
+      break;
+    }
+  }
+  LeaveCriticalSection(&prefetch_cs);
+  if (x < PREFETCH_SLOTS && !l) SetEvent(prefetchEvent);
+  return l;
+}
+
+// deletes list on the prefetch thread, if there is one
+void C_RenderTransitionClass::freeList(C_RenderListClass *list)
+{
+  int x;
+  EnterCriticalSection(&prefetch_cs);
+  for (x = 0; x < PREFETCH_SLOTS && prefetchThread; x ++)
+  {
+    if (prefetch[x].state == PREFETCH_EMPTY)
+    {
+      prefetch[x].list=list;
+      prefetch[x].state=PREFETCH_FREE;
+      break;
+    }
+  }
+  LeaveCriticalSection(&prefetch_cs);
+  if (x < PREFETCH_SLOTS && prefetchThread) SetEvent(prefetchEvent);
+  else delete list;
+}
+
 
 int C_RenderTransitionClass::LoadPreset(char *file, int which, C_UndoItem *item)
 {
@@ -150,7 +390,13 @@ int C_RenderTransitionClass::LoadPreset(char *file, int which, C_UndoItem *item)
   else
   {
     lstrcpyn(last_file,file,sizeof(last_file));
-    if (file[0]) r=g_render_effects2->__LoadPreset(file,1);
+    C_RenderListClass *pre = file[0] ? takePrefetched(file) : NULL;
+    if (pre)
+    {
+      freeList(g_render_effects2);
+      g_render_effects2=pre;
+    }
+    else if (file[0]) r=g_render_effects2->__LoadPreset(file,1);
     else 
     {
       g_render_effects2->clearRenders();
@@ -199,7 +445,7 @@ int C_RenderTransitionClass::render(char visdata[2][2][576], int isBeat, int *fr
     _dotransitionflag=0;
     if (cfg_transitions&last_which)
     {
-      curtrans = (cfg_transition_mode&0x7fff) ? (cfg_transition_mode&0x7fff) : (rand() % ((sizeof(transitionmodes)/sizeof(transitionmodes[0]))-1))+1;
+      curtrans = (cfg_transition_mode&0x7fff) ? (cfg_transition_mode&0x7fff) : rng.below(sizeof(transitionmodes)/sizeof(transitionmodes[0])-1)+1;
       if (cfg_transition_mode&0x8000) curtrans|=0x8000;
       ep[0]=0;
       ep[1]=2;
@@ -234,7 +480,7 @@ int C_RenderTransitionClass::render(char visdata[2][2][576], int isBeat, int *fr
     {
       if (fbs[x]) 
         {
-        GlobalFree(fbs[x]);
+        C_FBArena::free(fbs[x]);
         fbs[x]=NULL;
       }
     }
@@ -243,7 +489,10 @@ int C_RenderTransitionClass::render(char visdata[2][2][576], int isBeat, int *fr
       g_render_effects2->clearRenders();
       g_render_effects2->freeBuffers();
     }
-    return g_render_effects->render(visdata,isBeat,framebuffer,fbout,w,h);
+    int prof=C_Profiler::enter("Preset");
+    int t=g_render_effects->render(visdata,isBeat,framebuffer,fbout,w,h);
+    C_Profiler::leave(prof);
+    return t;
   }
 
 	// handle resize
@@ -254,8 +503,8 @@ int C_RenderTransitionClass::render(char visdata[2][2][576], int isBeat, int *fr
     int x;
     for (x = 0; x < 4; x ++)
     {
-      if (fbs[x]) GlobalFree(fbs[x]);
-      fbs[x]=(int*)GlobalAlloc(GPTR,l_w*l_h*sizeof(int));
+      if (fbs[x]) C_FBArena::free(fbs[x]);
+      fbs[x]=(int*)C_FBArena::alloc(l_w*l_h*sizeof(int),"Transitions");
     }
   }
 
@@ -268,9 +517,17 @@ int C_RenderTransitionClass::render(char visdata[2][2][576], int isBeat, int *fr
 
 	// maybe there's a faster way than using 3 more buffers without screwing
 	// any effect... justin ?
+  int prof;
   if (curtrans&0x8000)
+  {
+    prof=C_Profiler::enter("New preset");
 	  ep[1]^=g_render_effects2->render(visdata,isBeat,fbs[ep[1]],fbs[ep[1]^1],w,h)&1;
+    C_Profiler::leave(prof);
+  }
+  prof=C_Profiler::enter("Preset");
   ep[0]^=g_render_effects->render(visdata,isBeat,fbs[ep[0]],fbs[ep[0]^1],w,h)&1;
+  C_Profiler::leave(prof);
+  prof=C_Profiler::enter("Transition");
 
 	int *p = fbs[ep[1]];
   int *d = fbs[ep[0]];
@@ -339,7 +596,7 @@ int C_RenderTransitionClass::render(char visdata[2][2][576], int isBeat, int *fr
             {
               do 
               {
-							  r = rand()%9; 
+							  r = rng.below(9); 
               }
 							while ((1 << r) & mask);
             }
@@ -522,6 +779,7 @@ int C_RenderTransitionClass::render(char visdata[2][2][576], int isBeat, int *fr
     default:
 		  break;
   }
+  C_Profiler::leave(prof);
 
 	if (n == 255)
   {
@@ -530,7 +788,7 @@ int C_RenderTransitionClass::render(char visdata[2][2][576], int isBeat, int *fr
     start_time=0;
     for (x = 0; x < 4; x ++)
     {
-      if (fbs[x]) GlobalFree(fbs[x]);
+      if (fbs[x]) C_FBArena::free(fbs[x]);
       fbs[x]=NULL;
     }
     g_render_effects2->clearRenders();
@@ -31,6 +31,13 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define _R_TRANSITION_H_
 
 #include "undo.h"
+#include "rng.h"
+
+class C_RenderListClass;
+
+#define PREFETCH_AHEAD 2 // presets to have ready for next/random preset
+#define PREFETCH_SLOTS 4 // room for those plus lists waiting to be freed
+#define PREFETCH_MAXMEM (64<<20) // bytes, estimated
 
 class C_RenderTransitionClass  {
 	protected:
@@ -42,14 +49,40 @@ class C_RenderTransitionClass  {
 		int start_time;
 		int curtrans;
 		int mask;
+		C_Rng rng;
     HANDLE initThread;
     char last_file[MAX_PATH];
     int last_which;
     int _dotransitionflag;
 
+    // presets read and parsed by m_prefetchThread before they are asked
+    // for. see Prefetch()
+    struct
+    {
+      char file[MAX_PATH];
+      FILETIME mtime;
+      int size;
+      int state; // PREFETCH_*
+      int cancel;
+      int mem;
+      C_RenderListClass *list;
+    } prefetch[PREFETCH_SLOTS];
+    CRITICAL_SECTION prefetch_cs;
+    HANDLE prefetchThread, prefetchEvent;
+    int prefetchQuit;
+
+    C_RenderListClass *takePrefetched(char *file);
+    void freeList(C_RenderListClass *list);
+
 	public:
 
     static  unsigned int WINAPI m_initThread(LPVOID p);
+    static  unsigned int WINAPI m_prefetchThread(LPVOID p);
+
+    // replaces the queue of presets to prefetch. LoadPreset() of a prefetched
+    // preset only swaps the list in.
+    void Prefetch(char **files, int nfiles);
+    int GetPrefetched(char *file, int maxlen); // a ready preset, 0 if none
 
     int LoadPreset(char *file, int which, C_UndoItem *item=0); // 0 on success
     C_RenderTransitionClass();
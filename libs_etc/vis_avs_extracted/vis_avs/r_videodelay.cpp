@@ -34,6 +34,7 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <windows.h>
 #include "resource.h"
 #include "r_defs.h"
+#include "frame_ring.h"
 #include "../Agave/Language/api_language.h"
 
 #ifndef LASER
@@ -58,6 +59,8 @@ class C_DELAY : public C_RBASE
 		bool enabled;
 		bool usebeats;
 		unsigned int delay;
+		bool compress;
+		unsigned int budget; // MB, for compress
 
 		// unsaved members
 		LPVOID buffer;
@@ -69,6 +72,8 @@ class C_DELAY : public C_RBASE
 		unsigned long framedelay;
 		unsigned long framemem;
 		unsigned long oldframemem;
+		C_FrameRing ring; // used instead of buffer when compress is set
+		unsigned int framecount;
 };
 
 // global configuration dialog pointer 
@@ -92,6 +97,8 @@ static BOOL CALLBACK g_DlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam,LPARAM lPa
 			hwndEdit = GetDlgItem(hwndDlg,IDC_EDIT1);
 			_itoa(g_Delay->delay,value,10);
 			SetWindowText(hwndEdit,value);
+			CheckDlgButton(hwndDlg,IDC_COMPRESS,g_Delay->compress);
+			SetDlgItemInt(hwndDlg,IDC_BUDGET,g_Delay->budget,FALSE);
 			return 1;
 		case WM_COMMAND:
 			objectcode = LOWORD(wParam);
@@ -102,6 +109,18 @@ static BOOL CALLBACK g_DlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam,LPARAM lPa
 				g_Delay->enabled = IsDlgButtonChecked(hwndDlg,IDC_CHECK1)==1;
 			    return 0;
 			}
+			if (objectcode == IDC_COMPRESS)
+			{
+				g_Delay->compress = IsDlgButtonChecked(hwndDlg,IDC_COMPRESS)==1;
+			    return 0;
+			}
+			if (objectcode == IDC_BUDGET && objectmessage == EN_CHANGE)
+			{
+				BOOL t;
+				val = GetDlgItemInt(hwndDlg,IDC_BUDGET,&t,FALSE);
+				if (t && val >= 1 && val < 4096) g_Delay->budget = val;
+			    return 0;
+			}
 			// see if beats radiobox is checked
 			if (objectcode == IDC_RADIO1)
 			{
@@ -163,6 +182,10 @@ C_DELAY::C_DELAY()
 	enabled = true;
 	usebeats = false;
 	delay = 10;
+	compress = false;
+	budget = 64;
+	framecount = 0;
+	ring.setOwner(MOD_NAME);
 	framedelay = 10;
 	framessincebeat = 0;
 	buffersize = 1;
@@ -201,6 +224,25 @@ int C_DELAY::render(char visdata[2][2][576], int isBeat, int *framebuffer, int *
 	}
 	if (enabled && framedelay!=0)
 	{
+		if (compress)
+		{
+			if (buffersize > 1)
+			{
+				// back to what the constructor set up, so turning compress
+				// off again allocates from scratch
+				VirtualFree(buffer,buffersize,MEM_DECOMMIT);
+				buffersize = virtualbuffersize = oldvirtualbuffersize = 1;
+				buffer = VirtualAlloc(NULL,buffersize,MEM_COMMIT,PAGE_READWRITE);
+				inoutpos = buffer;
+				oldframemem = 0;
+			}
+			ring.setBudget(budget<<20);
+			ring.setLength(framedelay+1);
+			framecount++;
+			ring.put(framecount,framebuffer,w,h);
+			return ring.get(framecount-framedelay,fbout,w,h);
+		}
+		ring.clear();
 		virtualbuffersize = framedelay*framemem;
 		if (framemem == oldframemem)
 		{
@@ -335,6 +377,19 @@ void C_DELAY::load_config(unsigned char *data, int len) // read configuration of
 
 		pos+=4; 
 	}
+	compress = false;
+	if (len-pos >= 4) 
+	{
+		compress=(GET_INT()==1);
+		pos+=4; 
+	}
+	budget = 64;
+	if (len-pos >= 4) 
+	{
+		budget=GET_INT();
+		if (budget < 1 || budget >= 4096) budget = 64;
+		pos+=4; 
+	}
 }
 
 // write configuration to data, return length. config data should not exceed 64k.
@@ -348,6 +403,10 @@ int  C_DELAY::save_config(unsigned char *data)
 	pos+=4;
 	PUT_INT((unsigned int)delay);
 	pos+=4;
+	PUT_INT((int)compress);
+	pos+=4;
+	PUT_INT(budget);
+	pos+=4;
 	return pos;
 }
 
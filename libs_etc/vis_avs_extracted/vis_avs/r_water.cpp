@@ -33,8 +33,8 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <commctrl.h>
 #include "r_defs.h"
 #include "resource.h"
+#include "fb_arena.h"
 
-#include "timing.h"
 #include "../Agave/Language/api_language.h"
 
 #ifndef LASER
@@ -53,7 +53,7 @@ class C_THISCLASS : public C_RBASE2 {
 		virtual void load_config(unsigned char *data, int len);
 		virtual int  save_config(unsigned char *data);
 
-    virtual int smp_getflags() { return 1; }
+    virtual int smp_getflags() { return 3; }
 		virtual int smp_begin(int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); 
     virtual void smp_render(int this_thread, int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); 
     virtual int smp_finish(char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h); // return value is that of render() for fbstuff etc
@@ -90,7 +90,7 @@ C_THISCLASS::C_THISCLASS()
 
 C_THISCLASS::~C_THISCLASS()
 {
-  if (lastframe) GlobalFree(lastframe);
+  if (lastframe) C_FBArena::free(lastframe);
 }
 
 
@@ -118,9 +118,9 @@ int C_THISCLASS::smp_begin(int max_threads, char visdata[2][2][576], int isBeat,
 
   if (!lastframe || w*h != lastframe_len)
   {
-    if (lastframe) GlobalFree(lastframe);
+    if (lastframe) C_FBArena::free(lastframe);
     lastframe_len=w*h;
-    lastframe=(unsigned int *)GlobalAlloc(GPTR,w*h*sizeof(int));
+    lastframe=(unsigned int *)C_FBArena::alloc(w*h*sizeof(int),MOD_NAME);
   }
 
   return max_threads;
@@ -163,7 +163,6 @@ void C_THISCLASS::smp_render(int this_thread, int max_threads, char visdata[2][2
   if (this_thread >= max_threads - 1) at_bottom=1;
 
 
-  timingEnter(0);
 
   {
 
@@ -458,7 +457,6 @@ mmx_water_loop1:
 #ifndef NO_MMX
     __asm emms;
 #endif
-	timingLeave(0);
 }
 
 C_RBASE *R_Water(char *desc)
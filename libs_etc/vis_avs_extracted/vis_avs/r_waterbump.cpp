@@ -34,6 +34,8 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <math.h>
 #include "resource.h"
 #include "r_defs.h"
+#include "fb_arena.h"
+#include "rng.h"
 #include "../Agave/Language/api_language.h"
 
 #ifndef LASER
@@ -67,6 +69,7 @@ class C_THISCLASS : public C_RBASE {
 	int drop_position_y;
 	int drop_radius;
 	int method;
+	C_Rng rng;
 };
 
 
@@ -90,7 +93,7 @@ C_THISCLASS::~C_THISCLASS()
 {
   int i;
   for(i=0;i<2;i++) {
-	  if(buffers[i]) GlobalFree(buffers[i]);
+	  if(buffers[i]) C_FBArena::free(buffers[i]);
 	  buffers[i]=NULL;
   }
 }
@@ -134,8 +137,8 @@ void C_THISCLASS::SineBlob(int x, int y, int radius, int height, int page)
   int radsquare = radius * radius;
   double length = (1024.0/(float)radius)*(1024.0/(float)radius);
 
-  if(x<0) x = 1+radius+ rand()%(buffer_w-2*radius-1);
-  if(y<0) y = 1+radius+ rand()%(buffer_h-2*radius-1);
+  if(x<0) x = 1+radius+ rng.below(buffer_w-2*radius-1);
+  if(y<0) y = 1+radius+ rng.below(buffer_h-2*radius-1);
 
 
   radsquare = (radius*radius);
@@ -173,8 +176,8 @@ void C_THISCLASS::HeightBlob(int x, int y, int radius, int height, int page)
   rquad = radius * radius;
 
   // Make a randomly-placed blob...
-  if(x<0) x = 1+radius+ rand()%(buffer_w-2*radius-1);
-  if(y<0) y = 1+radius+ rand()%(buffer_h-2*radius-1);
+  if(x<0) x = 1+radius+ rng.below(buffer_w-2*radius-1);
+  if(y<0) y = 1+radius+ rng.below(buffer_h-2*radius-1);
 
   left=-radius; right = radius;
   top=-radius; bottom = radius;
@@ -277,13 +280,13 @@ int C_THISCLASS::render(char visdata[2][2][576], int isBeat, int *framebuffer, i
 
   if(buffer_w!=w||buffer_h!=h) {
 	  for(i=0;i<2;i++) {
-		  if(buffers[i])GlobalFree(buffers[i]);
+		  if(buffers[i])C_FBArena::free(buffers[i]);
 		  buffers[i]=NULL;
 	  }
   }
   if(buffers[0]==NULL) {
 	  for(i=0;i<2;i++) {
-		buffers[i]=(int *)GlobalAlloc(GPTR,w*h*sizeof(int));
+		buffers[i]=(int *)C_FBArena::alloc(w*h*sizeof(int),MOD_NAME);
 		}
 	  buffer_w=w;
 	  buffer_h=h;
@@ -582,14 +582,6 @@ SOURCE=.\rlib.cpp
 # End Source File
 # Begin Source File
 
-SOURCE=.\TIMING.C
-# End Source File
-# Begin Source File
-
-SOURCE=.\TIMING.H
-# End Source File
-# Begin Source File
-
 SOURCE=.\undo.cpp
 # End Source File
 # Begin Source File
@@ -29,7 +29,6 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 #include <windows.h>
 #include "render.h"
-#include "timing.h"
 #include "undo.h"
 
 #ifdef LASER
@@ -63,19 +62,22 @@ unsigned int const mmx_blend4_revn[2]={0xff00ff,0xff00ff};//{0x1000100,0x1000100
 int const mmx_blendadj_mask[2] = { 0xff00ff,0xff00ff};
 int const mmx_blend4_zero=0;
 
+void Render_InitBlendTable()
+{
+  int i,j;
+  for (j=0;j<256;j++)
+    for (i=0;i<256;i++)
+      g_blendtable[i][j] = (unsigned char)((i / 255.0) * (float)j);
+  BlendSIMD_Init(BLENDSIMD_AVX2);
+}
+
 void Render_Init(HINSTANCE hDllInstance)
 {
 #ifdef LASER
   laser_connect();
   g_laser_linelist=createLineList();
 #endif
-	timingInit();
-  {
-    int i,j;
-    for (j=0;j<256;j++)
-  	  for (i=0;i<256;i++)
-	  	  g_blendtable[i][j] = (unsigned char)((i / 255.0) * (float)j);
-  }
+  Render_InitBlendTable();
 
   g_render_library=new C_RLibrary();
   g_render_effects=new C_RenderListClass(1);
@@ -132,7 +134,6 @@ void Render_Quit(HINSTANCE hDllInstance)
   if (g_render_library) delete g_render_library;
   g_render_library=NULL;
 
-	timingPrint();
 #ifdef LASER
   if (g_laser_linelist) delete g_laser_linelist;
   g_laser_linelist=0;
@@ -32,6 +32,7 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "r_transition.h"
 #include "rlib.h"
 
+void Render_InitBlendTable();
 void Render_Init(HINSTANCE hDllInstance);
 void Render_Quit(HINSTANCE hDllInstance);
 
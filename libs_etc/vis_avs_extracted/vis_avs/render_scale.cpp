@@ -0,0 +1,249 @@
+/*
+  LICENSE
+  -------
+Copyright 2005 Nullsoft, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, 
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer. 
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution. 
+
+  * Neither the name of Nullsoft nor the names of its contributors may be used to 
+    endorse or promote products derived from this software without specific prior written permission. 
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include <windows.h>
+#include <math.h>
+#include "r_defs.h"
+#include "blend_simd.h"
+#include "fb_arena.h"
+#include "smp_pool.h"
+#include "profiler.h"
+#include "render_scale.h"
+
+#define RSCALE_ROWS_PER_TILE 32
+
+extern int g_config_smp_mt,g_config_smp;
+
+C_RenderScale::C_RenderScale()
+{
+  LARGE_INTEGER f;
+  QueryPerformanceFrequency(&f);
+  m_freq=(double)f.QuadPart/1000.0;
+  m_level=RSCALE_MAX_LEVEL;
+  m_fb[0]=m_fb[1]=NULL;
+  m_s=m_w=m_h=0;
+  m_out=NULL;
+  m_ow=m_oh=0;
+  m_active=0;
+  m_avg=0.0;
+  m_hold=0;
+  m_tab=NULL;
+  m_tab_sw=m_tab_sh=m_tab_dw=m_tab_dh=0;
+  m_rs_src=m_rs_dst=NULL;
+}
+
+C_RenderScale::~C_RenderScale()
+{
+  freeBuffers();
+  C_FBArena::free(m_tab);
+}
+
+void C_RenderScale::freeBuffers()
+{
+  C_FBArena::free(m_fb[0]);
+  C_FBArena::free(m_fb[1]);
+  m_fb[0]=m_fb[1]=NULL;
+  m_w=m_h=0;
+}
+
+void C_RenderScale::scaledSize(int w, int h, int level, int *rw, int *rh)
+{
+  // even sizes, some effects halve them
+  *rw=max((w*level/RSCALE_MAX_LEVEL)&~1,min(w,RSCALE_MIN_SIZE));
+  *rh=max((h*level/RSCALE_MAX_LEVEL)&~1,min(h,RSCALE_MIN_SIZE));
+}
+
+// new internal buffers, starting out as the last image
+void C_RenderScale::setSize(int w, int h)
+{
+  int *nfb[2];
+  nfb[0]=(int*)C_FBArena::alloc(w*h*sizeof(int),"Render scale",0);
+  nfb[1]=(int*)C_FBArena::alloc(w*h*sizeof(int),"Render scale");
+  if (!nfb[0] || !nfb[1])
+  {
+    C_FBArena::free(nfb[0]);
+    C_FBArena::free(nfb[1]);
+    freeBuffers();
+    return;
+  }
+  if (m_fb[0]) resample(m_fb[m_s],m_w,m_h,nfb[0],w,h);
+  else resample(m_out,m_ow,m_oh,nfb[0],w,h);
+  freeBuffers();
+  m_fb[0]=nfb[0];
+  m_fb[1]=nfb[1];
+  m_s=0;
+  m_w=w;
+  m_h=h;
+}
+
+void C_RenderScale::begin(int targetfps, int **fb, int **fbout, int *w, int *h)
+{
+  QueryPerformanceCounter(&m_start);
+  m_out=*fb;
+  m_ow=*w;
+  m_oh=*h;
+  m_active=0;
+
+  if (targetfps <= 0)
+  {
+    m_level=RSCALE_MAX_LEVEL;
+    m_avg=0.0;
+    m_hold=0;
+    if (m_fb[0]) freeBuffers();
+    return;
+  }
+
+  if (m_hold > 0) m_hold--;
+  else if (m_avg > 0.0)
+  {
+    // render time goes with the pixel count, ie. the square of the level
+    double target=1000.0/targetfps*0.85;
+    int level=m_level;
+    if (m_avg > target) level=(int)(m_level*sqrt(target/m_avg));
+    else if (m_avg*(m_level+1)*(m_level+1) < target*0.9*m_level*m_level) level=m_level+1; // and still fits
+    level=min(max(level,RSCALE_MIN_LEVEL),RSCALE_MAX_LEVEL);
+    if (level != m_level)
+    {
+      m_avg*=(double)(level*level)/(double)(m_level*m_level);
+      m_level=level;
+      m_hold=RSCALE_HOLD_FRAMES;
+    }
+  }
+
+  if (m_level >= RSCALE_MAX_LEVEL)
+  {
+    if (m_fb[0]) freeBuffers(); // the last upscaled image is already in fb
+    return;
+  }
+
+  int rw, rh;
+  scaledSize(m_ow,m_oh,m_level,&rw,&rh);
+  if (rw == m_ow && rh == m_oh)
+  {
+    if (m_fb[0]) freeBuffers();
+    return;
+  }
+  if (rw != m_w || rh != m_h) setSize(rw,rh);
+  if (!m_fb[0]) return; // out of memory, render at full size
+
+  m_active=1;
+  *fb=m_fb[m_s];
+  *fbout=m_fb[m_s^1];
+  *w=m_w;
+  *h=m_h;
+}
+
+int C_RenderScale::end(int t)
+{
+  int ret=t&1;
+  if (m_active)
+  {
+    C_ProfileScope prof("Upscale");
+    m_s^=t&1;
+    resample(m_fb[m_s],m_w,m_h,m_out,m_ow,m_oh);
+    ret=0;
+  }
+
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+  double ms=(double)(now.QuadPart-m_start.QuadPart)/m_freq;
+  m_avg=m_avg > 0.0 ? m_avg*0.9+ms*0.1 : ms;
+  return ret;
+}
+
+void C_RenderScale::rowProc(void *ctx, int tile, int ntiles)
+{
+  C_RenderScale *_this=(C_RenderScale *)ctx;
+  int sw=_this->m_tab_sw, sh=_this->m_tab_sh, dw=_this->m_tab_dw, dh=_this->m_tab_dh;
+  int step=(int)(((__int64)sh<<16)/dh);
+  int y=tile*RSCALE_ROWS_PER_TILE, ye=min(y+RSCALE_ROWS_PER_TILE,dh);
+  int *dst=_this->m_rs_dst+y*dw;
+  for (; y < ye; y ++, dst += dw)
+  {
+    // sample centres line up, the last row and column blend (almost) nothing in
+    int fy=max(y*step+step/2-32768,0);
+    int y0=fy>>16, yf=(fy>>11)&31;
+    if (y0 >= sh-1)
+    {
+      y0=sh-2;
+      yf=31;
+    }
+    g_blendsimd.bilinear_tab(dst,_this->m_rs_src+y0*sw,sw,_this->m_tab+yf*dw,dw);
+  }
+}
+
+void C_RenderScale::resample(int *src, int sw, int sh, int *dst, int dw, int dh)
+{
+  if (sw < 2 || sh < 2)
+  {
+    int x;
+    for (x = 0; x < dw*dh; x ++) dst[x]=src[0];
+    return;
+  }
+
+  if (sw != m_tab_sw || sh != m_tab_sh || dw != m_tab_dw || dh != m_tab_dh)
+  {
+    C_FBArena::free(m_tab);
+    m_tab=(int*)C_FBArena::alloc(32*dw*sizeof(int),"Render scale",0);
+    m_tab_sw=m_tab_sh=m_tab_dw=m_tab_dh=0;
+    if (!m_tab) return;
+
+    int step=(int)(((__int64)sw<<16)/dw);
+    int x, yf;
+    for (x = 0; x < dw; x ++)
+    {
+      int fx=max(x*step+step/2-32768,0);
+      int x0=fx>>16, xf=(fx>>11)&31;
+      if (x0 >= sw-1)
+      {
+        x0=sw-2;
+        xf=31;
+      }
+      m_tab[x]=x0|(int)((unsigned int)xf<<27);
+    }
+    for (yf = 1; yf < 32; yf ++)
+    {
+      int *t=m_tab+yf*dw;
+      for (x = 0; x < dw; x ++) t[x]=m_tab[x]|(yf<<22);
+    }
+    m_tab_sw=sw;
+    m_tab_sh=sh;
+    m_tab_dw=dw;
+    m_tab_dh=dh;
+  }
+
+  // the output rows are independent, and at 4k there's a lot of them. as
+  // many threads as the SMP effects get, none if SMP is off
+  int nthreads=g_config_smp ? g_config_smp_mt : 0;
+  if (nthreads > SMP_POOL_MAX_THREADS) nthreads=SMP_POOL_MAX_THREADS;
+  if (nthreads < 2) nthreads=1;
+  m_rs_src=src;
+  m_rs_dst=dst;
+  C_SmpPool::run(nthreads,(dh+RSCALE_ROWS_PER_TILE-1)/RSCALE_ROWS_PER_TILE,rowProc,this);
+}
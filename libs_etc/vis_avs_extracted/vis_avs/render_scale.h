@@ -0,0 +1,103 @@
+/*
+  LICENSE
+  -------
+Copyright 2005 Nullsoft, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, 
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer. 
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution. 
+
+  * Neither the name of Nullsoft nor the names of its contributors may be used to 
+    endorse or promote products derived from this software without specific prior written permission. 
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef _RENDER_SCALE_H_
+#define _RENDER_SCALE_H_
+
+// Dynamic render resolution.
+//
+// When a target frame rate is set, the preset is rendered into a pair of
+// buffers of its own at some fraction of the output size, and the result is
+// scaled up into the output with the bilinear kernel from blend_simd. The
+// fraction (in 1/16ths of either dimension) follows the measured render
+// time: it drops as soon as frames take too long and creeps back up while
+// there's plenty of time left. At 16/16 frames go straight to the output
+// like before.
+//
+// Changing the size costs the effects a reallocation, and some of them
+// their state, so it happens at most once every RSCALE_HOLD_FRAMES frames.
+// The last image is resampled into the new buffers so feedback presets
+// carry on from it.
+
+#define RSCALE_MIN_LEVEL 4 // quarter width and height
+#define RSCALE_MAX_LEVEL 16
+#define RSCALE_HOLD_FRAMES 30
+#define RSCALE_MIN_SIZE 16
+
+class C_RenderScale
+{
+  public:
+    C_RenderScale();
+    ~C_RenderScale();
+
+    // call before rendering a frame of w*h from fb into fbout. targetfps=0
+    // turns scaling off. when scaling, fb/fbout are replaced by the internal
+    // buffers and w/h by their size.
+    void begin(int targetfps, int **fb, int **fbout, int *w, int *h);
+
+    // call after rendering, with what render() returned. scales the result
+    // back into fb (as it was given to begin()) if need be. returns nonzero
+    // if the caller should swap its buffers, like t&1 did.
+    int end(int t);
+
+    // nearest size to w*h*level/16 that effects are happy with
+    static void scaledSize(int w, int h, int level, int *rw, int *rh);
+
+    // bilinear resample of a sw*sh image into dw*dh, any ratio
+    void resample(int *src, int sw, int sh, int *dst, int dw, int dh);
+
+  protected:
+    void setSize(int w, int h);
+    void freeBuffers();
+    static void rowProc(void *ctx, int tile, int ntiles);
+
+    int m_level;
+    int *m_fb[2]; // internal buffers, m_fb[m_s] holds the last frame
+    int m_s, m_w, m_h;
+
+    int *m_out; // this frame's output, between begin() and end()
+    int m_ow, m_oh;
+    int m_active;
+
+    // timing, in ms
+    LARGE_INTEGER m_start;
+    double m_freq;
+    double m_avg;
+    int m_hold;
+
+    // per output row tables for g_blendsimd.bilinear_tab(), one for each of
+    // the 32 vertical fractions, for the sizes below
+    int *m_tab;
+    int m_tab_sw, m_tab_sh, m_tab_dw, m_tab_dh;
+
+    // the resample in progress, for rowProc()
+    int *m_rs_src, *m_rs_dst;
+};
+
+#endif//_RENDER_SCALE_H_
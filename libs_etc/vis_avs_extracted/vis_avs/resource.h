@@ -642,6 +642,16 @@
 #define IDC_THREADSBORDER               1209
 #define IDC_STATIC1                     1210
 #define IDC_STATIC2                     1211
+#define IDC_ADAPTIVE                    1212
+#define IDC_EDIT_ADAPTERR               1213
+#define IDC_COMPRESS                    1214
+#define IDC_BUDGET                      1215
+#define IDC_RENDERSCALE                 1216
+#define IDC_RENDERSCALE_FPS             1217
+#define IDC_RENDERSCALE_LABEL           1218
+#define IDC_RENDERSCALEBORDER           1219
+#define IDC_PROFILE                     1220
+#define IDC_PROFILE_TRACE               1221
 #define IDM_DISPLAY                     40001
 #define IDM_PRESETS                     40002
 #define IDM_TRANS                       40003
@@ -659,7 +669,7 @@
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NEXT_RESOURCE_VALUE        230
 #define _APS_NEXT_COMMAND_VALUE         40011
-#define _APS_NEXT_CONTROL_VALUE         1212
+#define _APS_NEXT_CONTROL_VALUE         1222
 #define _APS_NEXT_SYMED_VALUE           101
 #endif
 #endif
@@ -32,6 +32,7 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "r_unkn.h"
 #include "r_list.h"
 #include "rlib.h"
+#include "fb_arena.h"
 
 #include "ape.h"
 
@@ -109,55 +110,60 @@ void C_RLibrary::add_dofx(void *rf, int has_r2)
 // declarations for built-in effects
 #define DECLARE_EFFECT(name) extern C_RBASE *(name)(char *desc); add_dofx((void*)name,0);
 #define DECLARE_EFFECT2(name) extern C_RBASE *(name)(char *desc); add_dofx((void*)name,1);
+// effects that only ever touch their own state and framebuffer: no EEL code,
+// no global buffers, no line mode, no statics written while rendering.
+// lists of nothing else may render alongside each other, see IsIsolated()
+#define DECLARE_EFFECT_ISOLATED(name) DECLARE_EFFECT(name) RetrFuncs[NumRetrFuncs-1].isolated=1;
+#define DECLARE_EFFECT2_ISOLATED(name) DECLARE_EFFECT2(name) RetrFuncs[NumRetrFuncs-1].isolated=1;
 
 void C_RLibrary::initfx(void)
 {
-  DECLARE_EFFECT(R_SimpleSpectrum);
-  DECLARE_EFFECT(R_DotPlane);
-  DECLARE_EFFECT(R_OscStars);
-  DECLARE_EFFECT(R_FadeOut);
-  DECLARE_EFFECT(R_BlitterFB);
-  DECLARE_EFFECT(R_NFClear);
-  DECLARE_EFFECT2(R_Blur);
-  DECLARE_EFFECT(R_BSpin);
-  DECLARE_EFFECT(R_Parts);
-  DECLARE_EFFECT(R_RotBlit);
+  DECLARE_EFFECT_ISOLATED(R_SimpleSpectrum);
+  DECLARE_EFFECT_ISOLATED(R_DotPlane);
+  DECLARE_EFFECT_ISOLATED(R_OscStars);
+  DECLARE_EFFECT_ISOLATED(R_FadeOut);
+  DECLARE_EFFECT_ISOLATED(R_BlitterFB);
+  DECLARE_EFFECT_ISOLATED(R_NFClear);
+  DECLARE_EFFECT2_ISOLATED(R_Blur);
+  DECLARE_EFFECT_ISOLATED(R_BSpin);
+  DECLARE_EFFECT_ISOLATED(R_Parts);
+  DECLARE_EFFECT_ISOLATED(R_RotBlit);
   DECLARE_EFFECT(R_SVP);
-  DECLARE_EFFECT2(R_ColorFade);
-  DECLARE_EFFECT(R_ContrastEnhance);
-  DECLARE_EFFECT(R_RotStar);
-  DECLARE_EFFECT(R_OscRings);
+  DECLARE_EFFECT2_ISOLATED(R_ColorFade);
+  DECLARE_EFFECT_ISOLATED(R_ContrastEnhance);
+  DECLARE_EFFECT_ISOLATED(R_RotStar);
+  DECLARE_EFFECT_ISOLATED(R_OscRings);
   DECLARE_EFFECT2(R_Trans);
-  DECLARE_EFFECT(R_Scat);
-  DECLARE_EFFECT(R_DotGrid);
+  DECLARE_EFFECT_ISOLATED(R_Scat);
+  DECLARE_EFFECT_ISOLATED(R_DotGrid);
   DECLARE_EFFECT(R_Stack);
-  DECLARE_EFFECT(R_DotFountain);
-  DECLARE_EFFECT2(R_Water);
-  DECLARE_EFFECT(R_Comment);
-  DECLARE_EFFECT2(R_Brightness);
-  DECLARE_EFFECT(R_Interleave);
-  DECLARE_EFFECT(R_Grain);
-  DECLARE_EFFECT(R_Clear);
+  DECLARE_EFFECT_ISOLATED(R_DotFountain);
+  DECLARE_EFFECT2_ISOLATED(R_Water);
+  DECLARE_EFFECT_ISOLATED(R_Comment);
+  DECLARE_EFFECT2_ISOLATED(R_Brightness);
+  DECLARE_EFFECT_ISOLATED(R_Interleave);
+  DECLARE_EFFECT_ISOLATED(R_Grain);
+  DECLARE_EFFECT_ISOLATED(R_Clear);
   DECLARE_EFFECT(R_Mirror);
-  DECLARE_EFFECT(R_StarField);
+  DECLARE_EFFECT_ISOLATED(R_StarField);
   DECLARE_EFFECT(R_Text);
   DECLARE_EFFECT(R_Bump);
-  DECLARE_EFFECT(R_Mosaic);
-  DECLARE_EFFECT(R_WaterBump);
+  DECLARE_EFFECT_ISOLATED(R_Mosaic);
+  DECLARE_EFFECT_ISOLATED(R_WaterBump);
   DECLARE_EFFECT(R_AVI);
-  DECLARE_EFFECT(R_Bpm);
-  DECLARE_EFFECT(R_Picture);
+  DECLARE_EFFECT_ISOLATED(R_Bpm);
+  DECLARE_EFFECT_ISOLATED(R_Picture);
   DECLARE_EFFECT(R_DDM);
   DECLARE_EFFECT(R_SScope);
-  DECLARE_EFFECT(R_Invert);
-  DECLARE_EFFECT(R_Onetone);
-  DECLARE_EFFECT(R_Timescope);
+  DECLARE_EFFECT2_ISOLATED(R_Invert);
+  DECLARE_EFFECT2_ISOLATED(R_Onetone);
+  DECLARE_EFFECT_ISOLATED(R_Timescope);
   DECLARE_EFFECT(R_LineMode);
-  DECLARE_EFFECT(R_Interferences);
+  DECLARE_EFFECT_ISOLATED(R_Interferences);
   DECLARE_EFFECT(R_Shift);
   DECLARE_EFFECT2(R_DMove);
-  DECLARE_EFFECT(R_FastBright);
-  DECLARE_EFFECT(R_DColorMod);  
+  DECLARE_EFFECT2_ISOLATED(R_FastBright);
+  DECLARE_EFFECT2(R_DColorMod);  
 }
 
 static const struct 
@@ -184,6 +190,7 @@ void C_RLibrary::initbuiltinape(void)
 {
 #define ADD(sym) extern C_RBASE * sym(char *desc); _add_dll(0,sym,"Builtin_" #sym, 0)  
 #define ADD2(sym,name) extern C_RBASE * sym(char *desc); _add_dll(0,sym,name, 0)  
+#define ADD3(sym,name) extern C_RBASE * sym(char *desc); _add_dll(0,sym,name, 1) // C_RBASE2
 #ifdef LASER
   ADD(RLASER_Cone);
   ADD(RLASER_BeatHold);
@@ -191,14 +198,15 @@ void C_RLibrary::initbuiltinape(void)
   ADD(RLASER_Bren); // not including it for now
   ADD(RLASER_Transform);
 #else
-  ADD2(R_ChannelShift,"Channel Shift");
-  ADD2(R_ColorReduction,"Color Reduction");
+  ADD3(R_ChannelShift,"Channel Shift");
+  ADD3(R_ColorReduction,"Color Reduction");
   ADD2(R_Multiplier,"Multiplier");
   ADD2(R_VideoDelay,"Holden04: Video Delay");
   ADD2(R_MultiDelay,"Holden05: Multi Delay");
 #endif
 #undef ADD
 #undef ADD2
+#undef ADD3
 }
 
 
@@ -309,6 +317,11 @@ void C_RLibrary::initdll()
 }
 
 
+int C_RLibrary::IsIsolated(int which)
+{
+  return which >= 0 && which < NumRetrFuncs && RetrFuncs[which].isolated;
+}
+
 int C_RLibrary::GetRendererDesc(int which, char *str)
 {
   *str=0;
@@ -354,6 +367,8 @@ C_RBASE *C_RLibrary::CreateRenderer(int *which, int *has_r2)
         if (!strncmp(p,DLLFuncs[x].idstring,32))
         {
           *which=(int)DLLFuncs[x].idstring;
+          // only the built in ones, external APEs keep the render() path they always had
+          if (has_r2 && !DLLFuncs[x].hDllInstance) *has_r2 = DLLFuncs[x].is_r2;
           return DLLFuncs[x].createfunc(NULL);
         }
       }
@@ -439,12 +454,12 @@ void *getGlobalBuffer(int w, int h, int n, int do_alloc)
 
   if (!g_n_buffers[n] || g_n_buffers_w[n] != w || g_n_buffers_h[n] != h)
   {
-    if (g_n_buffers[n]) GlobalFree(g_n_buffers[n]);
+    if (g_n_buffers[n]) C_FBArena::free(g_n_buffers[n]);
     if (do_alloc)
     {
       g_n_buffers_w[n]=w;
       g_n_buffers_h[n]=h;
-      return g_n_buffers[n]=GlobalAlloc(GPTR,sizeof(int)*w*h);
+      return g_n_buffers[n]=C_FBArena::alloc(sizeof(int)*w*h,"Global buffers");
     }
 
     g_n_buffers[n]=NULL;
@@ -456,3 +471,15 @@ void *getGlobalBuffer(int w, int h, int n, int do_alloc)
   return g_n_buffers[n];
 }
 
+void freeGlobalBuffers()
+{
+  int n;
+  for (n = 0; n < NBUF; n ++)
+  {
+    if (g_n_buffers[n]) C_FBArena::free(g_n_buffers[n]);
+    g_n_buffers[n]=NULL;
+    g_n_buffers_w[n]=0;
+    g_n_buffers_h[n]=0;
+  }
+}
+
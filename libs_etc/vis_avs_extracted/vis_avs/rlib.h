@@ -38,6 +38,7 @@ class C_RLibrary {
     {
       C_RBASE *(*rf)(char *desc);
       int is_r2;
+      int isolated;
     } rfStruct;
     rfStruct *RetrFuncs;
 
@@ -65,6 +66,7 @@ class C_RLibrary {
     ~C_RLibrary();
     C_RBASE *CreateRenderer(int *which, int *has_r2);
     HINSTANCE GetRendererInstance(int which,HINSTANCE hThisInstance);
+    int IsIsolated(int which); // 1 for built-in effects that share nothing with other effects
     int GetRendererDesc(int which, char *str); 
        // if which is >= DLLRENDERBASE
        // returns "id" of DLL. which is used to enumerate. str is desc
@@ -0,0 +1,88 @@
+/*
+  LICENSE
+  -------
+Copyright 2005 Nullsoft, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, 
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer. 
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution. 
+
+  * Neither the name of Nullsoft nor the names of its contributors may be used to 
+    endorse or promote products derived from this software without specific prior written permission. 
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include <windows.h>
+#include "rng.h"
+#include "../ns-eel2/ns-eel.h"
+
+static volatile LONG g_rng_seed, g_rng_count;
+
+// murmur3's finalizer: neighbouring seeds give unrelated states
+static unsigned int rng_mix(unsigned int x)
+{
+  x^=x>>16;
+  x*=0x85ebca6b;
+  x^=x>>13;
+  x*=0xc2b2ae35;
+  x^=x>>16;
+  return x;
+}
+
+void C_Rng::setGlobalSeed(unsigned int seed)
+{
+  InterlockedExchange(&g_rng_seed,(LONG)seed);
+  InterlockedExchange(&g_rng_count,0);
+  NSEEL_rand_seed(rng_mix(seed)); // and the rand() of EEL code
+}
+
+// effects get created on the render thread, the preset loader and the
+// prefetcher at once, hence the interlocked count
+void C_Rng::reseed()
+{
+  unsigned int n=(unsigned int)InterlockedIncrement(&g_rng_count);
+  setSeed((unsigned int)g_rng_seed+n*0x9e3779b9);
+}
+
+void C_Rng::setSeed(unsigned int seed)
+{
+  int x;
+  for (x = 0; x < 4; x ++)
+  {
+    seed+=0x9e3779b9;
+    m_s[x]=rng_mix(seed);
+  }
+  if (!(m_s[0]|m_s[1]|m_s[2]|m_s[3])) m_s[0]=1; // the one state it can't leave
+}
+
+void C_Rng::fill(void *buf, int bytes)
+{
+  unsigned char *p=(unsigned char *)buf;
+  while (bytes >= 4)
+  {
+    unsigned int v=next();
+    memcpy(p,&v,4);
+    p+=4;
+    bytes-=4;
+  }
+  if (bytes > 0)
+  {
+    unsigned int v=next();
+    memcpy(p,&v,bytes);
+  }
+}
@@ -0,0 +1,83 @@
+/*
+  LICENSE
+  -------
+Copyright 2005 Nullsoft, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, 
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer. 
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution. 
+
+  * Neither the name of Nullsoft nor the names of its contributors may be used to 
+    endorse or promote products derived from this software without specific prior written permission. 
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef _RNG_H_
+#define _RNG_H_
+
+// Random numbers for effects, in place of rand().
+//
+// C_Rng is xoshiro128** (Blackman/Vigna): four words of state, a few adds,
+// shifts and one multiply per 32 bits, all bits usable. There is no shared
+// state and no lock, so every effect (or every worker thread of one) owns
+// its own generator instead of contending on the CRT's.
+//
+// A default constructed generator takes the next seed of a global sequence
+// started by setGlobalSeed(). Loading the same preset after the same
+// setGlobalSeed() gives every effect the same numbers again, which is what
+// makes benchmark runs repeatable frame for frame. It also reseeds rand() of
+// the EEL VMs allocated after it (NSEEL_rand_seed()).
+
+class C_Rng
+{
+  public:
+    C_Rng() { reseed(); }
+    C_Rng(unsigned int seed) { setSeed(seed); }
+
+    static void setGlobalSeed(unsigned int seed); // restarts the sequence reseed() draws from
+    void reseed();
+    void setSeed(unsigned int seed);
+
+    unsigned int next()
+    {
+      unsigned int r=rotl(m_s[1]*5,7)*9;
+      unsigned int t=m_s[1]<<9;
+      m_s[2]^=m_s[0];
+      m_s[3]^=m_s[1];
+      m_s[1]^=m_s[2];
+      m_s[0]^=m_s[3];
+      m_s[2]^=t;
+      m_s[3]=rotl(m_s[3],11);
+      return r;
+    }
+
+    // 0..n-1 without a divide (and without rand()%n's bias). 0 if n < 1.
+    int below(int n)
+    {
+      if (n < 1) return 0;
+      return (int)(((unsigned __int64)next()*(unsigned int)n)>>32);
+    }
+
+    void fill(void *buf, int bytes);
+
+  protected:
+    static unsigned int rotl(unsigned int x, int k) { return (x<<k)|(x>>(32-k)); }
+    unsigned int m_s[4];
+};
+
+#endif//_RNG_H_
@@ -0,0 +1,179 @@
+/*
+  LICENSE
+  -------
+Copyright 2005 Nullsoft, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, 
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer. 
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution. 
+
+  * Neither the name of Nullsoft nor the names of its contributors may be used to 
+    endorse or promote products derived from this software without specific prior written permission. 
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include <windows.h>
+#include "smp_pool.h"
+
+#define SMP_POOL_SPINS 4000
+
+volatile LONG C_SmpPool::m_ranges[SMP_POOL_MAX_THREADS];
+volatile LONG C_SmpPool::m_nextslot;
+volatile LONG C_SmpPool::m_pending;
+volatile LONG C_SmpPool::m_busy;
+int C_SmpPool::m_nslots;
+int C_SmpPool::m_ntiles;
+SmpPoolTileProc C_SmpPool::m_proc;
+void *C_SmpPool::m_ctx;
+HANDLE C_SmpPool::m_threads[SMP_POOL_MAX_THREADS];
+int C_SmpPool::m_nthreads;
+HANDLE C_SmpPool::m_hStart, C_SmpPool::m_hDone, C_SmpPool::m_hQuit;
+
+int C_SmpPool::pop(int slot)
+{
+  for (;;)
+  {
+    LONG r=m_ranges[slot];
+    int head=((unsigned int)r)>>16, tail=r&0xffff;
+    if (head >= tail) return -1;
+    if (InterlockedCompareExchange(&m_ranges[slot],((head+1)<<16)|tail,r) == r) return head;
+  }
+}
+
+int C_SmpPool::steal(int slot)
+{
+  int x;
+  for (x = 1; x < m_nslots; x ++)
+  {
+    int victim=(slot+x)%m_nslots;
+    for (;;)
+    {
+      LONG r=m_ranges[victim];
+      int head=((unsigned int)r)>>16, tail=r&0xffff;
+      if (head >= tail) break;
+      if (InterlockedCompareExchange(&m_ranges[victim],(head<<16)|(tail-1),r) == r) return tail-1;
+    }
+  }
+  return -1;
+}
+
+void C_SmpPool::work(int slot)
+{
+  // tiles are never added during a job, so once nothing is left to steal
+  // this participant is done.
+  for (;;)
+  {
+    int t=pop(slot);
+    if (t < 0) t=steal(slot);
+    if (t < 0) return;
+    m_proc(m_ctx,t,m_ntiles);
+  }
+}
+
+DWORD WINAPI C_SmpPool::threadProc(LPVOID parm)
+{
+  HANDLE hdls[2]={m_hQuit,m_hStart};
+  for (;;)
+  {
+    if (WaitForMultipleObjects(2,hdls,FALSE,INFINITE) != WAIT_OBJECT_0 + 1) return 0;
+
+    work(InterlockedIncrement(&m_nextslot));
+
+    if (!InterlockedDecrement(&m_pending)) SetEvent(m_hDone);
+  }
+}
+
+void C_SmpPool::run(int nthreads, int ntiles, SmpPoolTileProc proc, void *ctx)
+{
+  int x, own=0;
+  if (ntiles < 1) return;
+  if (ntiles > SMP_POOL_MAX_TILES) ntiles=SMP_POOL_MAX_TILES;
+  if (nthreads > SMP_POOL_MAX_THREADS) nthreads=SMP_POOL_MAX_THREADS;
+  if (nthreads > ntiles) nthreads=ntiles;
+  if (nthreads > 1)
+  {
+    if (InterlockedCompareExchange(&m_busy,1,0)) nthreads=1;
+    else own=1;
+  }
+
+  if (nthreads > 1 && !m_hStart)
+  {
+    m_hStart=CreateSemaphore(NULL,0,SMP_POOL_MAX_THREADS,NULL);
+    m_hDone=CreateEvent(NULL,FALSE,FALSE,NULL);
+    m_hQuit=CreateEvent(NULL,TRUE,FALSE,NULL);
+  }
+  while (m_nthreads < nthreads-1)
+  {
+    DWORD id;
+    HANDLE h=m_hStart ? CreateThread(NULL,0,threadProc,NULL,0,&id) : NULL;
+    if (!h) break;
+    m_threads[m_nthreads++]=h;
+  }
+  if (nthreads > m_nthreads+1) nthreads=m_nthreads+1;
+
+  if (nthreads < 2)
+  {
+    if (own) InterlockedExchange(&m_busy,0);
+    for (x = 0; x < ntiles; x ++) proc(ctx,x,ntiles);
+    return;
+  }
+
+  m_proc=proc;
+  m_ctx=ctx;
+  m_ntiles=ntiles;
+  m_nslots=nthreads;
+  for (x = 0; x < nthreads; x ++)
+  {
+    int head=(x*ntiles)/nthreads;
+    int tail=((x+1)*ntiles)/nthreads;
+    m_ranges[x]=(head<<16)|tail;
+  }
+  m_nextslot=0;
+  m_pending=nthreads-1;
+
+  // one release wakes exactly the workers we need, slot 0 is ours
+  ReleaseSemaphore(m_hStart,nthreads-1,NULL);
+  work(0);
+
+  // wait for every worker that was woken to leave the job, so none of them
+  // can see the next job's parameters half written. m_hDone may be left
+  // signalled by the previous job, hence the recheck.
+  int spins=0;
+  while (m_pending > 0)
+  {
+    if (spins < SMP_POOL_SPINS) { spins++; YieldProcessor(); }
+    else WaitForSingleObject(m_hDone,INFINITE);
+  }
+  InterlockedExchange(&m_busy,0);
+}
+
+void C_SmpPool::shutdown()
+{
+  int x;
+  if (m_nthreads > 0)
+  {
+    SetEvent(m_hQuit);
+    WaitForMultipleObjects(m_nthreads,m_threads,TRUE,INFINITE);
+    for (x = 0; x < m_nthreads; x ++) CloseHandle(m_threads[x]);
+  }
+  if (m_hStart) CloseHandle(m_hStart);
+  if (m_hDone) CloseHandle(m_hDone);
+  if (m_hQuit) CloseHandle(m_hQuit);
+  m_hStart=m_hDone=m_hQuit=NULL;
+  m_nthreads=0;
+}
@@ -0,0 +1,84 @@
+/*
+  LICENSE
+  -------
+Copyright 2005 Nullsoft, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, 
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer. 
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution. 
+
+  * Neither the name of Nullsoft nor the names of its contributors may be used to 
+    endorse or promote products derived from this software without specific prior written permission. 
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef _SMP_POOL_H_
+#define _SMP_POOL_H_
+
+// Persistent work-stealing thread pool.
+//
+// Workers are created on first use and then sleep on a semaphore between
+// jobs. A job is a set of tiles numbered 0..ntiles-1. Each participant
+// (the calling thread plus the workers that were woken) starts out owning
+// a contiguous run of tiles and takes them from the front. Once its own
+// run is empty it steals from the back of the others. run() returns once
+// every tile has been processed.
+//
+// Only one job runs at a time. A run() made while another is in progress
+// (from a tile, or from a thread that renders a preset off the render
+// thread) does its tiles on the calling thread.
+
+#define SMP_POOL_MAX_THREADS 8   // including the calling thread
+#define SMP_POOL_MAX_TILES 1024
+
+typedef void (*SmpPoolTileProc)(void *ctx, int tile, int ntiles);
+
+class C_SmpPool
+{
+  public:
+    // runs proc(ctx,tile,ntiles) once for every tile in [0,ntiles), spread
+    // over nthreads threads (the caller counts as one of them).
+    static void run(int nthreads, int ntiles, SmpPoolTileProc proc, void *ctx);
+
+    // stops and frees the workers. safe to call when nothing was started.
+    static void shutdown();
+
+  protected:
+    static void work(int slot);
+    static int pop(int slot);
+    static int steal(int slot);
+    static DWORD WINAPI threadProc(LPVOID parm);
+
+    // [head,tail) packed as head<<16|tail, updated with one CAS so owner
+    // and thieves can never hand out the same tile twice.
+    static volatile LONG m_ranges[SMP_POOL_MAX_THREADS];
+    static volatile LONG m_nextslot;
+    static volatile LONG m_pending;
+    static volatile LONG m_busy;
+
+    static int m_nslots;
+    static int m_ntiles;
+    static SmpPoolTileProc m_proc;
+    static void *m_ctx;
+
+    static HANDLE m_threads[SMP_POOL_MAX_THREADS];
+    static int m_nthreads;
+    static HANDLE m_hStart, m_hDone, m_hQuit;
+};
+
+#endif//_SMP_POOL_H_
@@ -28,11 +28,15 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 */
 #include <windows.h>
+#include <stdlib.h>
 #include "undo.h"
 #include "render.h"
 
-int C_UndoStack::list_pos;
-C_UndoItem *C_UndoStack::list[256];
+C_UndoItem *C_UndoStack::cur;
+C_UndoDelta **C_UndoStack::steps;
+bool *C_UndoStack::dirty;
+int C_UndoStack::list_pos, C_UndoStack::num_states, C_UndoStack::max_states;
+int C_UndoStack::step_bytes;
 
 C_UndoItem::C_UndoItem() : data(NULL), length(0), isdirty(true)
 {
@@ -43,7 +47,7 @@ C_UndoItem::C_UndoItem(const C_UndoItem& T) : data(NULL), length(0), isdirty(tru
   *this = T;
 }
 
-C_UndoItem::C_UndoItem(void *_data, int _length, bool _isdirty) : data(NULL), length(length), isdirty(_isdirty)
+C_UndoItem::C_UndoItem(void *_data, int _length, bool _isdirty) : data(NULL), length(_length), isdirty(_isdirty)
 {
   data = GlobalAlloc(GPTR, length);
   memcpy(data, _data, length);
@@ -93,85 +97,188 @@ void C_UndoItem::set(void *_data, int _length, bool _isdirty)
 }
 
 
+// one step of the history. an edit in the editor changes one effect's config,
+// so two neighbouring states only differ somewhere in the middle: keep the
+// bytes they share at either end as counts, and what's between in both
+// versions, which lets the same step go either way.
+class C_UndoDelta
+{
+  public:
+    static int make(const C_UndoItem &from, const C_UndoItem &to, C_UndoDelta **d); // 0 if the same, -1 if out of memory
+    ~C_UndoDelta() { if (data) GlobalFree(data); }
+    int apply(C_UndoItem &item, int forward) const; // 0 on success, item is left alone otherwise
+    int bytes() const { return sizeof(*this)+oldlen+newlen; }
+
+  private:
+    C_UndoDelta() : data(NULL) { }
+    int prefix, suffix; // bytes both states share at the start and at the end
+    int oldlen, newlen; // bytes between them in the older and the newer state
+    unsigned char *data; // oldlen bytes then newlen bytes
+};
+
+int C_UndoDelta::make(const C_UndoItem &from, const C_UndoItem &to, C_UndoDelta **d)
+{
+  const unsigned char *a=(const unsigned char *)from.data, *b=(const unsigned char *)to.data;
+  int n=min(from.length,to.length);
+  int p=0, s=0;
+  while (p+4 <= n && *(const int *)(a+p) == *(const int *)(b+p)) p+=4;
+  while (p < n && a[p] == b[p]) p++;
+  if (p == from.length && p == to.length) return 0;
+  n-=p;
+  while (s < n && a[from.length-1-s] == b[to.length-1-s]) s++;
+
+  C_UndoDelta *r=new C_UndoDelta;
+  r->prefix=p;
+  r->suffix=s;
+  r->oldlen=from.length-p-s;
+  r->newlen=to.length-p-s;
+  r->data=(unsigned char *)GlobalAlloc(GMEM_FIXED,r->oldlen+r->newlen);
+  if (!r->data)
+  {
+    delete r;
+    return -1;
+  }
+  memcpy(r->data,a+p,r->oldlen);
+  memcpy(r->data+r->oldlen,b+p,r->newlen);
+  *d=r;
+  return 1;
+}
+
+int C_UndoDelta::apply(C_UndoItem &item, int forward) const
+{
+  int dellen=forward ? oldlen : newlen;
+  int inslen=forward ? newlen : oldlen;
+  const unsigned char *ins=forward ? data+oldlen : data;
+  if (item.length != prefix+dellen+suffix) return 1;
+
+  int length=prefix+inslen+suffix;
+  unsigned char *out=(unsigned char *)GlobalAlloc(GMEM_FIXED,length);
+  if (!out) return 1;
+  memcpy(out,item.data,prefix);
+  memcpy(out+prefix,ins,inslen);
+  memcpy(out+prefix+inslen,(unsigned char *)item.data+prefix+dellen,suffix);
+  if (item.data) GlobalFree(item.data);
+  item.data=out;
+  item.length=length;
+  return 0;
+}
+
+
 void C_UndoStack::saveundo(int is2)
 {
-  // Save to the undo buffer (sets the dirty bit for this item)
+  // Save to the undo buffer (every new state starts dirty)
   C_UndoItem *item = new C_UndoItem;
-  C_UndoItem *old = list[list_pos];
+  C_UndoDelta *d = NULL;
+
+  if ((is2 ? g_render_effects2 : g_render_effects)->__SavePresetToUndo(*item))
+  {
+    delete item;
+    return;
+  }
 
-  if (is2) 
+  // Only add it to the stack if it has changed.
+  if (cur && C_UndoDelta::make(*cur,*item,&d) <= 0)
   {
-    g_render_effects2->__SavePresetToUndo(*item);
+    delete item;
+    return;
   }
-  else 
+
+  // a new state replaces whatever could have been redone
+  int x;
+  for (x = list_pos; x < num_states-1; x ++)
   {
-    g_render_effects->__SavePresetToUndo(*item);
+    step_bytes-=steps[x]->bytes();
+    delete steps[x];
   }
+  if (cur) num_states=list_pos+1;
 
-  // Only add it to the stack if it has changed.
-  if (!old || !(*old == *item))
+  if (num_states+1 > max_states)
   {
-    if (list_pos == sizeof(list)/sizeof(list[0])-1)
+    int n=max(64,max_states*2);
+    C_UndoDelta **ns=(C_UndoDelta **)realloc(steps,n*sizeof(*steps));
+    if (ns) steps=ns;
+    bool *nd=ns ? (bool *)realloc(dirty,n*sizeof(*dirty)) : NULL;
+    if (nd) dirty=nd;
+    if (!ns || !nd)
     {
-      delete list[0];
-      memcpy(list,list+1,sizeof(list)/sizeof(list[0])-1);
-      list_pos--;
+      delete d;
+      delete item;
+      return;
     }
-    list[++list_pos]=item;
+    max_states=n;
+  }
+
+  if (cur)
+  {
+    steps[list_pos++]=d;
+    step_bytes+=d->bytes();
+    delete cur;
   }
-  else delete item;
+  else list_pos=0;
+  cur=item;
+  dirty[list_pos]=true;
+  num_states=list_pos+1;
+
+  // always keep the step just made, even if it's over budget by itself
+  while (step_bytes > UNDO_BUDGET && num_states > 2) dropoldest();
+}
+
+void C_UndoStack::dropoldest()
+{
+  step_bytes-=steps[0]->bytes();
+  delete steps[0];
+  memmove(steps,steps+1,(num_states-2)*sizeof(*steps));
+  memmove(dirty,dirty+1,(num_states-1)*sizeof(*dirty));
+  num_states--;
+  list_pos--;
 }
 
 void C_UndoStack::cleardirty()
 {
   // If we're clearing the dirty bit, we only clear it on the current item.
-  if (list_pos >= 0 && list_pos < sizeof(list)/sizeof(list[0]) && list[list_pos])
-  {
-    list[list_pos]->isdirty = 0;
-  }
+  if (cur) dirty[list_pos] = false;
 }
 
 bool C_UndoStack::isdirty()
 {
-  if (list_pos >= 0 && list_pos < sizeof(list)/sizeof(list[0]) && list[list_pos])
-    return list[list_pos]->isdirty;
-  return false;
+  return cur && dirty[list_pos];
 }
 
 int C_UndoStack::can_undo()
 {
-  return (list_pos>0 && list[list_pos-1]);
+  return cur && list_pos > 0;
 }
 
 int C_UndoStack::can_redo()
 {
-  return list_pos < sizeof(list)/sizeof(list[0])-1 && list[list_pos+1];
+  return cur && list_pos < num_states-1;
 }
 
 
 void C_UndoStack::undo()
 {
-  if (list_pos>0 && list[list_pos-1])
+  if (can_undo() && !steps[list_pos-1]->apply(*cur,0))
   {
-    g_render_transition->LoadPreset(NULL,0,list[--list_pos]);
+    list_pos--;
+    g_render_transition->LoadPreset(NULL,0,cur);
   }
 }
 
 void C_UndoStack::redo()
 {
-  if (list_pos < sizeof(list)/sizeof(list[0])-1 && list[list_pos+1])
+  if (can_redo() && !steps[list_pos]->apply(*cur,1))
   {
-    g_render_transition->LoadPreset(NULL,0,list[++list_pos]);
+    list_pos++;
+    g_render_transition->LoadPreset(NULL,0,cur);
   }
 }
 
 void C_UndoStack::clear()
 {
-  list_pos=0;
   int x;
-  for (x = 0; x < sizeof(list)/sizeof(list[0]); x ++)
-  {
-    delete list[x];
-    list[x]=0;
-  }
+  for (x = 0; x < num_states-1; x ++) delete steps[x];
+  delete cur;
+  cur=NULL;
+  list_pos=num_states=0;
+  step_bytes=0;
 }
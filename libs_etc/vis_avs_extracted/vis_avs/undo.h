@@ -31,10 +31,12 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define _UNDO_H_
 
 class C_UndoStack;
+class C_UndoDelta;
 
 class C_UndoItem
 {
   friend C_UndoStack;
+  friend C_UndoDelta;
   public:
     C_UndoItem();
     ~C_UndoItem();
@@ -54,6 +56,11 @@ class C_UndoItem
     bool isdirty;
 };
 
+// the history keeps the current state in full and, for every step, only the
+// bytes that changed between two neighbouring states (see C_UndoDelta in
+// undo.cpp), so going back or forward is one patch of the current state.
+#define UNDO_BUDGET (16*1024*1024) // bytes of deltas kept, oldest steps go first
+
 class C_UndoStack
 {
   public:
@@ -70,12 +77,13 @@ class C_UndoStack
     static void clear();
 
   private:
+    static void dropoldest();
 
-    // sorry to do this mig, but that doubly linked lists made me scared. I think it
-    // wasn't actually the source of my bug (I later fixed it), but doubly linked lists
-    // are just plain hard to get right. :)
-    static int list_pos;
-    static C_UndoItem *list[256]; // only keep 256 elements in list at a time
+    static C_UndoItem *cur; // the state at list_pos
+    static C_UndoDelta **steps; // steps[x] goes from state x to state x+1
+    static bool *dirty; // per state
+    static int list_pos, num_states, max_states;
+    static int step_bytes;
 };
 
 #endif//_UNDO_H_
\ No newline at end of file
@@ -56,7 +56,7 @@ BSC32=bscmake.exe
 # ADD BSC32 /nologo
 LINK32=link.exe
 # ADD BASE LINK32 kernel32.lib user32.lib gdi32.lib winspool.lib comdlg32.lib advapi32.lib shell32.lib ole32.lib oleaut32.lib uuid.lib odbc32.lib odbccp32.lib /nologo /dll /machine:I386
-# ADD LINK32 kernel32.lib user32.lib gdi32.lib winspool.lib comdlg32.lib advapi32.lib shell32.lib ole32.lib oleaut32.lib uuid.lib odbc32.lib odbccp32.lib ddraw.lib vfw32.lib /nologo /dll /map /machine:I386 /out:"c:\progra~1\winamp\plugins\vis_avs.dll"
+# ADD LINK32 kernel32.lib user32.lib gdi32.lib winspool.lib comdlg32.lib advapi32.lib shell32.lib ole32.lib oleaut32.lib uuid.lib odbc32.lib odbccp32.lib ddraw.lib vfw32.lib winmm.lib /nologo /dll /map /machine:I386 /out:"c:\progra~1\winamp\plugins\vis_avs.dll"
 # SUBTRACT LINK32 /debug
 
 !ELSEIF  "$(CFG)" == "vis_avs - Win32 Debug"
@@ -83,7 +83,7 @@ BSC32=bscmake.exe
 # ADD BSC32 /nologo
 LINK32=link.exe
 # ADD BASE LINK32 kernel32.lib user32.lib gdi32.lib winspool.lib comdlg32.lib advapi32.lib shell32.lib ole32.lib oleaut32.lib uuid.lib odbc32.lib odbccp32.lib /nologo /dll /debug /machine:I386 /pdbtype:sept
-# ADD LINK32 kernel32.lib user32.lib gdi32.lib winspool.lib comdlg32.lib advapi32.lib shell32.lib ole32.lib oleaut32.lib uuid.lib odbc32.lib odbccp32.lib ddraw.lib vfw32.lib /nologo /dll /debug /machine:I386 /out:"c:\progra~1\winamp\plugins\vis_avs.dll" /pdbtype:sept
+# ADD LINK32 kernel32.lib user32.lib gdi32.lib winspool.lib comdlg32.lib advapi32.lib shell32.lib ole32.lib oleaut32.lib uuid.lib odbc32.lib odbccp32.lib ddraw.lib vfw32.lib winmm.lib /nologo /dll /debug /machine:I386 /out:"c:\progra~1\winamp\plugins\vis_avs.dll" /pdbtype:sept
 
 !ELSEIF  "$(CFG)" == "vis_avs - Win32 Laser Release"
 
@@ -111,9 +111,9 @@ BSC32=bscmake.exe
 # ADD BASE BSC32 /nologo
 # ADD BSC32 /nologo
 LINK32=link.exe
-# ADD BASE LINK32 kernel32.lib user32.lib gdi32.lib winspool.lib comdlg32.lib advapi32.lib shell32.lib ole32.lib oleaut32.lib uuid.lib odbc32.lib odbccp32.lib ddraw.lib vfw32.lib /nologo /dll /machine:I386 /out:"c:\program files\winamp\plugins\vis_avs.dll"
+# ADD BASE LINK32 kernel32.lib user32.lib gdi32.lib winspool.lib comdlg32.lib advapi32.lib shell32.lib ole32.lib oleaut32.lib uuid.lib odbc32.lib odbccp32.lib ddraw.lib vfw32.lib winmm.lib /nologo /dll /machine:I386 /out:"c:\program files\winamp\plugins\vis_avs.dll"
 # SUBTRACT BASE LINK32 /debug
-# ADD LINK32 kernel32.lib user32.lib gdi32.lib winspool.lib comdlg32.lib advapi32.lib shell32.lib ole32.lib oleaut32.lib uuid.lib odbc32.lib odbccp32.lib ddraw.lib vfw32.lib /nologo /dll /machine:I386 /out:"c:\program files\winamp\plugins\vis_avs_laser.dll"
+# ADD LINK32 kernel32.lib user32.lib gdi32.lib winspool.lib comdlg32.lib advapi32.lib shell32.lib ole32.lib oleaut32.lib uuid.lib odbc32.lib odbccp32.lib ddraw.lib vfw32.lib winmm.lib /nologo /dll /machine:I386 /out:"c:\program files\winamp\plugins\vis_avs_laser.dll"
 # SUBTRACT LINK32 /debug
 
 !ELSEIF  "$(CFG)" == "vis_avs - Win32 NoMMX Release"
@@ -142,9 +142,9 @@ BSC32=bscmake.exe
 # ADD BASE BSC32 /nologo
 # ADD BSC32 /nologo
 LINK32=link.exe
-# ADD BASE LINK32 kernel32.lib user32.lib gdi32.lib winspool.lib comdlg32.lib advapi32.lib shell32.lib ole32.lib oleaut32.lib uuid.lib odbc32.lib odbccp32.lib ddraw.lib vfw32.lib /nologo /dll /map /machine:I386 /out:"c:\progra~1\winamp\plugins\vis_avs.dll"
+# ADD BASE LINK32 kernel32.lib user32.lib gdi32.lib winspool.lib comdlg32.lib advapi32.lib shell32.lib ole32.lib oleaut32.lib uuid.lib odbc32.lib odbccp32.lib ddraw.lib vfw32.lib winmm.lib /nologo /dll /map /machine:I386 /out:"c:\progra~1\winamp\plugins\vis_avs.dll"
 # SUBTRACT BASE LINK32 /debug
-# ADD LINK32 kernel32.lib user32.lib gdi32.lib winspool.lib comdlg32.lib advapi32.lib shell32.lib ole32.lib oleaut32.lib uuid.lib odbc32.lib odbccp32.lib ddraw.lib vfw32.lib /nologo /dll /map /machine:I386 /out:"c:\progra~1\winamp\plugins\vis_avs.dll"
+# ADD LINK32 kernel32.lib user32.lib gdi32.lib winspool.lib comdlg32.lib advapi32.lib shell32.lib ole32.lib oleaut32.lib uuid.lib odbc32.lib odbccp32.lib ddraw.lib vfw32.lib winmm.lib /nologo /dll /map /machine:I386 /out:"c:\progra~1\winamp\plugins\vis_avs.dll"
 # SUBTRACT LINK32 /debug
 
 !ENDIF 
@@ -559,6 +559,22 @@ SOURCE=.\laser\linelist.h
 # End Group
 # Begin Source File
 
+SOURCE=.\audio_ring.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\avs_core.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\bench.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\blend_simd.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\bpm.cpp
 # End Source File
 # Begin Source File
@@ -571,14 +587,38 @@ SOURCE=.\draw.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\fb_arena.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\frame_pacer.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\frame_ring.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\main.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\onset.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\profiler.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\render.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\render_scale.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\res.rc
 # End Source File
 # Begin Source File
@@ -591,11 +631,11 @@ SOURCE=.\rlib.cpp
 # End Source File
 # Begin Source File
 
-SOURCE=.\TIMING.C
+SOURCE=.\rng.cpp
 # End Source File
 # Begin Source File
 
-SOURCE=.\TIMING.H
+SOURCE=.\smp_pool.cpp
 # End Source File
 # Begin Source File
 
@@ -615,6 +655,18 @@ SOURCE=.\ape.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\audio_ring.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\avs_core.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\blend_simd.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\bpm.h
 # End Source File
 # Begin Source File
@@ -627,14 +679,46 @@ SOURCE=.\draw.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\fb_arena.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\frame_pacer.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\frame_ring.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\onset.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\profiler.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\render.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\render_scale.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\rlib.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\rng.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\smp_pool.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\undo.h
 # End Source File
 # Begin Source File
@@ -466,6 +466,9 @@ int Wnd_Init(struct winampVisModule *this_mod)
     cfg_bkgnd_render=GetPrivateProfileInt(AVS_SECTION,"cfg_bkgnd_render",cfg_bkgnd_render,INI_FILE);
     cfg_bkgnd_render_color=GetPrivateProfileInt(AVS_SECTION,"cfg_bkgnd_render_color",cfg_bkgnd_render_color,INI_FILE);
     cfg_render_prio=GetPrivateProfileInt(AVS_SECTION,"cfg_render_prio",cfg_render_prio,INI_FILE);
+    cfg_render_scale=GetPrivateProfileInt(AVS_SECTION,"cfg_render_scale",cfg_render_scale,INI_FILE);
+    cfg_render_scale_fps=GetPrivateProfileInt(AVS_SECTION,"cfg_render_scale_fps",cfg_render_scale_fps,INI_FILE);
+    cfg_pace_audio=GetPrivateProfileInt(AVS_SECTION,"cfg_pace_audio",cfg_pace_audio,INI_FILE);
     g_saved_preset_dirty=GetPrivateProfileInt(AVS_SECTION,"g_preset_dirty",C_UndoStack::isdirty(),INI_FILE);
     config_prompt_save_preset=GetPrivateProfileInt(AVS_SECTION,"cfg_prompt_save_preset",config_prompt_save_preset,INI_FILE);
     config_reuseonresize=GetPrivateProfileInt(AVS_SECTION,"cfg_reuseonresize",config_reuseonresize,INI_FILE);
@@ -635,6 +638,9 @@ void Wnd_Quit(void)
 		WriteInt("cfg_bkgnd_render",cfg_bkgnd_render);
 		WriteInt("cfg_bkgnd_render_color",cfg_bkgnd_render_color);
 		WriteInt("cfg_render_prio",cfg_render_prio);
+		WriteInt("cfg_render_scale",cfg_render_scale);
+		WriteInt("cfg_render_scale_fps",cfg_render_scale_fps);
+		WriteInt("cfg_pace_audio",cfg_pace_audio);
     WriteInt("g_preset_dirty",C_UndoStack::isdirty());
     WriteInt("cfg_prompt_save_preset",config_prompt_save_preset);
 		WritePrivateProfileString(AVS_SECTION,"last_preset_name",last_preset,INI_FILE);
@@ -837,6 +843,28 @@ static int find_preset(char *parent_path, int dir, char *lastpreset, char *newpr
   return 0;
 }
 
+// has the presets that next_preset() or, with random presets on,
+// random_preset() would load next prefetched
+static void prefetch_presets()
+{
+  char files[PREFETCH_AHEAD][2048], *list[PREFETCH_AHEAD];
+  char i_path[1024];
+  int n;
+  if (config_pres_subdir[0]) wsprintf(i_path,"%s\\%s",g_path,config_pres_subdir);
+  else strcpy(i_path,g_path);
+
+  for (n = 0; n < PREFETCH_AHEAD; n ++)
+  {
+    int state=0;
+    files[n][0]=0;
+    if (cfg_fs_rnd) find_preset(i_path,0,NULL,files[n],&state);
+    else find_preset(i_path,1,n ? files[n-1] : last_preset,files[n],&state);
+    if (!files[n][0]) break;
+    list[n]=files[n];
+  }
+  g_render_transition->Prefetch(list,n);
+}
+
 void next_preset(HWND hwnd) {
   g_rnd_cnt=0;
 
@@ -857,6 +885,7 @@ void next_preset(HWND hwnd) {
       if (g_render_transition->LoadPreset(dirmask,2) != 2)
   	    lstrcpyn(last_preset,dirmask,sizeof(last_preset));
     }
+    prefetch_presets();
   }
 }
 
@@ -872,13 +901,16 @@ void random_preset(HWND hwnd) {
     dirmask[0]=0;
 
     int state=0;
-    find_preset(i_path,0,NULL,dirmask,&state);
+    // a prefetched pick is as random as a new one
+    if (!cfg_fs_rnd || !g_render_transition->GetPrefetched(dirmask,sizeof(dirmask)))
+      find_preset(i_path,0,NULL,dirmask,&state);
 
     if (dirmask[0])
     {  			
       if (g_render_transition->LoadPreset(dirmask,4) != 2)
         lstrcpyn(last_preset,dirmask,sizeof(last_preset));
     }
+    prefetch_presets();
   }
 }
 
@@ -901,6 +933,7 @@ void previous_preset(HWND hwnd) {
       if (g_render_transition->LoadPreset(dirmask,2) != 2)
         lstrcpyn(last_preset,dirmask,sizeof(last_preset));
     }
+    prefetch_presets();
   }
 }
 
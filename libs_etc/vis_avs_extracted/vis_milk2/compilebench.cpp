@@ -0,0 +1,232 @@
+/*
+  LICENSE
+  -------
+Copyright 2005-2013 Nullsoft, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, 
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer. 
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution. 
+
+  * Neither the name of Nullsoft nor the names of its contributors may be used to 
+    endorse or promote products derived from this software without specific prior written permission. 
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR 
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND 
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Expression compile benchmark.
+//
+// Loads every .milk preset in a directory and times what a preset switch
+// costs in CState::RecompileExpressions(): re-registering the built-in
+// variables and compiling the init/per-frame/per-vertex code plus the code
+// of all custom waves and shapes.  Init code is compiled but not run, so
+// this doesn't need a running plugin (no device, no g_plugin state).
+//
+// Run it from the plugin dll:
+//   rundll32 vis_milk2.dll,MD_CompileBench -presets "c:\presets" -out bench.txt
+// Options:
+//   -presets dir       directory to scan for *.milk (required)
+//   -reps N            compiles per preset; the best time is kept (default 10)
+//   -out file          where the report goes (default milk_compile_bench.txt)
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "api__vis_milk2.h"
+#include "state.h"
+
+void GetFast_CLEAR();
+void ReadCode(FILE* f, char* pStr, char* prefix);    // state.cpp
+
+typedef struct
+{
+    char   name[MAX_PATH];
+    double best_ms;
+    int    blocks;
+    int    errors;
+} benchPreset;
+
+static int bench_cmp(const void *a, const void *b)
+{
+    double d = ((benchPreset *)a)->best_ms - ((benchPreset *)b)->best_ms;
+    return d < 0 ? -1 : d > 0 ? 1 : 0;
+}
+
+static bool bench_load(CState *s, const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return false;
+
+    s->Default();
+    GetFast_CLEAR();
+    ReadCode(f, s->m_szPerFrameInit, "per_frame_init_");
+    ReadCode(f, s->m_szPerFrameExpr, "per_frame_");
+    ReadCode(f, s->m_szPerPixelExpr, "per_pixel_");
+    for (int i=0; i<MAX_CUSTOM_WAVES; i++)
+        s->m_wave[i].Import(f, NULL, i);
+    for (int i=0; i<MAX_CUSTOM_SHAPES; i++)
+        s->m_shape[i].Import(f, NULL, i);
+
+    fclose(f);
+    return true;
+}
+
+// compiles one block into vm the way RecompileExpressions() does; returns 0 if empty
+static int bench_compile(CState *s, NSEEL_VMCTX vm, char *src, char *buf, int *errors)
+{
+    s->StripLinefeedCharsAndComments(src, buf);
+    char *p = buf;
+    while (*p == ' ') p++;
+    if (!*p)
+        return 0;
+
+    NSEEL_CODEHANDLE h = NSEEL_code_compile(vm, buf, 0);
+    if (h)
+        NSEEL_code_free(h);
+    else
+        (*errors)++;
+    return 1;
+}
+
+static double bench_run(CState *s, char *buf, int *blocks, int *errors)
+{
+    LARGE_INTEGER t0, t1, freq;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t0);
+
+    *blocks = 0;
+    *errors = 0;
+    s->RegisterBuiltInVariables(RECOMPILE_PRESET_CODE | RECOMPILE_WAVE_CODE | RECOMPILE_SHAPE_CODE);
+    *blocks += bench_compile(s, s->m_pf_eel, s->m_szPerFrameInit, buf, errors);
+    *blocks += bench_compile(s, s->m_pf_eel, s->m_szPerFrameExpr, buf, errors);
+    *blocks += bench_compile(s, s->m_pv_eel, s->m_szPerPixelExpr, buf, errors);
+    for (int i=0; i<MAX_CUSTOM_WAVES; i++)
+    {
+        if (!s->m_wave[i].enabled)
+            continue;
+        *blocks += bench_compile(s, s->m_wave[i].m_pf_eel, s->m_wave[i].m_szInit,     buf, errors);
+        *blocks += bench_compile(s, s->m_wave[i].m_pf_eel, s->m_wave[i].m_szPerFrame, buf, errors);
+        *blocks += bench_compile(s, s->m_wave[i].m_pp_eel, s->m_wave[i].m_szPerPoint, buf, errors);
+    }
+    for (int i=0; i<MAX_CUSTOM_SHAPES; i++)
+    {
+        if (!s->m_shape[i].enabled)
+            continue;
+        *blocks += bench_compile(s, s->m_shape[i].m_pf_eel, s->m_shape[i].m_szInit,     buf, errors);
+        *blocks += bench_compile(s, s->m_shape[i].m_pf_eel, s->m_shape[i].m_szPerFrame, buf, errors);
+    }
+
+    QueryPerformanceCounter(&t1);
+    return (double)(t1.QuadPart - t0.QuadPart) * 1000.0 / (double)freq.QuadPart;
+}
+
+static char *bench_arg(char **p)
+{
+    char *s = *p;
+    while (*s == ' ') s++;
+    char *ret = s;
+    if (*s == '"')
+    {
+        ret = ++s;
+        while (*s && *s != '"') s++;
+    }
+    else
+        while (*s && *s != ' ') s++;
+    if (*s) *s++ = 0;
+    *p = s;
+    return ret;
+}
+
+extern "C" __declspec( dllexport ) void CALLBACK MD_CompileBench(HWND hwnd, HINSTANCE hinst, LPSTR cmdline, int nCmdShow)
+{
+    char dir[MAX_PATH] = "";
+    char outfile[MAX_PATH] = "milk_compile_bench.txt";
+    int reps = 10;
+
+    char *p = cmdline ? cmdline : (char*)"";
+    while (*p)
+    {
+        char *a = bench_arg(&p);
+        if (!_stricmp(a, "-presets")) lstrcpynA(dir, bench_arg(&p), MAX_PATH);
+        else if (!_stricmp(a, "-out")) lstrcpynA(outfile, bench_arg(&p), MAX_PATH);
+        else if (!_stricmp(a, "-reps")) { reps = atoi(bench_arg(&p)); if (reps < 1) reps = 1; }
+    }
+    if (!dir[0])
+        return;
+
+    FILE *fp = fopen(outfile, "wt");
+    if (!fp)
+        return;
+
+    NSEEL_init();
+
+    CState *s = new CState;
+    char *buf = (char *)malloc(MAX_BIGSTRING_LEN*3);
+    int n = 0, nalloc = 0;
+    benchPreset *list = NULL;
+
+    char mask[MAX_PATH];
+    wsprintfA(mask, "%s\\*.milk", dir);
+    WIN32_FIND_DATAA fd;
+    HANDLE h = FindFirstFileA(mask, &fd);
+    if (h != INVALID_HANDLE_VALUE)
+    {
+        do
+        {
+            char path[MAX_PATH];
+            wsprintfA(path, "%s\\%s", dir, fd.cFileName);
+            if (!bench_load(s, path))
+                continue;
+
+            if (n == nalloc)
+            {
+                nalloc = nalloc ? nalloc*2 : 256;
+                list = (benchPreset *)realloc(list, nalloc*sizeof(benchPreset));
+            }
+            benchPreset *b = &list[n++];
+            lstrcpynA(b->name, fd.cFileName, MAX_PATH);
+            b->best_ms = 1e30;
+            for (int r=0; r<reps; r++)
+            {
+                double ms = bench_run(s, buf, &b->blocks, &b->errors);
+                if (ms < b->best_ms) b->best_ms = ms;
+            }
+        }
+        while (FindNextFileA(h, &fd));
+        FindClose(h);
+    }
+
+    fprintf(fp, "; MilkDrop expression compile times, best of %d, %d presets in %s\n", reps, n, dir);
+    fprintf(fp, "%10s %6s %6s  %s\n", "ms", "blocks", "errors", "preset");
+    double total = 0;
+    for (int i=0; i<n; i++)
+    {
+        fprintf(fp, "%10.3f %6d %6d  %s\n", list[i].best_ms, list[i].blocks, list[i].errors, list[i].name);
+        total += list[i].best_ms;
+    }
+    if (n)
+    {
+        qsort(list, n, sizeof(benchPreset), bench_cmp);
+        fprintf(fp, "; total %.1f ms, mean %.3f ms, median %.3f ms, p95 %.3f ms, worst %.3f ms (%s)\n",
+            total, total/n, list[n/2].best_ms, list[(n*95)/100].best_ms,
+            list[n-1].best_ms, list[n-1].name);
+    }
+
+    fclose(fp);
+    free(list);
+    free(buf);
+    delete s;
+}
@@ -1820,6 +1820,35 @@ void CPlugin::ComputeGridAlphaValues()
 		float fSY		= (float)(*pState->var_pf_sy);
 		
 		int n = 0;
+		int nv = (m_nGridX+1)*(m_nGridY+1);
+		double *pv = m_pv_batch;
+
+#ifndef _NO_EXPR_
+		if (pState->m_pp_codehandle)
+		{
+			// run the user-defined equations over the whole mesh at once.  x/y/rad/ang
+			//  come from the mesh, the motion vars are reset to their per-frame values
+			//  for every vertex, and the results land in pv[] for computation as floats.
+			NSEEL_BATCHVAR bv[PV_NBUF] =
+			{
+				{ pState->var_pv_x,       pv + PV_X*nv,   1, NULL },
+				{ pState->var_pv_y,       pv + PV_Y*nv,   1, NULL },
+				{ pState->var_pv_rad,     pv + PV_RAD*nv, 1, NULL },
+				{ pState->var_pv_ang,     pv + PV_ANG*nv, 1, NULL },
+				{ pState->var_pv_zoom,    pState->var_pf_zoom,    0, pv + PV_ZOOM*nv },
+				{ pState->var_pv_zoomexp, pState->var_pf_zoomexp, 0, pv + PV_ZOOMEXP*nv },
+				{ pState->var_pv_rot,     pState->var_pf_rot,     0, pv + PV_ROT*nv },
+				{ pState->var_pv_warp,    pState->var_pf_warp,    0, pv + PV_WARP*nv },
+				{ pState->var_pv_cx,      pState->var_pf_cx,      0, pv + PV_CX*nv },
+				{ pState->var_pv_cy,      pState->var_pf_cy,      0, pv + PV_CY*nv },
+				{ pState->var_pv_dx,      pState->var_pf_dx,      0, pv + PV_DX*nv },
+				{ pState->var_pv_dy,      pState->var_pf_dy,      0, pv + PV_DY*nv },
+				{ pState->var_pv_sx,      pState->var_pf_sx,      0, pv + PV_SX*nv },
+				{ pState->var_pv_sy,      pState->var_pf_sy,      0, pv + PV_SY*nv },
+			};
+			NSEEL_code_execute_batch(pState->m_pp_codehandle, bv, PV_NBUF, nv);
+		}
+#endif
 
 		for (int y=0; y<=m_nGridY; y++)
 		{
@@ -1830,49 +1859,21 @@ void CPlugin::ComputeGridAlphaValues()
 				//m_verts[n].y = j/(float)m_nGridY*2.0f - 1.0f;
 				//m_verts[n].z = 0.0f;
 				
+#ifndef _NO_EXPR_
 				if (pState->m_pp_codehandle)
 				{
-					// restore all the variables to their original states,
-					//  run the user-defined equations,
-					//  then move the results into local vars for computation as floats
-
-					*pState->var_pv_x		= (double)(m_verts[n].x* 0.5f*m_fAspectX + 0.5f);
-					*pState->var_pv_y		= (double)(m_verts[n].y*-0.5f*m_fAspectY + 0.5f);
-					*pState->var_pv_rad		= (double)m_vertinfo[n].rad;
-					*pState->var_pv_ang		= (double)m_vertinfo[n].ang;
-					*pState->var_pv_zoom	= *pState->var_pf_zoom;
-					*pState->var_pv_zoomexp	= *pState->var_pf_zoomexp;
-					*pState->var_pv_rot		= *pState->var_pf_rot;
-					*pState->var_pv_warp	= *pState->var_pf_warp;
-					*pState->var_pv_cx		= *pState->var_pf_cx;
-					*pState->var_pv_cy		= *pState->var_pf_cy;
-					*pState->var_pv_dx		= *pState->var_pf_dx;
-					*pState->var_pv_dy		= *pState->var_pf_dy;
-					*pState->var_pv_sx		= *pState->var_pf_sx;
-					*pState->var_pv_sy		= *pState->var_pf_sy;
-					//*pState->var_pv_time		= *pState->var_pv_time;		// (these are all now initialized 
-					//*pState->var_pv_bass		= *pState->var_pv_bass;		//  just once per frame)
-					//*pState->var_pv_mid		= *pState->var_pv_mid;		
-					//*pState->var_pv_treb		= *pState->var_pv_treb;	
-					//*pState->var_pv_bass_att	= *pState->var_pv_bass_att;
-					//*pState->var_pv_mid_att	= *pState->var_pv_mid_att;	
-					//*pState->var_pv_treb_att	= *pState->var_pv_treb_att;
-
-#ifndef _NO_EXPR_
-					NSEEL_code_execute(pState->m_pp_codehandle);
-#endif
-
-					fZoom = (float)(*pState->var_pv_zoom);
-					fZoomExp = (float)(*pState->var_pv_zoomexp);
-					fRot  = (float)(*pState->var_pv_rot);
-					fWarp = (float)(*pState->var_pv_warp);
-					fCX   = (float)(*pState->var_pv_cx);
-					fCY   = (float)(*pState->var_pv_cy);
-					fDX   = (float)(*pState->var_pv_dx);
-					fDY   = (float)(*pState->var_pv_dy);
-					fSX   = (float)(*pState->var_pv_sx);
-					fSY   = (float)(*pState->var_pv_sy);
+					fZoom = (float)pv[PV_ZOOM*nv + n];
+					fZoomExp = (float)pv[PV_ZOOMEXP*nv + n];
+					fRot  = (float)pv[PV_ROT*nv + n];
+					fWarp = (float)pv[PV_WARP*nv + n];
+					fCX   = (float)pv[PV_CX*nv + n];
+					fCY   = (float)pv[PV_CY*nv + n];
+					fDX   = (float)pv[PV_DX*nv + n];
+					fDY   = (float)pv[PV_DY*nv + n];
+					fSX   = (float)pv[PV_SX*nv + n];
+					fSY   = (float)pv[PV_SY*nv + n];
 				}
+#endif
 
 				float fZoom2 = powf(fZoom, powf(fZoomExp, m_vertinfo[n].rad*2.0f - 1.0f));
 
@@ -55,6 +55,19 @@ extern "C" {
 
 #define NSEEL_CLOSEFACTOR 0.00001
 
+// x86-64 has no snippet glue; expressions are compiled by nseel-jit-x64.c
+#if !defined(NSEEL_NO_JIT) && EEL_F_SIZE == 8 && (defined(_M_X64) || defined(__x86_64__))
+#define NSEEL_JIT
+#endif
+
+// rand() generator (mersenne twister), one per VM so VMs can run on different threads
+typedef struct
+{
+  unsigned int mt[624];
+  int mti; // 0 until seeded from seed
+  unsigned int seed;
+} nseel_randState;
+
 typedef struct
 {
 	int srcByteCount;
@@ -66,6 +79,9 @@ typedef struct _compileContext
   EEL_F **varTable_Values;
   char   **varTable_Names;
   int varTable_numBlocks;
+  int varTable_numVars;
+  int *varTable_Hash; // open addressed, var index+1 (0=empty), varTable_HashSize is a power of 2
+  int varTable_HashSize;
 
   int errVar;
   int colCount;
@@ -89,6 +105,8 @@ typedef struct _compileContext
   void *tmpblocks_head,*blocks_head;
   int computTableTop; // make it abort on potential overflow =)
   int l_stats[4]; // source bytes, static code bytes, call code bytes, data bytes
+  int l_globals; // the code uses reg00-reg99 or gmegabuf()
+  int l_volatile; // the code calls rand() or a host function
 
   lineRecItem *compileLineRecs;
   int compileLineRecs_size;
@@ -100,6 +118,8 @@ typedef struct _compileContext
   void *gram_blocks;
 
   void *caller_this;
+
+  nseel_randState rng;
 }
 compileContext;
 
@@ -124,6 +144,10 @@ INT_PTR nseel_createCompiledFunction3(compileContext *ctx, int fntype, INT_PTR f
 
 extern EEL_F nseel_globalregs[100];
 
+EEL_F NSEEL_CGEN_CALL nseel_int_rand(void *state, EEL_F *f);
+int nseel_isVolatileFunction(functionType *f);
+void NSEEL_PProc_RNG(void *data, int data_size, compileContext *ctx);
+
 void nseel_resetVars(compileContext *ctx);
 EEL_F *nseel_getVarPtr(compileContext *ctx, char *varName);
 EEL_F *nseel_registerVar(compileContext *ctx, char *varName);
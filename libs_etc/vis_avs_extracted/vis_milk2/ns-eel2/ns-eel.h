@@ -72,12 +72,14 @@ void NSEEL_quit();
 
 int *NSEEL_getstats(); // returns a pointer to 5 ints... source bytes, static code bytes, call code bytes, data bytes, number of code handles
 EEL_F *NSEEL_getglobalregs();
+void NSEEL_resetglobals(); // zeroes reg00-reg99 and the shared gmem. not while code runs
 
 typedef void *NSEEL_VMCTX;
 typedef void *NSEEL_CODEHANDLE;
 
 NSEEL_VMCTX NSEEL_VM_alloc(); // return a handle
 void NSEEL_VM_free(NSEEL_VMCTX ctx); // free when done with a VM and ALL of its code have been freed, as well
+void NSEEL_rand_seed(unsigned int seed); // rand() of VMs allocated after this is seeded from seed and the allocation order. call while no VMs are being allocated
 
 void NSEEL_VM_enumallvars(NSEEL_VMCTX ctx, int (*func)(const char *name, EEL_F *val, void *ctx), void *userctx); // return false from func to stop
 void NSEEL_VM_resetvars(NSEEL_VMCTX ctx); // clears all vars to 0.0.
@@ -112,6 +114,41 @@ char *NSEEL_code_getcodeerror(NSEEL_VMCTX ctx);
 void NSEEL_code_execute(NSEEL_CODEHANDLE code);
 void NSEEL_code_free(NSEEL_CODEHANDLE code);
 int *NSEEL_code_getstats(NSEEL_CODEHANDLE code); // 4 ints...source bytes, static code bytes, call code bytes, data bytes
+int NSEEL_code_isvolatile(NSEEL_CODEHANDLE code); // 1 if it uses globals or calls rand() or a host function, so running it again can give other results
+// 1 if a run of the code can depend on a variable an earlier run left behind,
+// when the variables in inputs are set before every run. only the x86-64
+// code generator can tell, everything else (and code it can't follow) gives 1.
+int NSEEL_code_carriesstate(NSEEL_CODEHANDLE code, EEL_F **inputs, int ninputs);
+
+// like NSEEL_code_compile(), but reuses the code of an earlier compile of the
+// same source (ignoring comments and whitespace) in a VM with the same
+// variables, registering the variables it adds. this skips the compiler when
+// presets are reloaded. only the x86-64 code generator caches, elsewhere this
+// is NSEEL_code_compile(). free the handle with NSEEL_code_free() as usual.
+#ifdef __cplusplus
+NSEEL_CODEHANDLE NSEEL_code_compile_cached(NSEEL_VMCTX ctx, char *code, int lineoffs=0);
+#else
+NSEEL_CODEHANDLE NSEEL_code_compile_cached(NSEEL_VMCTX ctx, char *code, int lineoffs);
+#endif
+void NSEEL_code_cache_setsize(int maxunused); // entries kept once their handles are freed (default 128, 0 disables the cache)
+void NSEEL_code_cache_flush();
+int *NSEEL_code_cache_getstats(); // 4 ints... hits, misses, entries, entries not in use
+
+// runs code once per point for n points. for every point i, each var with
+// 'in' set is loaded from in[i*in_stride] (in_stride 0 resets it to in[0]),
+// the code runs, then each var with 'out' set is stored to out[i].
+// variables without 'in' keep their value from one point to the next, as if
+// NSEEL_code_execute() was called in a loop. on x86-64, code that carries no
+// state between points runs two points per pass in SSE2 lanes.
+typedef struct
+{
+  EEL_F *var; // from NSEEL_VM_regvar()
+  EEL_F *in;
+  int in_stride;
+  EEL_F *out;
+} NSEEL_BATCHVAR;
+
+void NSEEL_code_execute_batch(NSEEL_CODEHANDLE code, NSEEL_BATCHVAR *vars, int nvars, int n);
   
 
 // global memory control/view
@@ -39,20 +39,20 @@
 #define UPPER_MASK 0x80000000UL /* most significant w-r bits */
 #define LOWER_MASK 0x7fffffffUL /* least significant r bits */
 
-static unsigned int genrand_int32(void)
+static unsigned int genrand_int32(nseel_randState *st)
 {
 
     unsigned int y;
-    static unsigned int mag01[2]={0x0UL, MATRIX_A};
+    static const unsigned int mag01[2]={0x0UL, MATRIX_A};
     /* mag01[x] = x * MATRIX_A  for x=0,1 */
 
-    static unsigned int mt[N]; /* the array for the state vector  */
-    static int mti; /* mti==N+1 means mt[N] is not initialized */
+    unsigned int *mt=st->mt; /* the array for the state vector  */
+    int mti=st->mti; /* mti==0 means mt[N] is not initialized */
 
 
     if (!mti)
     { 
-      unsigned int s=0x4141f00d;
+      unsigned int s=st->seed;
       mt[0]= s & 0xffffffffUL;
       for (mti=1; mti<N; mti++) 
       {
@@ -85,6 +85,7 @@ static unsigned int genrand_int32(void)
     }
   
     y = mt[mti++];
+    st->mti = mti;
 
     /* Tempering */
     y ^= (y >> 11);
@@ -98,15 +99,15 @@ static unsigned int genrand_int32(void)
 
 
 //---------------------------------------------------------------------------------------------------------------
-EEL_F NSEEL_CGEN_CALL nseel_int_rand(EEL_F *f)
+EEL_F NSEEL_CGEN_CALL nseel_int_rand(void *state, EEL_F *f)
 {
   EEL_F x=floor(*f);
   if (x < 1.0) x=1.0;
  
 #ifdef NSEEL_EEL1_COMPAT_MODE 
-  return (EEL_F)(genrand_int32()%(int)x);
+  return (EEL_F)(genrand_int32((nseel_randState *)state)%(int)x);
 #else
-  return (EEL_F) (genrand_int32()*(1.0/(double)0xFFFFFFFF)*x);
+  return (EEL_F) (genrand_int32((nseel_randState *)state)*(1.0/(double)0xFFFFFFFF)*x);
 #endif
 //  return (EEL_F)(rand()%EEL_F2int(x));
 }
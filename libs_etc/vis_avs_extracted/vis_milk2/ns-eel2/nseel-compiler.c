@@ -32,6 +32,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <stddef.h>
 
 #ifndef _WIN64
   #ifndef __ppc__
@@ -45,6 +46,10 @@
   #endif
 #endif
 
+#if defined(NSEEL_JIT) && !defined(_WIN32) && !defined(EEL_USE_MPROTECT)
+  #define EEL_USE_MPROTECT
+#endif
+
 #ifdef EEL_USE_MPROTECT
 #include <sys/mman.h>
 #include <stdint.h>
@@ -59,7 +64,7 @@
 
 #endif
 
-#ifndef _WIN64
+#if !defined(_WIN64) && !defined(NSEEL_JIT)
 #if !defined(_RC_CHOP) && !defined(EEL_NO_CHANGE_FPFLAGS)
 
 #include <fpu_control.h>
@@ -168,6 +173,8 @@ INT_PTR *EEL_GLUE_set_immediate(void *_p, void *newv)
 
 //x86 specific code
 
+// the snippet glue, which the x86-64 code generator has no use for
+#ifndef NSEEL_JIT
 #define GLUE_FUNC_ENTER_SIZE 0
 #define GLUE_FUNC_LEAVE_SIZE 0
 const static unsigned int GLUE_FUNC_ENTER[1];
@@ -258,6 +265,7 @@ static void GLUE_CALL_CODE(INT_PTR bp, INT_PTR cp)
     #endif //gcc x86
   #endif // 32bit
 }
+#endif
 
 INT_PTR *EEL_GLUE_set_immediate(void *_p, void *newv)
 {
@@ -270,6 +278,7 @@ INT_PTR *EEL_GLUE_set_immediate(void *_p, void *newv)
 #endif
 
 
+#ifndef NSEEL_JIT
 static void *GLUE_realAddress(void *fn, void *fn_e, int *size)
 {
 #if defined(_MSC_VER) || defined(__LP64__)
@@ -311,6 +320,7 @@ static void *GLUE_realAddress(void *fn, void *fn_e, int *size)
   return fn;
 #endif
 }
+#endif
 
 
 
@@ -379,6 +389,18 @@ typedef struct {
   llBlock *blocks;
   void *code;
   int code_stats[4];
+  int uses_globals;
+  int uses_volatile;
+#ifdef NSEEL_JIT
+  llBlock *tree_blocks; // expression tree, kept for NSEEL_code_execute_batch()
+  startPtr *tree;
+  llBlock *batch_blocks;
+  void *batch_code;
+  NSEEL_BATCHVAR *batch_sig; // binding batch_code was generated for
+  int batch_nsig;
+  struct _codeCacheEnt *cache; // code cache entry this handle's code and tree came from
+  EEL_F **vars; // with cache: the variables of the entry, in this VM
+#endif
 } codeHandleType;
 
 #ifndef NSEEL_MAX_TEMPSPACE_ENTRIES
@@ -387,15 +409,18 @@ typedef struct {
 
 static void *__newBlock(llBlock **start,int size);
 
-#define newTmpBlock(x) __newTmpBlock((llBlock **)&ctx->tmpblocks_head,x)
 #define newBlock(x,a) __newBlock_align(ctx,x,a)
 
+#ifndef NSEEL_JIT
+#define newTmpBlock(x) __newTmpBlock((llBlock **)&ctx->tmpblocks_head,x)
+
 static void *__newTmpBlock(llBlock **start, int size)
 {
   void *p=__newBlock(start,size+4);
   if (p && size>=0) *((int *)p) = size;
   return p;
 }
+#endif
 
 static void *__newBlock_align(compileContext *ctx, int size, int align) // makes sure block is aligned to 32 byte boundary, for code
 {
@@ -469,7 +494,9 @@ static EEL_F g_signs[2]={1.0,-1.0};
 static EEL_F negativezeropointfive=-0.5f;
 static EEL_F onepointfive=1.5f;
 static EEL_F g_closefact = NSEEL_CLOSEFACTOR;
+#ifdef __ppc__
 static const EEL_F eel_zero=0.0, eel_one=1.0;
+#endif
 
 //#if defined(_MSC_VER) && _MSC_VER >= 1400
 //static double __floor(double a) { return floor(a); }
@@ -491,8 +518,6 @@ static double eel1sigmoid(double x, double constraint)
 }
 
 
-EEL_F NSEEL_CGEN_CALL nseel_int_rand(EEL_F *f);
-
 static functionType fnTable1[] = {
   { "_if",     nseel_asm_if,nseel_asm_if_end,    3,  {&g_closefact} },
   { "_and",   nseel_asm_band,nseel_asm_band_end,  2 } ,
@@ -566,7 +591,7 @@ static functionType fnTable1[] = {
 #else
    { "sign",   nseel_asm_sign,nseel_asm_sign_end,  1, {&g_signs}} ,
 #endif
-	 { "rand",   nseel_asm_1pp,nseel_asm_1pp_end,  1, {&nseel_int_rand}, } ,
+	 { "rand",   _asm_generic1parm_retd,_asm_generic1parm_retd_end,  1, {&nseel_int_rand}, NSEEL_PProc_RNG } ,
 
 //#if defined(_MSC_VER) && _MSC_VER >= 1400
 //   { "floor",  nseel_asm_1pdd,nseel_asm_1pdd_end, 1, {&__floor} },
@@ -610,6 +635,14 @@ functionType *nseel_getFunctionFromTable(int idx)
   return fnTable1+idx;
 }
 
+// rand() and host functions (audio, time, mouse...) can return something
+// else every time they are called
+int nseel_isVolatileFunction(functionType *f)
+{
+  return (f->afunc == (void*)_asm_generic1parm_retd && f->replptrs[0] == (void*)nseel_int_rand) ||
+         f < fnTable1 || f >= fnTable1+sizeof(fnTable1)/sizeof(fnTable1[0]);
+}
+
 int NSEEL_init() // returns 0 on success
 {
   NSEEL_quit();
@@ -634,10 +667,16 @@ void NSEEL_addfunctionex2(const char *name, int nparms, char *code_startaddr, in
     fnTableUser[fnTableUser_size].replptrs[1]=fptr2;
     fnTableUser_size++;
   }
+#ifdef NSEEL_JIT
+  NSEEL_code_cache_flush(); // cached code may have compiled the name as a variable
+#endif
 }
 
 void NSEEL_quit()
 {
+#ifdef NSEEL_JIT
+  NSEEL_code_cache_flush();
+#endif
   free(fnTableUser);
   fnTableUser_size=0;
   fnTableUser=0;
@@ -701,6 +740,12 @@ static void *__newBlock(llBlock **start, int size)
 }
 
 
+#ifdef NSEEL_JIT
+struct _jitReloc;
+static NSEEL_CODEHANDLE nseel_code_compile(compileContext *ctx, char *_expression, int lineoffs, struct _jitReloc **relocs, int *nrelocs);
+#include "nseel-jit-x64.c"
+#else
+
 //---------------------------------------------------------------------------------------------------------------
 INT_PTR nseel_createCompiledValue(compileContext *ctx, EEL_F value, EEL_F *addrValue)
 {
@@ -1007,6 +1052,8 @@ INT_PTR nseel_createCompiledFunction1(compileContext *ctx, int fntype, INT_PTR f
 }
 
 
+#endif // !NSEEL_JIT
+
 static char *preprocessCode(compileContext *ctx, char *expression)
 {
   char *expression_start=expression;
@@ -1489,7 +1536,16 @@ static void movestringover(char *str, int amount)
 //------------------------------------------------------------------------------
 NSEEL_CODEHANDLE NSEEL_code_compile(NSEEL_VMCTX _ctx, char *_expression, int lineoffs)
 {
+#ifdef NSEEL_JIT
+  return nseel_code_compile((compileContext *)_ctx,_expression,lineoffs,NULL,NULL);
+}
+
+// relocs: if set, receives the positions in the code that depend on the VM (for the code cache)
+static NSEEL_CODEHANDLE nseel_code_compile(compileContext *ctx, char *_expression, int lineoffs, struct _jitReloc **relocs, int *nrelocs)
+{
+#else
   compileContext *ctx = (compileContext *)_ctx;
+#endif
   char *expression,*expression_start;
   int computable_size=0;
   codeHandleType *handle;
@@ -1505,6 +1561,8 @@ NSEEL_CODEHANDLE NSEEL_code_compile(NSEEL_VMCTX _ctx, char *_expression, int lin
   freeBlocks((llBlock **)&ctx->tmpblocks_head);  // free blocks
   freeBlocks((llBlock **)&ctx->blocks_head);  // free blocks
   memset(ctx->l_stats,0,sizeof(ctx->l_stats));
+  ctx->l_globals=0;
+  ctx->l_volatile=0;
   free(ctx->compileLineRecs); ctx->compileLineRecs=0; ctx->compileLineRecs_size=0; ctx->compileLineRecs_alloc=0;
 
   handle = (codeHandleType*)newBlock(sizeof(codeHandleType),8);
@@ -1595,6 +1653,20 @@ NSEEL_CODEHANDLE NSEEL_code_compile(NSEEL_VMCTX _ctx, char *_expression, int lin
   {
     handle=NULL;              // return NULL (after resetting blocks_head)
   }
+#ifdef NSEEL_JIT
+  else if (!(handle->code = nseel_jit_generate(ctx,startpts,relocs,nrelocs)))
+  {
+    handle=NULL;
+  }
+  else
+  {
+    handle->blocks = ctx->blocks_head;
+    ctx->blocks_head=0;
+    handle->tree_blocks = ctx->tmpblocks_head;
+    ctx->tmpblocks_head=0;
+    handle->tree = startpts;
+  }
+#else
   else 
   {
     char *tabptr = (char *)(handle->workTable=calloc(computable_size+64,  sizeof(EEL_F)));
@@ -1637,12 +1709,15 @@ NSEEL_CODEHANDLE NSEEL_code_compile(NSEEL_VMCTX _ctx, char *_expression, int lin
     ctx->blocks_head=0;
 
   }
+#endif
   freeBlocks((llBlock **)&ctx->tmpblocks_head);  // free blocks
   freeBlocks((llBlock **)&ctx->blocks_head);  // free blocks
 
   if (handle)
   {
     memcpy(handle->code_stats,ctx->l_stats,sizeof(ctx->l_stats));
+    handle->uses_globals=ctx->l_globals;
+    handle->uses_volatile=ctx->l_volatile;
     nseel_evallib_stats[0]+=ctx->l_stats[0];
     nseel_evallib_stats[1]+=ctx->l_stats[1];
     nseel_evallib_stats[2]+=ctx->l_stats[2];
@@ -1656,9 +1731,52 @@ NSEEL_CODEHANDLE NSEEL_code_compile(NSEEL_VMCTX _ctx, char *_expression, int lin
   return (NSEEL_CODEHANDLE)handle;
 }
 
+//------------------------------------------------------------------------------
+NSEEL_CODEHANDLE NSEEL_code_compile_cached(NSEEL_VMCTX ctx, char *code, int lineoffs)
+{
+#ifdef NSEEL_JIT
+  return nseel_jit_compileCached((compileContext *)ctx,code,lineoffs);
+#else
+  return NSEEL_code_compile(ctx,code,lineoffs);
+#endif
+}
+
+void NSEEL_code_cache_setsize(int maxunused)
+{
+#ifdef NSEEL_JIT
+  NSEEL_HOSTSTUB_EnterMutex();
+  g_cache_max = maxunused > 0 ? maxunused : 0;
+  jit_cacheTrim();
+  NSEEL_HOSTSTUB_LeaveMutex();
+#endif
+}
+
+void NSEEL_code_cache_flush()
+{
+#ifdef NSEEL_JIT
+  NSEEL_HOSTSTUB_EnterMutex();
+  nseel_jit_cacheFlush();
+  NSEEL_HOSTSTUB_LeaveMutex();
+#endif
+}
+
+int *NSEEL_code_cache_getstats()
+{
+#ifdef NSEEL_JIT
+  return g_cache_stats;
+#else
+  static int stats[4];
+  return stats;
+#endif
+}
+
 //------------------------------------------------------------------------------
 void NSEEL_code_execute(NSEEL_CODEHANDLE code)
 {
+#ifdef NSEEL_JIT
+  codeHandleType *h = (codeHandleType *)code;
+  if (h && h->code) ((void (*)(void))h->code)();
+#else
   INT_PTR tabptr;
   INT_PTR codeptr;
   codeHandleType *h = (codeHandleType *)code;
@@ -1681,10 +1799,30 @@ void NSEEL_code_execute(NSEEL_CODEHANDLE code)
     tabptr += 32-((tabptr)&31);
   //printf("calling code!\n");
   GLUE_CALL_CODE(tabptr,codeptr);
+#endif
 
 }
 
 
+//------------------------------------------------------------------------------
+void NSEEL_code_execute_batch(NSEEL_CODEHANDLE code, NSEEL_BATCHVAR *vars, int nvars, int n)
+{
+  int i=0,x;
+  if (!code) return;
+
+#ifdef NSEEL_JIT
+  i=nseel_jit_execute_batch((codeHandleType *)code,vars,nvars,n);
+#endif
+
+  for (; i < n; i ++)
+  {
+    for (x = 0; x < nvars; x ++) if (vars[x].in) *vars[x].var = vars[x].in[i*vars[x].in_stride];
+    NSEEL_code_execute(code);
+    for (x = 0; x < nvars; x ++) if (vars[x].out) vars[x].out[i] = *vars[x].var;
+  }
+}
+
+
 char *NSEEL_code_getcodeerror(NSEEL_VMCTX ctx)
 {
   compileContext *c=(compileContext *)ctx;
@@ -1699,11 +1837,20 @@ void NSEEL_code_free(NSEEL_CODEHANDLE code)
   if (h != NULL)
   {
     free(h->workTable);
+    NSEEL_HOSTSTUB_EnterMutex(); // hosts may free code while others compile
     nseel_evallib_stats[0]-=h->code_stats[0];
     nseel_evallib_stats[1]-=h->code_stats[1];
     nseel_evallib_stats[2]-=h->code_stats[2];
     nseel_evallib_stats[3]-=h->code_stats[3];
     nseel_evallib_stats[4]--;
+    NSEEL_HOSTSTUB_LeaveMutex();
+#ifdef NSEEL_JIT
+    freeBlocks(&h->batch_blocks);
+    free(h->batch_sig);
+    freeBlocks(&h->tree_blocks);
+    free(h->vars);
+    if (h->cache) nseel_jit_cacheRelease(h->cache);
+#endif
     freeBlocks(&h->blocks);
 
 
@@ -1731,13 +1878,34 @@ void NSEEL_VM_resetvars(NSEEL_VMCTX _ctx)
     ctx->varTable_Names=0;
 
     ctx->varTable_numBlocks=0;
+
+    free(ctx->varTable_Hash);
+    ctx->varTable_Hash=0;
+    ctx->varTable_HashSize=0;
+    ctx->varTable_numVars=0;
   }
 }
 
 
+static unsigned int g_rand_seed=0x4141f00d, g_rand_vms;
+
+// no lock: hosts call this at startup, before the host mutex exists
+void NSEEL_rand_seed(unsigned int seed)
+{
+  g_rand_seed=seed;
+  g_rand_vms=0;
+}
+
 NSEEL_VMCTX NSEEL_VM_alloc() // return a handle
 {
   compileContext *ctx=calloc(1,sizeof(compileContext));
+  if (ctx)
+  {
+    // the first VM gets the sequence the shared generator used to produce
+    NSEEL_HOSTSTUB_EnterMutex();
+    ctx->rng.seed=g_rand_seed ^ (g_rand_vms++ * 0x9e3779b9);
+    NSEEL_HOSTSTUB_LeaveMutex();
+  }
   return ctx;
 }
 
@@ -1768,6 +1936,22 @@ int *NSEEL_code_getstats(NSEEL_CODEHANDLE code)
   return 0;
 }
 
+int NSEEL_code_isvolatile(NSEEL_CODEHANDLE code)
+{
+  codeHandleType *h = (codeHandleType *)code;
+  return h ? h->uses_globals || h->uses_volatile : 0;
+}
+
+int NSEEL_code_carriesstate(NSEEL_CODEHANDLE code, EEL_F **inputs, int ninputs)
+{
+  if (!code) return 0;
+#ifdef NSEEL_JIT
+  return nseel_jit_carriesState((codeHandleType *)code,inputs,ninputs);
+#else
+  return 1;
+#endif
+}
+
 void NSEEL_VM_SetCustomFuncThis(NSEEL_VMCTX ctx, void *thisptr)
 {
   if (ctx)
@@ -1789,3 +1973,7 @@ void NSEEL_PProc_THIS(void *data, int data_size, compileContext *ctx)
 {
   if (data_size>0) EEL_GLUE_set_immediate(data, ctx->caller_this);
 }
+void NSEEL_PProc_RNG(void *data, int data_size, compileContext *ctx)
+{
+  if (data_size>0) EEL_GLUE_set_immediate(data, &ctx->rng);
+}
@@ -91,48 +91,87 @@ void NSEEL_VM_enumallvars(NSEEL_VMCTX ctx, int (*func)(const char *name, EEL_F *
 
 
 
-static INT_PTR register_var(compileContext *ctx, const char *name, EEL_F **ptr)
+// vars are found through a hash of the part of the name that strnicmp() compares,
+// so lookups don't have to walk every block (compiling used to be O(vars^2))
+static unsigned int var_hash(const char *name)
 {
-  int wb;
-  int ti=0;
-  int i=0;
-  char *nameptr;
-  for (wb = 0; wb < ctx->varTable_numBlocks; wb ++)
+  unsigned int h=2166136261u;
+  int x;
+  for (x = 0; x < NSEEL_MAX_VARIABLE_NAMELEN && name[x]; x ++)
+    h=(h^(unsigned char)tolower(name[x]))*16777619u;
+  return h;
+}
+
+static char *var_name(compileContext *ctx, int i)
+{
+  return ctx->varTable_Names[i/NSEEL_VARS_PER_BLOCK]+(i%NSEEL_VARS_PER_BLOCK)*NSEEL_MAX_VARIABLE_NAMELEN;
+}
+
+static int var_find(compileContext *ctx, const char *name)
+{
+  unsigned int m,h;
+  int i;
+  if (!ctx->varTable_HashSize) return -1;
+
+  m=ctx->varTable_HashSize-1;
+  h=var_hash(name)&m;
+  while ((i=ctx->varTable_Hash[h]))
   {
-    int namepos=0;
-    for (ti = 0; ti < NSEEL_VARS_PER_BLOCK; ti ++)
-    {        
-      if (!ctx->varTable_Names[wb][namepos] || !strnicmp(ctx->varTable_Names[wb]+namepos,name,NSEEL_MAX_VARIABLE_NAMELEN))
-      {
-        break;
-      }
-      namepos += NSEEL_MAX_VARIABLE_NAMELEN;
-      i++;
-    }
-    if (ti < NSEEL_VARS_PER_BLOCK)
-      break;
+    if (!strnicmp(var_name(ctx,i-1),name,NSEEL_MAX_VARIABLE_NAMELEN)) return i-1;
+    h=(h+1)&m;
   }
-  if (wb == ctx->varTable_numBlocks)
-  {
-    ti=0;
-    // add new block
-    if (!(ctx->varTable_numBlocks&(NSEEL_VARS_MALLOC_CHUNKSIZE-1)) || !ctx->varTable_Values || !ctx->varTable_Names )
-    {
-      ctx->varTable_Values = (EEL_F **)realloc(ctx->varTable_Values,(ctx->varTable_numBlocks+NSEEL_VARS_MALLOC_CHUNKSIZE) * sizeof(EEL_F *));
-      ctx->varTable_Names = (char **)realloc(ctx->varTable_Names,(ctx->varTable_numBlocks+NSEEL_VARS_MALLOC_CHUNKSIZE) * sizeof(char *));
-    }
-    ctx->varTable_numBlocks++;
+  return -1;
+}
+
+static void var_hash_insert(compileContext *ctx, int i)
+{
+  unsigned int m=ctx->varTable_HashSize-1;
+  unsigned int h=var_hash(var_name(ctx,i))&m;
+  while (ctx->varTable_Hash[h]) h=(h+1)&m;
+  ctx->varTable_Hash[h]=i+1;
+}
 
-    ctx->varTable_Values[wb] = (EEL_F *)calloc(sizeof(EEL_F),NSEEL_VARS_PER_BLOCK);
-    ctx->varTable_Names[wb] = (char *)calloc(NSEEL_MAX_VARIABLE_NAMELEN,NSEEL_VARS_PER_BLOCK);
+// names slot i (which must be the next free one) and indexes it
+static void var_add(compileContext *ctx, int i, const char *name)
+{
+  strncpy(var_name(ctx,i),name,NSEEL_MAX_VARIABLE_NAMELEN);
+  if ((ctx->varTable_numVars+1)*2 > ctx->varTable_HashSize)
+  {
+    int x;
+    free(ctx->varTable_Hash);
+    ctx->varTable_HashSize = ctx->varTable_HashSize ? ctx->varTable_HashSize*2 : 256;
+    ctx->varTable_Hash = (int *)calloc(sizeof(int),ctx->varTable_HashSize);
+    for (x = 0; x < ctx->varTable_numVars; x ++) var_hash_insert(ctx,x);
   }
+  var_hash_insert(ctx,i);
+  ctx->varTable_numVars++;
+}
 
-  nameptr=ctx->varTable_Names[wb]+ti*NSEEL_MAX_VARIABLE_NAMELEN;
-  if (!nameptr[0])
+static INT_PTR register_var(compileContext *ctx, const char *name, EEL_F **ptr)
+{
+  int i=var_find(ctx,name);
+  if (i < 0)
   {
-    strncpy(nameptr,name,NSEEL_MAX_VARIABLE_NAMELEN);
+    int wb;
+    i=ctx->varTable_numVars;
+    wb=i/NSEEL_VARS_PER_BLOCK;
+    if (wb == ctx->varTable_numBlocks)
+    {
+      // add new block
+      if (!(ctx->varTable_numBlocks&(NSEEL_VARS_MALLOC_CHUNKSIZE-1)) || !ctx->varTable_Values || !ctx->varTable_Names )
+      {
+        ctx->varTable_Values = (EEL_F **)realloc(ctx->varTable_Values,(ctx->varTable_numBlocks+NSEEL_VARS_MALLOC_CHUNKSIZE) * sizeof(EEL_F *));
+        ctx->varTable_Names = (char **)realloc(ctx->varTable_Names,(ctx->varTable_numBlocks+NSEEL_VARS_MALLOC_CHUNKSIZE) * sizeof(char *));
+      }
+      ctx->varTable_numBlocks++;
+
+      ctx->varTable_Values[wb] = (EEL_F *)calloc(sizeof(EEL_F),NSEEL_VARS_PER_BLOCK);
+      ctx->varTable_Names[wb] = (char *)calloc(NSEEL_MAX_VARIABLE_NAMELEN,NSEEL_VARS_PER_BLOCK);
+    }
+    // an empty name gets the next free slot without claiming it, as before
+    if (*name) var_add(ctx,i,name);
   }
-  if (ptr) *ptr = ctx->varTable_Values[wb] + ti;
+  if (ptr) *ptr = ctx->varTable_Values[i/NSEEL_VARS_PER_BLOCK] + i%NSEEL_VARS_PER_BLOCK;
   return i;
 }
 
@@ -171,7 +210,8 @@ INT_PTR nseel_setVar(compileContext *ctx, INT_PTR varNum)
     nameptr=ctx->varTable_Names[wb]+ti*NSEEL_MAX_VARIABLE_NAMELEN;
     if (!nameptr[0]) 
     {
-      strncpy(nameptr,ctx->lastVar,NSEEL_MAX_VARIABLE_NAMELEN);
+      if (varNum == ctx->varTable_numVars && ctx->lastVar[0]) var_add(ctx,(int)varNum,ctx->lastVar);
+      else strncpy(nameptr,ctx->lastVar,NSEEL_MAX_VARIABLE_NAMELEN);
     }  
     return varNum;  
   }
@@ -184,7 +224,10 @@ INT_PTR nseel_getVar(compileContext *ctx, INT_PTR i)
   if (i >= 0 && i < (NSEEL_VARS_PER_BLOCK*ctx->varTable_numBlocks))
     return nseel_createCompiledValue(ctx,0, ctx->varTable_Values[i/NSEEL_VARS_PER_BLOCK] + i%NSEEL_VARS_PER_BLOCK); 
   if (i >= NSEEL_GLOBALVAR_BASE && i < NSEEL_GLOBALVAR_BASE+100) 
+  {
+    ctx->l_globals=1;
     return nseel_createCompiledValue(ctx,0, nseel_globalregs+i-NSEEL_GLOBALVAR_BASE);
+  }
 
   return nseel_createCompiledValue(ctx,0, NULL);
 }
@@ -241,7 +284,7 @@ INT_PTR nseel_translate(compileContext *ctx, int type)
 //------------------------------------------------------------------------------
 INT_PTR nseel_lookup(compileContext *ctx, int *typeOfObject)
 {
-	int i, ti, wb;
+	int i;
 	const char *nptr;
 	nseel_gettoken(ctx,ctx->yytext, sizeof(ctx->yytext));
 
@@ -251,27 +294,12 @@ INT_PTR nseel_lookup(compileContext *ctx, int *typeOfObject)
 		return i+NSEEL_GLOBALVAR_BASE;
 	}
 
-	i=0;
-	for (wb = 0; wb < ctx->varTable_numBlocks; wb ++)
+	if ((i=var_find(ctx,ctx->yytext)) >= 0)
 	{
-		int namepos=0;
-		for (ti = 0; ti < NSEEL_VARS_PER_BLOCK; ti ++)
-		{        
-			if (!ctx->varTable_Names[wb][namepos]) break;
-
-			if (!strnicmp(ctx->varTable_Names[wb]+namepos,ctx->yytext,NSEEL_MAX_VARIABLE_NAMELEN))
-			{
-				*typeOfObject = IDENTIFIER;
-				return i;
-			}
-
-			namepos += NSEEL_MAX_VARIABLE_NAMELEN;
-			i++;
-		}
-		if (ti < NSEEL_VARS_PER_BLOCK) break;
+		*typeOfObject = IDENTIFIER;
+		return i;
 	}
 
-
 	nptr = ctx->yytext;
 	if (!strcasecmp(nptr,"if")) nptr="_if";
 	else if (!strcasecmp(nptr,"bnot")) nptr="_not";
@@ -288,6 +316,8 @@ INT_PTR nseel_lookup(compileContext *ctx, int *typeOfObject)
 		functionType *f=nseel_getFunctionFromTable(i);
 		if (!strcasecmp(f->name, nptr))
 		{
+			if (!strcmp(f->name,"_gmem")) ctx->l_globals=1;
+			if (nseel_isVolatileFunction(f)) ctx->l_volatile=1;
 			switch (f->nParams)
 			{
 			case 1: *typeOfObject = FUNCTION1; break;
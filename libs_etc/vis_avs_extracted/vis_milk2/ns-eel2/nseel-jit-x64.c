@@ -0,0 +1,2285 @@
+/*
+  Expression Evaluator Library (NS-EEL) v2
+  Copyright (C) 2004-2008 Cockos Incorporated
+  Copyright (C) 1999-2003 Nullsoft, Inc.
+  
+  nseel-jit-x64.c: native x86-64 code generator (included by nseel-compiler.c)
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+// On x86-64 the parser actions build an expression tree instead of stitching
+// snippets together, and NSEEL_code_compile() hands the statements to
+// nseel_jit_generate(), which emits SSE2 code directly:
+//
+//  - intermediate values live in xmm0-xmm4 (xmm5 is scratch), spilling to
+//    the stack frame only for deeply nested expressions.
+//  - the most referenced variables of a code handle are kept in xmm6-xmm15
+//    for the whole run, loaded on entry and written back on exit (and around
+//    calls that could see them).
+//  - arithmetic, comparisons, if/loop/while, min/max/abs/sign etc are inlined;
+//    only transcendental functions, megabuf allocation and host functions are
+//    called. Host functions registered with the _asm_generic* stubs are called
+//    directly through their C function pointer.
+//
+// Semantics follow the x87 snippets: operands are read at the time of the
+// operation (so "x+(x=1)" is 2), float->int conversions truncate, and _set()
+// stores denormals/inf/nan as 0.
+
+#define JIT_NTEMPS 5        // xmm0-xmm4
+#define JIT_SCRATCH 5       // xmm5
+#define JIT_CACHE_FIRST 6   // xmm6-xmm15
+#define JIT_NCACHE 10
+
+// stack frame: 32 bytes of shadow space (win64), then 8 byte slots
+#define JIT_SLOT(x) (32+(x)*8)
+#define JIT_SLOT_ABSMASK 0    // 16 byte aligned
+#define JIT_SLOT_SIGNMASK 2   // 16 byte aligned
+#define JIT_SLOT_ONE 4        // 16 byte aligned
+#define JIT_SLOT_CLOSEFACT 5
+#define JIT_SLOT_NULLMEM 6    // megabuf() target when allocation fails
+#define JIT_SLOT_FIRST 7
+
+#define X64_RAX 0
+#define X64_RCX 1
+#define X64_RDX 2
+#define X64_RSP 4
+#define X64_RSI 6
+#define X64_RDI 7
+#define X64_R8 8
+#define X64_R9 9
+
+#define X64_JB 2
+#define X64_JAE 3
+#define X64_JZ 4
+#define X64_JNZ 5
+#define X64_JL 0xc
+
+#define SSE_LE 2
+#define SSE_NLE 6
+
+#ifdef _WIN64
+static const int jit_argregs[4]={X64_RCX,X64_RDX,X64_R8,X64_R9};
+#define JIT_CALLS_KEEP_CACHE 1 // xmm6-xmm15 are callee saved
+#else
+static const int jit_argregs[4]={X64_RDI,X64_RSI,X64_RDX,X64_RCX};
+#define JIT_CALLS_KEEP_CACHE 0
+#endif
+
+enum
+{
+  JOP_CONST, JOP_VAR,
+  JOP_SEQ, JOP_NEG,
+  JOP_ADD, JOP_SUB, JOP_MUL, JOP_DIV, JOP_MOD, JOP_BITOR, JOP_BITAND, JOP_MIN, JOP_MAX,
+  JOP_EQ, JOP_NE, JOP_LT, JOP_GT, JOP_LE, JOP_GE,
+  JOP_NOT, JOP_ABS, JOP_SQR, JOP_SQRT, JOP_SIGN,
+  JOP_IF, JOP_LAND, JOP_LOR, JOP_LOOP, JOP_WHILE,
+  JOP_SET, JOP_ADDOP, JOP_SUBOP, JOP_MULOP, JOP_DIVOP, JOP_MODOP, JOP_OROP, JOP_ANDOP, JOP_CALLOP,
+  JOP_CALL, // double f(double [,double])
+  JOP_CALLP, // double f(double * [,double *])
+  JOP_MEM,
+  JOP_GENERIC, JOP_GENERIC_RETD,
+  JOP_UNSUPPORTED
+};
+
+typedef struct _jitNode
+{
+  int op;
+  int nparms;
+  struct _jitNode *parms[3];
+  EEL_F value;    // JOP_CONST
+  EEL_F *addr;    // JOP_VAR
+  void *fptr;     // called function
+  void *fctx;     // context parameter of megabuf/generic functions
+  int fn;         // function table index, to recompute fctx for another VM
+  const char *name;
+} jitNode;
+
+typedef struct
+{
+  EEL_F *addr;
+  int refs;
+  int written;
+} jitVarUse;
+
+// an imm64 in the code that depends on the VM: a variable address, or the
+// fctx of function fn. the code cache patches these to rebind code to another VM.
+typedef struct _jitReloc
+{
+  int pos;
+  EEL_F *addr;
+  int fn;
+} jitReloc;
+
+// code cache entry, see nseel_jit_compileCached()
+typedef struct _codeCacheEnt
+{
+  struct _codeCacheEnt *hnext;          // hash chain
+  struct _codeCacheEnt *lprev, *lnext;  // entries not in use, most recent first
+  unsigned int hash;
+  int refs, dead;
+  char *text;         // normalized source
+  char *names;        // variable names (NSEEL_MAX_VARIABLE_NAMELEN each) of the VM after compiling.
+  int nbefore, nafter;  // the first nbefore were there before, the rest were added by the code
+  int nvars;          // variables the code refers to:
+  int *var_index;     // index in names
+  EEL_F **var_src;    // address in the VM it was compiled in. only used to look up tree nodes.
+  int nrelocs;
+  int *reloc_pos;
+  int *reloc_ref;     // >= 0: variable, < 0: fctx of function -1-ref
+  unsigned char *code;
+  int code_len;
+  startPtr *tree;     // copy of the expression tree, one allocation
+  int code_stats[4];
+  int uses_globals;
+  int uses_volatile;
+} codeCacheEnt;
+
+typedef struct
+{
+  compileContext *ctx;
+  unsigned char *buf;
+  int len, alloc;
+  int err;
+  const char *errname;
+
+  jitReloc *relocs;
+  int nrelocs;
+
+  int slots, maxslots;
+
+  int ncache;
+  EEL_F *cache[JIT_NCACHE];
+  int cache_written[JIT_NCACHE];
+} jitState;
+
+
+// the function tables and hosts refer to the snippet symbols; with the code
+// generator they are only used to identify functions, so they just need to
+// be distinct addresses.
+static volatile int nseel_jit_marker;
+#define JIT_MARKER(x) void x(void) { nseel_jit_marker=__LINE__*2; } void x##_end(void) { nseel_jit_marker=__LINE__*2+1; }
+
+JIT_MARKER(nseel_asm_sin)
+JIT_MARKER(nseel_asm_cos)
+JIT_MARKER(nseel_asm_tan)
+JIT_MARKER(nseel_asm_1pdd)
+JIT_MARKER(nseel_asm_2pdd)
+JIT_MARKER(nseel_asm_2pdds)
+JIT_MARKER(nseel_asm_1pp)
+JIT_MARKER(nseel_asm_2pp)
+JIT_MARKER(nseel_asm_sqr)
+JIT_MARKER(nseel_asm_sqrt)
+JIT_MARKER(nseel_asm_log)
+JIT_MARKER(nseel_asm_log10)
+JIT_MARKER(nseel_asm_abs)
+JIT_MARKER(nseel_asm_min)
+JIT_MARKER(nseel_asm_max)
+JIT_MARKER(nseel_asm_sig)
+JIT_MARKER(nseel_asm_sign)
+JIT_MARKER(nseel_asm_band)
+JIT_MARKER(nseel_asm_bor)
+JIT_MARKER(nseel_asm_bnot)
+JIT_MARKER(nseel_asm_if)
+JIT_MARKER(nseel_asm_repeat)
+JIT_MARKER(nseel_asm_repeatwhile)
+JIT_MARKER(nseel_asm_equal)
+JIT_MARKER(nseel_asm_notequal)
+JIT_MARKER(nseel_asm_below)
+JIT_MARKER(nseel_asm_above)
+JIT_MARKER(nseel_asm_beloweq)
+JIT_MARKER(nseel_asm_aboveeq)
+JIT_MARKER(nseel_asm_assign)
+JIT_MARKER(nseel_asm_add)
+JIT_MARKER(nseel_asm_sub)
+JIT_MARKER(nseel_asm_add_op)
+JIT_MARKER(nseel_asm_sub_op)
+JIT_MARKER(nseel_asm_mul)
+JIT_MARKER(nseel_asm_div)
+JIT_MARKER(nseel_asm_mul_op)
+JIT_MARKER(nseel_asm_div_op)
+JIT_MARKER(nseel_asm_mod)
+JIT_MARKER(nseel_asm_mod_op)
+JIT_MARKER(nseel_asm_or)
+JIT_MARKER(nseel_asm_and)
+JIT_MARKER(nseel_asm_or_op)
+JIT_MARKER(nseel_asm_and_op)
+JIT_MARKER(nseel_asm_uplus)
+JIT_MARKER(nseel_asm_uminus)
+JIT_MARKER(nseel_asm_invsqrt)
+JIT_MARKER(nseel_asm_exec2)
+JIT_MARKER(_asm_generic3parm)
+JIT_MARKER(_asm_generic3parm_retd)
+JIT_MARKER(_asm_generic2parm)
+JIT_MARKER(_asm_generic2parm_retd)
+JIT_MARKER(_asm_generic1parm)
+JIT_MARKER(_asm_generic1parm_retd)
+JIT_MARKER(_asm_megabuf)
+
+static double jit_sin(double a) { return sin(a); }
+static double jit_cos(double a) { return cos(a); }
+static double jit_tan(double a) { return tan(a); }
+static double jit_log(double a) { return log(a); }
+static double jit_log10(double a) { return log10(a); }
+static double jit_invsqrt(double a)
+{
+  union { float f; int i; } y;
+  y.f=(float)a;
+  y.i=0x5f3759df-(y.i>>1);
+  return y.f*(onepointfive+negativezeropointfive*a*y.f*y.f);
+}
+
+
+//---------------------------------------------------------------------------------------------------------------
+// tree construction (called by the parser)
+
+static jitNode *jit_newNode(compileContext *ctx, int op, int nparms)
+{
+  jitNode *n=(jitNode *)__newBlock((llBlock **)&ctx->tmpblocks_head,sizeof(jitNode));
+  if (n)
+  {
+    memset(n,0,sizeof(jitNode));
+    n->op=op;
+    n->nparms=nparms;
+  }
+  return n;
+}
+
+// value the function's preprocessor would patch into the snippet, ie the
+// context pointer of megabuf/generic functions
+static void *jit_pprocValue(compileContext *ctx, functionType *f)
+{
+  INT_PTR v=~(INT_PTR)0;
+  if (!f->pProc) return NULL;
+  f->pProc(&v,sizeof(v),ctx);
+  return v == ~(INT_PTR)0 ? NULL : (void *)v;
+}
+
+static void jit_resolveFunction(compileContext *ctx, jitNode *n, int fn)
+{
+  static const struct { void *afunc; int op; void *fptr; } tab[]=
+  {
+    { nseel_asm_if, JOP_IF },
+    { nseel_asm_band, JOP_LAND },
+    { nseel_asm_bor, JOP_LOR },
+    { nseel_asm_repeat, JOP_LOOP },
+    { nseel_asm_repeatwhile, JOP_WHILE },
+    { nseel_asm_bnot, JOP_NOT },
+    { nseel_asm_equal, JOP_EQ },
+    { nseel_asm_notequal, JOP_NE },
+    { nseel_asm_below, JOP_LT },
+    { nseel_asm_above, JOP_GT },
+    { nseel_asm_beloweq, JOP_LE },
+    { nseel_asm_aboveeq, JOP_GE },
+    { nseel_asm_assign, JOP_SET },
+    { nseel_asm_mod, JOP_MOD },
+    { nseel_asm_add_op, JOP_ADDOP },
+    { nseel_asm_sub_op, JOP_SUBOP },
+    { nseel_asm_mul_op, JOP_MULOP },
+    { nseel_asm_div_op, JOP_DIVOP },
+    { nseel_asm_mod_op, JOP_MODOP },
+    { nseel_asm_or_op, JOP_OROP },
+    { nseel_asm_and_op, JOP_ANDOP },
+    { nseel_asm_sqr, JOP_SQR },
+    { nseel_asm_sqrt, JOP_SQRT },
+    { nseel_asm_abs, JOP_ABS },
+    { nseel_asm_min, JOP_MIN },
+    { nseel_asm_max, JOP_MAX },
+    { nseel_asm_sign, JOP_SIGN },
+    { nseel_asm_exec2, JOP_SEQ },
+    { nseel_asm_sin, JOP_CALL, jit_sin },
+    { nseel_asm_cos, JOP_CALL, jit_cos },
+    { nseel_asm_tan, JOP_CALL, jit_tan },
+    { nseel_asm_log, JOP_CALL, jit_log },
+    { nseel_asm_log10, JOP_CALL, jit_log10 },
+    { nseel_asm_invsqrt, JOP_CALL, jit_invsqrt },
+  };
+  functionType *f=nseel_getFunctionFromTable(fn);
+  int x;
+
+  n->op=JOP_UNSUPPORTED;
+  if (!f) return;
+  n->name=f->name;
+
+  for (x = 0; x < sizeof(tab)/sizeof(tab[0]); x ++)
+  {
+    if (f->afunc == tab[x].afunc)
+    {
+      n->op=tab[x].op;
+      n->fptr=tab[x].fptr;
+      return;
+    }
+  }
+
+  n->fptr=f->replptrs[0];
+  if (f->afunc == (void*)nseel_asm_1pdd || f->afunc == (void*)nseel_asm_2pdd) n->op=JOP_CALL;
+  else if (f->afunc == (void*)nseel_asm_2pdds) n->op=JOP_CALLOP;
+  else if (f->afunc == (void*)nseel_asm_1pp || f->afunc == (void*)nseel_asm_2pp) n->op=JOP_CALLP;
+  else if (f->afunc == (void*)_asm_megabuf)
+  {
+    n->op=JOP_MEM;
+    n->fptr=f->replptrs[1];
+    n->fctx=jit_pprocValue(ctx,f);
+    n->fn=fn;
+  }
+  else if (f->afunc == (void*)_asm_generic1parm || f->afunc == (void*)_asm_generic2parm || f->afunc == (void*)_asm_generic3parm)
+  {
+    n->op=JOP_GENERIC;
+    n->fctx=jit_pprocValue(ctx,f);
+    n->fn=fn;
+  }
+  else if (f->afunc == (void*)_asm_generic1parm_retd || f->afunc == (void*)_asm_generic2parm_retd || f->afunc == (void*)_asm_generic3parm_retd)
+  {
+    n->op=JOP_GENERIC_RETD;
+    n->fctx=jit_pprocValue(ctx,f);
+    n->fn=fn;
+  }
+}
+
+INT_PTR nseel_createCompiledValue(compileContext *ctx, EEL_F value, EEL_F *addrValue)
+{
+  jitNode *n=jit_newNode(ctx,addrValue ? JOP_VAR : JOP_CONST,0);
+  if (n)
+  {
+    n->value=value;
+    n->addr=addrValue;
+  }
+  return (INT_PTR)n;
+}
+
+INT_PTR nseel_createCompiledFunction1(compileContext *ctx, int fntype, INT_PTR fn, INT_PTR code)
+{
+  jitNode *a=(jitNode *)code, *n;
+  if (!a) return 0;
+
+  ctx->computTableTop++;
+  if (fntype == MATH_SIMPLE)
+  {
+    if (fn == FN_UPLUS) return code;
+    if (a->op == JOP_CONST) // fold -constant
+    {
+      a->value=-a->value;
+      return code;
+    }
+    n=jit_newNode(ctx,JOP_NEG,1);
+  }
+  else
+  {
+    n=jit_newNode(ctx,JOP_UNSUPPORTED,1);
+    if (n) jit_resolveFunction(ctx,n,(int)fn);
+  }
+  if (n) n->parms[0]=a;
+  return (INT_PTR)n;
+}
+
+INT_PTR nseel_createCompiledFunction2(compileContext *ctx, int fntype, INT_PTR fn, INT_PTR code1, INT_PTR code2)
+{
+  jitNode *a=(jitNode *)code1, *b=(jitNode *)code2, *n;
+  if (!a || !b) return 0;
+
+  ctx->computTableTop++;
+  if (fntype == MATH_SIMPLE)
+  {
+    int op;
+    switch (fn)
+    {
+      case FN_ASSIGN: op=JOP_SET; break;
+      case FN_MULTIPLY: op=JOP_MUL; break;
+      case FN_DIVIDE: op=JOP_DIV; break;
+      case FN_MODULO: op=JOP_SEQ; break; // ; inside parentheses
+      case FN_ADD: op=JOP_ADD; break;
+      case FN_SUB: op=JOP_SUB; break;
+      case FN_AND: op=JOP_BITAND; break;
+      case FN_OR: op=JOP_BITOR; break;
+      default: op=JOP_UNSUPPORTED; break;
+    }
+    if (a->op == JOP_CONST && b->op == JOP_CONST && op >= JOP_ADD && op <= JOP_DIV) // fold constants
+    {
+      if (op == JOP_ADD) a->value+=b->value;
+      else if (op == JOP_SUB) a->value-=b->value;
+      else if (op == JOP_MUL) a->value*=b->value;
+      else a->value/=b->value;
+      return code1;
+    }
+    n=jit_newNode(ctx,op,2);
+  }
+  else
+  {
+    n=jit_newNode(ctx,JOP_UNSUPPORTED,2);
+    if (n) jit_resolveFunction(ctx,n,(int)fn);
+  }
+  if (n)
+  {
+    n->parms[0]=a;
+    n->parms[1]=b;
+  }
+  return (INT_PTR)n;
+}
+
+INT_PTR nseel_createCompiledFunction3(compileContext *ctx, int fntype, INT_PTR fn, INT_PTR code1, INT_PTR code2, INT_PTR code3)
+{
+  jitNode *n;
+  if (!code1 || !code2 || !code3) return 0;
+
+  ctx->computTableTop++;
+  n=jit_newNode(ctx,JOP_UNSUPPORTED,3);
+  if (n)
+  {
+    if (fntype == MATH_FN) jit_resolveFunction(ctx,n,(int)fn);
+    n->parms[0]=(jitNode *)code1;
+    n->parms[1]=(jitNode *)code2;
+    n->parms[2]=(jitNode *)code3;
+  }
+  return (INT_PTR)n;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------
+// instruction encoding
+
+static void jit_emit(jitState *s, int b)
+{
+  if (s->err) return;
+  if (s->len >= s->alloc)
+  {
+    int na=s->alloc*2+4096;
+    unsigned char *nb=(unsigned char *)realloc(s->buf,na);
+    if (!nb)
+    {
+      s->err=1;
+      return;
+    }
+    s->buf=nb;
+    s->alloc=na;
+  }
+  s->buf[s->len++]=(unsigned char)b;
+}
+
+static void jit_emit32(jitState *s, int v)
+{
+  jit_emit(s,v&0xff);
+  jit_emit(s,(v>>8)&0xff);
+  jit_emit(s,(v>>16)&0xff);
+  jit_emit(s,(v>>24)&0xff);
+}
+
+static void jit_emit64(jitState *s, INT_PTR v)
+{
+  jit_emit32(s,(int)v);
+  jit_emit32(s,(int)(v>>32));
+}
+
+static void x64_rex(jitState *s, int w, int r, int b)
+{
+  int v=0x40|(w?8:0)|((r&8)?4:0)|((b&8)?1:0);
+  if (v != 0x40) jit_emit(s,v);
+}
+
+static void x64_modrm(jitState *s, int r, int rm, int mem, int disp)
+{
+  int mod;
+  if (!mem)
+  {
+    jit_emit(s,0xc0|((r&7)<<3)|(rm&7));
+    return;
+  }
+  mod = (!disp && (rm&7) != 5) ? 0 : (disp >= -128 && disp < 128) ? 1 : 2;
+  jit_emit(s,(mod<<6)|((r&7)<<3)|(rm&7));
+  if ((rm&7) == 4) jit_emit(s,0x24); // sib for rsp/r12
+  if (mod == 1) jit_emit(s,disp&0xff);
+  else if (mod == 2) jit_emit32(s,disp);
+}
+
+// [rex] op modrm
+static void x64_op(jitState *s, int w, int op, int r, int rm, int mem, int disp)
+{
+  x64_rex(s,w,r,rm);
+  jit_emit(s,op);
+  x64_modrm(s,r,rm,mem,disp);
+}
+
+// [prefix] [rex] 0f op modrm
+static void x64_op0f(jitState *s, int pfx, int w, int op, int r, int rm, int mem, int disp)
+{
+  if (pfx) jit_emit(s,pfx);
+  x64_rex(s,w,r,rm);
+  jit_emit(s,0x0f);
+  jit_emit(s,op);
+  x64_modrm(s,r,rm,mem,disp);
+}
+
+static void x64_movimm(jitState *s, int r, INT_PTR v)
+{
+  if (v >= 0 && v <= 0x7fffffff) // mov r32, imm32 (zero extends)
+  {
+    x64_rex(s,0,0,r);
+    jit_emit(s,0xb8+(r&7));
+    jit_emit32(s,(int)v);
+  }
+  else
+  {
+    x64_rex(s,1,0,r);
+    jit_emit(s,0xb8+(r&7));
+    jit_emit64(s,v);
+  }
+}
+
+// mov r, imm64 that the code cache can patch (see jitReloc)
+static void x64_movreloc(jitState *s, int r, void *v, EEL_F *addr, int fn)
+{
+  x64_rex(s,1,0,r);
+  jit_emit(s,0xb8+(r&7));
+  if (!s->err)
+  {
+    if (!(s->nrelocs&63))
+    {
+      jitReloc *nr=(jitReloc *)realloc(s->relocs,(s->nrelocs+64)*sizeof(jitReloc));
+      if (!nr) s->err=1;
+      else s->relocs=nr;
+    }
+    if (!s->err)
+    {
+      s->relocs[s->nrelocs].pos=s->len;
+      s->relocs[s->nrelocs].addr=addr;
+      s->relocs[s->nrelocs].fn=fn;
+      s->nrelocs++;
+    }
+  }
+  jit_emit64(s,(INT_PTR)v);
+}
+#define x64_movvar(s,r,addr) x64_movreloc(s,r,addr,addr,-1)
+#define x64_movfctx(s,r,n) x64_movreloc(s,r,(n)->fctx,NULL,(n)->fn)
+
+#define x64_movsd_load(s,x,base,disp) x64_op0f(s,0xf2,0,0x10,x,base,1,disp)
+#define x64_movsd_store(s,x,base,disp) x64_op0f(s,0xf2,0,0x11,x,base,1,disp)
+#define x64_sd(s,op,x,y) x64_op0f(s,0xf2,0,op,x,y,0,0) // 51 sqrt 58 add 59 mul 5c sub 5d min 5e div 5f max
+#define x64_sd_slot(s,op,x,slot) x64_op0f(s,0xf2,0,op,x,X64_RSP,1,JIT_SLOT(slot))
+#define x64_pd_slot(s,op,x,slot) x64_op0f(s,0x66,0,op,x,X64_RSP,1,JIT_SLOT(slot)) // 54 and 57 xor
+#define x64_xorpd(s,x,y) x64_op0f(s,0x66,0,0x57,x,y,0,0)
+#define x64_ucomisd_slot(s,x,slot) x64_op0f(s,0x66,0,0x2e,x,X64_RSP,1,JIT_SLOT(slot))
+#define x64_movq_from_xmm(s,r,x) x64_op0f(s,0x66,1,0x7e,x,r,0,0)
+#define x64_movq_to_xmm(s,x,r) x64_op0f(s,0x66,1,0x6e,x,r,0,0)
+#define x64_cvttsd2si(s,w,r,x) x64_op0f(s,0xf2,w,0x2c,r,x,0,0)
+#define x64_cvtsi2sd(s,w,x,r) x64_op0f(s,0xf2,w,0x2a,x,r,0,0)
+#define x64_mov_slot_load(s,r,slot) x64_op(s,1,0x8b,r,X64_RSP,1,JIT_SLOT(slot))
+#define x64_mov_slot_store(s,r,slot) x64_op(s,1,0x89,r,X64_RSP,1,JIT_SLOT(slot))
+
+static void x64_movapd(jitState *s, int x, int y)
+{
+  if (x != y) x64_op0f(s,0x66,0,0x28,x,y,0,0);
+}
+
+static void x64_cmpsd(jitState *s, int x, int y, int pred)
+{
+  x64_op0f(s,0xf2,0,0xc2,x,y,0,0);
+  jit_emit(s,pred);
+}
+
+static void x64_call(jitState *s, void *f)
+{
+  x64_movimm(s,X64_RAX,(INT_PTR)f);
+  x64_op(s,0,0xff,2,X64_RAX,0,0); // call rax
+}
+
+// forward jump (cc<0 for jmp), returns the position to patch
+static int x64_jump(jitState *s, int cc)
+{
+  if (cc < 0) jit_emit(s,0xe9);
+  else
+  {
+    jit_emit(s,0x0f);
+    jit_emit(s,0x80|cc);
+  }
+  jit_emit32(s,0);
+  return s->len;
+}
+
+static void x64_patch(jitState *s, int pos)
+{
+  if (!s->err)
+  {
+    int rel=s->len-pos;
+    memcpy(s->buf+pos-4,&rel,4);
+  }
+}
+
+static void x64_jumpback(jitState *s, int cc, int target)
+{
+  x64_jump(s,cc);
+  if (!s->err)
+  {
+    int rel=target-s->len;
+    memcpy(s->buf+s->len-4,&rel,4);
+  }
+}
+
+
+//---------------------------------------------------------------------------------------------------------------
+// code generation
+
+static int jit_allocSlot(jitState *s)
+{
+  int r=s->slots++;
+  if (s->slots > s->maxslots) s->maxslots=s->slots;
+  return r;
+}
+
+static int jit_cacheReg(jitState *s, EEL_F *addr)
+{
+  int x;
+  for (x = 0; x < s->ncache; x ++)
+    if (s->cache[x] == addr) return JIT_CACHE_FIRST+x;
+  return -1;
+}
+
+static void jit_storeCache(jitState *s)
+{
+  int x;
+  for (x = 0; x < s->ncache; x ++)
+  {
+    if (s->cache_written[x])
+    {
+      x64_movvar(s,X64_RCX,s->cache[x]);
+      x64_movsd_store(s,JIT_CACHE_FIRST+x,X64_RCX,0);
+    }
+  }
+}
+
+static void jit_loadCache(jitState *s)
+{
+  int x;
+  for (x = 0; x < s->ncache; x ++)
+  {
+    x64_movvar(s,X64_RCX,s->cache[x]);
+    x64_movsd_load(s,JIT_CACHE_FIRST+x,X64_RCX,0);
+  }
+}
+
+// saves the live temporaries (xmm0..d-1) and, if the callee could clobber or
+// look at them, the cached variables. returns the slot base for jit_callEnd.
+static int jit_callBegin(jitState *s, int d, int impure)
+{
+  int x, base=s->slots;
+  for (x = 0; x < d; x ++) x64_movsd_store(s,x,X64_RSP,JIT_SLOT(jit_allocSlot(s)));
+  if (impure || !JIT_CALLS_KEEP_CACHE) jit_storeCache(s);
+  return base;
+}
+
+// restores what jit_callBegin saved. leaves rax alone.
+static void jit_callEnd(jitState *s, int d, int base, int impure)
+{
+  int x;
+  if (impure || !JIT_CALLS_KEEP_CACHE) jit_loadCache(s);
+  for (x = 0; x < d; x ++) x64_movsd_load(s,x,X64_RSP,JIT_SLOT(base+x));
+  s->slots=base;
+}
+
+static void jit_loadConst(jitState *s, int x, EEL_F v)
+{
+  INT_PTR bits;
+  memcpy(&bits,&v,sizeof(bits));
+  if (!bits) x64_xorpd(s,x,x);
+  else
+  {
+    x64_movimm(s,X64_RAX,bits);
+    x64_movq_to_xmm(s,x,X64_RAX);
+  }
+}
+
+static int jit_isLeaf(jitNode *n)
+{
+  return n->op == JOP_CONST || n->op == JOP_VAR;
+}
+
+static void jit_loadLeaf(jitState *s, int x, jitNode *n)
+{
+  int c;
+  if (n->op == JOP_CONST) jit_loadConst(s,x,n->value);
+  else if ((c=jit_cacheReg(s,n->addr)) >= 0) x64_movapd(s,x,c);
+  else
+  {
+    x64_movvar(s,X64_RAX,n->addr);
+    x64_movsd_load(s,x,X64_RAX,0);
+  }
+}
+
+static void jit_storeVar(jitState *s, int x, EEL_F *addr)
+{
+  int c=jit_cacheReg(s,addr);
+  if (c >= 0) x64_movapd(s,c,x);
+  else
+  {
+    x64_movvar(s,X64_RAX,addr);
+    x64_movsd_store(s,x,X64_RAX,0);
+  }
+}
+
+// register holding a leaf: its cache register, or xmm5
+static int jit_leafReg(jitState *s, jitNode *n)
+{
+  if (n->op == JOP_VAR)
+  {
+    int c=jit_cacheReg(s,n->addr);
+    if (c >= 0) return c;
+  }
+  jit_loadLeaf(s,JIT_SCRATCH,n);
+  return JIT_SCRATCH;
+}
+
+static void jit_gen(jitState *s, jitNode *n, int d);
+
+// evaluates a into xmm(d) and b into the returned register. leaves are read
+// last, like the snippets which only dereferenced their operands at the end.
+static int jit_genOperands(jitState *s, jitNode *a, jitNode *b, int d)
+{
+  if (jit_isLeaf(b))
+  {
+    jit_gen(s,a,d);
+    return jit_leafReg(s,b);
+  }
+  if (jit_isLeaf(a))
+  {
+    jit_gen(s,b,d);
+    x64_movapd(s,JIT_SCRATCH,d);
+    jit_loadLeaf(s,d,a);
+    return JIT_SCRATCH;
+  }
+  jit_gen(s,a,d);
+  if (d+1 < JIT_NTEMPS)
+  {
+    jit_gen(s,b,d+1);
+    return d+1;
+  }
+  else
+  {
+    int base=s->slots, sl=jit_allocSlot(s);
+    x64_movsd_store(s,d,X64_RSP,JIT_SLOT(sl));
+    jit_gen(s,b,d);
+    x64_movapd(s,JIT_SCRATCH,d);
+    x64_movsd_load(s,d,X64_RSP,JIT_SLOT(sl));
+    s->slots=base;
+    return JIT_SCRATCH;
+  }
+}
+
+// xmm(d) = (pred ? 1.0 : 0.0), pred comparing (x,y) or (y,x) with cmpsd
+static void jit_compare(jitState *s, int d, int rb, int pred, int swap)
+{
+  if (!swap) x64_cmpsd(s,d,rb,pred);
+  else
+  {
+    x64_movapd(s,JIT_SCRATCH,rb);
+    x64_cmpsd(s,JIT_SCRATCH,d,pred);
+    x64_movapd(s,d,JIT_SCRATCH);
+  }
+  x64_pd_slot(s,0x54,d,JIT_SLOT_ONE);
+}
+
+// xmm(d) = (|xmm(d)| < closefact) ? 1.0 : 0.0 (or the reverse), nan counts as zero like fcomp
+static void jit_isZero(jitState *s, int d, int invert)
+{
+  x64_pd_slot(s,0x54,d,JIT_SLOT_ABSMASK);
+  x64_sd_slot(s,0x10,JIT_SCRATCH,JIT_SLOT_CLOSEFACT);
+  x64_cmpsd(s,JIT_SCRATCH,d,invert ? SSE_LE : SSE_NLE);
+  x64_pd_slot(s,0x54,JIT_SCRATCH,JIT_SLOT_ONE);
+  x64_movapd(s,d,JIT_SCRATCH);
+}
+
+// jumps if |xmm(d)| < closefact (cc=X64_JB) or >= (X64_JAE); xmm(d) is preserved
+static int jit_testZero(jitState *s, int d, int cc)
+{
+  x64_movapd(s,JIT_SCRATCH,d);
+  x64_pd_slot(s,0x54,JIT_SCRATCH,JIT_SLOT_ABSMASK);
+  x64_ucomisd_slot(s,JIT_SCRATCH,JIT_SLOT_CLOSEFACT);
+  return x64_jump(s,cc);
+}
+
+// truncating conversion of |x| to a 32 bit int, like fabs+fistp in chop mode
+static void jit_absToInt(jitState *s, int r, int x)
+{
+  x64_movq_from_xmm(s,X64_RAX,x);
+  x64_op0f(s,0,1,0xba,6,X64_RAX,0,0); jit_emit(s,63); // btr rax, 63
+  x64_movq_to_xmm(s,JIT_SCRATCH,X64_RAX);
+  x64_cvttsd2si(s,0,r,JIT_SCRATCH);
+}
+
+// xmm(d) = sign(xmm(d)), +-0 stays as is
+static void jit_sign(jitState *s, int d)
+{
+  int p;
+  x64_movq_from_xmm(s,X64_RAX,d);
+  x64_op(s,1,0x89,X64_RAX,X64_RCX,0,0); // mov rcx, rax
+  x64_op(s,1,0xd1,4,X64_RCX,0,0); // shl rcx, 1
+  p=x64_jump(s,X64_JZ);
+  x64_op(s,1,0xc1,5,X64_RAX,0,0); jit_emit(s,63); // shr rax, 63
+  x64_op(s,1,0xc1,4,X64_RAX,0,0); jit_emit(s,63); // shl rax, 63
+  x64_movimm(s,X64_RCX,(INT_PTR)0x3FF0000000000000ull);
+  x64_op(s,1,0x09,X64_RCX,X64_RAX,0,0); // or rax, rcx
+  x64_movq_to_xmm(s,d,X64_RAX);
+  x64_patch(s,p);
+}
+
+static void jit_binop(jitState *s, int op, int d, int rb)
+{
+  switch (op)
+  {
+    case JOP_ADD: case JOP_ADDOP: x64_sd(s,0x58,d,rb); break;
+    case JOP_SUB: case JOP_SUBOP: x64_sd(s,0x5c,d,rb); break;
+    case JOP_MUL: case JOP_MULOP: x64_sd(s,0x59,d,rb); break;
+    case JOP_DIV: case JOP_DIVOP: x64_sd(s,0x5e,d,rb); break;
+    case JOP_MIN: x64_sd(s,0x5d,d,rb); break;
+    case JOP_MAX: x64_sd(s,0x5f,d,rb); break;
+    // fcomp sets C0 for "less or unordered"
+    case JOP_LT: jit_compare(s,d,rb,SSE_NLE,1); break;
+    case JOP_GT: jit_compare(s,d,rb,SSE_NLE,0); break;
+    case JOP_LE: jit_compare(s,d,rb,SSE_LE,0); break;
+    case JOP_GE: jit_compare(s,d,rb,SSE_LE,1); break;
+    case JOP_EQ:
+    case JOP_NE:
+      x64_sd(s,0x5c,d,rb);
+      jit_isZero(s,d,op == JOP_NE);
+    break;
+    case JOP_MOD: case JOP_MODOP:
+      jit_absToInt(s,X64_RCX,rb);
+      jit_absToInt(s,X64_RAX,d);
+      x64_op(s,0,0x31,X64_RDX,X64_RDX,0,0); // xor edx, edx
+      x64_op(s,0,0x85,X64_RCX,X64_RCX,0,0); // test ecx, ecx
+      jit_emit(s,0x74); jit_emit(s,2); // jz +2
+      x64_op(s,0,0xf7,6,X64_RCX,0,0); // div ecx
+      x64_cvtsi2sd(s,0,d,X64_RDX);
+    break;
+    case JOP_BITOR: case JOP_OROP:
+    case JOP_BITAND: case JOP_ANDOP:
+      x64_cvttsd2si(s,1,X64_RAX,d);
+      x64_cvttsd2si(s,1,X64_RCX,rb);
+      x64_op(s,1,(op == JOP_BITOR || op == JOP_OROP) ? 0x09 : 0x21,X64_RCX,X64_RAX,0,0);
+      x64_cvtsi2sd(s,1,d,X64_RAX);
+    break;
+  }
+}
+
+// pointer to megabuf()/gmegabuf() slot in rax
+static void jit_genMemPtr(jitState *s, jitNode *n, int d)
+{
+  int base;
+  jit_gen(s,n->parms[0],d);
+  x64_sd_slot(s,0x58,d,JIT_SLOT_CLOSEFACT);
+  x64_cvttsd2si(s,0,X64_RAX,d);
+  base=jit_callBegin(s,d,0);
+  x64_op(s,0,0x89,X64_RAX,jit_argregs[1],0,0); // mov arg2, eax
+  x64_movfctx(s,jit_argregs[0],n);
+  x64_call(s,n->fptr);
+  jit_callEnd(s,d,base,0);
+
+  x64_op(s,1,0x85,X64_RAX,X64_RAX,0,0); // test rax, rax
+  {
+    int p=x64_jump(s,X64_JNZ);
+    x64_op(s,1,0x8d,X64_RAX,X64_RSP,1,JIT_SLOT(JIT_SLOT_NULLMEM)); // lea rax, [nullmem]
+    x64_op(s,1,0xc7,0,X64_RAX,1,0); jit_emit32(s,0); // mov qword [rax], 0
+    x64_patch(s,p);
+  }
+}
+
+// double f(double[,double])
+static void jit_genCall(jitState *s, jitNode *n, int d)
+{
+  int base=s->slots, cb, x, sl[2];
+  if (n->nparms == 1 && !jit_isLeaf(n->parms[0]))
+  {
+    jit_gen(s,n->parms[0],d);
+    cb=jit_callBegin(s,d,0);
+    x64_movapd(s,0,d);
+  }
+  else
+  {
+    for (x = 0; x < n->nparms && x < 2; x ++)
+    {
+      if (!jit_isLeaf(n->parms[x]))
+      {
+        jit_gen(s,n->parms[x],d);
+        sl[x]=jit_allocSlot(s);
+        x64_movsd_store(s,d,X64_RSP,JIT_SLOT(sl[x]));
+      }
+    }
+    cb=jit_callBegin(s,d,0);
+    for (x = 0; x < n->nparms && x < 2; x ++)
+    {
+      if (jit_isLeaf(n->parms[x])) jit_loadLeaf(s,x,n->parms[x]);
+      else x64_movsd_load(s,x,X64_RSP,JIT_SLOT(sl[x]));
+    }
+  }
+  x64_call(s,n->fptr);
+  x64_movapd(s,d,0);
+  jit_callEnd(s,d,cb,0);
+  s->slots=base;
+}
+
+// functions taking double pointers: rand() style, and host functions
+static void jit_genCallPtr(jitState *s, jitNode *n, int d)
+{
+  int base=s->slots, cb, x, a=0, sl[3];
+  for (x = 0; x < n->nparms; x ++)
+  {
+    jitNode *p=n->parms[x];
+    if (p->op == JOP_VAR) continue;
+    sl[x]=jit_allocSlot(s);
+    if (p->op == JOP_MEM)
+    {
+      jit_genMemPtr(s,p,d);
+      x64_mov_slot_store(s,X64_RAX,sl[x]);
+    }
+    else
+    {
+      jit_gen(s,p,d);
+      x64_movsd_store(s,d,X64_RSP,JIT_SLOT(sl[x]));
+    }
+  }
+
+  // the callee gets variable addresses, so the cache is written back first
+  cb=jit_callBegin(s,d,1);
+  if (n->op != JOP_CALLP) x64_movfctx(s,jit_argregs[a++],n);
+  for (x = 0; x < n->nparms; x ++, a ++)
+  {
+    jitNode *p=n->parms[x];
+    if (p->op == JOP_VAR) x64_movvar(s,jit_argregs[a],p->addr);
+    else if (p->op == JOP_MEM) x64_mov_slot_load(s,jit_argregs[a],sl[x]);
+    else x64_op(s,1,0x8d,jit_argregs[a],X64_RSP,1,JIT_SLOT(sl[x])); // lea
+  }
+  x64_call(s,n->fptr);
+  if (n->op == JOP_GENERIC) x64_movsd_load(s,d,X64_RAX,0); // returned a pointer
+  else x64_movapd(s,d,0);
+  jit_callEnd(s,d,cb,1);
+  s->slots=base;
+}
+
+// _set() and the op= family. the target is read after the value was evaluated.
+static void jit_genStore(jitState *s, jitNode *n, int d)
+{
+  jitNode *lv=n->parms[0];
+  int base=s->slots, sl=-1;
+
+  if (lv->op == JOP_MEM)
+  {
+    jit_genMemPtr(s,lv,d);
+    sl=jit_allocSlot(s);
+    x64_mov_slot_store(s,X64_RAX,sl);
+  }
+  else if (lv->op != JOP_VAR) // not assignable, operate on a copy
+  {
+    jit_gen(s,lv,d);
+    sl=jit_allocSlot(s);
+    x64_movsd_store(s,d,X64_RSP,JIT_SLOT(sl));
+  }
+
+  jit_gen(s,n->parms[1],d);
+  if (n->op == JOP_SET)
+  {
+    // denormals, inf and nan become 0
+    int p1,p2;
+    x64_movq_from_xmm(s,X64_RAX,d);
+    x64_op(s,1,0xc1,5,X64_RAX,0,0); jit_emit(s,52); // shr rax, 52
+    jit_emit(s,0x25); jit_emit32(s,0x7ff); // and eax, 0x7ff
+    p1=x64_jump(s,X64_JZ);
+    jit_emit(s,0x3d); jit_emit32(s,0x7ff); // cmp eax, 0x7ff
+    p2=x64_jump(s,X64_JNZ);
+    x64_patch(s,p1);
+    x64_xorpd(s,d,d);
+    x64_patch(s,p2);
+  }
+  else
+  {
+    x64_movapd(s,JIT_SCRATCH,d);
+    if (lv->op == JOP_VAR) jit_loadLeaf(s,d,lv);
+    else if (lv->op == JOP_MEM)
+    {
+      x64_mov_slot_load(s,X64_RAX,sl);
+      x64_movsd_load(s,d,X64_RAX,0);
+    }
+    else x64_movsd_load(s,d,X64_RSP,JIT_SLOT(sl));
+
+    if (n->op == JOP_CALLOP)
+    {
+      int cb=jit_callBegin(s,d,0);
+      x64_movapd(s,0,d);
+      x64_movapd(s,1,JIT_SCRATCH);
+      x64_call(s,n->fptr);
+      x64_movapd(s,d,0);
+      jit_callEnd(s,d,cb,0);
+    }
+    else jit_binop(s,n->op,d,JIT_SCRATCH);
+  }
+
+  if (lv->op == JOP_VAR) jit_storeVar(s,d,lv->addr);
+  else if (lv->op == JOP_MEM)
+  {
+    x64_mov_slot_load(s,X64_RAX,sl);
+    x64_movsd_store(s,d,X64_RAX,0);
+  }
+  s->slots=base;
+}
+
+static void jit_gen(jitState *s, jitNode *n, int d)
+{
+  int x;
+  if (s->err) return;
+
+  switch (n->op)
+  {
+    case JOP_CONST:
+    case JOP_VAR:
+      jit_loadLeaf(s,d,n);
+    break;
+    case JOP_SEQ:
+      for (x = 0; x < n->nparms; x ++) jit_gen(s,n->parms[x],d);
+    break;
+    case JOP_NEG:
+      jit_gen(s,n->parms[0],d);
+      x64_pd_slot(s,0x57,d,JIT_SLOT_SIGNMASK);
+    break;
+    case JOP_ADD: case JOP_SUB: case JOP_MUL: case JOP_DIV: case JOP_MOD:
+    case JOP_BITOR: case JOP_BITAND: case JOP_MIN: case JOP_MAX:
+    case JOP_EQ: case JOP_NE: case JOP_LT: case JOP_GT: case JOP_LE: case JOP_GE:
+      x=jit_genOperands(s,n->parms[0],n->parms[1],d);
+      jit_binop(s,n->op,d,x);
+    break;
+    case JOP_NOT:
+      jit_gen(s,n->parms[0],d);
+      jit_isZero(s,d,0);
+    break;
+    case JOP_ABS:
+      jit_gen(s,n->parms[0],d);
+      x64_pd_slot(s,0x54,d,JIT_SLOT_ABSMASK);
+    break;
+    case JOP_SQR:
+      jit_gen(s,n->parms[0],d);
+      x64_sd(s,0x59,d,d);
+    break;
+    case JOP_SQRT:
+      jit_gen(s,n->parms[0],d);
+      x64_pd_slot(s,0x54,d,JIT_SLOT_ABSMASK);
+      x64_sd(s,0x51,d,d);
+    break;
+    case JOP_SIGN:
+      jit_gen(s,n->parms[0],d);
+      jit_sign(s,d);
+    break;
+    case JOP_IF:
+      {
+        int pf,pe;
+        jit_gen(s,n->parms[0],d);
+        pf=jit_testZero(s,d,X64_JB);
+        jit_gen(s,n->parms[1],d);
+        pe=x64_jump(s,-1);
+        x64_patch(s,pf);
+        jit_gen(s,n->parms[2],d);
+        x64_patch(s,pe);
+      }
+    break;
+    case JOP_LAND:
+    case JOP_LOR:
+      {
+        // _and: 0 if a is zero, else !!b. _or: 1 if a is nonzero, else !!b.
+        int cc = n->op == JOP_LAND ? X64_JB : X64_JAE;
+        int p1,p2,pe;
+        jit_gen(s,n->parms[0],d);
+        p1=jit_testZero(s,d,cc);
+        jit_gen(s,n->parms[1],d);
+        p2=jit_testZero(s,d,cc);
+        if (n->op == JOP_LAND) x64_sd_slot(s,0x10,d,JIT_SLOT_ONE);
+        else x64_xorpd(s,d,d);
+        pe=x64_jump(s,-1);
+        x64_patch(s,p1);
+        x64_patch(s,p2);
+        if (n->op == JOP_LAND) x64_xorpd(s,d,d);
+        else x64_sd_slot(s,0x10,d,JIT_SLOT_ONE);
+        x64_patch(s,pe);
+      }
+    break;
+    case JOP_LOOP:
+      {
+        int base=s->slots, sl=jit_allocSlot(s), pskip, top;
+        jit_gen(s,n->parms[0],d);
+        x64_cvttsd2si(s,0,X64_RAX,d);
+        jit_emit(s,0x83); jit_emit(s,0xf8); jit_emit(s,1); // cmp eax, 1
+        pskip=x64_jump(s,X64_JL);
+        jit_emit(s,0x3d); jit_emit32(s,NSEEL_LOOPFUNC_SUPPORT_MAXLEN); // cmp eax, max
+        jit_emit(s,0x7c); jit_emit(s,5); // jl +5
+        jit_emit(s,0xb8); jit_emit32(s,NSEEL_LOOPFUNC_SUPPORT_MAXLEN); // mov eax, max
+        x64_op(s,0,0x89,X64_RAX,X64_RSP,1,JIT_SLOT(sl));
+        top=s->len;
+        jit_gen(s,n->parms[1],d);
+        x64_op(s,0,0xff,1,X64_RSP,1,JIT_SLOT(sl)); // dec dword [sl]
+        x64_jumpback(s,X64_JNZ,top);
+        x64_patch(s,pskip);
+        s->slots=base;
+      }
+    break;
+    case JOP_WHILE:
+      {
+        int base=s->slots, sl=jit_allocSlot(s), pexit, top;
+        x64_op(s,0,0xc7,0,X64_RSP,1,JIT_SLOT(sl)); jit_emit32(s,NSEEL_LOOPFUNC_SUPPORT_MAXLEN);
+        top=s->len;
+        jit_gen(s,n->parms[0],d);
+        pexit=jit_testZero(s,d,X64_JB);
+        x64_op(s,0,0xff,1,X64_RSP,1,JIT_SLOT(sl)); // dec dword [sl]
+        x64_jumpback(s,X64_JNZ,top);
+        x64_patch(s,pexit);
+        s->slots=base;
+      }
+    break;
+    case JOP_SET: case JOP_ADDOP: case JOP_SUBOP: case JOP_MULOP: case JOP_DIVOP:
+    case JOP_MODOP: case JOP_OROP: case JOP_ANDOP: case JOP_CALLOP:
+      jit_genStore(s,n,d);
+    break;
+    case JOP_CALL:
+      jit_genCall(s,n,d);
+    break;
+    case JOP_CALLP:
+    case JOP_GENERIC:
+    case JOP_GENERIC_RETD:
+      jit_genCallPtr(s,n,d);
+    break;
+    case JOP_MEM:
+      jit_genMemPtr(s,n,d);
+      x64_movsd_load(s,d,X64_RAX,0);
+    break;
+    default:
+      s->err=2;
+      s->errname=n->name;
+    break;
+  }
+}
+
+static void jit_countVars(jitNode *n, jitVarUse **uses, int *nuses, int written)
+{
+  int x;
+  if (n->op == JOP_VAR)
+  {
+    for (x = 0; x < *nuses && (*uses)[x].addr != n->addr; x ++);
+    if (x == *nuses)
+    {
+      if (!(x&63))
+      {
+        jitVarUse *nu=(jitVarUse *)realloc(*uses,(x+64)*sizeof(jitVarUse));
+        if (!nu) return;
+        *uses=nu;
+      }
+      (*uses)[x].addr=n->addr;
+      (*uses)[x].refs=0;
+      (*uses)[x].written=0;
+      (*nuses)++;
+    }
+    (*uses)[x].refs++;
+    if (written) (*uses)[x].written=1;
+    return;
+  }
+  for (x = 0; x < n->nparms; x ++)
+  {
+    jitNode *p=n->parms[x];
+    int w = !x && p->op == JOP_VAR && n->op >= JOP_SET && n->op <= JOP_CALLOP;
+    jit_countVars(p,uses,nuses,w);
+  }
+}
+
+// keeps the most referenced variables in registers
+static void jit_chooseCache(jitState *s, startPtr *list)
+{
+  jitVarUse *uses=NULL;
+  int nuses=0;
+  for (; list; list=list->next) jit_countVars((jitNode *)list->startptr,&uses,&nuses,0);
+
+  while (s->ncache < JIT_NCACHE)
+  {
+    int x, best=-1;
+    for (x = 0; x < nuses; x ++)
+      if (uses[x].refs > 1 && (best < 0 || uses[x].refs > uses[best].refs)) best=x;
+    if (best < 0) break;
+    s->cache[s->ncache]=uses[best].addr;
+    s->cache_written[s->ncache]=uses[best].written;
+    s->ncache++;
+    uses[best].refs=0;
+  }
+  free(uses);
+}
+
+// generates the code for list. if relocs is set, it gets the jitReloc list
+// (positions relative to the returned code, free() it)
+static void *nseel_jit_generate(compileContext *ctx, startPtr *list, jitReloc **relocs, int *nrelocs)
+{
+  jitState s, ps;
+  startPtr *p;
+  int frame, saveoffs, nsave, x;
+  unsigned char *code=NULL;
+
+  memset(&s,0,sizeof(s));
+  memset(&ps,0,sizeof(ps));
+  s.ctx=ps.ctx=ctx;
+  s.slots=s.maxslots=JIT_SLOT_FIRST;
+
+  jit_chooseCache(&s,list);
+
+  for (p=list; p; p=p->next) jit_gen(&s,(jitNode *)p->startptr,0);
+
+  // frame: slots, then the callee saved xmm registers on win64. rsp+8 is
+  // 16 byte aligned on entry, keep it aligned for calls.
+  saveoffs=(JIT_SLOT(s.maxslots)+15)&~15;
+  nsave = JIT_CALLS_KEEP_CACHE ? s.ncache : 0;
+  frame=saveoffs+nsave*16+8;
+
+  x64_op(&ps,1,0x81,5,X64_RSP,0,0); jit_emit32(&ps,frame); // sub rsp, frame
+  for (x = 0; x < nsave; x ++) x64_op0f(&ps,0,0,0x11,JIT_CACHE_FIRST+x,X64_RSP,1,saveoffs+x*16); // movups
+  {
+    static const EEL_F one=1.0;
+    INT_PTR v;
+    x64_movimm(&ps,X64_RAX,(INT_PTR)0x7FFFFFFFFFFFFFFFull);
+    x64_mov_slot_store(&ps,X64_RAX,JIT_SLOT_ABSMASK);
+    x64_movimm(&ps,X64_RAX,(INT_PTR)0x8000000000000000ull);
+    x64_mov_slot_store(&ps,X64_RAX,JIT_SLOT_SIGNMASK);
+    memcpy(&v,&one,sizeof(v));
+    x64_movimm(&ps,X64_RAX,v);
+    x64_mov_slot_store(&ps,X64_RAX,JIT_SLOT_ONE);
+    memcpy(&v,&g_closefact,sizeof(v));
+    x64_movimm(&ps,X64_RAX,v);
+    x64_mov_slot_store(&ps,X64_RAX,JIT_SLOT_CLOSEFACT);
+  }
+  ps.ncache=s.ncache;
+  memcpy(ps.cache,s.cache,sizeof(s.cache));
+  jit_loadCache(&ps);
+
+  jit_storeCache(&s);
+  for (x = 0; x < nsave; x ++) x64_op0f(&s,0,0,0x10,JIT_CACHE_FIRST+x,X64_RSP,1,saveoffs+x*16); // movups
+  x64_op(&s,1,0x81,0,X64_RSP,0,0); jit_emit32(&s,frame); // add rsp, frame
+  jit_emit(&s,0xc3); // ret
+
+  if (s.err == 2)
+  {
+    sprintf(ctx->last_error_string,"'%.64s' is not supported by the x64 code generator",s.errname ? s.errname : "?");
+  }
+  else if (!s.err && !ps.err)
+  {
+    code=(unsigned char *)newBlock(ps.len+s.len,32);
+    if (code)
+    {
+      memcpy(code,ps.buf,ps.len);
+      memcpy(code+ps.len,s.buf,s.len);
+      ctx->l_stats[1]=ps.len+s.len;
+    }
+    if (code && relocs)
+    {
+      *nrelocs=ps.nrelocs+s.nrelocs;
+      *relocs=(jitReloc *)malloc((*nrelocs+1)*sizeof(jitReloc));
+      if (!*relocs) code=NULL;
+      else
+      {
+        memcpy(*relocs,ps.relocs,ps.nrelocs*sizeof(jitReloc));
+        for (x = 0; x < s.nrelocs; x ++)
+        {
+          (*relocs)[ps.nrelocs+x]=s.relocs[x];
+          (*relocs)[ps.nrelocs+x].pos+=ps.len;
+        }
+      }
+    }
+  }
+  free(ps.relocs);
+  free(s.relocs);
+  free(ps.buf);
+  free(s.buf);
+  return code;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------
+// batch execution (NSEEL_code_execute_batch): two points per pass, one in each
+// lane of the xmm registers. only code that carries no state from one point to
+// the next qualifies, ie every variable is loaded per point, never written, or
+// assigned before it is first read. megabuf, loops and host functions are left
+// to the scalar path, as are assignments inside if() branches. variables live
+// in 16 byte stack slots while the batch runs.
+
+#define JIT_VSLOT(x) (32+(x)*16)
+#define JIT_VSLOT_ABSMASK 0
+#define JIT_VSLOT_SIGNMASK 1
+#define JIT_VSLOT_ONE 2
+#define JIT_VSLOT_CLOSEFACT 3
+#define JIT_VSLOT_NORMMIN 4
+#define JIT_VSLOT_NORMMAX 5
+#define JIT_VSLOT_VARS 6
+#define JIT_VSLOT_COUNT 7
+#define JIT_VSLOT_OFFS 8
+#define JIT_VSLOT_FIRST 9
+
+#define JIT_VAR_READ 1 // read before it was written
+#define JIT_VAR_WRITTEN 2
+#define JIT_VAR_INPUT 4
+
+typedef struct
+{
+  EEL_F *addr;
+  int flags;
+  int home;
+} jitVecVar;
+
+typedef struct
+{
+  jitState s;
+  codeHandleType *h;
+  jitVecVar *vars;
+  int nvars;
+} jitVecState;
+
+static jitVecVar *jit_vecVar(jitVecState *vs, EEL_F *addr)
+{
+  int x;
+  for (x = 0; x < vs->nvars; x ++)
+    if (vs->vars[x].addr == addr) return vs->vars+x;
+  if (!(x&63))
+  {
+    jitVecVar *nv=(jitVecVar *)realloc(vs->vars,(x+64)*sizeof(jitVecVar));
+    if (!nv) return NULL;
+    vs->vars=nv;
+  }
+  vs->vars[x].addr=addr;
+  vs->vars[x].flags=0;
+  vs->vars[x].home=-1;
+  vs->nvars++;
+  return vs->vars+x;
+}
+
+// the variable of a tree node. a tree shared through the code cache has the
+// addresses of the VM it was compiled in, h->vars has this VM's.
+static jitVecVar *jit_vecNodeVar(jitVecState *vs, EEL_F *addr)
+{
+  codeCacheEnt *e=vs->h->cache;
+  int x;
+  if (e) for (x = 0; x < e->nvars; x ++)
+  {
+    if (e->var_src[x] == addr)
+    {
+      addr=vs->h->vars[x];
+      break;
+    }
+  }
+  return jit_vecVar(vs,addr);
+}
+
+// records variable accesses in evaluation order, returns 0 if the node can't be run in lanes.
+// with pure set, the subtree is evaluated for both lanes regardless of a condition, so it must not store.
+static int jit_vecCheck(jitVecState *vs, jitNode *n, int pure)
+{
+  jitVecVar *v;
+  int x;
+  switch (n->op)
+  {
+    case JOP_CONST:
+    return 1;
+    case JOP_VAR:
+      if (!(v=jit_vecNodeVar(vs,n->addr))) return 0;
+      if (!(v->flags&JIT_VAR_WRITTEN)) v->flags|=JIT_VAR_READ;
+    return 1;
+    case JOP_SET: case JOP_ADDOP: case JOP_SUBOP: case JOP_MULOP: case JOP_DIVOP:
+    case JOP_MODOP: case JOP_OROP: case JOP_ANDOP: case JOP_CALLOP:
+      if (pure || n->parms[0]->op != JOP_VAR || !jit_vecCheck(vs,n->parms[1],0)) return 0;
+      if (!(v=jit_vecNodeVar(vs,n->parms[0]->addr))) return 0;
+      if (n->op != JOP_SET && !(v->flags&JIT_VAR_WRITTEN)) v->flags|=JIT_VAR_READ;
+      v->flags|=JIT_VAR_WRITTEN;
+    return 1;
+    case JOP_IF:
+    case JOP_LAND:
+    case JOP_LOR:
+      if (!jit_vecCheck(vs,n->parms[0],pure)) return 0;
+      for (x = 1; x < n->nparms; x ++) if (!jit_vecCheck(vs,n->parms[x],1)) return 0;
+    return 1;
+    case JOP_CALL:
+      if (n->nparms > 2) return 0;
+    // fall through
+    case JOP_SEQ: case JOP_NEG:
+    case JOP_ADD: case JOP_SUB: case JOP_MUL: case JOP_DIV: case JOP_MOD: case JOP_BITOR: case JOP_BITAND: case JOP_MIN: case JOP_MAX:
+    case JOP_EQ: case JOP_NE: case JOP_LT: case JOP_GT: case JOP_LE: case JOP_GE:
+    case JOP_NOT: case JOP_ABS: case JOP_SQR: case JOP_SQRT: case JOP_SIGN:
+      for (x = 0; x < n->nparms; x ++) if (!jit_vecCheck(vs,n->parms[x],pure)) return 0;
+    return 1;
+  }
+  return 0;
+}
+
+#define x64_pd(s,op,x,y) x64_op0f(s,0x66,0,op,x,y,0,0)
+#define x64_pd_vslot(s,op,x,slot) x64_op0f(s,0x66,0,op,x,X64_RSP,1,JIT_VSLOT(slot)) // 28 load 29 store 54 and 55 andn 56 or 57 xor
+#define x64_movsd_lane_load(s,x,slot,lane) x64_movsd_load(s,x,X64_RSP,JIT_VSLOT(slot)+(lane)*8)
+#define x64_movsd_lane_store(s,x,slot,lane) x64_movsd_store(s,x,X64_RSP,JIT_VSLOT(slot)+(lane)*8)
+
+static void x64_cmppd(jitState *s, int x, int y, int pred)
+{
+  x64_op0f(s,0x66,0,0xc2,x,y,0,0);
+  jit_emit(s,pred);
+}
+
+static void x64_cmppd_vslot(jitState *s, int x, int slot, int pred)
+{
+  x64_op0f(s,0x66,0,0xc2,x,X64_RSP,1,JIT_VSLOT(slot));
+  jit_emit(s,pred);
+}
+
+// fills both lanes of a slot with a bit pattern
+static void jit_vecSetSlot(jitState *s, int slot, INT_PTR v)
+{
+  x64_movimm(s,X64_RAX,v);
+  x64_op(s,1,0x89,X64_RAX,X64_RSP,1,JIT_VSLOT(slot));
+  x64_op(s,1,0x89,X64_RAX,X64_RSP,1,JIT_VSLOT(slot)+8);
+}
+
+static void jit_vecLeaf(jitVecState *vs, int x, jitNode *n)
+{
+  if (n->op == JOP_CONST)
+  {
+    jit_loadConst(&vs->s,x,n->value);
+    x64_pd(&vs->s,0x14,x,x); // unpcklpd
+  }
+  else x64_pd_vslot(&vs->s,0x28,x,jit_vecNodeVar(vs,n->addr)->home);
+}
+
+// xmm(d) = (|xmm(d)| < closefact) ? 1.0 : 0.0 (or the reverse), in both lanes
+static void jit_vecIsZero(jitState *s, int d, int invert)
+{
+  x64_pd_vslot(s,0x54,d,JIT_VSLOT_ABSMASK);
+  x64_pd_vslot(s,0x28,JIT_SCRATCH,JIT_VSLOT_CLOSEFACT);
+  x64_cmppd(s,JIT_SCRATCH,d,invert ? SSE_LE : SSE_NLE);
+  x64_pd_vslot(s,0x54,JIT_SCRATCH,JIT_VSLOT_ONE);
+  x64_movapd(s,d,JIT_SCRATCH);
+}
+
+// xmm(d) = { lane 0 of slot a, xmm(d) }. lane 0 results go through memory one
+// at a time, a single 16 byte reload of two 8 byte stores would stall.
+static void jit_vecJoinLanes(jitState *s, int d, int a)
+{
+  x64_movsd_lane_load(s,JIT_SCRATCH,a,0);
+  x64_pd(s,0x14,JIT_SCRATCH,d); // unpcklpd
+  x64_movapd(s,d,JIT_SCRATCH);
+}
+
+// calls double f(double[,double]) for each lane of slot a (and b), result in xmm(d)
+static void jit_vecCallLanes(jitState *s, void *f, int d, int a, int b)
+{
+  int base=s->slots, x, l;
+  for (x = 0; x < d; x ++) x64_pd_vslot(s,0x29,x,jit_allocSlot(s));
+  for (l = 0; l < 2; l ++)
+  {
+    x64_movsd_lane_load(s,0,a,l);
+    if (b >= 0) x64_movsd_lane_load(s,1,b,l);
+    x64_call(s,f);
+    if (!l) x64_movsd_lane_store(s,0,a,0);
+  }
+  x64_movapd(s,d,0);
+  for (x = 0; x < d; x ++) x64_pd_vslot(s,0x28,x,base+x);
+  s->slots=base;
+  jit_vecJoinLanes(s,d,a);
+}
+
+static void jit_vecGen(jitVecState *vs, jitNode *n, int d);
+
+static int jit_vecOperands(jitVecState *vs, jitNode *a, jitNode *b, int d)
+{
+  jitState *s=&vs->s;
+  if (jit_isLeaf(b))
+  {
+    jit_vecGen(vs,a,d);
+    jit_vecLeaf(vs,JIT_SCRATCH,b);
+    return JIT_SCRATCH;
+  }
+  if (jit_isLeaf(a))
+  {
+    jit_vecGen(vs,b,d);
+    x64_movapd(s,JIT_SCRATCH,d);
+    jit_vecLeaf(vs,d,a);
+    return JIT_SCRATCH;
+  }
+  jit_vecGen(vs,a,d);
+  if (d+1 < JIT_NTEMPS)
+  {
+    jit_vecGen(vs,b,d+1);
+    return d+1;
+  }
+  else
+  {
+    int base=s->slots, sl=jit_allocSlot(s);
+    x64_pd_vslot(s,0x29,d,sl);
+    jit_vecGen(vs,b,d);
+    x64_movapd(s,JIT_SCRATCH,d);
+    x64_pd_vslot(s,0x28,d,sl);
+    s->slots=base;
+    return JIT_SCRATCH;
+  }
+}
+
+static void jit_vecBinop(jitState *s, int op, int d, int rb)
+{
+  switch (op)
+  {
+    case JOP_ADD: case JOP_ADDOP: x64_pd(s,0x58,d,rb); break;
+    case JOP_SUB: case JOP_SUBOP: x64_pd(s,0x5c,d,rb); break;
+    case JOP_MUL: case JOP_MULOP: x64_pd(s,0x59,d,rb); break;
+    case JOP_DIV: case JOP_DIVOP: x64_pd(s,0x5e,d,rb); break;
+    case JOP_MIN: x64_pd(s,0x5d,d,rb); break;
+    case JOP_MAX: x64_pd(s,0x5f,d,rb); break;
+    case JOP_LT: case JOP_GE:
+      x64_movapd(s,JIT_SCRATCH,rb);
+      x64_cmppd(s,JIT_SCRATCH,d,op == JOP_LT ? SSE_NLE : SSE_LE);
+      x64_movapd(s,d,JIT_SCRATCH);
+      x64_pd_vslot(s,0x54,d,JIT_VSLOT_ONE);
+    break;
+    case JOP_GT: case JOP_LE:
+      x64_cmppd(s,d,rb,op == JOP_GT ? SSE_NLE : SSE_LE);
+      x64_pd_vslot(s,0x54,d,JIT_VSLOT_ONE);
+    break;
+    case JOP_EQ:
+    case JOP_NE:
+      x64_pd(s,0x5c,d,rb);
+      jit_vecIsZero(s,d,op == JOP_NE);
+    break;
+    default: // integer ops, one lane at a time
+      {
+        int base=s->slots, a=jit_allocSlot(s), b=jit_allocSlot(s), l;
+        x64_pd_vslot(s,0x29,d,a);
+        x64_pd_vslot(s,0x29,rb,b);
+        for (l = 0; l < 2; l ++)
+        {
+          x64_movsd_lane_load(s,d,a,l);
+          x64_movsd_lane_load(s,JIT_SCRATCH,b,l);
+          jit_binop(s,op,d,JIT_SCRATCH);
+          if (!l) x64_movsd_lane_store(s,d,a,0);
+        }
+        jit_vecJoinLanes(s,d,a);
+        s->slots=base;
+      }
+    break;
+  }
+}
+
+static void jit_vecGen(jitVecState *vs, jitNode *n, int d)
+{
+  jitState *s=&vs->s;
+  int x;
+  if (s->err) return;
+
+  switch (n->op)
+  {
+    case JOP_CONST:
+    case JOP_VAR:
+      jit_vecLeaf(vs,d,n);
+    break;
+    case JOP_SEQ:
+      for (x = 0; x < n->nparms; x ++) jit_vecGen(vs,n->parms[x],d);
+    break;
+    case JOP_NEG:
+      jit_vecGen(vs,n->parms[0],d);
+      x64_pd_vslot(s,0x57,d,JIT_VSLOT_SIGNMASK);
+    break;
+    case JOP_ADD: case JOP_SUB: case JOP_MUL: case JOP_DIV: case JOP_MOD:
+    case JOP_BITOR: case JOP_BITAND: case JOP_MIN: case JOP_MAX:
+    case JOP_EQ: case JOP_NE: case JOP_LT: case JOP_GT: case JOP_LE: case JOP_GE:
+      x=jit_vecOperands(vs,n->parms[0],n->parms[1],d);
+      jit_vecBinop(s,n->op,d,x);
+    break;
+    case JOP_NOT:
+      jit_vecGen(vs,n->parms[0],d);
+      jit_vecIsZero(s,d,0);
+    break;
+    case JOP_ABS:
+      jit_vecGen(vs,n->parms[0],d);
+      x64_pd_vslot(s,0x54,d,JIT_VSLOT_ABSMASK);
+    break;
+    case JOP_SQR:
+      jit_vecGen(vs,n->parms[0],d);
+      x64_pd(s,0x59,d,d);
+    break;
+    case JOP_SQRT:
+      jit_vecGen(vs,n->parms[0],d);
+      x64_pd_vslot(s,0x54,d,JIT_VSLOT_ABSMASK);
+      x64_pd(s,0x51,d,d);
+    break;
+    case JOP_SIGN:
+      {
+        int base=s->slots, a=jit_allocSlot(s), l;
+        jit_vecGen(vs,n->parms[0],d);
+        x64_pd_vslot(s,0x29,d,a);
+        for (l = 0; l < 2; l ++)
+        {
+          x64_movsd_lane_load(s,d,a,l);
+          jit_sign(s,d);
+          if (!l) x64_movsd_lane_store(s,d,a,0);
+        }
+        jit_vecJoinLanes(s,d,a);
+        s->slots=base;
+      }
+    break;
+    case JOP_IF:
+      {
+        // both branches are evaluated, then selected per lane
+        int base=s->slots, m=jit_allocSlot(s), t=jit_allocSlot(s);
+        jit_vecGen(vs,n->parms[0],d);
+        x64_pd_vslot(s,0x54,d,JIT_VSLOT_ABSMASK);
+        x64_pd_vslot(s,0x28,JIT_SCRATCH,JIT_VSLOT_CLOSEFACT);
+        x64_cmppd(s,JIT_SCRATCH,d,SSE_NLE);
+        x64_pd_vslot(s,0x29,JIT_SCRATCH,m); // all ones where the condition is false
+        jit_vecGen(vs,n->parms[1],d);
+        x64_pd_vslot(s,0x29,d,t);
+        jit_vecGen(vs,n->parms[2],d);
+        x64_pd_vslot(s,0x28,JIT_SCRATCH,m);
+        x64_pd(s,0x54,d,JIT_SCRATCH);
+        x64_pd_vslot(s,0x55,JIT_SCRATCH,t);
+        x64_pd(s,0x56,d,JIT_SCRATCH);
+        s->slots=base;
+      }
+    break;
+    case JOP_LAND:
+    case JOP_LOR:
+      {
+        int base=s->slots, a=jit_allocSlot(s);
+        jit_vecGen(vs,n->parms[0],d);
+        jit_vecIsZero(s,d,1);
+        x64_pd_vslot(s,0x29,d,a);
+        jit_vecGen(vs,n->parms[1],d);
+        jit_vecIsZero(s,d,1);
+        x64_pd_vslot(s,n->op == JOP_LAND ? 0x54 : 0x56,d,a);
+        s->slots=base;
+      }
+    break;
+    case JOP_SET:
+      {
+        int home=jit_vecNodeVar(vs,n->parms[0]->addr)->home;
+        jit_vecGen(vs,n->parms[1],d);
+        // denormals, inf and nan become 0
+        x64_movapd(s,JIT_SCRATCH,d);
+        x64_pd_vslot(s,0x54,JIT_SCRATCH,JIT_VSLOT_ABSMASK);
+        x64_cmppd_vslot(s,JIT_SCRATCH,JIT_VSLOT_NORMMAX,SSE_LE);
+        x64_pd(s,0x54,d,JIT_SCRATCH);
+        x64_movapd(s,JIT_SCRATCH,d);
+        x64_pd_vslot(s,0x54,JIT_SCRATCH,JIT_VSLOT_ABSMASK);
+        x64_cmppd_vslot(s,JIT_SCRATCH,JIT_VSLOT_NORMMIN,5); // nlt
+        x64_pd(s,0x54,d,JIT_SCRATCH);
+        x64_pd_vslot(s,0x29,d,home);
+      }
+    break;
+    case JOP_ADDOP: case JOP_SUBOP: case JOP_MULOP: case JOP_DIVOP:
+    case JOP_MODOP: case JOP_OROP: case JOP_ANDOP:
+      {
+        int home=jit_vecNodeVar(vs,n->parms[0]->addr)->home;
+        jit_vecGen(vs,n->parms[1],d);
+        x64_movapd(s,JIT_SCRATCH,d);
+        x64_pd_vslot(s,0x28,d,home);
+        jit_vecBinop(s,n->op,d,JIT_SCRATCH);
+        x64_pd_vslot(s,0x29,d,home);
+      }
+    break;
+    case JOP_CALLOP:
+      {
+        int home=jit_vecNodeVar(vs,n->parms[0]->addr)->home;
+        int base=s->slots, a=jit_allocSlot(s), b=jit_allocSlot(s);
+        jit_vecGen(vs,n->parms[1],d);
+        x64_pd_vslot(s,0x29,d,b);
+        x64_pd_vslot(s,0x28,d,home);
+        x64_pd_vslot(s,0x29,d,a);
+        jit_vecCallLanes(s,n->fptr,d,a,b);
+        x64_pd_vslot(s,0x29,d,home);
+        s->slots=base;
+      }
+    break;
+    case JOP_CALL:
+      {
+        int base=s->slots, sl[2]={-1,-1};
+        for (x = 0; x < n->nparms; x ++) sl[x]=jit_allocSlot(s);
+        // leaves are read last
+        for (x = 0; x < n->nparms; x ++) if (!jit_isLeaf(n->parms[x]))
+        {
+          jit_vecGen(vs,n->parms[x],d);
+          x64_pd_vslot(s,0x29,d,sl[x]);
+        }
+        for (x = 0; x < n->nparms; x ++) if (jit_isLeaf(n->parms[x]))
+        {
+          jit_vecLeaf(vs,d,n->parms[x]);
+          x64_pd_vslot(s,0x29,d,sl[x]);
+        }
+        jit_vecCallLanes(s,n->fptr,d,sl[0],sl[1]);
+        s->slots=base;
+      }
+    break;
+    default:
+      s->err=2;
+    break;
+  }
+}
+
+#define JIT_BATCHVAR_OFFS(k,field) ((int)((k)*sizeof(NSEEL_BATCHVAR)+offsetof(NSEEL_BATCHVAR,field)))
+
+// generates void f(NSEEL_BATCHVAR *vars, INT_PTR npairs) for a binding, or returns NULL
+// if the code needs to run one point at a time.
+static void *nseel_jit_generateBatch(codeHandleType *h, NSEEL_BATCHVAR *bind, int nbind)
+{
+  jitVecState vs;
+  jitState ps, *s=&vs.s;
+  startPtr *p;
+  int x, top, frame, *cslot;
+  void *code=NULL;
+
+  memset(&vs,0,sizeof(vs));
+  memset(&ps,0,sizeof(ps));
+  vs.h=h;
+  s->slots=s->maxslots=JIT_VSLOT_FIRST;
+
+  cslot=(int *)calloc(nbind+1,sizeof(int));
+  if (!cslot) return NULL;
+
+  for (x = 0; x < nbind; x ++)
+  {
+    jitVecVar *v=jit_vecVar(&vs,bind[x].var);
+    if (!v) s->err=1;
+    else if (bind[x].in)
+    {
+      if (bind[x].in_stride != 0 && bind[x].in_stride != 1) s->err=1;
+      v->flags|=JIT_VAR_INPUT;
+    }
+  }
+  for (p=h->tree; p && !s->err; p=p->next)
+    if (!jit_vecCheck(&vs,(jitNode *)p->startptr,0)) s->err=1;
+  for (x = 0; x < vs.nvars && !s->err; x ++)
+  {
+    jitVecVar *v=vs.vars+x;
+    if ((v->flags&(JIT_VAR_READ|JIT_VAR_WRITTEN|JIT_VAR_INPUT)) == (JIT_VAR_READ|JIT_VAR_WRITTEN)) s->err=1; // carries state
+    v->home=jit_allocSlot(s);
+  }
+  for (x = 0; x < nbind; x ++) if (bind[x].in && !bind[x].in_stride) cslot[x]=jit_allocSlot(s);
+
+  if (!s->err)
+  {
+    // per pair of points: load inputs, run, store outputs
+    top=s->len;
+    for (x = 0; x < nbind; x ++)
+    {
+      if (!bind[x].in) continue;
+      if (bind[x].in_stride)
+      {
+        x64_op(s,1,0x8b,X64_RAX,X64_RSP,1,JIT_VSLOT(JIT_VSLOT_VARS));
+        x64_op(s,1,0x8b,X64_RAX,X64_RAX,1,JIT_BATCHVAR_OFFS(x,in));
+        x64_op(s,1,0x03,X64_RAX,X64_RSP,1,JIT_VSLOT(JIT_VSLOT_OFFS)); // add rax, [offs]
+        x64_op0f(s,0x66,0,0x10,0,X64_RAX,1,0); // movupd xmm0, [rax]
+      }
+      else x64_pd_vslot(s,0x28,0,cslot[x]);
+      x64_pd_vslot(s,0x29,0,jit_vecVar(&vs,bind[x].var)->home);
+    }
+    for (p=h->tree; p; p=p->next) jit_vecGen(&vs,(jitNode *)p->startptr,0);
+    for (x = 0; x < nbind; x ++)
+    {
+      if (!bind[x].out) continue;
+      x64_op(s,1,0x8b,X64_RAX,X64_RSP,1,JIT_VSLOT(JIT_VSLOT_VARS));
+      x64_op(s,1,0x8b,X64_RAX,X64_RAX,1,JIT_BATCHVAR_OFFS(x,out));
+      x64_op(s,1,0x03,X64_RAX,X64_RSP,1,JIT_VSLOT(JIT_VSLOT_OFFS));
+      x64_pd_vslot(s,0x28,0,jit_vecVar(&vs,bind[x].var)->home);
+      x64_op0f(s,0x66,0,0x11,0,X64_RAX,1,0); // movupd [rax], xmm0
+    }
+    x64_op(s,1,0x83,0,X64_RSP,1,JIT_VSLOT(JIT_VSLOT_OFFS)); jit_emit(s,16); // add qword [offs], 16
+    x64_op(s,1,0xff,1,X64_RSP,1,JIT_VSLOT(JIT_VSLOT_COUNT)); // dec qword [count]
+    x64_jumpback(s,X64_JNZ,top);
+
+    // variables end up with the values of the last point
+    for (x = 0; x < vs.nvars; x ++)
+    {
+      if (!(vs.vars[x].flags&(JIT_VAR_WRITTEN|JIT_VAR_INPUT))) continue;
+      x64_pd_vslot(s,0x28,0,vs.vars[x].home);
+      x64_pd(s,0x15,0,0); // unpckhpd
+      x64_movimm(s,X64_RAX,(INT_PTR)vs.vars[x].addr);
+      x64_movsd_store(s,0,X64_RAX,0);
+    }
+
+    frame=JIT_VSLOT(s->maxslots)+8;
+    x64_op(s,1,0x81,0,X64_RSP,0,0); jit_emit32(s,frame); // add rsp, frame
+    jit_emit(s,0xc3);
+
+    x64_op(&ps,1,0x81,5,X64_RSP,0,0); jit_emit32(&ps,frame); // sub rsp, frame
+    x64_op(&ps,1,0x89,jit_argregs[0],X64_RSP,1,JIT_VSLOT(JIT_VSLOT_VARS));
+    x64_op(&ps,1,0x89,jit_argregs[1],X64_RSP,1,JIT_VSLOT(JIT_VSLOT_COUNT));
+    jit_vecSetSlot(&ps,JIT_VSLOT_OFFS,0);
+    jit_vecSetSlot(&ps,JIT_VSLOT_ABSMASK,(INT_PTR)0x7FFFFFFFFFFFFFFFull);
+    jit_vecSetSlot(&ps,JIT_VSLOT_SIGNMASK,(INT_PTR)0x8000000000000000ull);
+    jit_vecSetSlot(&ps,JIT_VSLOT_ONE,(INT_PTR)0x3FF0000000000000ull);
+    jit_vecSetSlot(&ps,JIT_VSLOT_NORMMIN,(INT_PTR)0x0010000000000000ull);
+    jit_vecSetSlot(&ps,JIT_VSLOT_NORMMAX,(INT_PTR)0x7FEFFFFFFFFFFFFFull);
+    {
+      INT_PTR v;
+      memcpy(&v,&g_closefact,sizeof(v));
+      jit_vecSetSlot(&ps,JIT_VSLOT_CLOSEFACT,v);
+    }
+    for (x = 0; x < vs.nvars; x ++) // broadcast the current values
+    {
+      x64_movimm(&ps,X64_RAX,(INT_PTR)vs.vars[x].addr);
+      x64_op(&ps,1,0x8b,X64_RAX,X64_RAX,1,0);
+      x64_op(&ps,1,0x89,X64_RAX,X64_RSP,1,JIT_VSLOT(vs.vars[x].home));
+      x64_op(&ps,1,0x89,X64_RAX,X64_RSP,1,JIT_VSLOT(vs.vars[x].home)+8);
+    }
+    for (x = 0; x < nbind; x ++)
+    {
+      if (!bind[x].in || bind[x].in_stride) continue;
+      x64_op(&ps,1,0x8b,X64_RAX,X64_RSP,1,JIT_VSLOT(JIT_VSLOT_VARS));
+      x64_op(&ps,1,0x8b,X64_RAX,X64_RAX,1,JIT_BATCHVAR_OFFS(x,in));
+      x64_op(&ps,1,0x8b,X64_RAX,X64_RAX,1,0);
+      x64_op(&ps,1,0x89,X64_RAX,X64_RSP,1,JIT_VSLOT(cslot[x]));
+      x64_op(&ps,1,0x89,X64_RAX,X64_RSP,1,JIT_VSLOT(cslot[x])+8);
+    }
+
+    if (!s->err && !ps.err)
+    {
+      char *b=(char *)__newBlock(&h->batch_blocks,ps.len+s->len+31);
+      if (b)
+      {
+        b+=(32-(((INT_PTR)b)&31))&31;
+        memcpy(b,ps.buf,ps.len);
+        memcpy(b+ps.len,s->buf,s->len);
+        code=b;
+      }
+    }
+  }
+
+  free(cslot);
+  free(vs.vars);
+  free(ps.buf);
+  free(s->buf);
+  return code;
+}
+
+// runs the largest even number of points in lanes, returns how many were done
+static int nseel_jit_execute_batch(codeHandleType *h, NSEEL_BATCHVAR *vars, int nvars, int n)
+{
+  int x;
+  if (n < 2 || !h->tree) return 0;
+
+  if (!h->batch_sig || h->batch_nsig != nvars) x=0;
+  else for (x = 0; x < nvars; x ++)
+  {
+    NSEEL_BATCHVAR *a=h->batch_sig+x, *b=vars+x;
+    if (a->var != b->var || !a->in != !b->in || a->in_stride != b->in_stride || !a->out != !b->out) break;
+  }
+  if (x != nvars || !h->batch_sig) // binding changed, regenerate
+  {
+    freeBlocks(&h->batch_blocks);
+    free(h->batch_sig);
+    h->batch_code=NULL;
+    h->batch_nsig=nvars;
+    h->batch_sig=(NSEEL_BATCHVAR *)malloc((nvars+1)*sizeof(NSEEL_BATCHVAR));
+    if (!h->batch_sig) return 0;
+    memcpy(h->batch_sig,vars,nvars*sizeof(NSEEL_BATCHVAR));
+    h->batch_code=nseel_jit_generateBatch(h,vars,nvars);
+  }
+  if (!h->batch_code) return 0;
+
+  ((void (*)(NSEEL_BATCHVAR *, INT_PTR))h->batch_code)(vars,n/2);
+  return n&~1;
+}
+
+// the batch analysis without generating anything: 1 unless every variable
+// is an input, never written, or assigned before it is first read
+static int nseel_jit_carriesState(codeHandleType *h, EEL_F **inputs, int ninputs)
+{
+  jitVecState vs;
+  startPtr *p;
+  int x, r=0;
+  if (!h->tree) return 1;
+
+  memset(&vs,0,sizeof(vs));
+  vs.h=h;
+  for (x = 0; x < ninputs && !r; x ++)
+  {
+    jitVecVar *v=jit_vecVar(&vs,inputs[x]);
+    if (!v) r=1;
+    else v->flags|=JIT_VAR_INPUT;
+  }
+  for (p=h->tree; p && !r; p=p->next)
+    if (!jit_vecCheck(&vs,(jitNode *)p->startptr,0)) r=1;
+  for (x = 0; x < vs.nvars && !r; x ++)
+    if ((vs.vars[x].flags&(JIT_VAR_READ|JIT_VAR_WRITTEN|JIT_VAR_INPUT)) == (JIT_VAR_READ|JIT_VAR_WRITTEN)) r=1;
+  free(vs.vars);
+  return r;
+}
+
+
+//---------------------------------------------------------------------------------------------------------------
+// code cache (NSEEL_code_compile_cached): compiled code is kept with its
+// relocations, keyed by the normalized source and the variables the VM had
+// when it was compiled. compiling the same source in a VM with the same
+// variables (in the same order) registers the variables the code added and
+// patches a copy of the code, without parsing or generating anything. entries
+// are reference counted by their handles; up to g_cache_max entries that are
+// no longer in use are kept, least recently used go first.
+
+#define JIT_CACHE_HASHSIZE 256
+
+static codeCacheEnt *g_cache_hash[JIT_CACHE_HASHSIZE];
+static codeCacheEnt *g_cache_lru, *g_cache_lru_tail;
+static int g_cache_max=128;
+static int g_cache_stats[4]; // hits, misses, entries, entries not in use
+
+#define JIT_VARNAME(ctx,i) ((ctx)->varTable_Names[(i)/NSEEL_VARS_PER_BLOCK]+((i)%NSEEL_VARS_PER_BLOCK)*NSEEL_MAX_VARIABLE_NAMELEN)
+#define JIT_VARADDR(ctx,i) ((ctx)->varTable_Values[(i)/NSEEL_VARS_PER_BLOCK]+((i)%NSEEL_VARS_PER_BLOCK))
+
+static unsigned int jit_hashStr(unsigned int h, const char *p, int len, int lower)
+{
+  while (len-- && *p)
+  {
+    int c=*(unsigned char *)p++;
+    if (lower) c=tolower(c);
+    h=(h^c)*16777619u;
+  }
+  return h;
+}
+
+// drops comments and collapses whitespace the way preprocessCode() would see it
+static char *jit_cacheNormalize(const char *src)
+{
+  char *buf=(char *)malloc(strlen(src)+1), *o=buf;
+  int sp=0;
+  if (!buf) return NULL;
+  while (*src)
+  {
+    if (src[0] == '/' && src[1] == '/')
+    {
+      while (*src && *src != '\n') src++;
+    }
+    else if (src[0] == '/' && src[1] == '*')
+    {
+      src+=2;
+      while (*src && (src[0] != '*' || src[1] != '/')) src++;
+      if (*src) src+=2;
+    }
+    else if (isspace(*(unsigned char *)src))
+    {
+      src++;
+      sp=1;
+    }
+    else
+    {
+      int n = (src[0] == '$' && src[1] == '\'' && src[2] && src[3] == '\'') ? 4 : 1; // $'c'
+      if (sp && o > buf) *o++=' ';
+      sp=0;
+      while (n--) *o++=*src++;
+    }
+  }
+  *o=0;
+  return buf;
+}
+
+static int jit_varIndex(compileContext *ctx, EEL_F *addr)
+{
+  int wb;
+  for (wb = 0; wb < ctx->varTable_numBlocks; wb ++)
+  {
+    if (addr >= ctx->varTable_Values[wb] && addr < ctx->varTable_Values[wb]+NSEEL_VARS_PER_BLOCK)
+    {
+      int i=wb*NSEEL_VARS_PER_BLOCK+(int)(addr-ctx->varTable_Values[wb]);
+      return i < ctx->varTable_numVars ? i : -1;
+    }
+  }
+  return -1;
+}
+
+// index into e->var_src of a variable, adding it. -1 if addr isn't one of ctx's variables (reg00 etc).
+static int jit_cacheVar(compileContext *ctx, codeCacheEnt *e, EEL_F *addr)
+{
+  int x, i;
+  for (x = 0; x < e->nvars; x ++) if (e->var_src[x] == addr) return x;
+  if ((i=jit_varIndex(ctx,addr)) < 0) return -1;
+  if (!(x&15))
+  {
+    EEL_F **ns=(EEL_F **)realloc(e->var_src,(x+16)*sizeof(EEL_F *));
+    int *ni;
+    if (!ns) return -2;
+    e->var_src=ns;
+    if (!(ni=(int *)realloc(e->var_index,(x+16)*sizeof(int)))) return -2;
+    e->var_index=ni;
+  }
+  e->var_src[x]=addr;
+  e->var_index[x]=i;
+  e->nvars++;
+  return x;
+}
+
+static int jit_countNodes(jitNode *n)
+{
+  int x, c=1;
+  for (x = 0; x < n->nparms; x ++) c+=jit_countNodes(n->parms[x]);
+  return c;
+}
+
+static jitNode *jit_copyTree(compileContext *ctx, codeCacheEnt *e, jitNode *n, jitNode **pool)
+{
+  jitNode *c=(*pool)++;
+  int x;
+  *c=*n;
+  if (n->op == JOP_VAR && jit_cacheVar(ctx,e,n->addr) == -2) e->dead=1;
+  for (x = 0; x < n->nparms; x ++) c->parms[x]=jit_copyTree(ctx,e,n->parms[x],pool);
+  return c;
+}
+
+static void jit_cacheFreeEnt(codeCacheEnt *e)
+{
+  free(e->text);
+  free(e->names);
+  free(e->var_index);
+  free(e->var_src);
+  free(e->reloc_pos);
+  free(e->reloc_ref);
+  free(e->code);
+  free(e->tree);
+  free(e);
+}
+
+static void jit_cacheUnlink(codeCacheEnt *e)
+{
+  codeCacheEnt **p=&g_cache_hash[e->hash%JIT_CACHE_HASHSIZE];
+  while (*p && *p != e) p=&(*p)->hnext;
+  if (*p) *p=e->hnext;
+  g_cache_stats[2]--;
+}
+
+static void jit_lruRemove(codeCacheEnt *e)
+{
+  if (e->lprev) e->lprev->lnext=e->lnext;
+  else g_cache_lru=e->lnext;
+  if (e->lnext) e->lnext->lprev=e->lprev;
+  else g_cache_lru_tail=e->lprev;
+  e->lprev=e->lnext=NULL;
+  g_cache_stats[3]--;
+}
+
+static void jit_cacheTrim(void)
+{
+  while (g_cache_lru_tail && g_cache_stats[3] > g_cache_max)
+  {
+    codeCacheEnt *e=g_cache_lru_tail;
+    jit_lruRemove(e);
+    jit_cacheUnlink(e);
+    jit_cacheFreeEnt(e);
+  }
+}
+
+// makes an entry from a freshly compiled handle, which then uses the entry's tree
+static void jit_cacheAdd(compileContext *ctx, codeHandleType *h, const char *text, unsigned int hash,
+                         int nbefore, jitReloc *relocs, int nrelocs)
+{
+  codeCacheEnt *e=(codeCacheEnt *)calloc(1,sizeof(codeCacheEnt));
+  startPtr *p;
+  jitNode *pool;
+  int x, nlist=0, nnodes=0;
+  if (!e) return;
+
+  e->hash=hash;
+  e->nbefore=nbefore;
+  e->nafter=ctx->varTable_numVars;
+  e->code_len=h->code_stats[1];
+  memcpy(e->code_stats,h->code_stats,sizeof(e->code_stats));
+  e->uses_globals=h->uses_globals;
+  e->uses_volatile=h->uses_volatile;
+  for (p=h->tree; p; p=p->next) { nlist++; nnodes+=jit_countNodes((jitNode *)p->startptr); }
+
+  e->text=strdup(text);
+  e->names=(char *)malloc(e->nafter*NSEEL_MAX_VARIABLE_NAMELEN+1);
+  e->code=(unsigned char *)malloc(e->code_len);
+  e->reloc_pos=(int *)malloc((nrelocs+1)*sizeof(int));
+  e->reloc_ref=(int *)malloc((nrelocs+1)*sizeof(int));
+  e->tree=(startPtr *)malloc(nlist*sizeof(startPtr)+nnodes*sizeof(jitNode));
+  if (!e->text || !e->names || !e->code || !e->reloc_pos || !e->reloc_ref || !e->tree)
+  {
+    jit_cacheFreeEnt(e);
+    return;
+  }
+
+  for (x = 0; x < e->nafter; x ++) memcpy(e->names+x*NSEEL_MAX_VARIABLE_NAMELEN,JIT_VARNAME(ctx,x),NSEEL_MAX_VARIABLE_NAMELEN);
+  memcpy(e->code,h->code,e->code_len);
+
+  pool=(jitNode *)(e->tree+nlist);
+  for (x = 0, p=h->tree; p; p=p->next, x ++)
+  {
+    e->tree[x].startptr=jit_copyTree(ctx,e,(jitNode *)p->startptr,&pool);
+    e->tree[x].next = p->next ? e->tree+x+1 : NULL;
+  }
+
+  for (x = 0; x < nrelocs && !e->dead; x ++)
+  {
+    int ref = relocs[x].fn >= 0 ? -1-relocs[x].fn : jit_cacheVar(ctx,e,relocs[x].addr);
+    if (ref == -2) e->dead=1;
+    else if (ref != -1 || relocs[x].fn >= 0) // reg00-reg99 don't depend on the VM
+    {
+      e->reloc_pos[e->nrelocs]=relocs[x].pos;
+      e->reloc_ref[e->nrelocs]=ref;
+      e->nrelocs++;
+    }
+  }
+  if (e->dead || !(h->vars=(EEL_F **)malloc((e->nvars+1)*sizeof(EEL_F *))))
+  {
+    jit_cacheFreeEnt(e);
+    return;
+  }
+  memcpy(h->vars,e->var_src,e->nvars*sizeof(EEL_F *));
+
+  freeBlocks(&h->tree_blocks);
+  h->tree=e->tree;
+  h->cache=e;
+  e->refs=1;
+  e->hnext=g_cache_hash[hash%JIT_CACHE_HASHSIZE];
+  g_cache_hash[hash%JIT_CACHE_HASHSIZE]=e;
+  g_cache_stats[2]++;
+}
+
+static int jit_cacheSameLayout(compileContext *ctx, codeCacheEnt *e)
+{
+  int x;
+  if (ctx->varTable_numVars != e->nbefore) return 0;
+  for (x = 0; x < e->nbefore; x ++)
+    if (strncasecmp(JIT_VARNAME(ctx,x),e->names+x*NSEEL_MAX_VARIABLE_NAMELEN,NSEEL_MAX_VARIABLE_NAMELEN)) return 0;
+  return 1;
+}
+
+// a handle for ctx running e's code
+static codeHandleType *jit_cacheInstantiate(compileContext *ctx, codeCacheEnt *e)
+{
+  llBlock *blocks=NULL;
+  codeHandleType *h;
+  unsigned char *code;
+  int x;
+
+  for (x = e->nbefore; x < e->nafter; x ++)
+  {
+    char name[NSEEL_MAX_VARIABLE_NAMELEN+1];
+    memcpy(name,e->names+x*NSEEL_MAX_VARIABLE_NAMELEN,NSEEL_MAX_VARIABLE_NAMELEN);
+    name[NSEEL_MAX_VARIABLE_NAMELEN]=0;
+    NSEEL_VM_regvar(ctx,name);
+  }
+  if (ctx->varTable_numVars != e->nafter) return NULL;
+
+  h=(codeHandleType *)__newBlock(&blocks,sizeof(codeHandleType));
+  code=(unsigned char *)__newBlock(&blocks,e->code_len+31);
+  code+=(32-(((INT_PTR)code)&31))&31;
+  memset(h,0,sizeof(codeHandleType));
+  h->blocks=blocks;
+  if (!(h->vars=(EEL_F **)malloc((e->nvars+1)*sizeof(EEL_F *))))
+  {
+    freeBlocks(&h->blocks);
+    return NULL;
+  }
+  for (x = 0; x < e->nvars; x ++) h->vars[x]=JIT_VARADDR(ctx,e->var_index[x]);
+
+  memcpy(code,e->code,e->code_len);
+  for (x = 0; x < e->nrelocs; x ++)
+  {
+    int ref=e->reloc_ref[x];
+    void *v = ref >= 0 ? (void *)h->vars[ref] : jit_pprocValue(ctx,nseel_getFunctionFromTable(-1-ref));
+    memcpy(code+e->reloc_pos[x],&v,sizeof(v));
+  }
+  h->code=code;
+  h->tree=e->tree;
+  h->cache=e;
+  memcpy(h->code_stats,e->code_stats,sizeof(h->code_stats));
+  h->uses_globals=e->uses_globals;
+  h->uses_volatile=e->uses_volatile;
+  nseel_evallib_stats[0]+=h->code_stats[0];
+  nseel_evallib_stats[1]+=h->code_stats[1];
+  nseel_evallib_stats[2]+=h->code_stats[2];
+  nseel_evallib_stats[3]+=h->code_stats[3];
+  nseel_evallib_stats[4]++;
+
+  if (!e->refs++) jit_lruRemove(e);
+  return h;
+}
+
+static NSEEL_CODEHANDLE nseel_jit_compileCached(compileContext *ctx, char *code, int lineoffs)
+{
+  codeHandleType *h=NULL;
+  codeCacheEnt *e;
+  unsigned int hash;
+  char *text;
+  int x;
+
+  if (!ctx || !code || !*code || !g_cache_max || !(text=jit_cacheNormalize(code)))
+    return NSEEL_code_compile(ctx,code,lineoffs);
+
+  NSEEL_HOSTSTUB_EnterMutex();
+  hash=jit_hashStr(2166136261u,text,-1,0);
+  for (x = 0; x < ctx->varTable_numVars; x ++)
+    hash=jit_hashStr(hash*31,JIT_VARNAME(ctx,x),NSEEL_MAX_VARIABLE_NAMELEN,1);
+
+  for (e=g_cache_hash[hash%JIT_CACHE_HASHSIZE]; e; e=e->hnext)
+    if (e->hash == hash && !strcmp(e->text,text) && jit_cacheSameLayout(ctx,e)) break;
+
+  if (e && (h=jit_cacheInstantiate(ctx,e)))
+  {
+    ctx->last_error_string[0]=0;
+    g_cache_stats[0]++;
+  }
+  else
+  {
+    jitReloc *relocs=NULL;
+    int nrelocs=0, nbefore=ctx->varTable_numVars;
+    g_cache_stats[1]++;
+    h=(codeHandleType *)nseel_code_compile(ctx,code,lineoffs,&relocs,&nrelocs);
+    if (h && relocs)
+    {
+      jit_cacheAdd(ctx,h,text,hash,nbefore,relocs,nrelocs);
+      jit_cacheTrim();
+    }
+    free(relocs);
+  }
+  NSEEL_HOSTSTUB_LeaveMutex();
+
+  free(text);
+  return (NSEEL_CODEHANDLE)h;
+}
+
+static void nseel_jit_cacheRelease(codeCacheEnt *e)
+{
+  NSEEL_HOSTSTUB_EnterMutex();
+  if (!--e->refs)
+  {
+    if (e->dead) jit_cacheFreeEnt(e);
+    else
+    {
+      e->lnext=g_cache_lru;
+      if (g_cache_lru) g_cache_lru->lprev=e;
+      else g_cache_lru_tail=e;
+      g_cache_lru=e;
+      g_cache_stats[3]++;
+      jit_cacheTrim();
+    }
+  }
+  NSEEL_HOSTSTUB_LeaveMutex();
+}
+
+// forgets all entries. ones still in use are freed with their last handle.
+static void nseel_jit_cacheFlush(void)
+{
+  int x;
+  for (x = 0; x < JIT_CACHE_HASHSIZE; x ++)
+  {
+    while (g_cache_hash[x])
+    {
+      codeCacheEnt *e=g_cache_hash[x];
+      jit_cacheUnlink(e);
+      if (e->refs) e->dead=1;
+      else
+      {
+        jit_lruRemove(e);
+        jit_cacheFreeEnt(e);
+      }
+    }
+  }
+}
@@ -36,6 +36,8 @@ unsigned int NSEEL_RAM_limitmem=0;
 unsigned int NSEEL_RAM_memused=0;
 int NSEEL_RAM_memused_errors=0;
 
+static EEL_F * volatile nseel_gmembuf; // the shared gmem, for VMs without a GRAM context
+
 
 
 int NSEEL_VM_wantfreeRAM(NSEEL_VMCTX ctx)
@@ -94,19 +96,24 @@ void NSEEL_VM_freeRAMIfCodeRequested(NSEEL_VMCTX ctx) // check to see if our fre
 
 EEL_F * NSEEL_CGEN_CALL __NSEEL_RAMAllocGMEM(EEL_F ***blocks, int w)
 {
-  static EEL_F * volatile  gmembuf;
   if (blocks) return __NSEEL_RAMAlloc(blocks,w);
 
-  if (!gmembuf)
+  if (!nseel_gmembuf)
   {
     NSEEL_HOSTSTUB_EnterMutex(); 
-    if (!gmembuf) gmembuf=(EEL_F*)calloc(sizeof(EEL_F),NSEEL_SHARED_GRAM_SIZE);
+    if (!nseel_gmembuf) nseel_gmembuf=(EEL_F*)calloc(sizeof(EEL_F),NSEEL_SHARED_GRAM_SIZE);
     NSEEL_HOSTSTUB_LeaveMutex();
 
-    if (!gmembuf) return 0;
+    if (!nseel_gmembuf) return 0;
   }
 
-  return gmembuf+(((unsigned int)w)&((NSEEL_SHARED_GRAM_SIZE)-1));
+  return nseel_gmembuf+(((unsigned int)w)&((NSEEL_SHARED_GRAM_SIZE)-1));
+}
+
+void NSEEL_resetglobals()
+{
+  memset(nseel_globalregs,0,sizeof(nseel_globalregs));
+  if (nseel_gmembuf) memset(nseel_gmembuf,0,sizeof(EEL_F)*NSEEL_SHARED_GRAM_SIZE);
 }
 
 EEL_F * NSEEL_CGEN_CALL  __NSEEL_RAMAlloc(EEL_F ***blocks, int w)
@@ -279,6 +286,7 @@ void NSEEL_VM_freeRAM(NSEEL_VMCTX ctx)
     if (c->ram_blocks)
     {
       EEL_F **blocks = (EEL_F **)c->ram_blocks;
+      NSEEL_HOSTSTUB_EnterMutex(); // NSEEL_RAM_memused is shared with other VMs' code
       for (x = 0; x < NSEEL_RAM_BLOCKS; x ++)
       {
 	      if (blocks[x])
@@ -290,6 +298,7 @@ void NSEEL_VM_freeRAM(NSEEL_VMCTX ctx)
         free(blocks[x]);
         blocks[x]=0;
       }
+      NSEEL_HOSTSTUB_LeaveMutex();
       free(blocks);
       c->ram_blocks=0;
     }
@@ -1094,6 +1094,7 @@ void CPlugin::MyPreInitialize()
 	m_verts					= NULL;
 	m_verts_temp            = NULL;
 	m_vertinfo				= NULL;
+	m_pv_batch				= NULL;
 	m_indices_list			= NULL;
 	m_indices_strip			= NULL;
 
@@ -2257,9 +2258,10 @@ int CPlugin::AllocateMyDX9Stuff()
 	m_verts      = new MYVERTEX[(m_nGridX+1)*(m_nGridY+1)];
 	m_verts_temp = new MYVERTEX[(m_nGridX+2) * 4];
 	m_vertinfo   = new td_vertinfo[(m_nGridX+1)*(m_nGridY+1)];
+	m_pv_batch   = new double[PV_NBUF*(m_nGridX+1)*(m_nGridY+1)];
 	m_indices_strip = new int[(m_nGridX+2)*(m_nGridY*2)];
 	m_indices_list  = new int[m_nGridX*m_nGridY*6];
-	if (!m_verts || !m_vertinfo)
+	if (!m_verts || !m_vertinfo || !m_pv_batch)
 	{
 		swprintf(buf, L"couldn't allocate mesh - out of memory");
 		dumpmsg(buf); 
@@ -2293,6 +2295,13 @@ int CPlugin::AllocateMyDX9Stuff()
             m_verts[nVert].tu_orig =  m_verts[nVert].x*0.5f + 0.5f + texel_offset_x;
             m_verts[nVert].tv_orig = -m_verts[nVert].y*0.5f + 0.5f + texel_offset_y;
 
+            // per-vertex equation inputs
+            int nv = (m_nGridX+1)*(m_nGridY+1);
+            m_pv_batch[PV_X*nv + nVert]   = (double)(m_verts[nVert].x* 0.5f*m_fAspectX + 0.5f);
+            m_pv_batch[PV_Y*nv + nVert]   = (double)(m_verts[nVert].y*-0.5f*m_fAspectY + 0.5f);
+            m_pv_batch[PV_RAD*nv + nVert] = (double)m_vertinfo[nVert].rad;
+            m_pv_batch[PV_ANG*nv + nVert] = (double)m_vertinfo[nVert].ang;
+
 			nVert++;
 		}
 	}
@@ -3867,6 +3876,12 @@ void CPlugin::CleanUpMyDX9Stuff(int final_cleanup)
 		m_vertinfo = NULL;
 	}
 
+	if (m_pv_batch != NULL)
+	{
+		delete [] m_pv_batch;
+		m_pv_batch = NULL;
+	}
+
 	if (m_indices_list != NULL)
 	{
 		delete m_indices_list;
@@ -165,6 +165,10 @@ SOURCE=.\textmgr.h
 # PROP Default_Filter ""
 # Begin Source File
 
+SOURCE=.\compilebench.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\config.cpp
 # End Source File
 # Begin Source File
@@ -48,6 +48,7 @@ extern "C" int (*warand)(void);
 typedef enum { TEX_DISK, TEX_VS, TEX_BLUR0, TEX_BLUR1, TEX_BLUR2, TEX_BLUR3, TEX_BLUR4, TEX_BLUR5, TEX_BLUR6, TEX_BLUR_LAST } tex_code;
 typedef enum { UI_REGULAR, UI_MENU, UI_LOAD, UI_LOAD_DEL, UI_LOAD_RENAME, UI_SAVEAS, UI_SAVE_OVERWRITE, UI_EDIT_MENU_STRING, UI_CHANGEDIR, UI_IMPORT_WAVE, UI_EXPORT_WAVE, UI_IMPORT_SHAPE, UI_EXPORT_SHAPE, UI_UPGRADE_PIXEL_SHADER, UI_MASHUP } ui_mode;
 typedef struct { float rad; float ang; float a; float c;  } td_vertinfo; // blending: mix = max(0,min(1,a*t + c));
+typedef enum { PV_X, PV_Y, PV_RAD, PV_ANG, PV_ZOOM, PV_ZOOMEXP, PV_ROT, PV_WARP, PV_CX, PV_CY, PV_DX, PV_DY, PV_SX, PV_SY, PV_NBUF } pv_batch_array;
 typedef char* CHARPTR;
 LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam);
 
@@ -549,6 +550,7 @@ public:
         MYVERTEX          *m_verts;
         MYVERTEX          *m_verts_temp;
         td_vertinfo       *m_vertinfo;
+        double            *m_pv_batch;      // PV_NBUF arrays of per-vertex inputs/outputs for NSEEL_code_execute_batch()
         int               *m_indices_strip;
         int               *m_indices_list;
 